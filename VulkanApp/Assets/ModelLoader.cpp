@@ -169,6 +169,8 @@ std::vector<std::unique_ptr<Mesh>> ModelLoader::loadModelFromFile(const std::str
 			case MaterialLoadingMode::LOAD_MATERIALS_UNLIT:
 				mesh->material = loadUnlitMaterial(aiMaterial, file);
 				break;
+			case MaterialLoadingMode::LOAD_MATERIALS_NONE:
+				break;
 			default:
 				throw std::runtime_error("Unsupported material loading mode!");
 				break;
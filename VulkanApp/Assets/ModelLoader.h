@@ -11,7 +11,8 @@
 
 enum class MaterialLoadingMode {
 	LOAD_MATERIALS_PBR,
-	LOAD_MATERIALS_UNLIT
+	LOAD_MATERIALS_UNLIT,
+	LOAD_MATERIALS_NONE		// Only the geometry, e.g. for authored LODs that use the materials of the base meshes
 };
 
 class ModelLoader
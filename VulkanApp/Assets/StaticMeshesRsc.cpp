@@ -1,15 +1,156 @@
 #include "StaticMeshesRsc.h"
 #include "ModelLoader.h"
+#include "../Graphics/MeshSimplifier.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
 
-void StaticMeshesRsc::loadFromFile(const std::string& path, MaterialLoadingMode loadingMode)
+void StaticMeshesRsc::loadFromFile(const std::string& path, MaterialLoadingMode loadingMode, bool precisePicking, bool hlodSource)
 {
 	this->meshes = ModelLoader::loadModelFromFile(path, loadingMode);
+	m_triangleBVH.reset();
+	m_hlodSource.clear();
+	m_lodScreenSizes.clear();
+	if (precisePicking) {
+		this->buildTriangleBVH();
+	}
+	if (hlodSource) {
+		this->buildHLODSource();
+	}
+}
+
+void StaticMeshesRsc::buildTriangleBVH()
+{
+	m_triangleBVH = std::make_unique<TriangleBVH>();
+	for (size_t i = 0; i < meshes.size(); i++) {
+		m_triangleBVH->addMesh(meshes[i]->vertices, meshes[i]->indices, static_cast<uint32_t>(i));
+	}
+	m_triangleBVH->build();
+}
+
+void StaticMeshesRsc::buildHLODSource()
+{
+	m_hlodSource.clear();
+	m_hlodSource.reserve(meshes.size());
+	for (const auto& mesh : meshes) {
+		HLODSourceMesh source;
+		source.positions.reserve(mesh->vertices.size());
+		source.normals.reserve(mesh->vertices.size());
+		for (const auto& vertex : mesh->vertices) {
+			source.positions.push_back(vertex.pos);
+			source.normals.push_back(vertex.normal);
+		}
+		source.indices = mesh->indices;
+		if (mesh->material) {
+			source.baseColor = mesh->material->getBaseColor();
+		}
+		m_hlodSource.push_back(std::move(source));
+	}
+}
+
+void StaticMeshesRsc::generateLODs(const std::vector<float>& ratios, const std::vector<float>& screenSizes, float maxError)
+{
+	if (ratios.size() != screenSizes.size()) {
+		throw std::runtime_error("failed to generate lods: ratio count doesn't match the screen size count!");
+	}
+	for (size_t i = 0; i < ratios.size(); i++) {
+		if (!(ratios[i] > 0.0f && ratios[i] < 1.0f) || (i > 0 && ratios[i] >= ratios[i - 1])) {
+			throw std::runtime_error("failed to generate lods: ratios must be decreasing and between 0 and 1!");
+		}
+	}
+
+	// The LODs are appended, so authored and generated LODs can be mixed as long as they get coarser
+	for (size_t i = 0; i < ratios.size(); i++) {
+		if (!m_lodScreenSizes.empty() && screenSizes[i] >= m_lodScreenSizes.back()) {
+			throw std::runtime_error("failed to generate lods: screen sizes must be decreasing!");
+		}
+		for (const auto& mesh : meshes) {
+			// Each LOD simplifies the previous one, that is cheaper and keeps the LODs consistent
+			const std::vector<uint32_t>& source = mesh->lods.empty() || !mesh->lods.back().vertices.empty() ? mesh->indices : mesh->lods.back().indices;
+			size_t target = static_cast<size_t>(mesh->indices.size() / 3 * ratios[i]) * 3;
+			MeshLOD lod;
+			lod.indices = MeshSimplifier::simplify(mesh->vertices, source, target, maxError);
+
+			// Borders, the error limit or collapses that would flip triangles can stop the simplification early
+			if (lod.indices.size() > target && !mesh->indices.empty()) {
+				std::cout << "[LOD]: LOD " << mesh->lods.size() + 1 << " reached a ratio of "
+					<< static_cast<float>(lod.indices.size()) / mesh->indices.size() << " instead of " << ratios[i] << std::endl;
+			}
+			mesh->lods.push_back(std::move(lod));
+		}
+		m_lodScreenSizes.push_back(screenSizes[i]);
+	}
+}
+
+void StaticMeshesRsc::loadLODFromFile(const std::string& path, float screenSize)
+{
+	if (!m_lodScreenSizes.empty() && screenSize >= m_lodScreenSizes.back()) {
+		throw std::runtime_error("failed to load lod: screen sizes must be decreasing!");
+	}
+	auto lodMeshes = ModelLoader::loadModelFromFile(path, MaterialLoadingMode::LOAD_MATERIALS_NONE);
+	if (lodMeshes.size() != meshes.size()) {
+		throw std::runtime_error("failed to load lod: mesh count doesn't match the base meshes!");
+	}
+	for (size_t i = 0; i < meshes.size(); i++) {
+		MeshLOD lod;
+		lod.vertices = std::move(lodMeshes[i]->vertices);
+		lod.indices = std::move(lodMeshes[i]->indices);
+		meshes[i]->lods.push_back(std::move(lod));
+	}
+	m_lodScreenSizes.push_back(screenSize);
+}
+
+void StaticMeshesRsc::buildMeshlets(size_t maxVertices, size_t maxTriangles)
+{
+	// The LODs index the vertices, not the triangles, so reordering the triangles of the base meshes keeps them valid
+	for (auto& mesh : meshes) {
+		mesh->meshlets.clear();
+		if (mesh->indices.size() / 3 <= maxTriangles) {
+			continue;
+		}
+		mesh->meshlets = MeshletBuilder::build(mesh->vertices, mesh->indices, maxVertices, maxTriangles);
+	}
+
+	// Hits store the triangle index, it changed with the order of the triangles
+	if (m_triangleBVH) {
+		this->buildTriangleBVH();
+	}
+}
+
+int StaticMeshesRsc::selectLOD(float screenSize, int currentLOD) const
+{
+	int lod = std::clamp(currentLOD, 0, static_cast<int>(m_lodScreenSizes.size()));
+
+	// Switch to coarser LODs right at their screen size, back to finer LODs only beyond the hysteresis
+	while (lod < static_cast<int>(m_lodScreenSizes.size()) && screenSize < m_lodScreenSizes[lod]) {
+		lod++;
+	}
+	while (lod > 0 && screenSize > m_lodScreenSizes[lod - 1] * (1.0f + this->lodHysteresis)) {
+		lod--;
+	}
+	return lod;
+}
+
+float StaticMeshesRsc::getScreenSize(const glm::vec3& center, float radius, const UboViewProjection& viewProjection)
+{
+	// projection[1][1] is the cotangent of half the vertical field of view
+	float distance = glm::length(center - viewProjection.cameraPos);
+	if (distance <= radius) {
+		return FLT_MAX;
+	}
+	return radius * std::abs(viewProjection.projection[1][1]) / distance;
 }
 
 void StaticMeshesRsc::init(Renderer* renderer)
 {
+	m_bounds = AABB();
+	for (const auto& mesh : meshes) {
+		for (const auto& vertex : mesh->vertices) {
+			m_bounds.expand(vertex.pos);
+		}
+	}
 	for (const auto& mesh : meshes) {
-		mesh->init(renderer);
+		mesh->init(renderer, this->keepMeshData);
 	}
 }
 
@@ -3,18 +3,148 @@
 #include "AssetRessource.h"
 #include "../Graphics/Renderer.h"
 #include "../Graphics/Mesh.h"
+#include "../Math/TriangleBVH.h"
+#include "../Graphics/HLODBuilder.h"
+#include "../Math/AABB.h"
+#include <cfloat>
+#include <memory>
 #include <vector>
 class StaticMeshesRsc :
     public AssetRessource
 {
+private:
+	/// <summary>
+	/// Triangle BVH over all meshes for precise raycasts, shared by all models using this resource
+	/// </summary>
+	std::unique_ptr<TriangleBVH> m_triangleBVH;
+
+	/// <summary>
+	/// CPU copy of the meshes for baking HLOD proxies, the mesh data itself is freed on init
+	/// </summary>
+	std::vector<HLODSourceMesh> m_hlodSource;
+
+	/// <summary>
+	/// Screen size below which each coarser LOD is used, m_lodScreenSizes[0] switches from LOD 0 to LOD 1
+	/// </summary>
+	std::vector<float> m_lodScreenSizes;
+
+	/// <summary>
+	/// Local bounds of all meshes, computed on init before the mesh data is freed
+	/// </summary>
+	AABB m_bounds;
 
 public:
 	std::vector<std::unique_ptr<Mesh>> meshes;
 
+	/// <summary>
+	/// Relative margin around the LOD screen sizes, a model switches back to the finer LOD only once it is that much
+	/// larger than the screen size it switched at, so models near a threshold don't flicker between LODs
+	/// </summary>
+	float lodHysteresis = 0.1f;
+
+	/// <summary>
+	/// Keeps the vertices and indices of the meshes after init, scenes only merge the static models of resources keeping them
+	/// </summary>
+	bool keepMeshData = false;
+
 	StaticMeshesRsc() = default;
 	~StaticMeshesRsc() = default;
 
-	void loadFromFile(const std::string& path, MaterialLoadingMode loadingMode = MaterialLoadingMode::LOAD_MATERIALS_PBR);
+	/// <summary>
+	/// Loads the meshes from a model file
+	/// </summary>
+	/// <param name="path"></param>
+	/// <param name="loadingMode"></param>
+	/// <param name="precisePicking">Builds the triangle BVH so models of this resource are raycast per triangle</param>
+	/// <param name="hlodSource">Keeps a copy of the meshes so chunked scenes can bake HLOD proxies of models of this resource</param>
+	void loadFromFile(const std::string& path, MaterialLoadingMode loadingMode = MaterialLoadingMode::LOAD_MATERIALS_PBR, bool precisePicking = false, bool hlodSource = false);
+
+	/// <summary>
+	/// Builds the triangle BVH over the vertices and indices of all meshes
+	/// Call it again after changing the meshes, the mesh index of a hit is the index in meshes.
+	/// </summary>
+	void buildTriangleBVH();
+
+	/// <summary>
+	/// Returns the triangle BVH of the resource
+	/// </summary>
+	/// <returns>nullptr if precise picking is not enabled for this resource</returns>
+	const TriangleBVH* getTriangleBVH() const {
+		return m_triangleBVH.get();
+	}
+
+	/// <summary>
+	/// Copies the positions, normals and indices of all meshes together with the base colors of their materials
+	/// Has to be called before init, which frees the mesh data and the textures.
+	/// </summary>
+	void buildHLODSource();
+
+	/// <summary>
+	/// Returns the HLOD source meshes of the resource
+	/// </summary>
+	/// <returns>Empty if the HLOD source was not built</returns>
+	const std::vector<HLODSourceMesh>& getHLODSource() const {
+		return m_hlodSource;
+	}
+
+	/// <summary>
+	/// Generates coarser LODs of all meshes by quadric edge collapse, the LODs draw the vertices of the base meshes
+	/// Has to be called before init, which frees the mesh data.
+	/// </summary>
+	/// <param name="ratios">Triangle ratio of each LOD relative to the base meshes, decreasing</param>
+	/// <param name="screenSizes">Screen size below which each LOD is used, decreasing</param>
+	/// <param name="maxError">Largest simplification error relative to the mesh size, a LOD stays finer than its ratio rather than exceeding it</param>
+	void generateLODs(const std::vector<float>& ratios, const std::vector<float>& screenSizes, float maxError = FLT_MAX);
+
+	/// <summary>
+	/// Loads an authored LOD from a model file with the same meshes in the same order
+	/// The LOD is drawn with the materials of the base meshes. Has to be called before init.
+	/// </summary>
+	/// <param name="path"></param>
+	/// <param name="screenSize">Screen size below which the LOD is used, smaller than the screen size of the previous LOD</param>
+	void loadLODFromFile(const std::string& path, float screenSize);
+
+	/// <summary>
+	/// Splits the base meshes into meshlets and reorders their triangles, meshes fitting into one meshlet are kept whole
+	/// Has to be called before init, which frees the mesh data. Rebuilds the triangle BVH if it was built.
+	/// </summary>
+	/// <param name="maxVertices">Largest number of distinct vertices in a meshlet</param>
+	/// <param name="maxTriangles">Largest number of triangles in a meshlet</param>
+	void buildMeshlets(size_t maxVertices = 64, size_t maxTriangles = 124);
+
+	/// <summary>
+	/// Returns the number of LODs including the base meshes
+	/// </summary>
+	/// <returns></returns>
+	int getLODCount() const {
+		return static_cast<int>(m_lodScreenSizes.size()) + 1;
+	}
+
+	/// <summary>
+	/// Selects the LOD for a screen size, the current LOD is kept within the hysteresis
+	/// </summary>
+	/// <param name="screenSize">Projected size of the bounding sphere, see getScreenSize</param>
+	/// <param name="currentLOD">The LOD used last frame</param>
+	/// <returns></returns>
+	int selectLOD(float screenSize, int currentLOD) const;
+
+	/// <summary>
+	/// Returns the local bounds of all meshes
+	/// </summary>
+	/// <returns>An invalid AABB before init</returns>
+	const AABB& getBounds() const {
+		return m_bounds;
+	}
+
+	/// <summary>
+	/// Projected diameter of a bounding sphere as a fraction of the viewport height
+	/// </summary>
+	/// <param name="center"></param>
+	/// <param name="radius"></param>
+	/// <param name="viewProjection"></param>
+	/// <returns></returns>
+	static float getScreenSize(const glm::vec3& center, float radius, const UboViewProjection& viewProjection);
+
 	void init(Renderer* renderer) override;
 	void dispose(Renderer* renderer) override;
 };
@@ -0,0 +1,103 @@
+#include "RaycastBenchmark.h"
+#include "../Core/Scene3D.h"
+#include "../Core/PrimitiveEntity.h"
+#include "../Math/RayPacket.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace {
+	/// <summary>
+	/// Times a function and returns the elapsed milliseconds
+	/// </summary>
+	template<typename Fn>
+	double measureMs(Fn&& fn) {
+		auto start = std::chrono::high_resolution_clock::now();
+		fn();
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+		return elapsed.count();
+	}
+
+	/// <summary>
+	/// Whether two hits are the same, boxes hit at the same distance count as the same hit
+	/// </summary>
+	bool sameHit(const RayHit& a, const RayHit& b) {
+		if (a.hit != b.hit) {
+			return false;
+		}
+		if (!a.hit || a.hitobject == b.hitobject) {
+			return true;
+		}
+		return std::abs(a.distance - b.distance) <= 1e-4f * std::max(1.0f, a.distance);
+	}
+}
+
+RaycastBenchmarkResult RaycastBenchmark::run(size_t boxCount, size_t resolution, int iterations, uint32_t seed)
+{
+	RaycastBenchmarkResult result;
+	result.boxCount = boxCount;
+	result.rayCount = resolution * resolution;
+	result.packetSize = RAY_PACKET_SIZE;
+
+	// Random cubes in a 200 units wide volume, the update syncs them into the BVH without a renderer
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> scale(0.5f, 3.0f);
+	Scene3D scene;
+	for (size_t i = 0; i < boxCount; i++) {
+		auto cube = scene.addEntity<PrimitiveEntity>(std::make_unique<PrimitiveEntity>("Box" + std::to_string(i), PrimitiveType::PRIMITIVE_TYPE_CUBE));
+		cube->createAABB();
+		cube->setPosition(glm::vec3(position(rng), position(rng), position(rng)));
+		cube->setScale(glm::vec3(scale(rng), scale(rng), scale(rng)));
+	}
+	scene.update(0.0f);
+	scene.rebuildSpatialIndex();
+
+	// Coherent camera rays with a 60 degree field of view, neighbouring rays share most BVH nodes like picking or visibility rays do
+	std::vector<Ray> rays(result.rayCount);
+	float tanHalfFov = std::tan(glm::radians(30.0f));
+	for (size_t y = 0; y < resolution; y++) {
+		for (size_t x = 0; x < resolution; x++) {
+			float u = ((static_cast<float>(x) + 0.5f) / static_cast<float>(resolution)) * 2.0f - 1.0f;
+			float v = ((static_cast<float>(y) + 0.5f) / static_cast<float>(resolution)) * 2.0f - 1.0f;
+			Ray& ray = rays[y * resolution + x];
+			ray.origin = glm::vec3(0.0f, 0.0f, -150.0f);
+			ray.direction = glm::normalize(glm::vec3(u * tanHalfFov, v * tanHalfFov, 1.0f));
+		}
+	}
+
+	std::vector<RayHit> scalarHits(result.rayCount);
+	std::vector<RayHit> batchHits(result.rayCount);
+	result.scalarMs = std::numeric_limits<double>::max();
+	result.batchMs = std::numeric_limits<double>::max();
+	for (int i = 0; i < std::max(1, iterations); i++) {
+		result.scalarMs = std::min(result.scalarMs, measureMs([&]() {
+			for (size_t ray = 0; ray < rays.size(); ray++) {
+				scalarHits[ray] = scene.raycast(rays[ray]);
+			}
+		}));
+		result.batchMs = std::min(result.batchMs, measureMs([&]() {
+			scene.raycastBatch(rays, batchHits);
+		}));
+	}
+
+	for (size_t ray = 0; ray < rays.size(); ray++) {
+		if (scalarHits[ray].hit) {
+			result.hitCount++;
+		}
+		if (!sameHit(scalarHits[ray], batchHits[ray])) {
+			result.mismatchCount++;
+		}
+	}
+
+	std::cout << "[RAYCAST BENCHMARK] " << result.boxCount << " boxes, " << result.rayCount << " rays, " << result.hitCount << " hits." << std::endl;
+	std::cout << "[RAYCAST BENCHMARK] Scalar: " << result.scalarMs << " ms, batch with " << result.packetSize << " ray packets: " << result.batchMs << " ms." << std::endl;
+	if (result.mismatchCount > 0) {
+		std::cout << "[RAYCAST BENCHMARK] " << result.mismatchCount << " batched hits differ from the scalar hits!" << std::endl;
+	}
+	return result;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/// <summary>
+/// Results of a raycast benchmark run
+/// </summary>
+struct RaycastBenchmarkResult
+{
+	size_t boxCount = 0;
+	size_t rayCount = 0;
+	int packetSize = 0;			// RAY_PACKET_SIZE the batch was compiled with
+	double scalarMs = 0.0;		// Best time of Scene::raycast over all rays
+	double batchMs = 0.0;		// Best time of Scene::raycastBatch over all rays
+	size_t hitCount = 0;		// Rays that hit a box in the scalar run
+	size_t mismatchCount = 0;	// Rays whose batched hit differs from the scalar hit
+};
+
+/// <summary>
+/// Static class comparing single raycasts against batched packet raycasts
+/// Fills a Scene3D with randomly placed cubes, builds its BVH without a renderer and casts a grid of
+/// coherent camera rays through it, once per ray with Scene::raycast and once with Scene::raycastBatch.
+/// The same seed always generates the same scene and rays, so runs can be compared across builds.
+/// </summary>
+class RaycastBenchmark
+{
+public:
+	/// <summary>
+	/// Runs the benchmark and prints the timings and the hit comparison
+	/// </summary>
+	/// <param name="boxCount">Number of cubes in the scene</param>
+	/// <param name="resolution">The rays form a resolution x resolution grid</param>
+	/// <param name="iterations">Each path runs this often, the best time is reported</param>
+	/// <param name="seed">Seed of the random scene</param>
+	/// <returns></returns>
+	static RaycastBenchmarkResult run(size_t boxCount = 20000, size_t resolution = 512, int iterations = 5, uint32_t seed = 1337);
+};
@@ -1,24 +1,12 @@
 #include "FrustumCullingBhv.h"
 #include "../Core/Entity.h"
+#include "../Core/Scene.h"
 
-bool FrustumCullingBhv::isDirty(Transform& transform)
-{
-	if(transform.position != m_lastParentPosition ||
-		transform.rotation != m_lastParentRotation ||
-		transform.scale != m_lastParentScale)
-	{
-		m_lastParentPosition = transform.position;
-		m_lastParentRotation = transform.rotation;
-		m_lastParentScale = transform.scale;
-		return true;
-	}
-	return false;
-}
-
-FrustumCullingBhv::FrustumCullingBhv(Camera* camera, CullingMode mode)
+FrustumCullingBhv::FrustumCullingBhv(Camera* camera, CullingMode mode, bool occlusionCulling)
 {
 	m_camera = camera;
 	m_cullingMode = mode;
+	m_occlusionCulling = occlusionCulling;
 }
 
 void FrustumCullingBhv::init(Scene* scene, Renderer* renderer)
@@ -28,12 +16,25 @@ void FrustumCullingBhv::init(Scene* scene, Renderer* renderer)
 
 void FrustumCullingBhv::update(Scene* scene, float dt)
 {
-	// Get the AABB if the transform is dirty
-	if (isDirty(this->parent->transform))
+	// Skip the test if the scene already culled the group of the entity as a whole
+	switch (scene->getCullingHint(this->parent, m_camera))
 	{
-		m_aabb = this->parent->getAABB(true);
+	case FrustumTestResult::FRUSTUM_TEST_INSIDE:
+		this->parent->addState(EntityState::ENTITY_STATE_VISIBLE);
+		if (m_occlusionCulling) {
+			this->cullOccluded(scene, this->parent->getAABB(true));
+		}
+		return;
+	case FrustumTestResult::FRUSTUM_TEST_OUTSIDE:
+		this->parent->removeState(EntityState::ENTITY_STATE_VISIBLE);
+		return;
+	default:
+		break;
 	}
 
+	// The entity caches its world AABB and only rebuilds it if the transform changed
+	AABB aabb = this->parent->getAABB(true);
+
 	// Perform frustum culling
 	auto frustum = m_camera->getFrustum();
 	float radius;
@@ -41,8 +42,8 @@ void FrustumCullingBhv::update(Scene* scene, float dt)
 	switch (m_cullingMode)
 	{
 	case CullingMode::AABB_CULLING:
-		if (m_aabb.isValid()) {
-			if (frustum.intersectsAABB(m_aabb)) {
+		if (aabb.isValid()) {
+			if (frustum.intersectsAABB(aabb)) {
 				this->parent->addState(EntityState::ENTITY_STATE_VISIBLE);
 			}
 			else {
@@ -51,8 +52,8 @@ void FrustumCullingBhv::update(Scene* scene, float dt)
 		}
 		break;
 	case CullingMode::SPHERE_CULLING:
-		radius = glm::length(m_aabb.halfExtents());
-		if (frustum.intersectsSphere(m_aabb.center(), radius)) {
+		radius = glm::length(aabb.halfExtents());
+		if (frustum.intersectsSphere(aabb.center(), radius)) {
 			this->parent->addState(EntityState::ENTITY_STATE_VISIBLE);
 		}
 		else {
@@ -60,9 +61,9 @@ void FrustumCullingBhv::update(Scene* scene, float dt)
 		}
 		break;
 	case CullingMode::SPHERE_THEN_AABB_CULLING:
-		radius = glm::length(m_aabb.halfExtents());
-		if (frustum.intersectsSphere(m_aabb.center(), radius)) {
-			if(frustum.intersectsAABB(m_aabb)) {
+		radius = glm::length(aabb.halfExtents());
+		if (frustum.intersectsSphere(aabb.center(), radius)) {
+			if(frustum.intersectsAABB(aabb)) {
 				this->parent->addState(EntityState::ENTITY_STATE_VISIBLE);
 			}
 			else {
@@ -74,7 +75,7 @@ void FrustumCullingBhv::update(Scene* scene, float dt)
 		}
 		break;
 	case CullingMode::ORIGIN_CULLING:
-		if (frustum.containsPoint(m_aabb.center())) {
+		if (frustum.containsPoint(aabb.center())) {
 			this->parent->addState(EntityState::ENTITY_STATE_VISIBLE);
 		}
 		else {
@@ -83,7 +84,19 @@ void FrustumCullingBhv::update(Scene* scene, float dt)
 		break;
 	default:
 		break;
-	}	
+	}
+
+	if (m_occlusionCulling) {
+		this->cullOccluded(scene, aabb);
+	}
+}
+
+void FrustumCullingBhv::cullOccluded(Scene* scene, const AABB& aabb)
+{
+	// Only entities inside the frustum are worth the occlusion test
+	if (aabb.isValid() && this->parent->hasState(EntityState::ENTITY_STATE_VISIBLE) && scene->isOccluded(aabb)) {
+		this->parent->removeState(EntityState::ENTITY_STATE_VISIBLE);
+	}
 }
 
 void FrustumCullingBhv::destroy(Scene* scene, Renderer* renderer)
@@ -31,38 +31,22 @@ private:
 	/// </summary>
 	CullingMode m_cullingMode = CullingMode::SPHERE_THEN_AABB_CULLING;
 
-	/// <summary>
-	/// Cached Axis-Aligned Bounding Box of the parent entity
-	/// </summary>
-	AABB m_aabb = AABB();
-
 	/// <summary>
 	/// The half extents of the bounding box
 	/// </summary>
 	glm::vec3 m_halfExtents = glm::vec3(0.0f);
 
 	/// <summary>
-	/// The last known position of the parent transform
-	/// </summary>
-	glm::vec3 m_lastParentPosition = glm::vec3(0.0f);
-
-	/// <summary>
-	/// The last known rotation of the parent transform
+	/// Whether visible entities are also tested against the depth the scene rendered before
 	/// </summary>
-	glm::quat m_lastParentRotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+	bool m_occlusionCulling = false;
 
 	/// <summary>
-	/// The last known scale of the parent transform
+	/// Hides the parent if it is visible but the scene reports it as occluded
 	/// </summary>
-	glm::vec3 m_lastParentScale = glm::vec3(1.0f);
-
-	/// <summary>
-	/// Checks if the transform has changed since the last check
-	/// Updates the last known transform values if dirty
-	/// </summary>
-	/// <param name="transform"></param>
-	/// <returns></returns>
-	bool isDirty(Transform& transform);
+	/// <param name="scene"></param>
+	/// <param name="aabb"></param>
+	void cullOccluded(Scene* scene, const AABB& aabb);
 
 public:
 
@@ -71,7 +55,8 @@ public:
 	/// </summary>
 	/// <param name="camera"></param>
 	/// <param name="mode"></param>
-	FrustumCullingBhv(Camera* camera, CullingMode mode = CullingMode::SPHERE_THEN_AABB_CULLING);
+	/// <param name="occlusionCulling">Also hides entities occluded by the scene, see Scene3D::occlusionCulling</param>
+	FrustumCullingBhv(Camera* camera, CullingMode mode = CullingMode::SPHERE_THEN_AABB_CULLING, bool occlusionCulling = false);
 
 	/// <summary>
 	/// The initialization of the behavior
@@ -103,10 +88,25 @@ public:
 	/// <param name="frame"></param>
 	void render(Scene* scene, Renderer* renderer, VkCommandBuffer commandbuffer, int frame) override;
 
+	/// <summary>
+	/// Culling happens in update, render does nothing
+	/// </summary>
+	/// <returns></returns>
+	bool rendersEveryFrame() const override {
+		return false;
+	}
+
 	/// <summary>
 	/// Gets the unique identifier of this behavior
 	/// </summary>
 	/// <returns></returns>
 	std::string getIdentifier() override;
+
+	/// <summary>
+	/// Culling only reads the camera frustum and writes the parent state
+	/// so it can run in parallel scene updates
+	/// </summary>
+	/// <returns></returns>
+	bool supportsParallelUpdate() const override { return true; }
 };
 
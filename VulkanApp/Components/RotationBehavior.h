@@ -10,5 +10,7 @@ public:
 	void destroy(Scene* scene, Renderer* renderer) override {}
 	void render(Scene* scene, Renderer* renderer, VkCommandBuffer commandbuffer, int frame) override {}
 	std::string getIdentifier() override { return "RotationBehavior"; }
+	bool supportsParallelUpdate() const override { return true; }
+	bool rendersEveryFrame() const override { return false; }
 };
 
@@ -53,5 +53,25 @@ public:
 	/// </summary>
 	/// <returns></returns>
 	virtual std::string getIdentifier() = 0;
+
+	/// <summary>
+	/// Whether update may run on a worker thread while other entities are updated
+	/// Only return true if update writes nothing but this behavior and its parent entity
+	/// and only reads shared state (e.g. cameras) that is not written during the scene update.
+	/// Accessing other entities, adding or removing entities, scene raycasts and renderer calls are not allowed.
+	/// </summary>
+	/// <returns></returns>
+	virtual bool supportsParallelUpdate() const {
+		return false;
+	}
+
+	/// <summary>
+	/// Whether render has to run every frame
+	/// Return false if render does nothing, scenes may then replay cached draws of the parent entity.
+	/// </summary>
+	/// <returns></returns>
+	virtual bool rendersEveryFrame() const {
+		return true;
+	}
 };
 
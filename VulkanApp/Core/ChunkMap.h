@@ -0,0 +1,210 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/// <summary>
+/// The chunk index structure
+/// </summary>
+struct ChunkIndex {
+	int chunkX;
+	int chunkY;
+	int chunkZ;
+
+	auto operator<=>(const ChunkIndex&) const = default;
+	bool operator==(const ChunkIndex&) const = default;
+};
+
+/// <summary>
+/// Open addressing hash map from chunk indices to values
+/// Uses linear probing in a power of two table that is kept at most half full, removals shift
+/// the following entries back so lookups never have to skip tombstones.
+/// </summary>
+/// <typeparam name="T"></typeparam>
+template<typename T>
+class ChunkMap
+{
+private:
+	/// <summary>
+	/// A slot of the table
+	/// </summary>
+	struct Slot {
+		ChunkIndex key = { 0, 0, 0 };
+		T value = {};
+		bool used = false;
+	};
+
+	/// <summary>
+	/// The table, its size is zero or a power of two
+	/// </summary>
+	std::vector<Slot> m_slots;
+
+	/// <summary>
+	/// Number of used slots
+	/// </summary>
+	size_t m_count = 0;
+
+	/// <summary>
+	/// Returns the slot of the key or the empty slot where it would be inserted
+	/// </summary>
+	/// <param name="key"></param>
+	/// <returns></returns>
+	size_t findSlot(const ChunkIndex& key) const {
+		size_t mask = m_slots.size() - 1;
+		size_t slot = hash(key) & mask;
+		while (m_slots[slot].used && !(m_slots[slot].key == key)) {
+			slot = (slot + 1) & mask;
+		}
+		return slot;
+	}
+
+	/// <summary>
+	/// Resizes the table and reinserts all entries
+	/// </summary>
+	/// <param name="capacity">Must be a power of two</param>
+	void rehash(size_t capacity) {
+		std::vector<Slot> slots(capacity);
+		std::swap(m_slots, slots);
+		for (auto& slot : slots) {
+			if (slot.used) {
+				Slot& target = m_slots[this->findSlot(slot.key)];
+				target.key = slot.key;
+				target.value = std::move(slot.value);
+				target.used = true;
+			}
+		}
+	}
+
+public:
+	ChunkMap() = default;
+	~ChunkMap() = default;
+
+	/// <summary>
+	/// Hash of a chunk index, mixes the three coordinates with large primes
+	/// </summary>
+	/// <param name="key"></param>
+	/// <returns></returns>
+	static size_t hash(const ChunkIndex& key) {
+		uint64_t h = static_cast<uint64_t>(static_cast<uint32_t>(key.chunkX)) * 0x9E3779B97F4A7C15ull;
+		h ^= static_cast<uint64_t>(static_cast<uint32_t>(key.chunkY)) * 0xC2B2AE3D27D4EB4Full;
+		h ^= static_cast<uint64_t>(static_cast<uint32_t>(key.chunkZ)) * 0x165667B19E3779F9ull;
+		return static_cast<size_t>(h ^ (h >> 29));
+	}
+
+	/// <summary>
+	/// Finds the value of a chunk
+	/// </summary>
+	/// <param name="key"></param>
+	/// <returns>nullptr if the chunk is not in the map</returns>
+	T* find(const ChunkIndex& key) {
+		if (m_count == 0) {
+			return nullptr;
+		}
+		Slot& slot = m_slots[this->findSlot(key)];
+		return slot.used ? &slot.value : nullptr;
+	}
+
+	const T* find(const ChunkIndex& key) const {
+		if (m_count == 0) {
+			return nullptr;
+		}
+		const Slot& slot = m_slots[this->findSlot(key)];
+		return slot.used ? &slot.value : nullptr;
+	}
+
+	/// <summary>
+	/// Returns the value of a chunk and inserts a default value if the chunk is not in the map
+	/// </summary>
+	/// <param name="key"></param>
+	/// <returns></returns>
+	T& operator[](const ChunkIndex& key) {
+		if ((m_count + 1) * 2 > m_slots.size()) {
+			this->rehash(m_slots.empty() ? 64 : m_slots.size() * 2);
+		}
+		Slot& slot = m_slots[this->findSlot(key)];
+		if (!slot.used) {
+			slot.key = key;
+			slot.used = true;
+			m_count++;
+		}
+		return slot.value;
+	}
+
+	/// <summary>
+	/// Removes a chunk
+	/// </summary>
+	/// <param name="key"></param>
+	/// <returns>True if the chunk was in the map</returns>
+	bool erase(const ChunkIndex& key) {
+		if (m_count == 0) {
+			return false;
+		}
+		size_t mask = m_slots.size() - 1;
+		size_t hole = this->findSlot(key);
+		if (!m_slots[hole].used) {
+			return false;
+		}
+
+		// Shift the following entries of the probe sequence back into the hole
+		size_t slot = hole;
+		while (true) {
+			slot = (slot + 1) & mask;
+			if (!m_slots[slot].used) {
+				break;
+			}
+			size_t home = hash(m_slots[slot].key) & mask;
+			// Entries whose home lies cyclically in (hole, slot] have to stay
+			if (((slot - home) & mask) < ((slot - hole) & mask)) {
+				continue;
+			}
+			m_slots[hole].key = m_slots[slot].key;
+			m_slots[hole].value = std::move(m_slots[slot].value);
+			hole = slot;
+		}
+		m_slots[hole].value = T();
+		m_slots[hole].used = false;
+		m_count--;
+		return true;
+	}
+
+	/// <summary>
+	/// Calls the function for every chunk in the map
+	/// The map must not be changed during the iteration.
+	/// </summary>
+	/// <typeparam name="Fn"></typeparam>
+	/// <param name="function">Gets the chunk index and the value</param>
+	template<typename Fn>
+	void forEach(Fn&& function) {
+		for (auto& slot : m_slots) {
+			if (slot.used) {
+				function(static_cast<const ChunkIndex&>(slot.key), slot.value);
+			}
+		}
+	}
+
+	template<typename Fn>
+	void forEach(Fn&& function) const {
+		for (const auto& slot : m_slots) {
+			if (slot.used) {
+				function(slot.key, slot.value);
+			}
+		}
+	}
+
+	/// <summary>
+	/// Removes all chunks
+	/// </summary>
+	void clear() {
+		m_slots.clear();
+		m_count = 0;
+	}
+
+	/// <summary>
+	/// Returns the number of chunks in the map
+	/// </summary>
+	/// <returns></returns>
+	size_t size() const {
+		return m_count;
+	}
+};
@@ -1,10 +1,15 @@
 #include "ChunkedScene3D.h"
+#include "GFX.h"
+#include "Model.h"
+#include "../Graphics/Material.h"
+#include "../Graphics/Camera2D.h"
+#include <algorithm>
+#include <cstdlib>
 
 ChunkedScene3D::ChunkedScene3D(glm::vec3 initialPosition) : Scene()
 {
-	// Set the starting chunk and its neighbors
+	// Set the starting chunk
 	m_currentChunk = this->getChunkForPosition(initialPosition);
-	m_neighboringChunks = this->getChunkNeighbors(m_currentChunk);
 
 	// Create the directional light and set its binding infos for the engine predefined pipelines
 	this->directionalLight = std::make_unique<DirectionalLight>();
@@ -12,19 +17,42 @@ ChunkedScene3D::ChunkedScene3D(glm::vec3 initialPosition) : Scene()
 	this->directionalLight->addBindingInfo({ ToString(PipelineType::PIPELINE_TYPE_GRAPHICS_3D_INSTANCED), 7 });
 }
 
+ChunkedScene3D::~ChunkedScene3D()
+{
+	// Loader jobs write into their chunks, they have to finish before the chunks go away
+	this->waitForChunkLoads();
+	this->waitForProxyBakes();
+	this->releaseEntityIndex();
+}
+
+void ChunkedScene3D::enableEntityStorage()
+{
+	Scene::enableEntityStorage();
+	m_chunks.forEach([this](const ChunkIndex& chunkIndex, std::unique_ptr<Chunk>& chunk) {
+		for (const auto& entity : chunk->entities)
+		{
+			entity->attachToStorage(this->getEntityStorage());
+		}
+	});
+	for (const auto& entity : m_globalEntities)
+	{
+		entity->attachToStorage(this->getEntityStorage());
+	}
+}
+
 void ChunkedScene3D::init(Renderer* renderer)
 {
 	// Call base init to create render target
 	Scene::init(renderer);
+	m_renderer = renderer;
 
 	// Init all chunk entities
-	for (const auto& [chunkIndex, entities] : m_chunks)
-	{
-		for (const auto& entity : entities)
+	m_chunks.forEach([this, renderer](const ChunkIndex& chunkIndex, std::unique_ptr<Chunk>& chunk) {
+		for (const auto& entity : chunk->entities)
 		{
 			entity->init(this, renderer);
 		}
-	}
+	});
 
 	// Init all global entities
 	for (const auto& entity : m_globalEntities)
@@ -32,6 +60,34 @@ void ChunkedScene3D::init(Renderer* renderer)
 		entity->init(this, renderer);
 	}
 
+	// Build the BVH over all chunks once the entities have their AABBs
+	m_updateQueue.clear();
+	m_chunks.forEach([this](const ChunkIndex& chunkIndex, std::unique_ptr<Chunk>& chunk) {
+		for (const auto& entity : chunk->entities)
+		{
+			m_updateQueue.push_back(entity.get());
+		}
+	});
+	for (const auto& entity : m_globalEntities)
+	{
+		m_updateQueue.push_back(entity.get());
+	}
+	this->syncSpatialIndex(m_updateQueue);
+	this->rebuildSpatialIndex();
+
+	// Merge the static models of every chunk and the global ones
+	if (this->staticBatching) {
+		m_chunks.forEach([this](const ChunkIndex& chunkIndex, std::unique_ptr<Chunk>& chunk) {
+			this->buildChunkStaticGeometry(chunk.get());
+		});
+		m_updateQueue.clear();
+		for (const auto& entity : m_globalEntities)
+		{
+			m_updateQueue.push_back(entity.get());
+		}
+		m_globalStaticGeometry.build(renderer, m_updateQueue, this->staticClusterSize);
+	}
+
 	// Init the skybox if it exists
 	if (this->skybox != nullptr)
 	{
@@ -47,77 +103,148 @@ void ChunkedScene3D::init(Renderer* renderer)
 void ChunkedScene3D::update(float deltaTime)
 {
 	Scene::update(deltaTime);
-
-	// Update the current chunk
-	auto it = m_chunks.find(m_currentChunk);
-	if (it != m_chunks.end()) {
-		const auto& currentChunkEntities = it->second;
-		for (const auto& entity : currentChunkEntities) {
-			entity->update(this, deltaTime);
-		}
+	this->updateStreaming();
+	if (m_activeChunksDirty) {
+		this->rebuildActiveChunks();
 	}
 
-	// Update the neighboring chunks
-	for (const auto& neighborIndex : m_neighboringChunks)
+	// Cull whole chunks before the entities run their own culling
+	this->cullChunks();
+	this->updateProxies();
+
+	// Collect the entities of the active chunks
+	m_updateQueue.clear();
+	for (Chunk* chunk : m_activeChunks)
 	{
-		auto neighborsIt = m_chunks.find(neighborIndex);
-		if (neighborsIt != m_chunks.end()) {
-			const auto& neighborEntities = neighborsIt->second;
-			for (const auto& entity : neighborEntities) {
-				entity->update(this, deltaTime);
-			}
+		for (const auto& entity : chunk->entities) {
+			m_updateQueue.push_back(entity.get());
 		}
 	}
 
-	// Update global entities
+	// Collect global entities
 	for (const auto& entity : m_globalEntities)
 	{
-		entity->update(this, deltaTime);
+		m_updateQueue.push_back(entity.get());
 	}
+
+	this->updateEntities(m_updateQueue, deltaTime);
+
+	// Entities that crossed a chunk border change their chunk after all entities are updated
+	this->migrateEntities();
+	m_frame++;
 }
 
 void ChunkedScene3D::render(Renderer* renderer, VkCommandBuffer commandBuffer, uint32_t currentFrame)
 {
 	int renderTargetIndex = this->getRenderTargetIndex();
 	auto renderTarget = renderer->getRenderTarget(renderTargetIndex);
+	VkFramebuffer framebuffer = renderTarget->getFramebuffer();
 
-	renderer->beginnRenderPass(commandBuffer, renderTarget->getFramebuffer(), glm::vec4(0.0f, 0.0f, 0.0f, 0.0f), renderer->getOffscreenRenderPass());
+	// A render pass that executes secondary command buffers can't contain inline draws,
+	// so with cached chunks the remaining draws are recorded into per frame secondary command buffers
+	bool cached = this->cacheChunkCommandBuffers;
+	VkSubpassContents contents = cached ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE;
+	renderer->beginnRenderPass(commandBuffer, framebuffer, glm::vec4(0.0f, 0.0f, 0.0f, 0.0f), renderer->getOffscreenRenderPass(), contents);
 
-	Scene::render(renderer, commandBuffer, currentFrame);
+	VkCommandBuffer drawBuffer = commandBuffer;
+	if (cached) {
+		this->validateChunkDraws(renderer, framebuffer);
+		m_executeQueue.clear();
+		drawBuffer = this->beginFrameCommandBuffer(renderer, framebuffer, currentFrame, 0);
+	}
+
+	Scene::render(renderer, drawBuffer, currentFrame);
 
 	// Update the light buffers and bind the light
 	if (this->directionalLight != nullptr) {
-		this->directionalLight->updateBuffers(renderer, commandBuffer, currentFrame);
+		this->directionalLight->updateBuffers(renderer, drawBuffer, currentFrame);
 	}
 
-	// Render current chunk entities
-	auto it = m_chunks.find(m_currentChunk);
-	if (it != m_chunks.end()) {
-		const auto& currentChunkEntities = it->second;
-		for (const auto& entity : currentChunkEntities) {
+	if (cached) {
+		renderer->endSecondaryCommandBuffer(drawBuffer);
+		m_executeQueue.push_back(drawBuffer);
+	}
+
+	// Batched sprites outside of the view of a 2D culling camera are dropped when they are queued,
+	// the bounds of another scene rendered before must not cull the sprites of this one
+	Camera2D* camera2D = dynamic_cast<Camera2D*>(this->cullingCamera);
+	if (camera2D != nullptr) {
+		glm::vec2 viewMin, viewMax;
+		camera2D->getViewBounds(viewMin, viewMax);
+		renderer->setSpriteCullBounds(viewMin, viewMax);
+	}
+	else {
+		renderer->disableSpriteCulling();
+	}
+
+	// Render the entities of the active chunks, the current chunk comes first
+	// Cached chunk draws have to stay in their chunk, so their models are not batched
+	if (m_activeChunksDirty) {
+		this->rebuildActiveChunks();
+	}
+	if (!cached) {
+		this->beginModelBatch();
+	}
+	for (Chunk* chunk : m_activeChunks) {
+		if (chunk->visibility == FrustumTestResult::FRUSTUM_TEST_OUTSIDE) {
+			continue;
+		}
+		if (cached) {
+			m_executeQueue.push_back(this->getChunkCommandBuffer(chunk, renderer, framebuffer, currentFrame));
+			continue;
+		}
+		const Frustum* frustum = chunk->visibility == FrustumTestResult::FRUSTUM_TEST_INSIDE || this->cullingCamera == nullptr ? nullptr : &this->cullingCamera->getFrustum();
+		chunk->staticGeometry.render(this, renderer, commandBuffer, currentFrame, frustum);
+		for (const auto& entity : chunk->entities) {
 			entity->render(this, renderer, commandBuffer, currentFrame);
 		}
 	}
 
-	// Render neighboring chunk entities
-	for (const auto& neighborIndex : m_neighboringChunks) {
-		auto neighborsIt = m_chunks.find(neighborIndex);
-		if (neighborsIt != m_chunks.end()) {
-			const auto& neighborEntities = neighborsIt->second;
-			for (const auto& entity : neighborEntities) {
-				entity->render(this, renderer, commandBuffer, currentFrame);
+	if (cached) {
+		drawBuffer = this->beginFrameCommandBuffer(renderer, framebuffer, currentFrame, 1);
+		this->beginModelBatch();
+
+		// Entities whose draws change from frame to frame (LODs, batched and queued draws) render every frame
+		for (Chunk* chunk : m_activeChunks) {
+			if (chunk->visibility == FrustumTestResult::FRUSTUM_TEST_OUTSIDE) {
+				continue;
+			}
+			for (const auto& entity : chunk->entities) {
+				if (!entity->hasCacheableDraws()) {
+					entity->render(this, renderer, drawBuffer, currentFrame);
+				}
 			}
 		}
 	}
 
+	// Render the proxies of the distant chunks
+	this->renderProxies(renderer, drawBuffer, currentFrame);
+
 	// Render global entities
+	m_globalStaticGeometry.render(this, renderer, drawBuffer, currentFrame, this->cullingCamera != nullptr ? &this->cullingCamera->getFrustum() : nullptr);
 	for (const auto& entity : m_globalEntities) {
-		entity->render(this, renderer, commandBuffer, currentFrame);
+		entity->render(this, renderer, drawBuffer, currentFrame);
 	}
+	this->flushModelBatch(renderer, drawBuffer, currentFrame);
 
 	// Render the skybox if it exists
 	if (this->skybox != nullptr) {
-		skybox->render(renderer, commandBuffer, currentFrame);
+		skybox->render(renderer, drawBuffer, currentFrame);
+	}
+
+	// Batched sprites don't write depth, draw them over the skybox
+	renderer->flushSprites(drawBuffer, currentFrame);
+
+	// Queued text draws over the sprites
+	renderer->flushText(drawBuffer, currentFrame);
+
+	// Debug shapes queued while rendering the scene
+	renderer->flushDebugDraw(drawBuffer, currentFrame);
+
+	if (cached) {
+		renderer->endSecondaryCommandBuffer(drawBuffer);
+		m_executeQueue.push_back(drawBuffer);
+		renderer->executeCommandBuffers(commandBuffer, m_executeQueue);
 	}
 
 	renderer->endRenderPass(commandBuffer);
@@ -126,15 +253,31 @@ void ChunkedScene3D::render(Renderer* renderer, VkCommandBuffer commandBuffer, u
 void ChunkedScene3D::destroy(Renderer* renderer)
 {
 	Scene::destroy(renderer);
+	this->waitForChunkLoads();
+	this->waitForProxyBakes();
+
+	this->releaseCommandBuffers(renderer);
 
-	// Destroy all chunk entities 
-	for (const auto& [chunkIndex, entities] : m_chunks) {
-		for (const auto& chunkEntity : entities) {
+	// Destroy all initialized chunk entities, entities still waiting for their upload were never initialized
+	m_chunks.forEach([this, renderer](const ChunkIndex& chunkIndex, std::unique_ptr<Chunk>& chunk) {
+		chunk->staticGeometry.dispose(renderer);
+		for (const auto& chunkEntity : chunk->entities) {
 			chunkEntity->destroy(this, renderer);
 		}
-	}
+	});
+	this->releaseRetiredChunks(true);
+
+	// Destroy all proxies
+	m_proxyDraws.clear();
+	m_proxyBakes.clear();
+	m_proxies.forEach([this](const ChunkIndex& chunkIndex, std::unique_ptr<ChunkProxy>& proxy) {
+		this->releaseProxy(proxy.get());
+	});
+	m_proxies.clear();
+	this->releaseRetiredProxies(true);
 
 	// Destroy all global entities
+	m_globalStaticGeometry.dispose(renderer);
 	for (const auto& entity : m_globalEntities) {
 		entity->destroy(this, renderer);
 	}
@@ -145,6 +288,13 @@ void ChunkedScene3D::destroy(Renderer* renderer)
 	}
 }
 
+void ChunkedScene3D::beforeSwapchainRecreate(Renderer* renderer)
+{
+	// The recorded draws use the old pipelines and framebuffer, the device is idle at this point
+	Scene::beforeSwapchainRecreate(renderer);
+	this->releaseCommandBuffers(renderer);
+}
+
 ChunkIndex ChunkedScene3D::getChunkForPosition(const glm::vec3& position)
 {
 	ChunkIndex index;
@@ -157,7 +307,31 @@ ChunkIndex ChunkedScene3D::getChunkForPosition(const glm::vec3& position)
 void ChunkedScene3D::addEntityToChunk(std::unique_ptr<Entity> entity)
 {
 	ChunkIndex index = this->getChunkForPosition(entity->getPosition());
-	m_chunks[index].push_back(std::move(entity));
+	auto& chunk = m_chunks[index];
+	if (chunk == nullptr) {
+		chunk = std::make_unique<Chunk>();
+		chunk->index = index;
+		chunk->state = ChunkState::CHUNK_STATE_RESIDENT;
+		m_activeChunksDirty = true;
+	}
+
+	// Chunks with hand placed entities can't be restored by the loader, so they are never evicted
+	chunk->persistent = true;
+	chunk->boundsDirty = true;
+	this->registerEntity(entity.get());
+	this->insertChunkEntity(chunk.get(), std::move(entity));
+}
+
+bool ChunkedScene3D::isChunkResident(const ChunkIndex& chunkIndex) const
+{
+	const auto* chunk = m_chunks.find(chunkIndex);
+	return chunk != nullptr && (*chunk)->state == ChunkState::CHUNK_STATE_RESIDENT;
+}
+
+AABB ChunkedScene3D::getChunkBounds(const ChunkIndex& chunkIndex) const
+{
+	const auto* chunk = m_chunks.find(chunkIndex);
+	return chunk != nullptr ? (*chunk)->bounds : AABB();
 }
 
 void ChunkedScene3D::setActiveChunk(const glm::vec3& position)
@@ -167,7 +341,9 @@ void ChunkedScene3D::setActiveChunk(const glm::vec3& position)
 		return;
 	}
 	m_currentChunk = chunkIndex;
-	m_neighboringChunks = this->getChunkNeighbors(m_currentChunk);
+	m_activeChunksDirty = true;
+	m_streamingDirty = true;
+	m_proxiesDirty = true;
 }
 
 std::vector<ChunkIndex> ChunkedScene3D::getChunkNeighbors(const ChunkIndex& chunkIndex)
@@ -200,66 +376,804 @@ void ChunkedScene3D::bindSceneDescriptorSets(Renderer* renderer, VkCommandBuffer
 
 RayHit ChunkedScene3D::raycast(const Ray& ray) const
 {
-	float closestDistance = std::numeric_limits<float>::max();
-	Entity* hitEntity = nullptr;
+	RayHit hitResult = this->raycastEntities(ray);
+	if (!hitResult.hit) {
+		hitResult.distance = -1.0f;
+	}
+	return hitResult;
+}
 
-	// Check global entities
-	for (const auto& entity : m_globalEntities) {
-		if (entity->hasState(EntityState::ENTITY_STATE_RAYCASTABLE)) {
-			AABB worldAabb = entity->getAABB(true);
-			float tMin, tMax;
-			if (RayCast::rayIntersectsAABB(ray, worldAabb, tMin, tMax)) {
-				if (tMin < closestDistance) {
-					closestDistance = tMin;
-					hitEntity = entity.get();
-				}
+void ChunkedScene3D::raycastBatch(std::span<const Ray> rays, std::span<RayHit> hits, bool parallel) const
+{
+	Scene::raycastBatch(rays, hits, parallel);
+	for (RayHit& hit : hits) {
+		if (!hit.hit) {
+			hit.distance = -1.0f;
+		}
+	}
+}
+
+bool ChunkedScene3D::isEntityQueryable(const Entity* entity) const
+{
+	// Global entities are always active, chunk entities only within the load radius
+	auto it = m_entityChunks.find(entity);
+	if (it == m_entityChunks.end()) {
+		return true;
+	}
+	return chunkDistance(it->second.chunk->index, m_currentChunk) <= this->loadRadius;
+}
+
+void ChunkedScene3D::onEntityMoved(Entity* entity)
+{
+	auto it = m_entityChunks.find(entity);
+	if (it == m_entityChunks.end()) {
+		return;
+	}
+	Chunk* chunk = it->second.chunk;
+	chunk->boundsDirty = true;
+	chunk->proxyDirty = true;
+	chunk->drawRevision++;
+	if (!(this->getChunkForPosition(entity->getPosition()) == chunk->index)) {
+		m_migrations.push_back(entity);
+	}
+}
+
+FrustumTestResult ChunkedScene3D::getCullingHint(const Entity* entity, const Camera* camera) const
+{
+	if (camera == nullptr || camera != this->cullingCamera) {
+		return FrustumTestResult::FRUSTUM_TEST_INTERSECTS;
+	}
+	auto it = m_entityChunks.find(entity);
+	if (it == m_entityChunks.end()) {
+		return FrustumTestResult::FRUSTUM_TEST_INTERSECTS;
+	}
+	return it->second.chunk->visibility;
+}
+
+int ChunkedScene3D::chunkDistance(const ChunkIndex& a, const ChunkIndex& b)
+{
+	return std::max({ std::abs(a.chunkX - b.chunkX), std::abs(a.chunkY - b.chunkY), std::abs(a.chunkZ - b.chunkZ) });
+}
+
+void ChunkedScene3D::updateStreaming()
+{
+	if (m_loadOffsetsRadius != this->loadRadius) {
+		this->rebuildLoadOffsets();
+	}
+
+	if (this->chunkLoader) {
+		if (m_streamingDirty) {
+			this->requestChunks();
+			m_streamingDirty = false;
+		}
+		this->collectLoadedChunks();
+		this->startChunkLoads();
+		this->uploadChunks();
+	}
+	this->releaseRetiredChunks(false);
+}
+
+void ChunkedScene3D::rebuildLoadOffsets()
+{
+	// Offsets of all chunks within the load radius, nearest first so close chunks load first
+	m_loadOffsets.clear();
+	for (int x = -this->loadRadius; x <= this->loadRadius; x++) {
+		for (int y = -this->loadRadius; y <= this->loadRadius; y++) {
+			for (int z = -this->loadRadius; z <= this->loadRadius; z++) {
+				m_loadOffsets.push_back({ x, y, z });
+			}
+		}
+	}
+	std::stable_sort(m_loadOffsets.begin(), m_loadOffsets.end(), [](const ChunkIndex& a, const ChunkIndex& b) {
+		return a.chunkX * a.chunkX + a.chunkY * a.chunkY + a.chunkZ * a.chunkZ <
+			b.chunkX * b.chunkX + b.chunkY * b.chunkY + b.chunkZ * b.chunkZ;
+	});
+	m_loadOffsetsRadius = this->loadRadius;
+	m_activeChunksDirty = true;
+	m_streamingDirty = true;
+}
+
+void ChunkedScene3D::requestChunks()
+{
+	// Evict streamed chunks that left the load radius plus the hysteresis
+	int evictionRadius = this->loadRadius + std::max(0, this->evictionHysteresis);
+	std::vector<ChunkIndex> evicted;
+	m_chunks.forEach([&](const ChunkIndex& chunkIndex, std::unique_ptr<Chunk>& chunk) {
+		// Loading chunks are checked again once their loader is done
+		if (!chunk->persistent && chunk->state != ChunkState::CHUNK_STATE_LOADING && chunkDistance(chunkIndex, m_currentChunk) > evictionRadius) {
+			evicted.push_back(chunkIndex);
+		}
+	});
+	for (const auto& chunkIndex : evicted) {
+		this->retireChunk(chunkIndex);
+	}
+
+	// Queue the missing chunks within the load radius, nearest first
+	for (const auto& offset : m_loadOffsets) {
+		ChunkIndex chunkIndex = { m_currentChunk.chunkX + offset.chunkX, m_currentChunk.chunkY + offset.chunkY, m_currentChunk.chunkZ + offset.chunkZ };
+		auto& chunk = m_chunks[chunkIndex];
+		if (chunk == nullptr) {
+			chunk = std::make_unique<Chunk>();
+			chunk->index = chunkIndex;
+			m_loadQueue.push_back(chunk.get());
+		}
+	}
+
+	// Chunks queued for an earlier position go after the new ones
+	std::stable_partition(m_loadQueue.begin(), m_loadQueue.end(), [this](const Chunk* chunk) {
+		return chunkDistance(chunk->index, m_currentChunk) <= this->loadRadius;
+	});
+}
+
+void ChunkedScene3D::startChunkLoads()
+{
+	auto jobSystem = GFX::instance().getService<JobSystem>(JobSystem::SERVICE_NAME);
+	while (!m_loadQueue.empty() && m_loadingChunks.size() < std::max<size_t>(1, this->maxConcurrentChunkLoads)) {
+		Chunk* chunk = m_loadQueue.front();
+		m_loadQueue.pop_front();
+
+		// The chunk may have left the load radius while it was waiting
+		if (chunkDistance(chunk->index, m_currentChunk) > this->loadRadius) {
+			m_chunks.erase(chunk->index);
+			continue;
+		}
+
+		chunk->state = ChunkState::CHUNK_STATE_LOADING;
+		m_loadingChunks.push_back(chunk);
+		auto load = [chunk, loader = this->chunkLoader]() {
+			try {
+				chunk->loadedEntities = loader(chunk->index);
+			}
+			catch (...) {
+				chunk->loadError = std::current_exception();
+			}
+			chunk->loaded.store(true, std::memory_order_release);
+		};
+
+		// Without a job system the chunk is loaded right away
+		if (jobSystem != nullptr) {
+			jobSystem->submit(load, &m_loadCounter);
+		}
+		else {
+			load();
+		}
+	}
+}
+
+void ChunkedScene3D::collectLoadedChunks()
+{
+	int evictionRadius = this->loadRadius + std::max(0, this->evictionHysteresis);
+	for (size_t i = 0; i < m_loadingChunks.size();) {
+		Chunk* chunk = m_loadingChunks[i];
+		if (!chunk->loaded.load(std::memory_order_acquire)) {
+			i++;
+			continue;
+		}
+		m_loadingChunks[i] = m_loadingChunks.back();
+		m_loadingChunks.pop_back();
+
+		if (chunk->loadError) {
+			std::exception_ptr error = chunk->loadError;
+			m_chunks.erase(chunk->index);
+			std::rethrow_exception(error);
+		}
+
+		// Nothing of the chunk is initialized yet, a chunk that is out of range can simply be dropped
+		if (chunkDistance(chunk->index, m_currentChunk) > evictionRadius) {
+			m_chunks.erase(chunk->index);
+			continue;
+		}
+		chunk->state = ChunkState::CHUNK_STATE_UPLOADING;
+		chunk->entities.reserve(chunk->loadedEntities.size());
+		m_uploadQueue.push_back(chunk);
+	}
+}
+
+void ChunkedScene3D::uploadChunks()
+{
+	if (m_renderer == nullptr) {
+		return;
+	}
+
+	// Initializing an entity creates its GPU resources, limit how many are initialized per frame
+	size_t budget = std::max<size_t>(1, this->maxEntityUploadsPerFrame);
+	while (!m_uploadQueue.empty() && budget > 0) {
+		Chunk* chunk = m_uploadQueue.front();
+		while (chunk->entities.size() < chunk->loadedEntities.size() && budget > 0) {
+			auto& entity = chunk->loadedEntities[chunk->entities.size()];
+			this->registerEntity(entity.get());
+			entity->init(this, m_renderer);
+			this->insertChunkEntity(chunk, std::move(entity));
+			budget--;
+		}
+		if (chunk->entities.size() < chunk->loadedEntities.size()) {
+			break;
+		}
+
+		// The whole chunk is initialized, make it visible
+		chunk->loadedEntities.clear();
+		chunk->state = ChunkState::CHUNK_STATE_RESIDENT;
+		m_uploadQueue.pop_front();
+
+		m_updateQueue.clear();
+		for (const auto& entity : chunk->entities) {
+			m_updateQueue.push_back(entity.get());
+		}
+		this->syncSpatialIndex(m_updateQueue);
+		this->buildChunkStaticGeometry(chunk);
+		m_activeChunksDirty = true;
+	}
+}
+
+void ChunkedScene3D::buildChunkStaticGeometry(Chunk* chunk)
+{
+	if (!this->staticBatching || m_renderer == nullptr) {
+		return;
+	}
+	m_updateQueue.clear();
+	for (const auto& entity : chunk->entities) {
+		m_updateQueue.push_back(entity.get());
+	}
+	chunk->staticGeometry.build(m_renderer, m_updateQueue, this->staticClusterSize);
+	chunk->drawRevision++;
+}
+
+void ChunkedScene3D::retireChunk(const ChunkIndex& index)
+{
+	auto* slot = m_chunks.find(index);
+	if (slot == nullptr) {
+		return;
+	}
+	std::unique_ptr<Chunk> chunk = std::move(*slot);
+	m_chunks.erase(index);
+
+	if (chunk->state == ChunkState::CHUNK_STATE_QUEUED) {
+		m_loadQueue.erase(std::remove(m_loadQueue.begin(), m_loadQueue.end(), chunk.get()), m_loadQueue.end());
+		return;
+	}
+	if (chunk->state == ChunkState::CHUNK_STATE_UPLOADING) {
+		m_uploadQueue.erase(std::remove(m_uploadQueue.begin(), m_uploadQueue.end(), chunk.get()), m_uploadQueue.end());
+	}
+
+	// A proxy that is still drawn after the eviction has to show the latest state of the chunk
+	int proxyRadius = this->hlodRadius + std::max(0, this->evictionHysteresis);
+	if (this->hlodEnabled() && chunk->state == ChunkState::CHUNK_STATE_RESIDENT && chunk->proxyDirty &&
+		chunkDistance(chunk->index, m_currentChunk) <= proxyRadius && !this->isProxyBaking(chunk->index)) {
+		this->bakeChunkProxy(chunk.get());
+	}
+
+	// The entities leave the scene now, their GPU resources go once no frame in flight uses them
+	for (const auto& entity : chunk->entities) {
+		this->unregisterEntity(entity.get());
+		m_entityChunks.erase(entity.get());
+	}
+	uint64_t framesInFlight = m_renderer != nullptr ? static_cast<uint64_t>(m_renderer->getNumFramesInFlight()) : 0;
+	m_retiredChunks.push_back({ std::move(chunk), m_frame + framesInFlight + 1 });
+	m_activeChunksDirty = true;
+}
+
+void ChunkedScene3D::releaseRetiredChunks(bool all)
+{
+	for (size_t i = 0; i < m_retiredChunks.size();) {
+		RetiredChunk& retired = m_retiredChunks[i];
+		if (!all && retired.releaseFrame > m_frame) {
+			i++;
+			continue;
+		}
+		if (m_renderer != nullptr) {
+			releaseChunkCommandBuffers(retired.chunk.get(), m_renderer);
+			retired.chunk->staticGeometry.dispose(m_renderer);
+			for (const auto& entity : retired.chunk->entities) {
+				entity->destroy(this, m_renderer);
+			}
+		}
+		m_retiredChunks[i] = std::move(m_retiredChunks.back());
+		m_retiredChunks.pop_back();
+	}
+}
+
+void ChunkedScene3D::rebuildActiveChunks()
+{
+	// Only called when chunks change, not every frame
+	m_activeChunks.clear();
+	if (m_loadOffsetsRadius != this->loadRadius) {
+		this->rebuildLoadOffsets();
+	}
+	for (const auto& offset : m_loadOffsets) {
+		ChunkIndex chunkIndex = { m_currentChunk.chunkX + offset.chunkX, m_currentChunk.chunkY + offset.chunkY, m_currentChunk.chunkZ + offset.chunkZ };
+		auto* chunk = m_chunks.find(chunkIndex);
+		if (chunk != nullptr && (*chunk)->state == ChunkState::CHUNK_STATE_RESIDENT) {
+			m_activeChunks.push_back(chunk->get());
+		}
+	}
+	m_activeChunksDirty = false;
+}
+
+void ChunkedScene3D::waitForChunkLoads()
+{
+	if (m_loadCounter.isDone()) {
+		return;
+	}
+	auto jobSystem = GFX::instance().getService<JobSystem>(JobSystem::SERVICE_NAME);
+	if (jobSystem != nullptr) {
+		jobSystem->wait(m_loadCounter);
+	}
+}
+
+void ChunkedScene3D::updateChunkBounds(Chunk* chunk)
+{
+	chunk->bounds = AABB();
+	chunk->unbounded = false;
+	for (const auto& entity : chunk->entities) {
+		AABB aabb = entity->getAABB(true);
+		if (aabb.isValid()) {
+			chunk->bounds.expand(aabb);
+		}
+		else {
+			chunk->unbounded = true;
+		}
+	}
+	chunk->boundsDirty = false;
+}
+
+void ChunkedScene3D::cullChunks()
+{
+	// Entities moved by the last update marked their chunks dirty in syncSpatialIndex
+	for (Chunk* chunk : m_activeChunks) {
+		if (chunk->boundsDirty) {
+			this->updateChunkBounds(chunk);
+		}
+	}
+
+	if (this->cullingCamera == nullptr) {
+		for (Chunk* chunk : m_activeChunks) {
+			chunk->visibility = FrustumTestResult::FRUSTUM_TEST_INTERSECTS;
+		}
+		return;
+	}
+
+	const Frustum& frustum = this->cullingCamera->getFrustum();
+	for (Chunk* chunk : m_activeChunks) {
+		if (chunk->unbounded) {
+			chunk->visibility = FrustumTestResult::FRUSTUM_TEST_INTERSECTS;
+		}
+		else if (!chunk->bounds.isValid()) {
+			chunk->visibility = FrustumTestResult::FRUSTUM_TEST_OUTSIDE;
+		}
+		else {
+			chunk->visibility = frustum.classifyAABB(chunk->bounds);
+		}
+	}
+}
+
+void ChunkedScene3D::migrateEntities()
+{
+	if (m_migrations.empty()) {
+		return;
+	}
+
+	// An entity can be reported more than once if it waited for its chunk
+	std::sort(m_migrations.begin(), m_migrations.end());
+	m_migrations.erase(std::unique(m_migrations.begin(), m_migrations.end()), m_migrations.end());
+
+	size_t waiting = 0;
+	for (Entity* entity : m_migrations) {
+		// Entities of evicted chunks are not listed anymore
+		auto it = m_entityChunks.find(entity);
+		if (it == m_entityChunks.end()) {
+			continue;
+		}
+		Chunk* source = it->second.chunk;
+		ChunkIndex targetIndex = this->getChunkForPosition(entity->getPosition());
+		if (targetIndex == source->index) {
+			continue;
+		}
+
+		// Without a loader chunks are created on demand, streamed chunks have to be resident first
+		auto* slot = m_chunks.find(targetIndex);
+		Chunk* target = slot != nullptr ? slot->get() : nullptr;
+		if (target == nullptr && !this->chunkLoader) {
+			auto& created = m_chunks[targetIndex];
+			created = std::make_unique<Chunk>();
+			created->index = targetIndex;
+			created->state = ChunkState::CHUNK_STATE_RESIDENT;
+			target = created.get();
+			m_activeChunksDirty = true;
+		}
+		if (target == nullptr || target->state != ChunkState::CHUNK_STATE_RESIDENT || source->state != ChunkState::CHUNK_STATE_RESIDENT) {
+			m_migrations[waiting++] = entity;
+			continue;
+		}
+
+		// Entities of persistent chunks can't be restored by the loader, their new chunk must not be evicted
+		if (source->persistent) {
+			target->persistent = true;
+		}
+		EntityLocation location = it->second;
+		this->insertChunkEntity(target, this->removeChunkEntity(location));
+		source->boundsDirty = true;
+		target->boundsDirty = true;
+	}
+	m_migrations.resize(waiting);
+}
+
+void ChunkedScene3D::insertChunkEntity(Chunk* chunk, std::unique_ptr<Entity> entity)
+{
+	m_entityChunks[entity.get()] = { chunk, chunk->entities.size() };
+	chunk->entities.push_back(std::move(entity));
+	chunk->drawRevision++;
+	chunk->proxyDirty = true;
+}
+
+std::unique_ptr<Entity> ChunkedScene3D::removeChunkEntity(const EntityLocation& location)
+{
+	// Swap with the last entity so the removal doesn't shift the vector
+	auto& entities = location.chunk->entities;
+	std::unique_ptr<Entity> entity = std::move(entities[location.slot]);
+	if (location.slot + 1 < entities.size()) {
+		entities[location.slot] = std::move(entities.back());
+		m_entityChunks[entities[location.slot].get()].slot = location.slot;
+	}
+	entities.pop_back();
+	location.chunk->drawRevision++;
+	location.chunk->proxyDirty = true;
+	return entity;
+}
+
+void ChunkedScene3D::validateChunkDraws(Renderer* renderer, VkFramebuffer framebuffer)
+{
+	uint64_t materialRevision = Material::getRevision();
+	int camera = renderer->getActiveCamera();
+	if (materialRevision == m_recordedMaterialRevision && camera == m_recordedCamera && framebuffer == m_recordedFramebuffer) {
+		return;
+	}
+	m_chunks.forEach([](const ChunkIndex& chunkIndex, std::unique_ptr<Chunk>& chunk) {
+		chunk->drawRevision++;
+	});
+	m_recordedMaterialRevision = materialRevision;
+	m_recordedCamera = camera;
+	m_recordedFramebuffer = framebuffer;
+}
+
+VkCommandBuffer ChunkedScene3D::getChunkCommandBuffer(Chunk* chunk, Renderer* renderer, VkFramebuffer framebuffer, uint32_t currentFrame)
+{
+	// Frustum culling toggles the visible state of entities without moving them
+	uint64_t visibilityHash = 1469598103934665603ull;
+	for (const auto& entity : chunk->entities) {
+		uint32_t bits = (entity->hasState(EntityState::ENTITY_STATE_VISIBLE) ? 1u : 0u) | (entity->hasCacheableDraws() ? 2u : 0u);
+		visibilityHash = (visibilityHash ^ bits) * 1099511628211ull;
+	}
+	if (visibilityHash != chunk->visibilityHash) {
+		chunk->visibilityHash = visibilityHash;
+		chunk->drawRevision++;
+	}
+
+	if (chunk->commandBuffers.size() <= currentFrame) {
+		chunk->commandBuffers.resize(currentFrame + 1, VK_NULL_HANDLE);
+		chunk->recordedRevisions.resize(currentFrame + 1, 0);
+	}
+	VkCommandBuffer& commandBuffer = chunk->commandBuffers[currentFrame];
+	if (commandBuffer == VK_NULL_HANDLE) {
+		commandBuffer = renderer->createSecondaryCommandBuffer();
+	}
+
+	// The command buffer of this swapchain image is not in use anymore, it can be recorded again
+	if (chunk->recordedRevisions[currentFrame] != chunk->drawRevision) {
+		renderer->beginSecondaryCommandBuffer(commandBuffer, framebuffer, renderer->getOffscreenRenderPass());
+		chunk->staticGeometry.render(this, renderer, commandBuffer, currentFrame, nullptr);
+		for (const auto& entity : chunk->entities) {
+			if (entity->hasCacheableDraws()) {
+				entity->render(this, renderer, commandBuffer, currentFrame);
 			}
 		}
+		renderer->endSecondaryCommandBuffer(commandBuffer);
+		chunk->recordedRevisions[currentFrame] = chunk->drawRevision;
 	}
+	return commandBuffer;
+}
 
-	// Check current chunk entities
-	auto it = m_chunks.find(m_currentChunk);
-	if (it != m_chunks.end()) {
-		const auto& entities = it->second;
-		for (const auto& entity : entities) {
-			if (entity->hasState(EntityState::ENTITY_STATE_RAYCASTABLE)) {
-				AABB worldAabb = entity->getAABB(true);
-				float tMin, tMax;
-				if (RayCast::rayIntersectsAABB(ray, worldAabb, tMin, tMax)) {
-					if (tMin < closestDistance) {
-						closestDistance = tMin;
-						hitEntity = entity.get();
+VkCommandBuffer ChunkedScene3D::beginFrameCommandBuffer(Renderer* renderer, VkFramebuffer framebuffer, uint32_t currentFrame, size_t slot)
+{
+	size_t index = static_cast<size_t>(currentFrame) * 2 + slot;
+	if (m_frameCommandBuffers.size() <= index) {
+		m_frameCommandBuffers.resize(index + 1, VK_NULL_HANDLE);
+	}
+	if (m_frameCommandBuffers[index] == VK_NULL_HANDLE) {
+		m_frameCommandBuffers[index] = renderer->createSecondaryCommandBuffer();
+	}
+	renderer->beginSecondaryCommandBuffer(m_frameCommandBuffers[index], framebuffer, renderer->getOffscreenRenderPass());
+	return m_frameCommandBuffers[index];
+}
+
+void ChunkedScene3D::releaseChunkCommandBuffers(Chunk* chunk, Renderer* renderer)
+{
+	for (VkCommandBuffer commandBuffer : chunk->commandBuffers) {
+		renderer->destroyCommandBuffer(commandBuffer);
+	}
+	chunk->commandBuffers.clear();
+	chunk->recordedRevisions.clear();
+}
+
+void ChunkedScene3D::releaseCommandBuffers(Renderer* renderer)
+{
+	m_chunks.forEach([renderer](const ChunkIndex& chunkIndex, std::unique_ptr<Chunk>& chunk) {
+		releaseChunkCommandBuffers(chunk.get(), renderer);
+	});
+	for (auto& retired : m_retiredChunks) {
+		releaseChunkCommandBuffers(retired.chunk.get(), renderer);
+	}
+	for (VkCommandBuffer commandBuffer : m_frameCommandBuffers) {
+		renderer->destroyCommandBuffer(commandBuffer);
+	}
+	m_frameCommandBuffers.clear();
+	m_recordedFramebuffer = VK_NULL_HANDLE;
+}
+
+void ChunkedScene3D::updateProxies()
+{
+	if (m_renderer == nullptr) {
+		return;
+	}
+	this->releaseRetiredProxies(false);
+	m_proxyDraws.clear();
+	if (!this->hlodEnabled()) {
+		// Proxies of a disabled HLOD are released, bakes that are still running are dropped on upload
+		m_proxies.forEach([this](const ChunkIndex& chunkIndex, std::unique_ptr<ChunkProxy>& proxy) {
+			this->retireProxy(std::move(proxy));
+		});
+		m_proxies.clear();
+		m_proxyRequests.clear();
+		m_proxiesDirty = true;
+		return;
+	}
+
+	this->uploadProxies();
+
+	int proxyRadius = this->hlodRadius + std::max(0, this->evictionHysteresis);
+	if (m_proxiesDirty) {
+		// Evict proxies that left the HLOD radius plus the hysteresis
+		std::vector<ChunkIndex> evicted;
+		m_proxies.forEach([&](const ChunkIndex& chunkIndex, std::unique_ptr<ChunkProxy>& proxy) {
+			if (chunkDistance(chunkIndex, m_currentChunk) > proxyRadius) {
+				evicted.push_back(chunkIndex);
+			}
+		});
+		for (const auto& chunkIndex : evicted) {
+			this->retireProxy(std::move(*m_proxies.find(chunkIndex)));
+			m_proxies.erase(chunkIndex);
+		}
+
+		// Chunks beyond the load radius may have an offline proxy, nearest first
+		m_proxyRequests.clear();
+		if (this->proxyLoader) {
+			std::vector<ChunkIndex> requests;
+			for (int x = -this->hlodRadius; x <= this->hlodRadius; x++) {
+				for (int y = -this->hlodRadius; y <= this->hlodRadius; y++) {
+					for (int z = -this->hlodRadius; z <= this->hlodRadius; z++) {
+						ChunkIndex chunkIndex = { m_currentChunk.chunkX + x, m_currentChunk.chunkY + y, m_currentChunk.chunkZ + z };
+						if (chunkDistance(chunkIndex, m_currentChunk) > this->loadRadius) {
+							requests.push_back(chunkIndex);
+						}
 					}
 				}
 			}
+			std::stable_sort(requests.begin(), requests.end(), [this](const ChunkIndex& a, const ChunkIndex& b) {
+				return chunkDistance(a, m_currentChunk) < chunkDistance(b, m_currentChunk);
+			});
+			m_proxyRequests.assign(requests.begin(), requests.end());
 		}
+		m_proxiesDirty = false;
 	}
 
-	// check neighboring chunk entities 
-	for (const auto& neighborIndex : m_neighboringChunks) {
-		auto neighborsIt = m_chunks.find(neighborIndex);
-		if (neighborsIt != m_chunks.end()) {
-			const auto& entities = neighborsIt->second;
-			for (const auto& entity : entities) {
-				if (entity->hasState(EntityState::ENTITY_STATE_RAYCASTABLE)) {
-					AABB worldAabb = entity->getAABB(true);
-					float tMin, tMax;
-					if (RayCast::rayIntersectsAABB(ray, worldAabb, tMin, tMax)) {
-						if (tMin < closestDistance) {
-							closestDistance = tMin;
-							hitEntity = entity.get();
-						}
+	// Bake resident chunks whose proxy is missing or outdated, an outdated proxy within the load radius
+	// is not drawn, so it is baked again once its chunk leaves the load radius
+	size_t maxBakes = std::max<size_t>(1, this->maxConcurrentProxyBakes);
+	m_chunks.forEach([&](const ChunkIndex& chunkIndex, std::unique_ptr<Chunk>& chunk) {
+		if (m_proxyBakes.size() >= maxBakes || chunk->state != ChunkState::CHUNK_STATE_RESIDENT) {
+			return;
+		}
+		bool missing = m_proxies.find(chunkIndex) == nullptr;
+		int distance = chunkDistance(chunkIndex, m_currentChunk);
+		if (distance > proxyRadius || (!missing && (!chunk->proxyDirty || distance <= this->loadRadius))) {
+			return;
+		}
+		if (!this->isProxyBaking(chunkIndex)) {
+			this->bakeChunkProxy(chunk.get());
+		}
+	});
+
+	// Load the offline proxies of chunks that were never resident
+	while (!m_proxyRequests.empty() && m_proxyBakes.size() < maxBakes) {
+		ChunkIndex chunkIndex = m_proxyRequests.front();
+		m_proxyRequests.pop_front();
+		if (m_proxies.find(chunkIndex) != nullptr || this->isProxyBaking(chunkIndex) || this->isChunkResident(chunkIndex)) {
+			continue;
+		}
+		auto bake = std::make_unique<ProxyBake>();
+		bake->index = chunkIndex;
+		bake->offline = true;
+		this->startProxyBake(std::move(bake));
+	}
+
+	// Collect the proxies to draw, chunks within the load radius draw their entities once they are resident
+	const Frustum* frustum = this->cullingCamera != nullptr ? &this->cullingCamera->getFrustum() : nullptr;
+	m_proxies.forEach([&](const ChunkIndex& chunkIndex, std::unique_ptr<ChunkProxy>& proxy) {
+		if (proxy->geometryIndex < 0) {
+			return;
+		}
+		int distance = chunkDistance(chunkIndex, m_currentChunk);
+		if (distance > this->hlodRadius || (distance <= this->loadRadius && this->isChunkResident(chunkIndex))) {
+			return;
+		}
+		if (frustum != nullptr && frustum->classifyAABB(proxy->bounds) == FrustumTestResult::FRUSTUM_TEST_OUTSIDE) {
+			return;
+		}
+		m_proxyDraws.push_back(proxy.get());
+	});
+}
+
+void ChunkedScene3D::bakeChunkProxy(Chunk* chunk)
+{
+	// The job only reads the HLOD sources of the mesh resources, so it doesn't depend on the entities
+	auto bake = std::make_unique<ProxyBake>();
+	bake->index = chunk->index;
+	for (const auto& entity : chunk->entities) {
+		auto model = dynamic_cast<Model*>(entity.get());
+		if (model == nullptr || model->getMeshResource() == nullptr || model->getMeshResource()->getHLODSource().empty()) {
+			continue;
+		}
+		bake->sources.push_back({ &model->getMeshResource()->getHLODSource(), model->getWorldMatrix() });
+	}
+	chunk->proxyDirty = false;
+	this->startProxyBake(std::move(bake));
+}
+
+void ChunkedScene3D::startProxyBake(std::unique_ptr<ProxyBake> bake)
+{
+	auto jobSystem = GFX::instance().getService<JobSystem>(JobSystem::SERVICE_NAME);
+	ProxyBake* job = bake.get();
+	m_proxyBakes.push_back(std::move(bake));
+
+	auto run = [job, cellSize = this->hlodCellSize, loader = this->proxyLoader]() {
+		try {
+			if (job->offline) {
+				job->data = loader(job->index);
+			}
+			else {
+				HLODBuilder builder;
+				for (const auto& [meshes, worldMatrix] : job->sources) {
+					for (const auto& mesh : *meshes) {
+						builder.addMesh(mesh, worldMatrix);
 					}
 				}
+				job->data = builder.build(cellSize);
 			}
 		}
+		catch (...) {
+			job->bakeError = std::current_exception();
+		}
+		job->baked.store(true, std::memory_order_release);
+	};
+
+	// Without a job system the proxy is baked right away
+	if (jobSystem != nullptr) {
+		jobSystem->submit(run, &m_proxyCounter);
+	}
+	else {
+		run();
 	}
+}
 
-	RayHit hitResult = {};
-	hitResult.hitobject = hitEntity;
-	hitResult.distance = (hitEntity != nullptr) ? closestDistance : -1.0f;
-	hitResult.position = ray.origin + ray.direction * closestDistance;
-	hitResult.hit = (hitEntity != nullptr);
-	return hitResult;
+void ChunkedScene3D::uploadProxies()
+{
+	int proxyRadius = this->hlodRadius + std::max(0, this->evictionHysteresis);
+	for (size_t i = 0; i < m_proxyBakes.size();) {
+		if (!m_proxyBakes[i]->baked.load(std::memory_order_acquire)) {
+			i++;
+			continue;
+		}
+		std::unique_ptr<ProxyBake> bake = std::move(m_proxyBakes[i]);
+		m_proxyBakes[i] = std::move(m_proxyBakes.back());
+		m_proxyBakes.pop_back();
+
+		if (bake->bakeError) {
+			std::rethrow_exception(bake->bakeError);
+		}
+		if (chunkDistance(bake->index, m_currentChunk) > proxyRadius) {
+			continue;
+		}
+
+		// The proxy is one mesh with a PBR material, the atlas is its albedo and the other maps are neutral
+		auto proxy = std::make_unique<ChunkProxy>();
+		HLODMeshData& data = bake->data;
+		if (!data.indices.empty()) {
+			if (data.atlasWidth <= 0 || data.atlasHeight <= 0 || data.atlasPixels.size() != static_cast<size_t>(data.atlasWidth) * data.atlasHeight * 4) {
+				throw std::runtime_error("failed to upload hlod proxy: invalid atlas size!");
+			}
+			proxy->material = std::make_unique<PBRMaterial>();
+			proxy->material->setAlbedoTexture(std::make_unique<ImageTexture>(data.atlasWidth, data.atlasHeight, data.atlasPixels));
+			proxy->material->setNormalTexture(std::make_unique<ImageTexture>(1, 1, std::vector<uint8_t>{ 128, 128, 255, 255 }));
+			proxy->material->setMetRoughTexture(std::make_unique<ImageTexture>(1, 1, std::vector<uint8_t>{ 0, 255, 0, 255 }));
+			proxy->material->setAOTexture(std::make_unique<ImageTexture>(1, 1, std::vector<uint8_t>{ 255, 255, 255, 255 }));
+			proxy->material->init(m_renderer);
+			proxy->geometryIndex = m_renderer->createGeometry(&data.vertices, &data.indices);
+			proxy->bounds = data.bounds;
+		}
+
+		// The old proxy may still be used by frames in flight
+		auto& slot = m_proxies[bake->index];
+		if (slot != nullptr) {
+			this->retireProxy(std::move(slot));
+		}
+		slot = std::move(proxy);
+	}
 }
 
+void ChunkedScene3D::retireProxy(std::unique_ptr<ChunkProxy> proxy)
+{
+	uint64_t framesInFlight = m_renderer != nullptr ? static_cast<uint64_t>(m_renderer->getNumFramesInFlight()) : 0;
+	m_retiredProxies.push_back({ std::move(proxy), m_frame + framesInFlight + 1 });
+}
+
+void ChunkedScene3D::releaseRetiredProxies(bool all)
+{
+	for (size_t i = 0; i < m_retiredProxies.size();) {
+		if (!all && m_retiredProxies[i].releaseFrame > m_frame) {
+			i++;
+			continue;
+		}
+		this->releaseProxy(m_retiredProxies[i].proxy.get());
+		m_retiredProxies[i] = std::move(m_retiredProxies.back());
+		m_retiredProxies.pop_back();
+	}
+}
+
+void ChunkedScene3D::releaseProxy(ChunkProxy* proxy)
+{
+	if (m_renderer == nullptr || proxy->material == nullptr) {
+		return;
+	}
+	proxy->material->dispose(m_renderer);
+	m_renderer->disposeGeometry(proxy->geometryIndex);
+}
+
+void ChunkedScene3D::waitForProxyBakes()
+{
+	if (m_proxyCounter.isDone()) {
+		return;
+	}
+	auto jobSystem = GFX::instance().getService<JobSystem>(JobSystem::SERVICE_NAME);
+	if (jobSystem != nullptr) {
+		jobSystem->wait(m_proxyCounter);
+	}
+}
+
+bool ChunkedScene3D::isProxyBaking(const ChunkIndex& index) const
+{
+	for (const auto& bake : m_proxyBakes) {
+		if (bake->index == index) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void ChunkedScene3D::renderProxies(Renderer* renderer, VkCommandBuffer commandBuffer, uint32_t currentFrame)
+{
+	if (m_proxyDraws.empty()) {
+		return;
+	}
+
+	// Proxies are baked in world space, all of them share the pipeline, the lights and the camera
+	std::string pipelineType = ToString(PipelineType::PIPELINE_TYPE_GRAPHICS_3D);
+	UboModel modelMatrix = { glm::mat4(1.0f) };
+	renderer->bindPipeline(commandBuffer, pipelineType);
+	this->bindSceneDescriptorSets(renderer, commandBuffer, currentFrame, pipelineType);
+	renderer->bindPushConstants(commandBuffer, renderer->getCurrentPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(UboModel), &modelMatrix);
+	renderer->bindDescriptorSet(renderer->getCameraDescriptorSet(renderer->getActiveCamera(), currentFrame), 0, currentFrame);
+
+	for (ChunkProxy* proxy : m_proxyDraws) {
+		proxy->material->bindMaterial(renderer, commandBuffer, 1, currentFrame);
+		renderer->drawGeometry(proxy->geometryIndex, commandBuffer);
+	}
+}
@@ -1,48 +1,494 @@
 ﻿#pragma once
 #include "Scene.h"
 #include "Entity.h"
-#include <map>
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <unordered_map>
 #include <vector>
+#include "ChunkMap.h"
+#include "JobSystem.h"
 #include "../Graphics/DirectionalLight.h"
+#include "../Graphics/HLODBuilder.h"
+#include "../Graphics/PBRMaterial.h"
+#include "StaticGeometry.h"
 
 /// <summary>
-/// The chunk index structure
+/// Loads the entities of a chunk, e.g. from a file on disk
+/// Runs on a worker thread, so it should only do CPU work like reading files, creating the entities
+/// and setting their transforms and AABBs. GPU resources are created by Entity::init on the main thread.
 /// </summary>
-struct ChunkIndex {
-	int chunkX;
-	int chunkY;
-	int chunkZ;
+using ChunkLoader = std::function<std::vector<std::unique_ptr<Entity>>(const ChunkIndex&)>;
 
-	auto operator<=>(const ChunkIndex&) const = default;
-	bool operator==(const ChunkIndex&) const = default;
-};
+/// <summary>
+/// Loads the HLOD proxy of a chunk that was baked offline
+/// Runs on a worker thread like the chunk loader. Return an empty mesh for chunks without a proxy.
+/// </summary>
+using ChunkProxyLoader = std::function<HLODMeshData(const ChunkIndex&)>;
 
 /// <summary>
 /// Scene for streaming large 3D worlds in chunks
+/// Chunks are kept in a hash map. Without a chunk loader all chunks stay resident. With a chunk loader
+/// the chunks within the load radius are loaded on the job system, their entities are initialized a few
+/// per frame and chunks outside the load radius plus the hysteresis are evicted.
 /// </summary>
 class ChunkedScene3D : 
 	public Scene
 {
 private:
+	/// <summary>
+	/// The streaming states of a chunk
+	/// </summary>
+	enum class ChunkState {
+		CHUNK_STATE_QUEUED,		// Waits for a free load slot
+		CHUNK_STATE_LOADING,	// The loader runs on a worker thread
+		CHUNK_STATE_UPLOADING,	// The loaded entities are initialized a few per frame
+		CHUNK_STATE_RESIDENT	// All entities are initialized and active
+	};
+
+	/// <summary>
+	/// A chunk and its entities
+	/// </summary>
+	struct Chunk {
+		ChunkIndex index = { 0, 0, 0 };
+		ChunkState state = ChunkState::CHUNK_STATE_QUEUED;
+
+		/// <summary>
+		/// Chunks with entities added by addEntityToChunk are never evicted
+		/// </summary>
+		bool persistent = false;
+
+		/// <summary>
+		/// The initialized entities of the chunk
+		/// </summary>
+		std::vector<std::unique_ptr<Entity>> entities;
+
+		/// <summary>
+		/// Entities created by the loader that are not initialized yet
+		/// </summary>
+		std::vector<std::unique_ptr<Entity>> loadedEntities;
+
+		/// <summary>
+		/// Set by the loader job once loadedEntities is filled
+		/// </summary>
+		std::atomic<bool> loaded = false;
+
+		/// <summary>
+		/// Exception thrown by the loader, rethrown on the main thread
+		/// </summary>
+		std::exception_ptr loadError;
+
+		/// <summary>
+		/// World AABB of all entities of the chunk, invalid for an empty chunk
+		/// </summary>
+		AABB bounds;
+
+		/// <summary>
+		/// Whether entities were added or moved since the bounds were computed
+		/// </summary>
+		bool boundsDirty = true;
+
+		/// <summary>
+		/// Set if an entity of the chunk has no valid AABB, the chunk can't be culled as a whole then
+		/// </summary>
+		bool unbounded = false;
+
+		/// <summary>
+		/// Result of the last chunk frustum test against the culling camera
+		/// </summary>
+		FrustumTestResult visibility = FrustumTestResult::FRUSTUM_TEST_INTERSECTS;
+
+		/// <summary>
+		/// Secondary command buffers with the draws of the chunk, one per swapchain image
+		/// </summary>
+		std::vector<VkCommandBuffer> commandBuffers;
+
+		/// <summary>
+		/// The draw revision each command buffer was recorded with
+		/// </summary>
+		std::vector<uint64_t> recordedRevisions;
+
+		/// <summary>
+		/// Changes whenever the draws of the chunk change
+		/// </summary>
+		uint64_t drawRevision = 1;
+
+		/// <summary>
+		/// Hash of the visible and cacheable states of the entities when the draws were last checked
+		/// </summary>
+		uint64_t visibilityHash = 0;
+
+		/// <summary>
+		/// Whether entities were added, removed or moved since the HLOD proxy was baked
+		/// </summary>
+		bool proxyDirty = true;
+
+		/// <summary>
+		/// The merged geometry of the static models of the chunk, built when the chunk becomes resident
+		/// </summary>
+		StaticGeometry staticGeometry;
+	};
+
+	/// <summary>
+	/// The simplified stand-in of a chunk, drawn with one draw call beyond the load radius
+	/// </summary>
+	struct ChunkProxy {
+		int geometryIndex = -1;		// -1 if the chunk has no geometry
+		std::unique_ptr<PBRMaterial> material;
+		AABB bounds;
+	};
+
+	/// <summary>
+	/// A proxy bake running on the job system
+	/// </summary>
+	struct ProxyBake {
+		ChunkIndex index = { 0, 0, 0 };
+
+		/// <summary>
+		/// Offline proxies come from the proxy loader instead of the models of the chunk
+		/// </summary>
+		bool offline = false;
+
+		/// <summary>
+		/// HLOD source meshes and world matrices of the models of the chunk
+		/// </summary>
+		std::vector<std::pair<const std::vector<HLODSourceMesh>*, glm::mat4>> sources;
+
+		HLODMeshData data;
+		std::atomic<bool> baked = false;
+		std::exception_ptr bakeError;
+	};
+
+	/// <summary>
+	/// A replaced or evicted proxy waiting until the GPU is done with the frames that used it
+	/// </summary>
+	struct RetiredProxy {
+		std::unique_ptr<ChunkProxy> proxy;
+		uint64_t releaseFrame;
+	};
+
+	/// <summary>
+	/// Where a chunk entity is stored
+	/// </summary>
+	struct EntityLocation {
+		Chunk* chunk;
+		size_t slot;	// Index in chunk->entities
+	};
+
+	/// <summary>
+	/// An evicted chunk waiting until the GPU is done with the frames that used it
+	/// </summary>
+	struct RetiredChunk {
+		std::unique_ptr<Chunk> chunk;
+		uint64_t releaseFrame;
+	};
+
 	/// <summary>
 	/// The chunks in the scene
 	/// </summary>
-	std::map<ChunkIndex, std::vector<std::unique_ptr<Entity>>> m_chunks;
+	ChunkMap<std::unique_ptr<Chunk>> m_chunks;
 
 	/// <summary>
 	/// Global entities that are not part of any chunk
 	/// </summary>
 	std::vector<std::unique_ptr<Entity>> m_globalEntities;				
 
+	/// <summary>
+	/// The merged geometry of the static global models
+	/// </summary>
+	StaticGeometry m_globalStaticGeometry;
+
+	/// <summary>
+	/// The location of each chunk entity, global entities are not listed
+	/// </summary>
+	std::unordered_map<const Entity*, EntityLocation> m_entityChunks;
+
+	/// <summary>
+	/// Entities that moved into another chunk, they are moved at the end of the update
+	/// </summary>
+	std::vector<Entity*> m_migrations;
+
 	/// <summary>
 	/// The current active chunk
 	/// </summary>
 	ChunkIndex m_currentChunk = { 0, 0, 0 };
 
 	/// <summary>
-	/// The neighboring chunks of the current active chunk
+	/// Resident chunks within the load radius, nearest first
+	/// Rebuilt only when the current chunk changes or chunks are loaded or evicted.
+	/// </summary>
+	std::vector<Chunk*> m_activeChunks;
+
+	/// <summary>
+	/// Whether the active chunks have to be rebuilt
+	/// </summary>
+	bool m_activeChunksDirty = true;
+
+	/// <summary>
+	/// Whether chunks have to be requested and evicted for a new current chunk
+	/// </summary>
+	bool m_streamingDirty = true;
+
+	/// <summary>
+	/// Chunk offsets within the load radius sorted by distance
+	/// </summary>
+	std::vector<ChunkIndex> m_loadOffsets;
+
+	/// <summary>
+	/// The load radius m_loadOffsets was built for
+	/// </summary>
+	int m_loadOffsetsRadius = -1;
+
+	/// <summary>
+	/// Chunks waiting for a load slot, nearest first
+	/// </summary>
+	std::deque<Chunk*> m_loadQueue;
+
+	/// <summary>
+	/// Chunks whose loader job is running
 	/// </summary>
-	std::vector<ChunkIndex> m_neighboringChunks;
+	std::vector<Chunk*> m_loadingChunks;
+
+	/// <summary>
+	/// Loaded chunks whose entities are initialized a few per frame
+	/// </summary>
+	std::deque<Chunk*> m_uploadQueue;
+
+	/// <summary>
+	/// Evicted chunks waiting for their destruction
+	/// </summary>
+	std::vector<RetiredChunk> m_retiredChunks;
+
+	/// <summary>
+	/// Tracks the running loader jobs
+	/// </summary>
+	JobCounter m_loadCounter;
+
+	/// <summary>
+	/// The renderer the scene was initialized with, used to initialize streamed entities
+	/// </summary>
+	Renderer* m_renderer = nullptr;
+
+	/// <summary>
+	/// Number of updates so far, used to delay the destruction of evicted chunks
+	/// </summary>
+	uint64_t m_frame = 0;
+
+	/// <summary>
+	/// Entities to update this frame, reused between frames
+	/// </summary>
+	std::vector<Entity*> m_updateQueue;
+
+	/// <summary>
+	/// Secondary command buffers for the draws that are not cached, two per swapchain image
+	/// One for the draws before and one for the draws after the chunks.
+	/// </summary>
+	std::vector<VkCommandBuffer> m_frameCommandBuffers;
+
+	/// <summary>
+	/// Secondary command buffers executed this frame, reused between frames
+	/// </summary>
+	std::vector<VkCommandBuffer> m_executeQueue;
+
+	/// <summary>
+	/// The HLOD proxies of the chunks within the HLOD radius
+	/// </summary>
+	ChunkMap<std::unique_ptr<ChunkProxy>> m_proxies;
+
+	/// <summary>
+	/// Proxies whose bake is running or waiting for its upload
+	/// </summary>
+	std::vector<std::unique_ptr<ProxyBake>> m_proxyBakes;
+
+	/// <summary>
+	/// Replaced and evicted proxies waiting for their destruction
+	/// </summary>
+	std::vector<RetiredProxy> m_retiredProxies;
+
+	/// <summary>
+	/// Proxies to draw this frame, rebuilt every update
+	/// </summary>
+	std::vector<ChunkProxy*> m_proxyDraws;
+
+	/// <summary>
+	/// Chunks within the HLOD radius that may have an offline proxy, nearest first
+	/// </summary>
+	std::deque<ChunkIndex> m_proxyRequests;
+
+	/// <summary>
+	/// Whether offline proxies have to be requested and proxies evicted for a new current chunk
+	/// </summary>
+	bool m_proxiesDirty = true;
+
+	/// <summary>
+	/// Tracks the running proxy bakes
+	/// </summary>
+	JobCounter m_proxyCounter;
+
+	/// <summary>
+	/// Material revision, camera and framebuffer the cached chunk draws were recorded with
+	/// </summary>
+	uint64_t m_recordedMaterialRevision = 0;
+	int m_recordedCamera = -1;
+	VkFramebuffer m_recordedFramebuffer = VK_NULL_HANDLE;
+
+	/// <summary>
+	/// Chebyshev distance between two chunks
+	/// </summary>
+	/// <param name="a"></param>
+	/// <param name="b"></param>
+	/// <returns></returns>
+	static int chunkDistance(const ChunkIndex& a, const ChunkIndex& b);
+
+	/// <summary>
+	/// Runs one streaming step: requests and evicts chunks, starts loads, initializes loaded entities
+	/// and destroys evicted chunks the GPU is done with
+	/// </summary>
+	void updateStreaming();
+
+	void rebuildLoadOffsets();
+	void requestChunks();
+	void startChunkLoads();
+	void collectLoadedChunks();
+	void uploadChunks();
+
+	/// <summary>
+	/// Merges the static models of a chunk if static batching is enabled
+	/// </summary>
+	/// <param name="chunk"></param>
+	void buildChunkStaticGeometry(Chunk* chunk);
+	void retireChunk(const ChunkIndex& index);
+	void releaseRetiredChunks(bool all);
+	void rebuildActiveChunks();
+	void waitForChunkLoads();
+
+	/// <summary>
+	/// Whether HLOD proxies are enabled, they need an HLOD radius beyond the load radius
+	/// </summary>
+	/// <returns></returns>
+	bool hlodEnabled() const {
+		return this->hlodRadius > this->loadRadius;
+	}
+
+	/// <summary>
+	/// Runs one HLOD step: starts bakes for changed chunks and missing offline proxies, uploads finished
+	/// bakes, evicts proxies out of range and collects the proxies to draw
+	/// </summary>
+	void updateProxies();
+
+	/// <summary>
+	/// Starts a bake from the models of a resident chunk
+	/// </summary>
+	/// <param name="chunk"></param>
+	void bakeChunkProxy(Chunk* chunk);
+
+	/// <summary>
+	/// Starts a bake job, without a job system the proxy is baked right away
+	/// </summary>
+	/// <param name="bake"></param>
+	void startProxyBake(std::unique_ptr<ProxyBake> bake);
+
+	/// <summary>
+	/// Creates the buffers and the material of finished bakes
+	/// </summary>
+	void uploadProxies();
+
+	/// <summary>
+	/// Moves a proxy into the retired proxies
+	/// </summary>
+	/// <param name="proxy"></param>
+	void retireProxy(std::unique_ptr<ChunkProxy> proxy);
+	void releaseRetiredProxies(bool all);
+	void releaseProxy(ChunkProxy* proxy);
+	void waitForProxyBakes();
+
+	/// <summary>
+	/// Whether a bake for the chunk is running or waiting for its upload
+	/// </summary>
+	/// <param name="index"></param>
+	/// <returns></returns>
+	bool isProxyBaking(const ChunkIndex& index) const;
+
+	/// <summary>
+	/// Draws the proxies collected by the last update
+	/// </summary>
+	/// <param name="renderer"></param>
+	/// <param name="commandBuffer"></param>
+	/// <param name="currentFrame"></param>
+	void renderProxies(Renderer* renderer, VkCommandBuffer commandBuffer, uint32_t currentFrame);
+
+	/// <summary>
+	/// Recomputes the bounds of a chunk from the world AABBs of its entities
+	/// </summary>
+	/// <param name="chunk"></param>
+	void updateChunkBounds(Chunk* chunk);
+
+	/// <summary>
+	/// Tests the bounds of the active chunks against the frustum of the culling camera
+	/// </summary>
+	void cullChunks();
+
+	/// <summary>
+	/// Moves the entities that crossed a chunk border into their new chunk
+	/// Entities whose new chunk is still streaming in stay in their old chunk and are retried next update.
+	/// </summary>
+	void migrateEntities();
+
+	/// <summary>
+	/// Appends an entity to a chunk and records its location
+	/// </summary>
+	/// <param name="chunk"></param>
+	/// <param name="entity"></param>
+	void insertChunkEntity(Chunk* chunk, std::unique_ptr<Entity> entity);
+
+	/// <summary>
+	/// Removes an entity from its chunk by swapping it with the last entity
+	/// </summary>
+	/// <param name="location"></param>
+	/// <returns>The removed entity</returns>
+	std::unique_ptr<Entity> removeChunkEntity(const EntityLocation& location);
+
+	/// <summary>
+	/// Invalidates all cached chunk draws if a material, the active camera or the framebuffer changed
+	/// </summary>
+	/// <param name="renderer"></param>
+	/// <param name="framebuffer"></param>
+	void validateChunkDraws(Renderer* renderer, VkFramebuffer framebuffer);
+
+	/// <summary>
+	/// Returns the secondary command buffer with the draws of the chunk, records it again if the draws changed
+	/// </summary>
+	/// <param name="chunk"></param>
+	/// <param name="renderer"></param>
+	/// <param name="framebuffer"></param>
+	/// <param name="currentFrame"></param>
+	/// <returns></returns>
+	VkCommandBuffer getChunkCommandBuffer(Chunk* chunk, Renderer* renderer, VkFramebuffer framebuffer, uint32_t currentFrame);
+
+	/// <summary>
+	/// Begins one of the per frame secondary command buffers
+	/// </summary>
+	/// <param name="renderer"></param>
+	/// <param name="framebuffer"></param>
+	/// <param name="currentFrame"></param>
+	/// <param name="slot">0 for the draws before the chunks, 1 for the draws after them</param>
+	/// <returns></returns>
+	VkCommandBuffer beginFrameCommandBuffer(Renderer* renderer, VkFramebuffer framebuffer, uint32_t currentFrame, size_t slot);
+
+	/// <summary>
+	/// Frees the cached command buffers of a chunk
+	/// </summary>
+	/// <param name="chunk"></param>
+	/// <param name="renderer"></param>
+	static void releaseChunkCommandBuffers(Chunk* chunk, Renderer* renderer);
+
+	/// <summary>
+	/// Frees all secondary command buffers of the scene
+	/// </summary>
+	/// <param name="renderer"></param>
+	void releaseCommandBuffers(Renderer* renderer);
+
 public:
 	/// <summary>
 	/// The skybox of the scene
@@ -59,16 +505,97 @@ public:
 	/// </summary>
 	float chunkSize = 100.0f;
 
+	/// <summary>
+	/// Loads the entities of streamed chunks, streaming is disabled while it is empty
+	/// </summary>
+	ChunkLoader chunkLoader;
+
+	/// <summary>
+	/// Chunks within this Chebyshev distance of the current chunk are loaded and active
+	/// </summary>
+	int loadRadius = 1;
+
+	/// <summary>
+	/// Extra distance before a streamed chunk is evicted, avoids reloading when moving along a chunk border
+	/// </summary>
+	int evictionHysteresis = 1;
+
+	/// <summary>
+	/// Maximum number of chunks loading at the same time
+	/// </summary>
+	size_t maxConcurrentChunkLoads = 4;
+
+	/// <summary>
+	/// Maximum number of streamed entities initialized per frame, bounds the GPU uploads of a frame
+	/// </summary>
+	size_t maxEntityUploadsPerFrame = 32;
+
+	/// <summary>
+	/// Camera the active chunks are culled against, chunk culling is disabled while it is nullptr
+	/// Chunks outside its frustum are not rendered. FrustumCullingBhv components using the same camera
+	/// only test their entity if its chunk is partly visible.
+	/// </summary>
+	Camera* cullingCamera = nullptr;
+
+	/// <summary>
+	/// Records the draws of each chunk once into a secondary command buffer and replays it every frame
+	/// Only entities whose draws are cacheable (see Entity::hasCacheableDraws, e.g. static models with a single LOD)
+	/// are recorded, all other entities of the chunk still render every frame. A chunk is recorded again only when
+	/// one of its entities is added, removed, moved or changes its visibility, or when a material, the active camera
+	/// or the render target changes.
+	/// </summary>
+	bool cacheChunkCommandBuffers = false;
+
+	/// <summary>
+	/// Chunks beyond the load radius up to this Chebyshev distance are drawn with their HLOD proxy
+	/// Proxies are disabled while it is not larger than the load radius. A proxy merges the models of a chunk
+	/// whose mesh resource keeps an HLOD source into one simplified mesh with one material, it is baked on the
+	/// job system when the chunk becomes resident and again when its entities changed.
+	/// </summary>
+	int hlodRadius = 0;
+
+	/// <summary>
+	/// Edge length of the clustering cells used to simplify proxies, larger cells give coarser proxies
+	/// </summary>
+	float hlodCellSize = 4.0f;
+
+	/// <summary>
+	/// Loads proxies baked offline for chunks that were never resident, optional
+	/// </summary>
+	ChunkProxyLoader proxyLoader;
+
+	/// <summary>
+	/// Maximum number of proxies baking at the same time
+	/// </summary>
+	size_t maxConcurrentProxyBakes = 2;
+
+	/// <summary>
+	/// Merges the models with the ENTITY_STATE_STATIC state into world space clusters
+	/// The models of a chunk are merged at init or once its streamed entities are initialized, the global models at init.
+	/// Every cluster holds the triangles of one material inside one grid cell and is culled against the culling camera.
+	/// Static models must stay inside their chunk, entities added to a resident chunk later draw themselves.
+	/// Merged models are drawn with their full detail meshes, they don't switch LODs anymore.
+	/// </summary>
+	bool staticBatching = false;
+
+	/// <summary>
+	/// Edge length of the grid cells the static geometry is split into
+	/// </summary>
+	float staticClusterSize = 32.0f;
+
 	/// <summary>
 	/// Creates a new chunked 3D scene with an initial position
 	/// </summary>
 	/// <param name="initialPosition"></param>
 	ChunkedScene3D(glm::vec3 initialPosition);
+	~ChunkedScene3D();
 
+	void enableEntityStorage() override;
 	void init(Renderer* renderer) override;
 	void update(float deltaTime) override;
 	void render(Renderer* renderer, VkCommandBuffer commandBuffer, uint32_t currentFrame) override;
 	void destroy(Renderer* renderer) override;
+	void beforeSwapchainRecreate(Renderer* renderer) override;
 
 	/// <summary>
 	/// Get the chunk data for a given world position
@@ -79,6 +606,7 @@ public:
 
 	/// <summary>
 	/// Add an entity to the appropriate chunk based on its position
+	/// The entity is moved to another chunk automatically when it crosses a chunk border.
 	/// </summary>
 	/// <param name="entity"></param>
 	void addEntityToChunk(std::unique_ptr<Entity> entity);
@@ -94,6 +622,7 @@ public:
 		if (!casted) {
 			throw std::runtime_error("Failed to add global entity: invalid type cast");
 		}
+		this->registerEntity(casted);
 		m_globalEntities.push_back(std::move(entity));
 		return casted;
 	}
@@ -106,9 +635,9 @@ public:
 	/// <returns></returns>
 	template<typename T>
 	T* findGlobalEntity(const std::string& name) const {
-		for (const auto& entity : m_globalEntities) {
-			if (entity->name == name) {
-				if (auto casted = dynamic_cast<T*>(entity.get())) {
+		for (Entity* entity : this->getEntityIndex().getByName(StringTable::instance().find(name))) {
+			if (m_entityChunks.find(entity) == m_entityChunks.end()) {
+				if (auto casted = dynamic_cast<T*>(entity)) {
 					return casted;
 				}
 			}
@@ -125,14 +654,10 @@ public:
 	/// <returns></returns>
 	template<typename T>
 	T* findChunkEntity(const ChunkIndex& chunkIndex, const std::string& name) const {
-		auto it = m_chunks.find(chunkIndex);
-		if (it == m_chunks.end()) {
-			return nullptr;
-		}
-		const auto& chunkdata = it->second;
-		for (const auto& entity : chunkdata) {
-			if (entity->name == name) {
-				if (auto casted = dynamic_cast<T*>(entity.get())) {
+		for (Entity* entity : this->getEntityIndex().getByName(StringTable::instance().find(name))) {
+			auto it = m_entityChunks.find(entity);
+			if (it != m_entityChunks.end() && it->second.chunk->index == chunkIndex) {
+				if (auto casted = dynamic_cast<T*>(entity)) {
 					return casted;
 				}
 			}
@@ -140,6 +665,37 @@ public:
 		return nullptr;
 	}
 
+	/// <summary>
+	/// Checks if all entities of a chunk are loaded and initialized
+	/// </summary>
+	/// <param name="chunkIndex"></param>
+	/// <returns></returns>
+	bool isChunkResident(const ChunkIndex& chunkIndex) const;
+
+	/// <summary>
+	/// Returns the number of chunks in memory, including chunks that are still loading
+	/// </summary>
+	/// <returns></returns>
+	size_t getChunkCount() const {
+		return m_chunks.size();
+	}
+
+	/// <summary>
+	/// Returns the number of HLOD proxies in memory, including proxies of chunks without geometry
+	/// </summary>
+	/// <returns></returns>
+	size_t getProxyCount() const {
+		return m_proxies.size();
+	}
+
+	/// <summary>
+	/// Returns the world AABB of the entities of a chunk
+	/// The bounds of active chunks are updated at the start of each update.
+	/// </summary>
+	/// <param name="chunkIndex"></param>
+	/// <returns>An invalid AABB if the chunk is not in memory or empty</returns>
+	AABB getChunkBounds(const ChunkIndex& chunkIndex) const;
+
 	/// <summary>
 	/// Set the active chunk based on a world position
 	/// </summary>
@@ -169,5 +725,36 @@ public:
 	/// <returns></returns>
 	RayHit raycast(const Ray& ray) const override;
 
+	/// <summary>
+	/// Performs many raycasts at once, misses report a distance of -1 like raycast
+	/// </summary>
+	/// <param name="rays"></param>
+	/// <param name="hits"></param>
+	/// <param name="parallel"></param>
+	void raycastBatch(std::span<const Ray> rays, std::span<RayHit> hits, bool parallel = false) const override;
+
+	/// <summary>
+	/// Returns the visibility of the chunk of the entity if the camera is the culling camera
+	/// </summary>
+	/// <param name="entity"></param>
+	/// <param name="camera"></param>
+	/// <returns></returns>
+	FrustumTestResult getCullingHint(const Entity* entity, const Camera* camera) const override;
+
+protected:
+	/// <summary>
+	/// Only global entities and entities of the current and the neighboring chunks take part in queries
+	/// </summary>
+	/// <param name="entity"></param>
+	/// <returns></returns>
+	bool isEntityQueryable(const Entity* entity) const override;
+
+	/// <summary>
+	/// Marks the bounds of the chunk of the entity as dirty and queues the entity for migration
+	/// if it crossed a chunk border
+	/// </summary>
+	/// <param name="entity"></param>
+	void onEntityMoved(Entity* entity) override;
+
 };
 
@@ -1,51 +1,223 @@
 #include "Entity.h"
+#include "EntityIndex.h"
 #include "../Utils.h"
+#include <algorithm>
 
 Entity::Entity(std::string name)
 {
-	this->name = name;
-	this->uuId = generateUUID();
+	m_name = name;
+	m_nameId = StringTable::instance().intern(name);
+	m_uuId = generateUUID();
+	m_data = std::make_unique<EntityData>();
+}
+
+Entity::~Entity()
+{
+	// Unlink the hierarchy, the children keep their transform as world transform
+	this->setParent(nullptr);
+	for (auto child : m_children) {
+		child->m_parent = nullptr;
+		child->worldCacheRef().hasParent = false;
+		child->invalidateWorldData();
+	}
+	m_children.clear();
+
+	if (m_index != nullptr) {
+		m_index->remove(this);
+	}
+	this->detachFromStorage();
+}
+
+void Entity::setName(const std::string& name)
+{
+	StringId previousName = m_nameId;
+	m_name = name;
+	m_nameId = StringTable::instance().intern(name);
+	if (m_index != nullptr && previousName != m_nameId) {
+		m_index->onNameChanged(this, previousName);
+	}
+}
+
+void Entity::addTag(const std::string& key, const std::string& value)
+{
+	auto& table = StringTable::instance();
+	StringId id = table.intern(key);
+	bool added = m_tags.find(id) == m_tags.end();
+	m_tags[id] = value;
+	if (!added) {
+		return;
+	}
+
+	uint32_t bit = table.getTagBit(id);
+	if (bit != MAX_TAG_BITS) {
+		m_tagMask.set(bit);
+	}
+	if (m_index != nullptr) {
+		m_index->onTagAdded(this, id);
+	}
+}
+
+void Entity::removeTag(const std::string& key)
+{
+	auto& table = StringTable::instance();
+	StringId id = table.find(key);
+	auto it = m_tags.find(id);
+	if (it == m_tags.end()) {
+		return;
+	}
+	m_tags.erase(it);
+
+	uint32_t bit = table.getTagBit(id);
+	if (bit != MAX_TAG_BITS) {
+		m_tagMask.reset(bit);
+	}
+	if (m_index != nullptr) {
+		m_index->onTagRemoved(this, id);
+	}
+}
+
+void Entity::attachToStorage(EntityStorage* storage)
+{
+	if (m_storage == storage) {
+		return;
+	}
+	this->detachFromStorage();
+	if (storage != nullptr) {
+		m_storageId = storage->create(this, m_data->transform, m_data->aabb, m_data->state, m_data->worldCache);
+		m_storage = storage;
+		m_data.reset();
+	}
+}
+
+void Entity::detachFromStorage()
+{
+	if (m_storage == nullptr) {
+		return;
+	}
+	m_data = std::make_unique<EntityData>();
+	m_data->transform = m_storage->getTransform(m_storageId);
+	m_data->aabb = m_storage->getLocalAABB(m_storageId);
+	m_data->state = m_storage->getState(m_storageId);
+	m_data->worldMatrix = m_storage->getWorldMatrix(m_storageId);
+	m_data->worldAABB = m_storage->getWorldAABB(m_storageId);
+	m_data->worldCache = m_storage->getWorldCache(m_storageId);
+	m_storage->destroy(m_storageId);
+	m_storage = nullptr;
+	m_storageId = INVALID_ENTITY_ID;
+}
+
+void Entity::setParent(Entity* parent)
+{
+	if (m_parent == parent) {
+		return;
+	}
+
+	// Make sure the entity doesn't become its own ancestor
+	for (Entity* ancestor = parent; ancestor != nullptr; ancestor = ancestor->m_parent) {
+		if (ancestor == this) {
+			throw std::runtime_error("failed to set parent: entity hierarchy would contain a cycle!");
+		}
+	}
+
+	if (m_parent != nullptr) {
+		auto& siblings = m_parent->m_children;
+		siblings.erase(std::remove(siblings.begin(), siblings.end(), this), siblings.end());
+	}
+
+	m_parent = parent;
+	if (m_parent != nullptr) {
+		m_parent->m_children.push_back(this);
+	}
+
+	WorldCacheState& cache = this->worldCacheRef();
+	cache.hasParent = m_parent != nullptr;
+	cache.valid = false;
+}
+
+const glm::mat4& Entity::getWorldMatrix()
+{
+	this->refreshWorldData();
+	return this->worldMatrixRef();
+}
+
+uint32_t Entity::getWorldVersion()
+{
+	this->refreshWorldData();
+	return this->worldCacheRef().version;
+}
+
+glm::vec3 Entity::getWorldPosition()
+{
+	return glm::vec3(this->getWorldMatrix()[3]);
+}
+
+void Entity::refreshWorldData()
+{
+	// Parents are refreshed first, their version tells if the children are outdated
+	uint32_t parentVersion = 0;
+	if (m_parent != nullptr) {
+		parentVersion = m_parent->getWorldVersion();
+	}
+
+	const Transform& transform = this->getTransform();
+	WorldCacheState& cache = this->worldCacheRef();
+	if (cache.valid && cache.transformVersion == transform.getVersion() && cache.parentVersion == parentVersion) {
+		return;
+	}
+
+	glm::mat4& worldMatrix = this->worldMatrixRef();
+	worldMatrix = transform.getMatrix();
+	if (m_parent != nullptr) {
+		worldMatrix = m_parent->worldMatrixRef() * worldMatrix;
+	}
+
+	const AABB& localAABB = m_storage ? m_storage->getLocalAABB(m_storageId) : m_data->aabb;
+	this->worldAABBRef() = localAABB * worldMatrix;
+
+	cache.transformVersion = transform.getVersion();
+	cache.parentVersion = parentVersion;
+	cache.version++;
+	cache.valid = true;
 }
 
 void Entity::setPosition(glm::vec3 position)
 {
-	transform.position = position;
+	this->getTransform().setPosition(position);
 }
 
 glm::vec3 Entity::getPosition()
 {
-	return transform.position;
+	return this->getTransform().getPosition();
 }
 
 void Entity::setScale(glm::vec3 scale)
 {
-	transform.scale = scale;
+	this->getTransform().setScale(scale);
 }
 
 glm::vec3 Entity::getScale()
 {
-	return transform.scale;
+	return this->getTransform().getScale();
 }
 
 void Entity::setRotation(glm::quat rotation)
 {
-	transform.rotation = rotation;
+	this->getTransform().setRotation(rotation);
 }
 
 glm::quat Entity::getRotation()
 {
-	return transform.rotation;
+	return this->getTransform().getRotation();
 }
 
 void Entity::rotate(float x, float y, float z)
 {
-	transform.rotate(x, y, z);
+	this->getTransform().rotate(x, y, z);
 }
 
 UboModel Entity::getModelMatrix()
 {
-	auto matrix = transform.getMatrix();
-	return { matrix };
+	return { this->getWorldMatrix() };
 }
 
 void Entity::update(Scene* scene, float dt)
@@ -55,6 +227,31 @@ void Entity::update(Scene* scene, float dt)
 	}
 }
 
+bool Entity::supportsParallelUpdate() const
+{
+	// Hierarchies share their cached world data
+	if (m_parent != nullptr || !m_children.empty()) {
+		return false;
+	}
+
+	for (const auto& component : m_behaviors) {
+		if (!component->supportsParallelUpdate()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Entity::behaviorsRenderEveryFrame() const
+{
+	for (const auto& component : m_behaviors) {
+		if (component->rendersEveryFrame()) {
+			return true;
+		}
+	}
+	return false;
+}
+
 void Entity::render(Scene* scene, Renderer* renderer, VkCommandBuffer commandBuffer, int32_t currentFrame)
 {
 	for (auto& component : m_behaviors) {
@@ -10,129 +10,222 @@
 #include <type_traits>  
 #include "../Math/Transform.h"
 #include "../Math/AABB.h"
+#include "../Math/RayCast.h"
+#include "EntityState.h"
+#include "EntityStorage.h"
+#include "StringTable.h"
+#include <unordered_map>
 
 class Scene;
+class EntityIndex;
 
 /// <summary>
-/// 
-/// </summary>
-enum class EntityState : uint8_t {
-	ENTITY_STATE_NONE = 0,
-	ENTITY_STATE_ACTIVE = 1 << 0,
-	ENTITY_STATE_VISIBLE = 1 << 1,
-	ENTITY_STATE_RAYCASTABLE = 1 << 2
-};
-
-/// <summary>
-/// Enum bitwise OR operator overload
+/// Header for the Entity class
 /// </summary>
-/// <param name="a"></param>
-/// <param name="b"></param>
-/// <returns></returns>
-inline EntityState operator|(EntityState a, EntityState b)
+class Entity
 {
-	return static_cast<EntityState>(static_cast<uint8_t>(a) | static_cast<uint8_t>(b));
-}
+private:
+	/// <summary>
+	/// The behaviors attached to this entity
+	/// </summary>
+	std::vector<std::unique_ptr<Behavior>> m_behaviors;
 
-/// <summary>
-/// Enum bitwise AND operator overload
-/// </summary>
-/// <param name="a"></param>
-/// <param name="b"></param>
-/// <returns></returns>
-inline EntityState operator&(EntityState a, EntityState b)
-{
-	return static_cast<EntityState>(static_cast<uint8_t>(a) & static_cast<uint8_t>(b));
-}
+	/// <summary>
+	/// The tags attached to this entity by interned key
+	/// </summary>
+	std::unordered_map<StringId, std::string> m_tags;
 
-/// <summary>
-/// Bitwise NOT operator overload
-/// </summary>
-/// <param name="a"></param>
-/// <returns></returns>
-inline EntityState operator~(EntityState a)
-{
-	return static_cast<EntityState>(~static_cast<uint8_t>(a));
-}
+	/// <summary>
+	/// One bit per tag key of the entity, see StringTable::getTagBit
+	/// </summary>
+	TagMask m_tagMask;
 
-/// <summary>
-/// Bitwise OR assignment operator overload
-/// </summary>
-/// <param name="a"></param>
-/// <param name="b"></param>
-/// <returns></returns>
-inline EntityState operator|=(EntityState a, EntityState b) {
-	return a = a | b;
-}
+	/// <summary>
+	/// The name of the entity
+	/// </summary>
+	std::string m_name;
 
-/// <summary>
-/// Bitwise AND assignment operator overload
-/// </summary>
-/// <param name="a"></param>
-/// <param name="b"></param>
-/// <returns></returns>
-inline EntityState operator&=(EntityState a, EntityState b) {
-	return a = a & b;
-}
+	/// <summary>
+	/// The interned name of the entity
+	/// </summary>
+	StringId m_nameId = INVALID_STRING_ID;
 
-/// <summary>
-/// Helpers to check if a flag is set in an EntityState
-/// </summary>
-/// <param name="state"></param>
-/// <param name="flag"></param>
-/// <returns></returns>
-inline bool hasFlag(EntityState state, EntityState flag) {
-	return (state & flag) == flag;
-}
+	/// <summary>
+	/// The unique ID of the entity
+	/// </summary>
+	std::string m_uuId;
 
-/// <summary>
-/// Header for the Entity class
-/// </summary>
-class Entity
-{
-private:
 	/// <summary>
-	/// The behaviors attached to this entity
+	/// The index of the scene owning the entity
 	/// </summary>
-	std::vector<std::unique_ptr<Behavior>> m_behaviors;
+	EntityIndex* m_index = nullptr;
+	friend class EntityIndex;
 
 	/// <summary>
-	/// The tags attached to this entity
+	/// The type bucket of the entity inside the index
+	/// Recorded when the entity is indexed, the destructor of Entity no longer sees the dynamic type.
 	/// </summary>
-	std::map<std::string, std::string> m_tags;
+	size_t m_indexTypeBucket = SIZE_MAX;
 
 	/// <summary>
-	/// The axis-aligned bounding box of the entity
+	/// The data of an entity that is not attached to an entity storage
 	/// </summary>
-	AABB m_aabb;
+	struct EntityData {
+		Transform transform;
+		AABB aabb;
+		EntityState state = EntityState::ENTITY_STATE_ACTIVE | EntityState::ENTITY_STATE_VISIBLE | EntityState::ENTITY_STATE_RAYCASTABLE;
+		glm::mat4 worldMatrix = glm::mat4(1.0f);	// Cached world matrix
+		AABB worldAABB;								// Cached world AABB
+		WorldCacheState worldCache;
+	};
 
 	/// <summary>
-	/// The state of the entity
+	/// The own data of the entity, nullptr while the entity is attached to an entity storage
+	/// Attached entities are handles that only keep the storage and their id.
 	/// </summary>
-	EntityState m_state = EntityState::ENTITY_STATE_ACTIVE | EntityState::ENTITY_STATE_VISIBLE | EntityState::ENTITY_STATE_RAYCASTABLE;
-public:
+	std::unique_ptr<EntityData> m_data;
+
 	/// <summary>
-	/// The transform of the entity
+	/// The parent entity, the transform is relative to it
 	/// </summary>
-	Transform transform;
+	Entity* m_parent = nullptr;
 
 	/// <summary>
-	/// The name of the entity
+	/// The child entities (not owned)
 	/// </summary>
-	std::string name;
+	std::vector<Entity*> m_children;
 
 	/// <summary>
-	/// The unique ID of the entity
+	/// The entity storage holding the data of the entity, nullptr if the entity owns its data
 	/// </summary>
-	std::string uuId;
+	EntityStorage* m_storage = nullptr;
 
+	/// <summary>
+	/// The id of the entity inside the entity storage
+	/// </summary>
+	EntityId m_storageId = INVALID_ENTITY_ID;
+public:
 	/// <summary>
 	/// The pipeline type used to render the entity
 	/// </summary>
 	std::string pipelineType;
 
 	Entity(std::string name);
-	virtual ~Entity() = default;
+	virtual ~Entity();
+
+	Entity(const Entity&) = delete;
+	Entity& operator=(const Entity&) = delete;
+
+	/// <summary>
+	/// Gets the name of the entity
+	/// </summary>
+	/// <returns></returns>
+	const std::string& getName() const {
+		return m_name;
+	}
+
+	/// <summary>
+	/// Gets the interned name of the entity
+	/// </summary>
+	/// <returns></returns>
+	StringId getNameId() const {
+		return m_nameId;
+	}
+
+	/// <summary>
+	/// Sets the name of the entity and updates the scene index
+	/// </summary>
+	/// <param name="name"></param>
+	void setName(const std::string& name);
+
+	/// <summary>
+	/// Gets the unique ID of the entity
+	/// </summary>
+	/// <returns></returns>
+	const std::string& getUUID() const {
+		return m_uuId;
+	}
+
+	/// <summary>
+	/// Moves the transform, AABB and state of the entity into the entity storage
+	/// The entity keeps only its id and reads and writes the data through the storage from now on.
+	/// </summary>
+	/// <param name="storage"></param>
+	void attachToStorage(EntityStorage* storage);
+
+	/// <summary>
+	/// Copies the data back from the entity storage and frees the slot
+	/// </summary>
+	void detachFromStorage();
+
+	/// <summary>
+	/// Gets the id of the entity inside its entity storage
+	/// </summary>
+	/// <returns>INVALID_ENTITY_ID if the entity is not attached</returns>
+	EntityId getStorageId() const {
+		return m_storageId;
+	}
+
+	/// <summary>
+	/// Gets the transform of the entity, relative to the parent if the entity has one
+	/// The reference is invalidated when entities are added to or removed from the entity storage.
+	/// </summary>
+	/// <returns></returns>
+	Transform& getTransform() {
+		return m_storage ? m_storage->getTransform(m_storageId) : m_data->transform;
+	}
+
+	/// <summary>
+	/// Gets the transform of the entity
+	/// </summary>
+	/// <returns></returns>
+	const Transform& getTransform() const {
+		return m_storage ? m_storage->getTransform(m_storageId) : m_data->transform;
+	}
+
+	/// <summary>
+	/// Sets the parent of the entity, nullptr detaches it from its parent
+	/// The transform of the entity is interpreted relative to the parent from now on.
+	/// Parents don't own their children, the scene still owns, updates and renders both.
+	/// </summary>
+	/// <param name="parent"></param>
+	void setParent(Entity* parent);
+
+	/// <summary>
+	/// Gets the parent of the entity
+	/// </summary>
+	/// <returns></returns>
+	Entity* getParent() const {
+		return m_parent;
+	}
+
+	/// <summary>
+	/// Gets the children of the entity
+	/// </summary>
+	/// <returns></returns>
+	const std::vector<Entity*>& getChildren() const {
+		return m_children;
+	}
+
+	/// <summary>
+	/// Gets the world matrix of the entity
+	/// The matrix is cached and only rebuilt if the transform of the entity or one of its parents changed.
+	/// </summary>
+	/// <returns></returns>
+	const glm::mat4& getWorldMatrix();
+
+	/// <summary>
+	/// Gets the version of the cached world data
+	/// Changes whenever the world matrix or world AABB was rebuilt.
+	/// </summary>
+	/// <returns></returns>
+	uint32_t getWorldVersion();
+
+	/// <summary>
+	/// Gets the position of the entity in world space
+	/// </summary>
+	/// <returns></returns>
+	glm::vec3 getWorldPosition();
 
 	/// <summary>
 	/// Sets the position of the entity
@@ -190,6 +283,14 @@ public:
 	/// <param name="dt"></param>
 	virtual void update(Scene* scene, float dt);
 
+	/// <summary>
+	/// Whether the entity can be updated on a worker thread in parallel scene updates
+	/// True if all behaviors support it and the entity is not part of a hierarchy. Entities that
+	/// override update and touch anything besides themselves have to override this and return false.
+	/// </summary>
+	/// <returns></returns>
+	virtual bool supportsParallelUpdate() const;
+
 	/// <summary>
 	/// Initialize the entity
 	/// </summary>
@@ -204,6 +305,33 @@ public:
 	/// <param name="currentFrame"></param>
 	virtual void render(Scene* scene, Renderer* renderer, VkCommandBuffer commandBuffer, int32_t currentFrame);
 
+	/// <summary>
+	/// Render the depth of the entity in the depth stage of a depth pre-pass, render follows in the same frame
+	/// The per frame work of render, e.g. the LOD selection or queueing batched draws, is done here once and render only
+	/// draws with its results, so both stages draw the same geometry. Behaviors are only rendered by render.
+	/// Entities that don't override it are only drawn in the shading stage.
+	/// </summary>
+	/// <param name="renderer"></param>
+	/// <param name="commandBuffer"></param>
+	/// <param name="currentFrame"></param>
+	virtual void renderDepth(Scene* scene, Renderer* renderer, VkCommandBuffer commandBuffer, int32_t currentFrame) {}
+
+	/// <summary>
+	/// Whether the draws recorded by render stay valid until the entity changes its state
+	/// Scenes may record them once into a cached command buffer and replay them instead of calling render every frame.
+	/// Entities that pick LODs, queue batched draws or update buffers in render have to return false.
+	/// </summary>
+	/// <returns></returns>
+	virtual bool hasCacheableDraws() const {
+		return false;
+	}
+
+	/// <summary>
+	/// Whether any behavior of the entity has to render every frame
+	/// </summary>
+	/// <returns></returns>
+	bool behaviorsRenderEveryFrame() const;
+
 	/// <summary>
 	/// Destroy the entity
 	/// </summary>
@@ -222,7 +350,32 @@ public:
 	/// <param name="worldpos">Defines whether to get the AABB in world position or local position</param>
 	/// <returns></returns>
 	virtual AABB getAABB(bool worldpos) {
-		return m_aabb * (worldpos ? transform.getMatrix() : glm::mat4(1.0f));
+		if (worldpos) {
+			this->refreshWorldData();
+			return this->worldAABBRef();
+		}
+		return m_storage ? m_storage->getLocalAABB(m_storageId) : m_data->aabb;
+	}
+
+	/// <summary>
+	/// Whether the entity has geometry for triangle accurate raycasts
+	/// Scenes use raycastGeometry instead of the AABB for these entities.
+	/// </summary>
+	/// <returns></returns>
+	virtual bool hasRaycastGeometry() const {
+		return false;
+	}
+
+	/// <summary>
+	/// Intersects a world space ray with the geometry of the entity
+	/// Only called if hasRaycastGeometry returns true and the ray hits the world AABB.
+	/// </summary>
+	/// <param name="ray"></param>
+	/// <param name="maxDistance"></param>
+	/// <param name="hit">Receives the hit if there is one closer than maxDistance</param>
+	/// <returns></returns>
+	virtual bool raycastGeometry(const Ray& ray, float maxDistance, RayHit& hit) {
+		return false;
 	}
 
 	/// <summary>
@@ -230,7 +383,13 @@ public:
 	/// </summary>
 	/// <param name="aabb"></param>
 	void setAABB(const AABB& aabb) {
-		m_aabb = aabb;
+		if (m_storage) {
+			m_storage->getLocalAABB(m_storageId) = aabb;
+		}
+		else {
+			m_data->aabb = aabb;
+		}
+		this->invalidateWorldData();
 	}
 
 	/// <summary>
@@ -238,21 +397,63 @@ public:
 	/// </summary>
 	/// <param name="key"></param>
 	/// <param name="value"></param>
-	void addTag(const std::string& key, const std::string& value)
+	void addTag(const std::string& key, const std::string& value);
+
+	/// <summary>
+	/// Removes a tag from the entity
+	/// </summary>
+	/// <param name="key"></param>
+	void removeTag(const std::string& key);
+
+	/// <summary>
+	/// Checks if the entity has a tag
+	/// </summary>
+	/// <param name="key"></param>
+	/// <returns></returns>
+	bool hasTag(const std::string& key) const
 	{
-		m_tags[key] = value;
+		return this->hasTag(StringTable::instance().find(key));
 	}
 
 	/// <summary>
-	/// Checks if the entity has a tag
+	/// Checks if the entity has a tag by its interned key
 	/// </summary>
 	/// <param name="key"></param>
 	/// <returns></returns>
-	bool hasTag(const std::string& key)
+	bool hasTag(StringId key) const
 	{
 		return m_tags.find(key) != m_tags.end();
 	}
 
+	/// <summary>
+	/// Checks if the entity has all tags of the mask
+	/// </summary>
+	/// <param name="mask"></param>
+	/// <returns></returns>
+	bool hasTags(const TagMask& mask) const
+	{
+		return (m_tagMask & mask) == mask;
+	}
+
+	/// <summary>
+	/// Gets the value of a tag
+	/// </summary>
+	/// <param name="key"></param>
+	/// <returns>nullptr if the entity doesn't have the tag</returns>
+	const std::string* getTag(const std::string& key) const
+	{
+		auto it = m_tags.find(StringTable::instance().find(key));
+		return it != m_tags.end() ? &it->second : nullptr;
+	}
+
+	/// <summary>
+	/// Gets the tag mask of the entity
+	/// </summary>
+	/// <returns></returns>
+	const TagMask& getTagMask() const {
+		return m_tagMask;
+	}
+
 	/// <summary>
 	/// Add a behavior to the entity and return it casted to the correct type
 	/// </summary>
@@ -290,7 +491,7 @@ public:
 	/// </summary>
 	/// <returns></returns>
 	EntityState getState() const {
-		return m_state;
+		return m_storage ? m_storage->getState(m_storageId) : m_data->state;
 	}
 
 	/// <summary>
@@ -298,7 +499,7 @@ public:
 	/// </summary>
 	/// <param name="state"></param>
 	void setState(EntityState state) {
-		m_state = state;
+		this->stateRef() = state;
 	}
 
 	/// <summary>
@@ -306,7 +507,8 @@ public:
 	/// </summary>
 	/// <param name="state"></param>
 	void addState(EntityState state) {
-		m_state = m_state | state;
+		EntityState& current = this->stateRef();
+		current = current | state;
 	}
 
 	/// <summary>
@@ -314,7 +516,8 @@ public:
 	/// </summary>
 	/// <param name="state"></param>
 	void removeState(EntityState state) {
-		m_state = m_state & ~state;
+		EntityState& current = this->stateRef();
+		current = current & ~state;
 	}
 
 	/// <summary>
@@ -323,6 +526,41 @@ public:
 	/// <param name="state"></param>
 	/// <returns></returns>
 	bool hasState(EntityState state) const {
-		return hasFlag(m_state, state);
+		return hasFlag(this->getState(), state);
+	}
+
+private:
+	/// <summary>
+	/// Rebuilds the world matrix and world AABB if the transform or a parent changed
+	/// </summary>
+	void refreshWorldData();
+
+	/// <summary>
+	/// Invalidates the cached world data of the entity
+	/// </summary>
+	void invalidateWorldData() {
+		this->worldCacheRef().valid = false;
+	}
+
+	/// <summary>
+	/// Gets the cached world data of the entity as writable references
+	/// </summary>
+	/// <returns></returns>
+	glm::mat4& worldMatrixRef() {
+		return m_storage ? m_storage->getWorldMatrix(m_storageId) : m_data->worldMatrix;
+	}
+	AABB& worldAABBRef() {
+		return m_storage ? m_storage->getWorldAABB(m_storageId) : m_data->worldAABB;
+	}
+	WorldCacheState& worldCacheRef() {
+		return m_storage ? m_storage->getWorldCache(m_storageId) : m_data->worldCache;
+	}
+
+	/// <summary>
+	/// Gets the state of the entity as a writable reference
+	/// </summary>
+	/// <returns></returns>
+	EntityState& stateRef() {
+		return m_storage ? m_storage->getState(m_storageId) : m_data->state;
 	}
 };
@@ -0,0 +1,147 @@
+#include "EntityIndex.h"
+#include "Entity.h"
+#include <algorithm>
+#include <stdexcept>
+
+EntityIndex::EntityIndex()
+{
+	m_tagBitKeys.fill(INVALID_STRING_ID);
+}
+
+EntityIndex::~EntityIndex()
+{
+	this->clear();
+}
+
+void EntityIndex::add(Entity* entity)
+{
+	if (entity->m_index != nullptr) {
+		throw std::runtime_error("failed to index entity: entity is already part of an index!");
+	}
+	if (!m_byUUID.emplace(entity->getUUID(), entity).second) {
+		throw std::runtime_error("failed to index entity: duplicate entity uuid!");
+	}
+	entity->m_index = this;
+
+	m_byName[entity->getNameId()].push_back(entity);
+	for (const auto& [tag, value] : entity->m_tags) {
+		this->onTagAdded(entity, tag);
+	}
+
+	// Sort the entity into the bucket of its dynamic type
+	std::type_index type(typeid(*entity));
+	auto it = m_typeToBucket.find(type);
+	if (it == m_typeToBucket.end()) {
+		it = m_typeToBucket.emplace(type, m_typeBuckets.size()).first;
+		m_typeBuckets.push_back({ type, {} });
+	}
+	auto& bucket = m_typeBuckets[it->second].entities;
+	if (bucket.empty()) {
+		m_typeGeneration++;
+	}
+	bucket.push_back(entity);
+	entity->m_indexTypeBucket = it->second;
+}
+
+void EntityIndex::remove(Entity* entity)
+{
+	if (entity->m_index != this) {
+		return;
+	}
+	entity->m_index = nullptr;
+	m_byUUID.erase(entity->getUUID());
+
+	auto nameIt = m_byName.find(entity->getNameId());
+	if (nameIt != m_byName.end()) {
+		removeFromBucket(nameIt->second, entity);
+	}
+	for (const auto& [tag, value] : entity->m_tags) {
+		auto tagIt = m_byTag.find(tag);
+		if (tagIt != m_byTag.end()) {
+			removeFromBucket(tagIt->second, entity);
+		}
+	}
+
+	// Entities remove themselves from ~Entity, where typeid already returns Entity, so use the recorded bucket
+	if (entity->m_indexTypeBucket < m_typeBuckets.size()) {
+		removeFromBucket(m_typeBuckets[entity->m_indexTypeBucket].entities, entity);
+	}
+	entity->m_indexTypeBucket = SIZE_MAX;
+}
+
+void EntityIndex::clear()
+{
+	for (const auto& [uuid, entity] : m_byUUID) {
+		entity->m_index = nullptr;
+		entity->m_indexTypeBucket = SIZE_MAX;
+	}
+	m_byUUID.clear();
+	m_byName.clear();
+	m_byTag.clear();
+	m_typeBuckets.clear();
+	m_typeToBucket.clear();
+	m_tagBitKeys.fill(INVALID_STRING_ID);
+	m_typeGeneration++;
+}
+
+void EntityIndex::onNameChanged(Entity* entity, StringId previousName)
+{
+	auto it = m_byName.find(previousName);
+	if (it != m_byName.end()) {
+		removeFromBucket(it->second, entity);
+	}
+	m_byName[entity->getNameId()].push_back(entity);
+}
+
+void EntityIndex::onTagAdded(Entity* entity, StringId tag)
+{
+	m_byTag[tag].push_back(entity);
+
+	uint32_t bit = StringTable::instance().getTagBit(tag);
+	if (bit != MAX_TAG_BITS) {
+		m_tagBitKeys[bit] = tag;
+	}
+}
+
+void EntityIndex::onTagRemoved(Entity* entity, StringId tag)
+{
+	auto it = m_byTag.find(tag);
+	if (it != m_byTag.end()) {
+		removeFromBucket(it->second, entity);
+	}
+}
+
+void EntityIndex::removeFromBucket(std::vector<Entity*>& bucket, Entity* entity)
+{
+	// Order inside a bucket doesn't matter, swap and pop
+	auto it = std::find(bucket.begin(), bucket.end(), entity);
+	if (it != bucket.end()) {
+		*it = bucket.back();
+		bucket.pop_back();
+	}
+}
+
+const std::vector<Entity*>& EntityIndex::getSmallestTagBucket(const TagMask& mask) const
+{
+	const std::vector<Entity*>* smallest = nullptr;
+	for (size_t bit = 0; bit < MAX_TAG_BITS; bit++) {
+		if (!mask.test(bit)) {
+			continue;
+		}
+
+		// A tag nobody in this scene ever had can't match
+		if (m_tagBitKeys[bit] == INVALID_STRING_ID) {
+			return s_empty;
+		}
+		const auto& bucket = this->getByTag(m_tagBitKeys[bit]);
+		if (smallest == nullptr || bucket.size() < smallest->size()) {
+			smallest = &bucket;
+		}
+	}
+	return smallest != nullptr ? *smallest : s_empty;
+}
+
+bool EntityIndex::hasTags(const Entity* entity, const TagMask& mask)
+{
+	return entity->hasTags(mask);
+}
@@ -0,0 +1,268 @@
+#pragma once
+#include <array>
+#include <mutex>
+#include <string>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+#include "StringTable.h"
+
+class Entity;
+
+/// <summary>
+/// Hash index over the entities of a scene
+/// Maps interned names, UUIDs, tag keys and dynamic types to entities so scene lookups
+/// don't have to scan all entities. Entities keep the index up to date when their name
+/// or tags change and remove themselves when they are destroyed.
+/// Not thread safe for writes, don't rename or retag entities during parallel updates.
+/// </summary>
+class EntityIndex
+{
+private:
+	/// <summary>
+	/// Entities of exactly one dynamic type
+	/// </summary>
+	struct TypeBucket {
+		std::type_index type;
+		std::vector<Entity*> entities;
+	};
+
+	/// <summary>
+	/// Cached list of buckets matching a queried type
+	/// </summary>
+	struct TypeQuery {
+		uint32_t generation = 0;
+		std::vector<size_t> buckets;
+	};
+
+	/// <summary>
+	/// Entities by interned name
+	/// </summary>
+	std::unordered_map<StringId, std::vector<Entity*>> m_byName;
+
+	/// <summary>
+	/// Entities by UUID
+	/// </summary>
+	std::unordered_map<std::string, Entity*> m_byUUID;
+
+	/// <summary>
+	/// Entities by interned tag key
+	/// </summary>
+	std::unordered_map<StringId, std::vector<Entity*>> m_byTag;
+
+	/// <summary>
+	/// The tag key of each tag mask bit
+	/// </summary>
+	std::array<StringId, MAX_TAG_BITS> m_tagBitKeys;
+
+	/// <summary>
+	/// Entities by dynamic type
+	/// </summary>
+	std::vector<TypeBucket> m_typeBuckets;
+
+	/// <summary>
+	/// Maps a dynamic type to its bucket
+	/// </summary>
+	std::unordered_map<std::type_index, size_t> m_typeToBucket;
+
+	/// <summary>
+	/// Bumped when a bucket is created or becomes non-empty, invalidates the type queries
+	/// </summary>
+	uint32_t m_typeGeneration = 1;
+
+	/// <summary>
+	/// Buckets matching a queried type, cached per queried type
+	/// </summary>
+	mutable std::unordered_map<std::type_index, TypeQuery> m_typeQueries;
+
+	/// <summary>
+	/// Guards the type query cache, queries may run from parallel updates
+	/// </summary>
+	mutable std::mutex m_typeQueryMutex;
+
+	/// <summary>
+	/// Empty result for lookups without a match
+	/// </summary>
+	inline static const std::vector<Entity*> s_empty;
+
+	/// <summary>
+	/// Removes the entity from a bucket
+	/// </summary>
+	/// <param name="bucket"></param>
+	/// <param name="entity"></param>
+	static void removeFromBucket(std::vector<Entity*>& bucket, Entity* entity);
+
+	/// <summary>
+	/// Returns the smallest tag bucket of the tags in the mask
+	/// </summary>
+	/// <param name="mask"></param>
+	/// <returns></returns>
+	const std::vector<Entity*>& getSmallestTagBucket(const TagMask& mask) const;
+
+	/// <summary>
+	/// Checks if the entity has all tags of the mask
+	/// </summary>
+	/// <param name="entity"></param>
+	/// <param name="mask"></param>
+	/// <returns></returns>
+	static bool hasTags(const Entity* entity, const TagMask& mask);
+
+	/// <summary>
+	/// Returns the buckets whose type derives from T
+	/// Buckets are tested once with dynamic_cast, the result is cached until new types show up.
+	/// The cache only changes when entities are added, which never overlaps with queries.
+	/// </summary>
+	/// <typeparam name="T"></typeparam>
+	/// <returns></returns>
+	template<typename T>
+	const std::vector<size_t>& getMatchingBuckets() const {
+		std::lock_guard<std::mutex> lock(m_typeQueryMutex);
+		TypeQuery& query = m_typeQueries[std::type_index(typeid(T))];
+		if (query.generation != m_typeGeneration) {
+			query.buckets.clear();
+			for (size_t i = 0; i < m_typeBuckets.size(); i++) {
+				const auto& entities = m_typeBuckets[i].entities;
+				if (!entities.empty() && dynamic_cast<T*>(entities.front()) != nullptr) {
+					query.buckets.push_back(i);
+				}
+			}
+			query.generation = m_typeGeneration;
+		}
+		return query.buckets;
+	}
+
+public:
+	EntityIndex();
+	~EntityIndex();
+
+	EntityIndex(const EntityIndex&) = delete;
+	EntityIndex& operator=(const EntityIndex&) = delete;
+
+	/// <summary>
+	/// Adds the entity to the index
+	/// </summary>
+	/// <param name="entity"></param>
+	void add(Entity* entity);
+
+	/// <summary>
+	/// Removes the entity from the index
+	/// </summary>
+	/// <param name="entity"></param>
+	void remove(Entity* entity);
+
+	/// <summary>
+	/// Removes all entities from the index without touching the buckets one by one
+	/// Call this before destroying a whole scene.
+	/// </summary>
+	void clear();
+
+	/// <summary>
+	/// Called by entities after their name changed
+	/// </summary>
+	/// <param name="entity"></param>
+	/// <param name="previousName"></param>
+	void onNameChanged(Entity* entity, StringId previousName);
+
+	/// <summary>
+	/// Called by entities after a tag was added
+	/// </summary>
+	/// <param name="entity"></param>
+	/// <param name="tag"></param>
+	void onTagAdded(Entity* entity, StringId tag);
+
+	/// <summary>
+	/// Called by entities after a tag was removed
+	/// </summary>
+	/// <param name="entity"></param>
+	/// <param name="tag"></param>
+	void onTagRemoved(Entity* entity, StringId tag);
+
+	/// <summary>
+	/// Returns all entities with the given name
+	/// </summary>
+	/// <param name="name"></param>
+	/// <returns></returns>
+	const std::vector<Entity*>& getByName(StringId name) const {
+		auto it = m_byName.find(name);
+		return it != m_byName.end() ? it->second : s_empty;
+	}
+
+	/// <summary>
+	/// Returns all entities with the given tag key
+	/// </summary>
+	/// <param name="tag"></param>
+	/// <returns></returns>
+	const std::vector<Entity*>& getByTag(StringId tag) const {
+		auto it = m_byTag.find(tag);
+		return it != m_byTag.end() ? it->second : s_empty;
+	}
+
+	/// <summary>
+	/// Returns the entity with the given UUID
+	/// </summary>
+	/// <param name="uuid"></param>
+	/// <returns>nullptr if there is no such entity</returns>
+	Entity* findByUUID(const std::string& uuid) const {
+		auto it = m_byUUID.find(uuid);
+		return it != m_byUUID.end() ? it->second : nullptr;
+	}
+
+	/// <summary>
+	/// Returns the number of indexed entities
+	/// </summary>
+	/// <returns></returns>
+	size_t size() const {
+		return m_byUUID.size();
+	}
+
+	/// <summary>
+	/// Calls the function for every entity of type T (including derived types)
+	/// Return false from the function to stop the iteration.
+	/// </summary>
+	/// <typeparam name="T"></typeparam>
+	/// <typeparam name="Fn"></typeparam>
+	/// <param name="function"></param>
+	template<typename T, typename Fn>
+	void forEach(Fn&& function) const {
+		for (size_t bucket : this->getMatchingBuckets<T>()) {
+			for (Entity* entity : m_typeBuckets[bucket].entities) {
+				// All entities of a bucket share the dynamic type, so the cast can't fail
+				if (!function(static_cast<T*>(entity))) {
+					return;
+				}
+			}
+		}
+	}
+
+	/// <summary>
+	/// Returns the first entity of type T (including derived types)
+	/// </summary>
+	/// <typeparam name="T"></typeparam>
+	/// <returns></returns>
+	template<typename T>
+	T* findFirst() const {
+		for (size_t bucket : this->getMatchingBuckets<T>()) {
+			const auto& entities = m_typeBuckets[bucket].entities;
+			if (!entities.empty()) {
+				return static_cast<T*>(entities.front());
+			}
+		}
+		return nullptr;
+	}
+
+	/// <summary>
+	/// Calls the function for every entity having all tags of the mask
+	/// Iterates the smallest tag bucket of the mask. Return false from the function to stop the iteration.
+	/// </summary>
+	/// <typeparam name="Fn"></typeparam>
+	/// <param name="mask"></param>
+	/// <param name="function"></param>
+	template<typename Fn>
+	void forEachWithTags(const TagMask& mask, Fn&& function) const {
+		for (Entity* entity : this->getSmallestTagBucket(mask)) {
+			if (hasTags(entity, mask) && !function(entity)) {
+				return;
+			}
+		}
+	}
+};
@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+
+/// <summary>
+/// State flags of an entity
+/// </summary>
+enum class EntityState : uint8_t {
+	ENTITY_STATE_NONE = 0,
+	ENTITY_STATE_ACTIVE = 1 << 0,
+	ENTITY_STATE_VISIBLE = 1 << 1,
+	ENTITY_STATE_RAYCASTABLE = 1 << 2,
+	ENTITY_STATE_STATIC = 1 << 3	// Never moves, scenes with static batching merge its geometry at init
+};
+
+/// <summary>
+/// Enum bitwise OR operator overload
+/// </summary>
+/// <param name="a"></param>
+/// <param name="b"></param>
+/// <returns></returns>
+inline EntityState operator|(EntityState a, EntityState b)
+{
+	return static_cast<EntityState>(static_cast<uint8_t>(a) | static_cast<uint8_t>(b));
+}
+
+/// <summary>
+/// Enum bitwise AND operator overload
+/// </summary>
+/// <param name="a"></param>
+/// <param name="b"></param>
+/// <returns></returns>
+inline EntityState operator&(EntityState a, EntityState b)
+{
+	return static_cast<EntityState>(static_cast<uint8_t>(a) & static_cast<uint8_t>(b));
+}
+
+/// <summary>
+/// Bitwise NOT operator overload
+/// </summary>
+/// <param name="a"></param>
+/// <returns></returns>
+inline EntityState operator~(EntityState a)
+{
+	return static_cast<EntityState>(~static_cast<uint8_t>(a));
+}
+
+/// <summary>
+/// Bitwise OR assignment operator overload
+/// </summary>
+/// <param name="a"></param>
+/// <param name="b"></param>
+/// <returns></returns>
+inline EntityState operator|=(EntityState a, EntityState b) {
+	return a = a | b;
+}
+
+/// <summary>
+/// Bitwise AND assignment operator overload
+/// </summary>
+/// <param name="a"></param>
+/// <param name="b"></param>
+/// <returns></returns>
+inline EntityState operator&=(EntityState a, EntityState b) {
+	return a = a & b;
+}
+
+/// <summary>
+/// Helpers to check if a flag is set in an EntityState
+/// </summary>
+/// <param name="state"></param>
+/// <param name="flag"></param>
+/// <returns></returns>
+inline bool hasFlag(EntityState state, EntityState flag) {
+	return (state & flag) == flag;
+}
@@ -0,0 +1,98 @@
+#include "EntityStorage.h"
+#include "Entity.h"
+#include "JobSystem.h"
+#include <stdexcept>
+
+EntityId EntityStorage::create(Entity* entity, const Transform& transform, const AABB& localAABB, EntityState state, const WorldCacheState& worldCache)
+{
+	// Reuse a free id or create a new one
+	EntityId id;
+	if (!m_freeIds.empty()) {
+		id = m_freeIds.back();
+		m_freeIds.pop_back();
+	}
+	else {
+		id = static_cast<EntityId>(m_idToSlot.size());
+		m_idToSlot.push_back(UINT32_MAX);
+	}
+
+	// Append the entity data to the arrays
+	m_idToSlot[id] = static_cast<uint32_t>(m_entities.size());
+	m_transforms.push_back(transform);
+	m_worldMatrices.push_back(transform.getMatrix());
+	m_localAABBs.push_back(localAABB);
+	m_worldAABBs.push_back(localAABB * m_worldMatrices.back());
+	m_worldCaches.push_back(worldCache);
+	m_worldCaches.back().valid = false;
+	m_states.push_back(state);
+	m_entities.push_back(entity);
+	m_slotIds.push_back(id);
+	return id;
+}
+
+void EntityStorage::destroy(EntityId id)
+{
+	if (!this->isValid(id)) {
+		throw std::runtime_error("failed to destroy entity storage slot: invalid entity id!");
+	}
+
+	// Move the last slot into the removed one
+	uint32_t slot = m_idToSlot[id];
+	uint32_t last = static_cast<uint32_t>(m_entities.size() - 1);
+	if (slot != last) {
+		m_transforms[slot] = m_transforms[last];
+		m_worldMatrices[slot] = m_worldMatrices[last];
+		m_localAABBs[slot] = m_localAABBs[last];
+		m_worldAABBs[slot] = m_worldAABBs[last];
+		m_worldCaches[slot] = m_worldCaches[last];
+		m_states[slot] = m_states[last];
+		m_entities[slot] = m_entities[last];
+		m_slotIds[slot] = m_slotIds[last];
+		m_idToSlot[m_slotIds[slot]] = slot;
+	}
+
+	m_transforms.pop_back();
+	m_worldMatrices.pop_back();
+	m_localAABBs.pop_back();
+	m_worldAABBs.pop_back();
+	m_worldCaches.pop_back();
+	m_states.pop_back();
+	m_entities.pop_back();
+	m_slotIds.pop_back();
+
+	m_idToSlot[id] = UINT32_MAX;
+	m_freeIds.push_back(id);
+}
+
+void EntityStorage::updateWorldData(JobSystem* jobSystem, size_t batchSize)
+{
+	// Root entities only depend on their own transform
+	auto updateRange = [this](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			WorldCacheState& cache = m_worldCaches[i];
+			if (cache.hasParent || (cache.valid && cache.transformVersion == m_transforms[i].getVersion())) {
+				continue;
+			}
+			m_worldMatrices[i] = m_transforms[i].getMatrix();
+			m_worldAABBs[i] = m_localAABBs[i] * m_worldMatrices[i];
+			cache.transformVersion = m_transforms[i].getVersion();
+			cache.parentVersion = 0;
+			cache.version++;
+			cache.valid = true;
+		}
+	};
+
+	if (jobSystem != nullptr) {
+		jobSystem->parallelFor(m_transforms.size(), batchSize, updateRange);
+	}
+	else {
+		updateRange(0, m_transforms.size());
+	}
+
+	// Children walk up their hierarchy, which may touch other slots
+	for (size_t i = 0; i < m_entities.size(); i++) {
+		if (m_worldCaches[i].hasParent) {
+			m_entities[i]->getWorldMatrix();
+		}
+	}
+}
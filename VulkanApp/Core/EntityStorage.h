@@ -0,0 +1,170 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <glm/mat4x4.hpp>
+#include "EntityState.h"
+#include "../Math/Transform.h"
+#include "../Math/AABB.h"
+
+class Entity;
+class JobSystem;
+
+/// <summary>
+/// Stable id of an entity inside an entity storage
+/// </summary>
+using EntityId = uint32_t;
+
+/// <summary>
+/// Id of entities that are not part of an entity storage
+/// </summary>
+constexpr EntityId INVALID_ENTITY_ID = UINT32_MAX;
+
+/// <summary>
+/// Bookkeeping for the cached world matrix and world AABB of an entity
+/// </summary>
+struct WorldCacheState {
+	uint32_t transformVersion = 0;	// Transform version the cache was built from
+	uint32_t parentVersion = 0;		// World version of the parent the cache was built from
+	uint32_t version = 0;			// Incremented whenever the cache is rebuilt, children compare against it
+	bool valid = false;				// False forces a rebuild on the next access
+	bool hasParent = false;			// Entities with a parent are refreshed through the hierarchy
+};
+
+/// <summary>
+/// Data-oriented storage for the hot entity data
+/// Transforms, world matrices, AABBs and states live in contiguous arrays (one array per component).
+/// Entities attached to the storage are thin handles that only keep their stable id.
+/// Removing an entity moves the last element into the free slot, so the arrays never have holes.
+/// Pointers and references into the arrays are invalidated when entities are added or removed.
+/// </summary>
+class EntityStorage
+{
+private:
+	/// <summary>
+	/// Local transforms of the entities
+	/// </summary>
+	std::vector<Transform> m_transforms;
+
+	/// <summary>
+	/// Cached world matrices of the entities
+	/// </summary>
+	std::vector<glm::mat4> m_worldMatrices;
+
+	/// <summary>
+	/// Local axis-aligned bounding boxes of the entities
+	/// </summary>
+	std::vector<AABB> m_localAABBs;
+
+	/// <summary>
+	/// Cached world axis-aligned bounding boxes of the entities
+	/// </summary>
+	std::vector<AABB> m_worldAABBs;
+
+	/// <summary>
+	/// Cache bookkeeping of the world matrices and world AABBs
+	/// </summary>
+	std::vector<WorldCacheState> m_worldCaches;
+
+	/// <summary>
+	/// State flags of the entities
+	/// </summary>
+	std::vector<EntityState> m_states;
+
+	/// <summary>
+	/// The entity owning each slot
+	/// </summary>
+	std::vector<Entity*> m_entities;
+
+	/// <summary>
+	/// Stable id of each slot
+	/// </summary>
+	std::vector<EntityId> m_slotIds;
+
+	/// <summary>
+	/// Maps a stable id to its slot
+	/// </summary>
+	std::vector<uint32_t> m_idToSlot;
+
+	/// <summary>
+	/// Ids that can be reused
+	/// </summary>
+	std::vector<EntityId> m_freeIds;
+
+public:
+	EntityStorage() = default;
+	~EntityStorage() = default;
+
+	EntityStorage(const EntityStorage&) = delete;
+	EntityStorage& operator=(const EntityStorage&) = delete;
+
+	/// <summary>
+	/// Creates a slot for the entity and returns its stable id
+	/// </summary>
+	/// <param name="entity"></param>
+	/// <param name="transform"></param>
+	/// <param name="localAABB"></param>
+	/// <param name="state"></param>
+	/// <param name="worldCache"></param>
+	/// <returns></returns>
+	EntityId create(Entity* entity, const Transform& transform, const AABB& localAABB, EntityState state, const WorldCacheState& worldCache);
+
+	/// <summary>
+	/// Removes the slot of the entity (swap and pop)
+	/// </summary>
+	/// <param name="id"></param>
+	void destroy(EntityId id);
+
+	/// <summary>
+	/// Checks if the id belongs to a living slot
+	/// </summary>
+	/// <param name="id"></param>
+	/// <returns></returns>
+	bool isValid(EntityId id) const {
+		return id < m_idToSlot.size() && m_idToSlot[id] != UINT32_MAX;
+	}
+
+	/// <summary>
+	/// Returns the slot index of an id
+	/// </summary>
+	/// <param name="id"></param>
+	/// <returns></returns>
+	uint32_t getSlot(EntityId id) const {
+		return m_idToSlot[id];
+	}
+
+	/// <summary>
+	/// Returns the number of entities in the storage
+	/// </summary>
+	/// <returns></returns>
+	size_t size() const {
+		return m_entities.size();
+	}
+
+	/// <summary>
+	/// Rebuilds the world matrices and world AABBs of all entities whose transform changed
+	/// Unchanged entities only cost a version compare. Root entities are processed in parallel batches
+	/// if a job system is given, entities with a parent afterwards on the calling thread.
+	/// </summary>
+	/// <param name="jobSystem"></param>
+	/// <param name="batchSize"></param>
+	void updateWorldData(JobSystem* jobSystem = nullptr, size_t batchSize = 256);
+
+	// Per entity access
+	Transform& getTransform(EntityId id) { return m_transforms[m_idToSlot[id]]; }
+	const Transform& getTransform(EntityId id) const { return m_transforms[m_idToSlot[id]]; }
+	glm::mat4& getWorldMatrix(EntityId id) { return m_worldMatrices[m_idToSlot[id]]; }
+	const glm::mat4& getWorldMatrix(EntityId id) const { return m_worldMatrices[m_idToSlot[id]]; }
+	AABB& getLocalAABB(EntityId id) { return m_localAABBs[m_idToSlot[id]]; }
+	AABB& getWorldAABB(EntityId id) { return m_worldAABBs[m_idToSlot[id]]; }
+	const AABB& getWorldAABB(EntityId id) const { return m_worldAABBs[m_idToSlot[id]]; }
+	WorldCacheState& getWorldCache(EntityId id) { return m_worldCaches[m_idToSlot[id]]; }
+	EntityState& getState(EntityId id) { return m_states[m_idToSlot[id]]; }
+	EntityState getState(EntityId id) const { return m_states[m_idToSlot[id]]; }
+
+	// Array access for passes that stream over all entities, indexed by slot
+	const std::vector<Transform>& getTransforms() const { return m_transforms; }
+	const std::vector<glm::mat4>& getWorldMatrices() const { return m_worldMatrices; }
+	const std::vector<AABB>& getWorldAABBs() const { return m_worldAABBs; }
+	const std::vector<EntityState>& getStates() const { return m_states; }
+	const std::vector<Entity*>& getEntities() const { return m_entities; }
+};
@@ -16,6 +16,10 @@ void Game::run(const std::string name, const glm::i32vec2 windowSize, const int
 	}
 	m_renderer = std::make_unique<Renderer>();
 
+	// Create the job system and make it available to scenes and games
+	m_jobSystem = std::make_unique<JobSystem>();
+	GFX::instance().registerAsService(JobSystem::SERVICE_NAME, m_jobSystem.get());
+
 	// Create the game window
 	this->window = GFX::instance().createWindow(name, windowSize.x, windowSize.y);
 
@@ -89,6 +93,10 @@ void Game::run(const std::string name, const glm::i32vec2 windowSize, const int
 	m_renderer->dispose();
 	GFX::instance().destroyWindows();
 	glfwTerminate();
+
+	// Shutdown the job system
+	GFX::instance().removeService(JobSystem::SERVICE_NAME);
+	m_jobSystem.reset();
 	GFX::instance().shutdownServices();
 }
 
@@ -4,6 +4,7 @@
 #include <GLFW/glfw3.h>
 #include "../Graphics/Renderer.h"
 #include "../Assets/AssetManager.h"
+#include "JobSystem.h"
 
 /// <summary>
 /// Abstract base class for a game application.
@@ -16,6 +17,12 @@ private:
 	/// </summary>
 	std::unique_ptr<Renderer> m_renderer;
 
+	/// <summary>
+	/// Job system for parallel engine and game work
+	/// Registered with GFX as JobSystem::SERVICE_NAME while the game runs
+	/// </summary>
+	std::unique_ptr<JobSystem> m_jobSystem;
+
 	/// <summary>
 	/// Last frame time in milliseconds.
 	/// </summary>
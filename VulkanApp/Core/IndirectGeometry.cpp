@@ -0,0 +1,213 @@
+#include "IndirectGeometry.h"
+#include "Scene.h"
+#include "Model.h"
+#include "Instancer.h"
+#include <algorithm>
+#include <iostream>
+
+namespace {
+	/// <summary>
+	/// An object with the data needed to sort it into its draw group
+	/// </summary>
+	struct ObjectEntry {
+		Material* material = nullptr;
+		int page = -1;
+		IndirectDrawObject object;
+		InstanceData instance;
+	};
+}
+
+size_t IndirectGeometry::build(Renderer* renderer, const std::vector<Entity*>& entities)
+{
+	this->dispose(renderer);
+	if (!renderer->supportsMultiDrawIndirect()) {
+		std::cout << "[INDIRECT GEOMETRY] Multi draw indirect is not supported, the static models draw themselves." << std::endl;
+		return 0;
+	}
+
+	std::vector<ObjectEntry> entries;
+	std::string pipelineType = ToString(PipelineType::PIPELINE_TYPE_GRAPHICS_3D);
+	size_t skippedModels = 0;
+	for (Entity* entity : entities) {
+		Model* model = dynamic_cast<Model*>(entity);
+		if (model == nullptr || !model->hasState(EntityState::ENTITY_STATE_STATIC) || model->pipelineType != pipelineType || model->getMeshResource() == nullptr || model->isStaticBatched()) {
+			continue;
+		}
+
+		// The culling shader draws one fixed range per object, models with LODs keep choosing their LOD themselves
+		if (model->getMeshResource()->getLODCount() > 1) {
+			skippedModels++;
+			continue;
+		}
+
+		// The world bounds of the model are used for all of its meshes
+		AABB bounds = model->getAABB(true);
+		if (!bounds.isValid()) {
+			continue;
+		}
+
+		// Normal cones only stay cones under uniform scales without mirroring
+		const glm::mat4& worldMatrix = model->getWorldMatrix();
+		glm::mat3 linear(worldMatrix);
+		glm::vec3 scale(glm::length(linear[0]), glm::length(linear[1]), glm::length(linear[2]));
+		float maxScale = std::max(scale.x, std::max(scale.y, scale.z));
+		float minScale = std::min(scale.x, std::min(scale.y, scale.z));
+		bool conesValid = glm::determinant(linear) > 0.0f && maxScale - minScale <= maxScale * 0.001f;
+		glm::vec3 boundsCenter = bounds.center();
+
+		for (const auto& mesh : model->getMeshResource()->meshes) {
+			const GeometryRange& range = renderer->getGeometry(mesh->getGeometryIndex(0));
+
+			// The instanced shader hides instances whose extras.x is zero
+			ObjectEntry entry;
+			entry.material = mesh->material.get();
+			entry.page = range.page;
+			entry.object.boundsMin = glm::vec4(bounds.min, 1.0f);
+			entry.object.boundsMax = glm::vec4(bounds.max, 1.0f);
+			entry.object.sphere = glm::vec4(boundsCenter, glm::length(bounds.max - boundsCenter));
+			entry.object.firstIndex = range.firstIndex;
+			entry.object.indexCount = range.indexCount;
+			entry.object.vertexOffset = static_cast<int32_t>(range.vertexOffset);
+			entry.instance = { worldMatrix, glm::vec4(1.0f, 0.0f, 0.0f, 0.0f) };
+			if (mesh->meshlets.empty()) {
+				entries.push_back(entry);
+				continue;
+			}
+
+			// Every meshlet is an object of its own, bounded by its sphere in world space
+			for (const Meshlet& meshlet : mesh->meshlets) {
+				ObjectEntry meshletEntry = entry;
+				glm::vec3 center = glm::vec3(worldMatrix * glm::vec4(meshlet.center, 1.0f));
+				float radius = meshlet.radius * maxScale;
+				meshletEntry.object.boundsMin = glm::vec4(center - glm::vec3(radius), 1.0f);
+				meshletEntry.object.boundsMax = glm::vec4(center + glm::vec3(radius), 1.0f);
+				meshletEntry.object.sphere = glm::vec4(center, radius);
+				if (conesValid && meshlet.coneCutoff < 1.0f) {
+					meshletEntry.object.cone = glm::vec4(glm::normalize(linear * meshlet.coneAxis), meshlet.coneCutoff);
+				}
+				meshletEntry.object.firstIndex = range.firstIndex + meshlet.firstIndex;
+				meshletEntry.object.indexCount = meshlet.indexCount;
+				entries.push_back(meshletEntry);
+			}
+		}
+
+		model->setStaticBatched(true);
+		m_models.push_back(model);
+	}
+	if (skippedModels > 0) {
+		std::cout << "[INDIRECT GEOMETRY] " << skippedModels << " static models with LODs were not included, they draw themselves to keep their LOD selection." << std::endl;
+	}
+	if (entries.empty()) {
+		return 0;
+	}
+
+	// Objects of the same material and page form a group, the commands of a group follow each other
+	std::stable_sort(entries.begin(), entries.end(), [](const ObjectEntry& a, const ObjectEntry& b) {
+		if (a.material != b.material) {
+			return a.material < b.material;
+		}
+		return a.page < b.page;
+	});
+
+	std::vector<IndirectDrawObject> objects;
+	std::vector<InstanceData> instances;
+	std::vector<IndirectDrawGroup> groups;
+	objects.reserve(entries.size());
+	instances.reserve(entries.size());
+	for (size_t i = 0; i < entries.size(); i++) {
+		ObjectEntry& entry = entries[i];
+		if (groups.empty() || entry.material != m_groupMaterials.back() || entry.page != groups.back().page) {
+			IndirectDrawGroup group;
+			group.page = entry.page;
+			group.firstCommand = static_cast<uint32_t>(i);
+			groups.push_back(group);
+			m_groupMaterials.push_back(entry.material);
+		}
+		IndirectDrawGroup& group = groups.back();
+		group.commandCount++;
+
+		entry.object.drawGroup = static_cast<uint32_t>(groups.size() - 1);
+		entry.object.firstCommand = group.firstCommand;
+		objects.push_back(entry.object);
+		instances.push_back(entry.instance);
+	}
+
+	m_drawListIndex = renderer->createIndirectDrawList(instances.data(), sizeof(InstanceData) * instances.size(), objects, groups);
+	m_objectCount = objects.size();
+	return m_models.size();
+}
+
+void IndirectGeometry::cull(Renderer* renderer, VkCommandBuffer commandBuffer, Camera* camera, int depthPyramidIndex, IndirectCullPhase phase)
+{
+	if (m_drawListIndex < 0) {
+		return;
+	}
+
+	std::array<glm::vec4, 6> planes;
+	glm::vec3 cameraPosition;
+	if (camera != nullptr) {
+		const Frustum& frustum = camera->getFrustum();
+		for (size_t i = 0; i < planes.size(); i++) {
+			planes[i] = glm::vec4(frustum.planes[i].normal, frustum.planes[i].d);
+		}
+		cameraPosition = camera->getViewProjection().cameraPos;
+	}
+	else {
+		// Extract the planes from the rows of the view projection matrix, the depth range is zero to one
+		const UboViewProjection& viewProjection = renderer->getCameraViewProjection(renderer->getActiveCamera());
+		cameraPosition = viewProjection.cameraPos;
+		glm::mat4 rows = glm::transpose(viewProjection.projection * viewProjection.view);
+		planes[0] = rows[3] + rows[0];
+		planes[1] = rows[3] - rows[0];
+		planes[2] = rows[3] + rows[1];
+		planes[3] = rows[3] - rows[1];
+		planes[4] = rows[2];
+		planes[5] = rows[3] - rows[2];
+	}
+	renderer->cullIndirectDrawList(m_drawListIndex, commandBuffer, planes, cameraPosition, depthPyramidIndex, phase);
+}
+
+void IndirectGeometry::render(Scene* scene, Renderer* renderer, VkCommandBuffer commandBuffer, uint32_t currentFrame)
+{
+	m_drawCount = 0;
+	if (m_drawListIndex < 0) {
+		return;
+	}
+
+	// All groups share the pipeline, the scene descriptor sets, the camera and the instance buffer
+	std::string pipelineType = ToString(PipelineType::PIPELINE_TYPE_GRAPHICS_3D_INSTANCED);
+	IndirectDrawList* drawList = renderer->getIndirectDrawList(m_drawListIndex);
+	renderer->bindPipeline(commandBuffer, pipelineType);
+	scene->bindSceneDescriptorSets(renderer, commandBuffer, currentFrame, pipelineType);
+	std::array<VkDescriptorSet, 2> baseDescriptorSets = {
+		renderer->getCameraDescriptorSet(renderer->getActiveCamera(), currentFrame),
+		renderer->getStorageBufferDescriptorSet(drawList->instanceDescriptorIndex)
+	};
+	renderer->bindDescriptorSets(baseDescriptorSets, 0, currentFrame);
+
+	Material* boundMaterial = nullptr;
+	for (size_t i = 0; i < m_groupMaterials.size(); i++) {
+		if (m_groupMaterials[i] != boundMaterial) {
+			m_groupMaterials[i]->bindMaterial(renderer, commandBuffer, 2, currentFrame);
+			boundMaterial = m_groupMaterials[i];
+		}
+		renderer->drawIndirectDrawList(m_drawListIndex, static_cast<int>(i), commandBuffer);
+		m_drawCount++;
+	}
+}
+
+void IndirectGeometry::dispose(Renderer* renderer)
+{
+	if (m_drawListIndex >= 0) {
+		renderer->disposeIndirectDrawList(m_drawListIndex);
+		m_drawListIndex = -1;
+	}
+	m_groupMaterials.clear();
+	m_objectCount = 0;
+	m_drawCount = 0;
+
+	for (Model* model : m_models) {
+		model->setStaticBatched(false);
+	}
+	m_models.clear();
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include "../Graphics/Renderer.h"
+#include "../Graphics/Material.h"
+#include "../Graphics/Camera.h"
+#include "Entity.h"
+#include <vector>
+
+class Scene;
+class Model;
+
+/// <summary>
+/// Static models drawn with GPU culled indirect draws
+/// Every mesh of the static models is an object in a GPU buffer with its transform, world bounds and geometry range,
+/// meshes split into meshlets add one object per meshlet instead. A compute pass culls the objects against the frustum
+/// and by their normal cones and writes the draw commands of the visible ones, grouped
+/// by material and geometry pool page. Each group is drawn with one indirect draw call, so the CPU cost doesn't
+/// depend on the number of objects. The models don't draw themselves anymore, so they must not move, change
+/// their mesh resource or leave the scene while the geometry is built.
+/// </summary>
+class IndirectGeometry
+{
+private:
+	/// <summary>
+	/// The material of every draw group, sorted so consecutive groups share the material binding
+	/// </summary>
+	std::vector<Material*> m_groupMaterials;
+
+	/// <summary>
+	/// The models drawn by the indirect draw list
+	/// </summary>
+	std::vector<Model*> m_models;
+
+	/// <summary>
+	/// The indirect draw list of the renderer, -1 if nothing was built
+	/// </summary>
+	int m_drawListIndex = -1;
+
+	/// <summary>
+	/// Number of culled objects
+	/// </summary>
+	size_t m_objectCount = 0;
+
+	/// <summary>
+	/// Number of indirect draw calls of the last render
+	/// </summary>
+	size_t m_drawCount = 0;
+
+public:
+	IndirectGeometry() = default;
+	~IndirectGeometry() = default;
+
+	IndirectGeometry(const IndirectGeometry&) = delete;
+	IndirectGeometry& operator=(const IndirectGeometry&) = delete;
+
+	/// <summary>
+	/// Creates the objects of the static models of the entities, other entities are ignored
+	/// Only models using the PBR pipeline without LODs that aren't drawn by other static geometry are used. Nothing is built
+	/// if the device doesn't support multi draw indirect. Replaces the objects built before.
+	/// </summary>
+	/// <param name="renderer"></param>
+	/// <param name="entities"></param>
+	/// <returns>Number of models drawn by the indirect draws</returns>
+	size_t build(Renderer* renderer, const std::vector<Entity*>& entities);
+
+	/// <summary>
+	/// Records the culling compute pass, call it before the render pass drawing the geometry begins
+	/// </summary>
+	/// <param name="renderer"></param>
+	/// <param name="commandBuffer"></param>
+	/// <param name="camera">The camera to cull against, nullptr culls against the view projection of the active camera</param>
+	/// <param name="depthPyramidIndex">Also rejects objects behind the depth pyramid, -1 disables the occlusion test</param>
+	/// <param name="phase">The occlusion culling phase, see IndirectCullPhase</param>
+	void cull(Renderer* renderer, VkCommandBuffer commandBuffer, Camera* camera, int depthPyramidIndex = -1, IndirectCullPhase phase = IndirectCullPhase::CULL_PHASE_SINGLE);
+
+	/// <summary>
+	/// Checks if there are objects to cull and draw
+	/// </summary>
+	/// <returns></returns>
+	bool hasObjects() const {
+		return m_drawListIndex >= 0;
+	}
+
+	/// <summary>
+	/// Draws the objects culled by the last cull
+	/// </summary>
+	/// <param name="scene">Binds the scene descriptor sets, e.g. the lights</param>
+	/// <param name="renderer"></param>
+	/// <param name="commandBuffer"></param>
+	/// <param name="currentFrame"></param>
+	void render(Scene* scene, Renderer* renderer, VkCommandBuffer commandBuffer, uint32_t currentFrame);
+
+	/// <summary>
+	/// Frees the buffers and lets the models draw themselves again
+	/// The buffers may still be used by frames in flight, dispose once the device doesn't use them anymore.
+	/// </summary>
+	/// <param name="renderer"></param>
+	void dispose(Renderer* renderer);
+
+	/// <summary>
+	/// Returns the number of culled objects, one per mesh or meshlet of every model
+	/// </summary>
+	/// <returns></returns>
+	size_t getObjectCount() const {
+		return m_objectCount;
+	}
+
+	/// <summary>
+	/// Returns the number of indirect draw calls of the last render
+	/// </summary>
+	/// <returns></returns>
+	size_t getDrawCount() const {
+		return m_drawCount;
+	}
+};
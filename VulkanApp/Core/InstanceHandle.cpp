@@ -3,9 +3,11 @@
 
 bool InstanceHandle::isDirty()
 {
-	if (m_previousState != this->getState()) 
+	uint32_t worldVersion = this->getWorldVersion();
+	if (m_previousState != this->getState() || m_previousWorldVersion != worldVersion) 
 	{
 		m_previousState = this->getState();
+		m_previousWorldVersion = worldVersion;
 		return true;
 	}
 	return false;
@@ -33,7 +35,7 @@ void InstanceHandle::render(Scene* scene, Renderer* renderer, VkCommandBuffer co
 	}
 	// Only update instance data if something changed
 	InstanceData data = {};
-	data.model = this->transform.getMatrix();
+	data.model = this->getWorldMatrix();
 	if (this->hasState(EntityState::ENTITY_STATE_VISIBLE))
 	{
 		data.extras.x = 1.0f;
@@ -17,6 +17,11 @@ private:
 
 	EntityState m_previousState = EntityState::ENTITY_STATE_NONE;
 
+	/// <summary>
+	/// The world version the instance data was last written with
+	/// </summary>
+	uint32_t m_previousWorldVersion = 0;
+
 	bool isDirty();
 public:
 	/// <summary>
@@ -2,11 +2,12 @@
 #include <GLFW/glfw3.h>
 #include "InstancedModel.h"
 #include "../Assets/ModelLoader.h"
+#include <algorithm>
 
 InstancedModel::InstancedModel(const std::string& name, StaticMeshesRsc* ressource, int instances) 
 	: Instancer(name, instances)
 {
-	this->name = name;
+	this->setName(name);
 	this->pipelineType = ToString(PipelineType::PIPELINE_TYPE_GRAPHICS_3D_INSTANCED);
 	m_meshResource = ressource;
 }
@@ -14,62 +15,173 @@ InstancedModel::InstancedModel(const std::string& name, StaticMeshesRsc* ressour
 InstancedModel::InstancedModel(const std::string& name, StaticMeshesRsc* ressource, const std::vector<InstanceData>& startValues, int instances)
 	: Instancer(name, startValues, instances)
 {
-	this->name = name;
+	this->setName(name);
 	this->pipelineType = ToString(PipelineType::PIPELINE_TYPE_GRAPHICS_3D_INSTANCED);
 	m_meshResource = ressource;
 }
 
+void InstancedModel::init(Scene* scene, Renderer* renderer)
+{
+	Instancer::init(scene, renderer);
+
+	// The sorted instances are rewritten while earlier frames still draw, so each swapchain image gets its own region
+	if (m_meshResource != nullptr && m_meshResource->getLODCount() > 1 && instanceCount > 0) {
+		m_lodRegions = renderer->numSwapChainImages();
+		m_lodStorageBufferIndex = renderer->createStorageBuffer(sizeof(InstanceData) * instanceCount * m_lodRegions);
+		m_instanceLODs.assign(instanceCount, 0);
+		m_lodInstances.resize(instanceCount);
+		m_uploadedRevisions.assign(m_lodRegions, 0);
+	}
+}
+
 void InstancedModel::render(Scene* scene, Renderer* renderer, VkCommandBuffer commandBuffer, int32_t currentFrame)
 {
 	if (this->hasState(EntityState::ENTITY_STATE_VISIBLE)) 
 	{
 		Entity::render(scene, renderer, commandBuffer, currentFrame);
 
-		// Early out if pipeline type is not set
-		if (this->pipelineType.empty()) {
-			throw std::runtime_error("failed to render instanced model: pipeline type is not set!");
+		// The depth pre-pass already sorted and uploaded the instances of this frame
+		if (!m_drawPrepared) {
+			this->prepareDraw(renderer, currentFrame);
 		}
+		m_drawPrepared = false;
+		this->drawInstances(scene, renderer, commandBuffer, currentFrame);
+	}
+}
 
-		// Validate the mesh resource
-		if (!m_meshResource) {
-			throw std::runtime_error("failed to render instanced model: mesh resource is null!");
-		}
+void InstancedModel::renderDepth(Scene* scene, Renderer* renderer, VkCommandBuffer commandBuffer, int32_t currentFrame)
+{
+	if (this->hasState(EntityState::ENTITY_STATE_VISIBLE))
+	{
+		this->prepareDraw(renderer, currentFrame);
+		m_drawPrepared = true;
+		this->drawInstances(scene, renderer, commandBuffer, currentFrame);
+	}
+}
 
-		// Early out if no instances or no meshes
-		if (instanceCount == 0 || m_meshResource->meshes.empty()) {
-			return;
+void InstancedModel::prepareDraw(Renderer* renderer, int32_t currentFrame)
+{
+	// Early out if pipeline type is not set
+	if (this->pipelineType.empty()) {
+		throw std::runtime_error("failed to render instanced model: pipeline type is not set!");
+	}
+
+	// Validate the mesh resource
+	if (!m_meshResource) {
+		throw std::runtime_error("failed to render instanced model: mesh resource is null!");
+	}
+
+	// Early out if no instances or no meshes
+	if (instanceCount == 0 || m_meshResource->meshes.empty()) {
+		return;
+	}
+
+	// With LODs the instances are drawn from the region of this swapchain image in the LOD storage buffer
+	if (m_lodStorageBufferIndex >= 0 && static_cast<size_t>(currentFrame) < m_lodRegions) {
+		this->updateInstanceLODs(renderer->getCameraViewProjection(renderer->getActiveCamera()));
+		if (m_uploadedRevisions[currentFrame] != m_lodRevision) {
+			VkDeviceSize size = sizeof(InstanceData) * instanceCount;
+			renderer->updateStorageBuffer(m_lodStorageBufferIndex, m_lodInstances.data(), size, sizeof(InstanceData) * instanceCount * currentFrame);
+			m_uploadedRevisions[currentFrame] = m_lodRevision;
 		}
+	}
+}
 
-		// Get the storage buffer for the instance data and the active camera
-		auto storageBuffer = renderer->getStorageBuffer(this->getStorageBufferIndex());
-		auto camera = renderer->getActiveCamera();
+void InstancedModel::drawInstances(Scene* scene, Renderer* renderer, VkCommandBuffer commandBuffer, int32_t currentFrame)
+{
+	// Early out if no instances or no meshes
+	if (instanceCount == 0 || m_meshResource->meshes.empty()) {
+		return;
+	}
 
-		// Bind the pipeline to render with
-		renderer->bindPipeline(commandBuffer, this->pipelineType);
+	// Get the storage buffer for the instance data and the active camera
+	auto storageBuffer = renderer->getStorageBuffer(this->getStorageBufferIndex());
+	auto camera = renderer->getActiveCamera();
+
+	// With LODs the instances are drawn from the region of this swapchain image in the LOD storage buffer
+	bool bucketed = m_lodStorageBufferIndex >= 0 && static_cast<size_t>(currentFrame) < m_lodRegions;
+	int regionOffset = 0;
+	if (bucketed) {
+		regionOffset = instanceCount * currentFrame;
+		storageBuffer = renderer->getStorageBuffer(m_lodStorageBufferIndex);
+	}
 
-		// Bind the scene descriptor sets (e.g. lights)
-		scene->bindSceneDescriptorSets(renderer, commandBuffer, currentFrame, this->pipelineType);
+	// Bind the pipeline to render with
+	renderer->bindPipeline(commandBuffer, this->pipelineType);
 
-		// Bind the model related push constants
-		VkDescriptorSet cameraDescriptorSet = renderer->getCameraDescriptorSet(camera, currentFrame);
-		VkDescriptorSet storageBufferDescriptorSet = renderer->getStorageBufferDescriptorSet(storageBuffer->descriptorIndex);
-		std::array<VkDescriptorSet, 2> baseDescriptorSets = {
-			cameraDescriptorSet,
-			storageBufferDescriptorSet
-		};
-		renderer->bindDescriptorSets(baseDescriptorSets, 0, currentFrame);
+	// Bind the scene descriptor sets (e.g. lights)
+	scene->bindSceneDescriptorSets(renderer, commandBuffer, currentFrame, this->pipelineType);
 
-		// Render each mesh in the model
-		for (auto& mesh : m_meshResource->meshes) {
-			auto material = mesh->material.get();
+	// Bind the model related push constants
+	VkDescriptorSet cameraDescriptorSet = renderer->getCameraDescriptorSet(camera, currentFrame);
+	VkDescriptorSet storageBufferDescriptorSet = renderer->getStorageBufferDescriptorSet(storageBuffer->descriptorIndex);
+	std::array<VkDescriptorSet, 2> baseDescriptorSets = {
+		cameraDescriptorSet,
+		storageBufferDescriptorSet
+	};
+	renderer->bindDescriptorSets(baseDescriptorSets, 0, currentFrame);
+
+	// Render each mesh in the model
+	for (auto& mesh : m_meshResource->meshes) {
+		auto material = mesh->material.get();
+
+		// Bind the material related descriptor sets
+		material->bindMaterial(renderer, commandBuffer, 2, currentFrame);
+
+		// Draw the mesh with instancing
+		if (!bucketed) {
+			renderer->drawGeometry(mesh->geometryIndex, commandBuffer, instanceCount);
+			continue;
+		}
 
-			// Bind the material related descriptor sets
-			material->bindMaterial(renderer, commandBuffer, 2, currentFrame);
+		// Draw each LOD bucket, gl_InstanceIndex starts at the first instance of the bucket
+		for (int lod = 0; lod + 1 < static_cast<int>(m_lodOffsets.size()); lod++) {
+			int count = m_lodOffsets[lod + 1] - m_lodOffsets[lod];
+			if (count > 0) {
+				renderer->drawGeometry(mesh->getGeometryIndex(lod), commandBuffer, count, regionOffset + m_lodOffsets[lod]);
+			}
+		}
+	}
+}
 
-			// Draw the mesh with instancing
-			renderer->drawBuffers(mesh->vertexBufferIndex, mesh->indexBufferIndex, commandBuffer, instanceCount);
+void InstancedModel::updateInstanceLODs(const UboViewProjection& viewProjection)
+{
+	const auto& instances = this->getInstances();
+	const AABB& bounds = m_meshResource->getBounds();
+	glm::vec3 center = bounds.isValid() ? bounds.center() : glm::vec3(0.0f);
+	float radius = bounds.isValid() ? glm::length(bounds.halfExtents()) : 0.0f;
+
+	// Select the LOD of each instance from the projected size of its bounding sphere
+	bool changed = m_sortedInstanceRevision != this->getInstanceRevision();
+	for (int i = 0; i < instanceCount; i++) {
+		const glm::mat4& model = instances[i].model;
+		float scale = std::max({ glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])) });
+		glm::vec3 worldCenter = glm::vec3(model * glm::vec4(center, 1.0f));
+		int lod = m_meshResource->selectLOD(StaticMeshesRsc::getScreenSize(worldCenter, radius * scale, viewProjection), m_instanceLODs[i]);
+		if (lod != m_instanceLODs[i]) {
+			m_instanceLODs[i] = lod;
+			changed = true;
 		}
 	}
+	if (!changed) {
+		return;
+	}
+
+	// Counting sort of the instances into the LOD buckets
+	int lodCount = m_meshResource->getLODCount();
+	m_lodOffsets.assign(lodCount + 1, 0);
+	for (int lod : m_instanceLODs) {
+		m_lodOffsets[lod + 1]++;
+	}
+	for (int lod = 0; lod < lodCount; lod++) {
+		m_lodOffsets[lod + 1] += m_lodOffsets[lod];
+	}
+	std::vector<int> next(m_lodOffsets.begin(), m_lodOffsets.end() - 1);
+	for (int i = 0; i < instanceCount; i++) {
+		m_lodInstances[next[m_instanceLODs[i]]++] = instances[i];
+	}
+	m_sortedInstanceRevision = this->getInstanceRevision();
+	m_lodRevision++;
 }
 
 void InstancedModel::update(Scene* scene, float dt)
@@ -16,19 +16,92 @@ private:
 	/// </summary>
 	StaticMeshesRsc* m_meshResource;
 
+	/// <summary>
+	/// Storage buffer with the instances sorted by LOD, one region per swapchain image
+	/// Only created if the mesh resource has LODs.
+	/// </summary>
+	int m_lodStorageBufferIndex = -1;
+	size_t m_lodRegions = 0;
+
+	/// <summary>
+	/// The LOD of each instance, kept for the hysteresis of the LOD selection
+	/// </summary>
+	std::vector<int> m_instanceLODs;
+
+	/// <summary>
+	/// The instances sorted by LOD and the first instance of each LOD, the last offset is the instance count
+	/// </summary>
+	std::vector<InstanceData> m_lodInstances;
+	std::vector<int> m_lodOffsets;
+
+	/// <summary>
+	/// Changes whenever the sorted instances change, each region is uploaded again once it differs
+	/// </summary>
+	uint64_t m_lodRevision = 1;
+	std::vector<uint64_t> m_uploadedRevisions;
+
+	/// <summary>
+	/// The instance revision the sorted instances were built from
+	/// </summary>
+	uint64_t m_sortedInstanceRevision = UINT64_MAX;
+
+	/// <summary>
+	/// Whether renderDepth already sorted and uploaded the instances of this frame
+	/// </summary>
+	bool m_drawPrepared = false;
+
+	/// <summary>
+	/// Selects the LOD of each instance and sorts the instances into LOD buckets if a LOD changed
+	/// </summary>
+	/// <param name="viewProjection"></param>
+	void updateInstanceLODs(const UboViewProjection& viewProjection);
+
+	/// <summary>
+	/// Sorts the instances by LOD and uploads them into the region of the swapchain image if the mesh resource has LODs
+	/// </summary>
+	/// <param name="renderer"></param>
+	/// <param name="currentFrame"></param>
+	void prepareDraw(Renderer* renderer, int32_t currentFrame);
+
+	/// <summary>
+	/// Draws the meshes for all instances, one draw per LOD bucket if the mesh resource has LODs
+	/// </summary>
+	/// <param name="scene"></param>
+	/// <param name="renderer"></param>
+	/// <param name="commandBuffer"></param>
+	/// <param name="currentFrame"></param>
+	void drawInstances(Scene* scene, Renderer* renderer, VkCommandBuffer commandBuffer, int32_t currentFrame);
+
 public:
 	InstancedModel(const std::string& name, StaticMeshesRsc* ressource, int instances);
 	InstancedModel(const std::string& name, StaticMeshesRsc* ressource, const std::vector<InstanceData>& startValues, int instances);
 	~InstancedModel() = default;
 
+	/// <summary>
+	/// Initialize the instanced model, creates the LOD storage buffer if the mesh resource has LODs
+	/// </summary>
+	/// <param name="scene"></param>
+	/// <param name="renderer"></param>
+	void init(Scene* scene, Renderer* renderer) override;
+
 	/// <summary>
 	/// Render the instanced model
+	/// With LODs the instances are sorted into one bucket per LOD and each bucket is drawn with its LOD.
 	/// </summary>
 	/// <param name="renderer"></param>
 	/// <param name="commandBuffer"></param>
 	/// <param name="currentFrame"></param>
 	void render(Scene* scene, Renderer* renderer, VkCommandBuffer commandBuffer, int32_t currentFrame) override;
 
+	/// <summary>
+	/// Render the depth of the instanced model, sorts the instances the following render draws with
+	/// </summary>
+	/// <param name="scene"></param>
+	/// <param name="renderer"></param>
+	/// <param name="commandBuffer"></param>
+	/// <param name="currentFrame"></param>
+	void renderDepth(Scene* scene, Renderer* renderer, VkCommandBuffer commandBuffer, int32_t currentFrame) override;
+
 	void update(Scene* scene, float dt) override;
 
 	/// <summary>
@@ -1,4 +1,5 @@
 #include "Instancer.h"
+#include <algorithm>
 
 Instancer::Instancer(const std::string& name, int instances) 
 	: Entity(name)
@@ -20,6 +21,7 @@ void Instancer::init(Scene* scene, Renderer* renderer)
 {
 	VkDeviceSize bufferSize = sizeof(InstanceData) * instanceCount;
 	m_storageBufferIndex = renderer->createStorageBuffer(bufferSize);
+	m_instances.assign(instanceCount, InstanceData{ glm::mat4(0.0f), glm::vec4(0.0f) });
 
 	// Update the initial instance data if provided
 	if (!m_instanceStartValues.empty()) {
@@ -44,6 +46,8 @@ void Instancer::updateInstance(Renderer* renderer, const InstanceData& data, int
 	VkDeviceSize size = sizeof(InstanceData);
 	VkDeviceSize offset = sizeof(InstanceData) * instanceIndex;
 	renderer->updateStorageBuffer(m_storageBufferIndex, &data, size, offset);
+	m_instances[instanceIndex] = data;
+	m_instanceRevision++;
 }
 
 void Instancer::updateInstanceRange(Renderer* renderer, const std::vector<InstanceData>& instanceDataArray, int offset)
@@ -56,6 +60,8 @@ void Instancer::updateInstanceRange(Renderer* renderer, const std::vector<Instan
 	VkDeviceSize size = sizeof(InstanceData) * updateInstanceCount;
 	VkDeviceSize bufferOffset = sizeof(InstanceData) * offset;
 	renderer->updateStorageBuffer(m_storageBufferIndex, instanceDataArray.data(), size, bufferOffset);
+	std::copy(instanceDataArray.begin(), instanceDataArray.end(), m_instances.begin() + offset);
+	m_instanceRevision++;
 }
 
 void Instancer::updateAllInstances(Renderer* renderer, const std::vector<InstanceData>& instanceDataArray)
@@ -65,4 +71,6 @@ void Instancer::updateAllInstances(Renderer* renderer, const std::vector<Instanc
 	}
 	VkDeviceSize size = sizeof(InstanceData) * instanceCount;
 	renderer->updateStorageBuffer(m_storageBufferIndex, instanceDataArray.data(), size, 0);
+	m_instances = instanceDataArray;
+	m_instanceRevision++;
 }
\ No newline at end of file
@@ -27,6 +27,16 @@ private:
 	/// Starting values for instances
 	/// </summary>
 	std::vector<InstanceData> m_instanceStartValues;
+
+	/// <summary>
+	/// CPU copy of the instance data, e.g. for per instance LOD selection
+	/// </summary>
+	std::vector<InstanceData> m_instances;
+
+	/// <summary>
+	/// Changes whenever instance data is updated
+	/// </summary>
+	uint64_t m_instanceRevision = 0;
 public:
 	/// <summary>
 	/// Create an instancer with a specific number of instances
@@ -52,6 +62,18 @@ public:
 	/// <returns></returns>
 	int getStorageBufferIndex() const { return m_storageBufferIndex; }
 
+	/// <summary>
+	/// Get the CPU copy of the instance data
+	/// </summary>
+	/// <returns></returns>
+	const std::vector<InstanceData>& getInstances() const { return m_instances; }
+
+	/// <summary>
+	/// Get the revision of the instance data, it changes whenever instance data is updated
+	/// </summary>
+	/// <returns></returns>
+	uint64_t getInstanceRevision() const { return m_instanceRevision; }
+
 	/// <summary>
 	/// Update the instance data for a specific instance
 	/// </summary>
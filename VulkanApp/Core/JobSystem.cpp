@@ -0,0 +1,292 @@
+#include "JobSystem.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+	// The job system and queue index of the current worker thread
+	thread_local const JobSystem* t_owner = nullptr;
+	thread_local size_t t_queueIndex = 0;
+}
+
+size_t TaskGraph::addTask(std::function<void()> function, const std::string& name)
+{
+	auto task = std::make_unique<Task>();
+	task->name = name;
+	task->function = std::move(function);
+	m_tasks.push_back(std::move(task));
+	return m_tasks.size() - 1;
+}
+
+void TaskGraph::addDependency(size_t before, size_t after)
+{
+	if (before >= m_tasks.size() || after >= m_tasks.size() || before == after) {
+		throw std::runtime_error("failed to add task dependency: invalid task id!");
+	}
+	m_tasks[before]->successors.push_back(after);
+	m_tasks[after]->dependencyCount++;
+}
+
+bool TaskGraph::validate() const
+{
+	// Kahn's algorithm, every task has to be reachable from a root
+	std::vector<uint32_t> dependencies(m_tasks.size());
+	std::vector<size_t> ready;
+	for (size_t i = 0; i < m_tasks.size(); i++) {
+		dependencies[i] = m_tasks[i]->dependencyCount;
+		if (dependencies[i] == 0) {
+			ready.push_back(i);
+		}
+	}
+
+	size_t visited = 0;
+	while (!ready.empty()) {
+		size_t index = ready.back();
+		ready.pop_back();
+		visited++;
+		for (size_t successor : m_tasks[index]->successors) {
+			if (--dependencies[successor] == 0) {
+				ready.push_back(successor);
+			}
+		}
+	}
+	return visited == m_tasks.size();
+}
+
+JobSystem::JobSystem(uint32_t workerCount)
+{
+	if (workerCount == 0) {
+		uint32_t hardwareThreads = std::thread::hardware_concurrency();
+		workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	// One queue per worker and one shared queue for the main thread
+	for (uint32_t i = 0; i < workerCount + 1; i++) {
+		m_queues.push_back(std::make_unique<WorkQueue>());
+	}
+
+	for (uint32_t i = 0; i < workerCount; i++) {
+		m_workers.emplace_back(&JobSystem::workerLoop, this, i);
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_running = false;
+	}
+	m_wakeCondition.notify_all();
+
+	for (auto& worker : m_workers) {
+		if (worker.joinable()) {
+			worker.join();
+		}
+	}
+}
+
+void JobSystem::submit(std::function<void()> job, JobCounter* counter)
+{
+	if (counter != nullptr) {
+		counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+	}
+	this->push({ std::move(job), counter });
+}
+
+void JobSystem::wait(JobCounter& counter)
+{
+	while (!counter.isDone()) {
+		if (!this->executeNext()) {
+			std::this_thread::yield();
+		}
+	}
+
+	if (counter.m_exception) {
+		std::exception_ptr exception = counter.m_exception;
+		counter.m_exception = nullptr;
+		std::rethrow_exception(exception);
+	}
+}
+
+void JobSystem::parallelFor(size_t count, size_t batchSize, const std::function<void(size_t, size_t)>& function)
+{
+	if (count == 0) {
+		return;
+	}
+	batchSize = std::max<size_t>(batchSize, 1);
+
+	// Not worth splitting, run inline
+	if (count <= batchSize || m_workers.empty()) {
+		function(0, count);
+		return;
+	}
+
+	JobCounter counter;
+	for (size_t begin = batchSize; begin < count; begin += batchSize) {
+		size_t end = std::min(begin + batchSize, count);
+		this->submit([&function, begin, end]() { function(begin, end); }, &counter);
+	}
+
+	// The calling thread takes the first batch itself
+	try {
+		function(0, std::min(batchSize, count));
+	}
+	catch (...) {
+		this->wait(counter);
+		throw;
+	}
+	this->wait(counter);
+}
+
+void JobSystem::run(TaskGraph& graph)
+{
+	if (graph.m_tasks.empty()) {
+		return;
+	}
+	if (!graph.validate()) {
+		throw std::runtime_error("failed to run task graph: graph contains a cycle!");
+	}
+
+	JobCounter counter;
+	counter.m_pending.store(static_cast<uint32_t>(graph.m_tasks.size()), std::memory_order_relaxed);
+	for (auto& task : graph.m_tasks) {
+		task->remainingDependencies.store(task->dependencyCount, std::memory_order_relaxed);
+	}
+
+	for (size_t i = 0; i < graph.m_tasks.size(); i++) {
+		if (graph.m_tasks[i]->dependencyCount == 0) {
+			this->submitTask(graph, i, &counter);
+		}
+	}
+	this->wait(counter);
+}
+
+void JobSystem::submitTask(TaskGraph& graph, size_t taskIndex, JobCounter* counter)
+{
+	// The counter already accounts for every task of the graph
+	this->push({ [this, &graph, taskIndex, counter]() {
+		auto& task = graph.m_tasks[taskIndex];
+		try {
+			task->function();
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> lock(counter->m_exceptionMutex);
+			if (!counter->m_exception) {
+				counter->m_exception = std::current_exception();
+			}
+		}
+
+		for (size_t successor : task->successors) {
+			if (graph.m_tasks[successor]->remainingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				this->submitTask(graph, successor, counter);
+			}
+		}
+	}, counter });
+}
+
+size_t JobSystem::getQueueIndex() const
+{
+	if (t_owner == this) {
+		return t_queueIndex;
+	}
+	return m_queues.size() - 1;
+}
+
+void JobSystem::push(Job job)
+{
+	auto& queue = m_queues[this->getQueueIndex()];
+	{
+		std::lock_guard<std::mutex> lock(queue->mutex);
+		queue->jobs.push_back(std::move(job));
+	}
+	m_queuedJobs.fetch_add(1, std::memory_order_release);
+
+	// Take the sleep mutex so a worker can't miss the wake up between its check and its wait
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+	}
+	m_wakeCondition.notify_one();
+}
+
+bool JobSystem::pop(Job& job)
+{
+	if (m_queuedJobs.load(std::memory_order_acquire) == 0) {
+		return false;
+	}
+
+	// Own queue first, newest job first to keep the caches warm
+	size_t ownIndex = this->getQueueIndex();
+	{
+		auto& queue = m_queues[ownIndex];
+		std::lock_guard<std::mutex> lock(queue->mutex);
+		if (!queue->jobs.empty()) {
+			job = std::move(queue->jobs.back());
+			queue->jobs.pop_back();
+			m_queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+
+	// Steal the oldest job from the other queues
+	for (size_t i = 1; i < m_queues.size(); i++) {
+		auto& queue = m_queues[(ownIndex + i) % m_queues.size()];
+		std::lock_guard<std::mutex> lock(queue->mutex);
+		if (!queue->jobs.empty()) {
+			job = std::move(queue->jobs.front());
+			queue->jobs.pop_front();
+			m_queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool JobSystem::executeNext()
+{
+	Job job;
+	if (!this->pop(job)) {
+		return false;
+	}
+	this->execute(job);
+	return true;
+}
+
+void JobSystem::execute(Job& job)
+{
+	try {
+		job.function();
+	}
+	catch (...) {
+		if (job.counter == nullptr) {
+			// Nobody waits for this job, don't lose the error silently
+			std::terminate();
+		}
+		std::lock_guard<std::mutex> lock(job.counter->m_exceptionMutex);
+		if (!job.counter->m_exception) {
+			job.counter->m_exception = std::current_exception();
+		}
+	}
+
+	if (job.counter != nullptr) {
+		job.counter->m_pending.fetch_sub(1, std::memory_order_acq_rel);
+	}
+}
+
+void JobSystem::workerLoop(size_t workerIndex)
+{
+	t_owner = this;
+	t_queueIndex = workerIndex;
+
+	while (true) {
+		if (this->executeNext()) {
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_wakeCondition.wait(lock, [this]() {
+			return !m_running || m_queuedJobs.load(std::memory_order_acquire) > 0;
+		});
+		if (!m_running && m_queuedJobs.load(std::memory_order_acquire) == 0) {
+			return;
+		}
+	}
+}
@@ -0,0 +1,262 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// Tracks the completion of a group of jobs
+/// Pass it to JobSystem::submit and wait on it with JobSystem::wait
+/// </summary>
+class JobCounter
+{
+private:
+	friend class JobSystem;
+
+	/// <summary>
+	/// Number of jobs that are not finished yet
+	/// </summary>
+	std::atomic<uint32_t> m_pending = 0;
+
+	/// <summary>
+	/// The first exception thrown by a job of this counter
+	/// </summary>
+	std::exception_ptr m_exception;
+
+	/// <summary>
+	/// Guards the stored exception
+	/// </summary>
+	std::mutex m_exceptionMutex;
+
+public:
+	JobCounter() = default;
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+
+	/// <summary>
+	/// Checks if all jobs of this counter are finished
+	/// </summary>
+	/// <returns></returns>
+	bool isDone() const {
+		return m_pending.load(std::memory_order_acquire) == 0;
+	}
+};
+
+/// <summary>
+/// A graph of tasks with dependencies between them
+/// Build it once and run it with JobSystem::run as often as needed
+/// </summary>
+class TaskGraph
+{
+private:
+	friend class JobSystem;
+
+	/// <summary>
+	/// A single task of the graph
+	/// </summary>
+	struct Task {
+		std::string name;
+		std::function<void()> function;
+		std::vector<size_t> successors;
+		uint32_t dependencyCount = 0;
+		std::atomic<uint32_t> remainingDependencies = 0;
+	};
+
+	/// <summary>
+	/// The tasks of the graph
+	/// </summary>
+	std::vector<std::unique_ptr<Task>> m_tasks;
+
+public:
+	/// <summary>
+	/// Adds a task to the graph and returns its id
+	/// </summary>
+	/// <param name="function"></param>
+	/// <param name="name"></param>
+	/// <returns></returns>
+	size_t addTask(std::function<void()> function, const std::string& name = "");
+
+	/// <summary>
+	/// Lets the task "after" wait for the task "before" to finish
+	/// </summary>
+	/// <param name="before"></param>
+	/// <param name="after"></param>
+	void addDependency(size_t before, size_t after);
+
+	/// <summary>
+	/// Checks that the graph has no cycles and can be executed
+	/// </summary>
+	/// <returns></returns>
+	bool validate() const;
+
+	/// <summary>
+	/// Removes all tasks from the graph
+	/// </summary>
+	void clear() {
+		m_tasks.clear();
+	}
+
+	/// <summary>
+	/// Returns the number of tasks in the graph
+	/// </summary>
+	/// <returns></returns>
+	size_t size() const {
+		return m_tasks.size();
+	}
+};
+
+/// <summary>
+/// Work-stealing thread pool for engine and game jobs
+/// Every worker owns a queue, pops its own work from the back and steals from the front of other queues.
+/// Threads that wait for jobs help executing them, so waiting from inside a job never deadlocks.
+/// Registered with GFX as service JobSystem::SERVICE_NAME by Game::run.
+/// </summary>
+class JobSystem
+{
+public:
+	/// <summary>
+	/// The name the job system is registered with in the GFX service registry
+	/// </summary>
+	static constexpr const char* SERVICE_NAME = "JobSystem";
+
+	/// <summary>
+	/// Creates the job system with the given number of worker threads
+	/// 0 uses one worker per hardware thread minus the calling thread
+	/// </summary>
+	/// <param name="workerCount"></param>
+	JobSystem(uint32_t workerCount = 0);
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	/// <summary>
+	/// Submits a job for execution
+	/// </summary>
+	/// <param name="job"></param>
+	/// <param name="counter">Optional counter that is signaled when the job is done</param>
+	void submit(std::function<void()> job, JobCounter* counter = nullptr);
+
+	/// <summary>
+	/// Waits until all jobs of the counter are finished and executes pending jobs meanwhile
+	/// Rethrows the first exception thrown by one of the jobs
+	/// </summary>
+	/// <param name="counter"></param>
+	void wait(JobCounter& counter);
+
+	/// <summary>
+	/// Splits the range [0, count) into batches and runs them in parallel
+	/// The function receives the begin and end index of its batch. Returns when all batches are done.
+	/// </summary>
+	/// <param name="count"></param>
+	/// <param name="batchSize"></param>
+	/// <param name="function"></param>
+	void parallelFor(size_t count, size_t batchSize, const std::function<void(size_t, size_t)>& function);
+
+	/// <summary>
+	/// Runs all tasks of the graph respecting their dependencies and returns when all are done
+	/// </summary>
+	/// <param name="graph"></param>
+	void run(TaskGraph& graph);
+
+	/// <summary>
+	/// Returns the number of worker threads
+	/// </summary>
+	/// <returns></returns>
+	uint32_t getWorkerCount() const {
+		return static_cast<uint32_t>(m_workers.size());
+	}
+
+private:
+	/// <summary>
+	/// A job together with the counter it belongs to
+	/// </summary>
+	struct Job {
+		std::function<void()> function;
+		JobCounter* counter = nullptr;
+	};
+
+	/// <summary>
+	/// Job queue of a single worker
+	/// </summary>
+	struct WorkQueue {
+		std::deque<Job> jobs;
+		std::mutex mutex;
+	};
+
+	/// <summary>
+	/// One queue per worker plus one for threads outside the pool
+	/// </summary>
+	std::vector<std::unique_ptr<WorkQueue>> m_queues;
+
+	/// <summary>
+	/// The worker threads
+	/// </summary>
+	std::vector<std::thread> m_workers;
+
+	/// <summary>
+	/// Number of jobs sitting in the queues
+	/// </summary>
+	std::atomic<uint32_t> m_queuedJobs = 0;
+
+	/// <summary>
+	/// Set to false to stop the workers
+	/// </summary>
+	std::atomic<bool> m_running = true;
+
+	/// <summary>
+	/// Sleep mutex and condition for idle workers
+	/// </summary>
+	std::mutex m_sleepMutex;
+	std::condition_variable m_wakeCondition;
+
+	/// <summary>
+	/// Queue index of the current thread, the last queue for threads outside the pool
+	/// </summary>
+	size_t getQueueIndex() const;
+
+	/// <summary>
+	/// Pushes a job to the queue of the current thread and wakes a worker
+	/// </summary>
+	/// <param name="job"></param>
+	void push(Job job);
+
+	/// <summary>
+	/// Pops a job from the own queue or steals one from another queue
+	/// </summary>
+	/// <param name="job"></param>
+	/// <returns></returns>
+	bool pop(Job& job);
+
+	/// <summary>
+	/// Executes a single pending job if there is one
+	/// </summary>
+	/// <returns></returns>
+	bool executeNext();
+
+	/// <summary>
+	/// Executes the job and signals its counter
+	/// </summary>
+	/// <param name="job"></param>
+	void execute(Job& job);
+
+	/// <summary>
+	/// Submits a task of a graph and schedules its successors once it is done
+	/// </summary>
+	/// <param name="graph"></param>
+	/// <param name="taskIndex"></param>
+	/// <param name="counter"></param>
+	void submitTask(TaskGraph& graph, size_t taskIndex, JobCounter* counter);
+
+	/// <summary>
+	/// Main loop of a worker thread
+	/// </summary>
+	/// <param name="workerIndex"></param>
+	void workerLoop(size_t workerIndex);
+};
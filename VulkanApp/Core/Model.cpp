@@ -31,44 +31,103 @@ void Model::render(Scene* scene, Renderer* renderer, VkCommandBuffer commandBuff
 	if (this->hasState(EntityState::ENTITY_STATE_VISIBLE)) {
 		Entity::render(scene, renderer, commandBuffer, currentFrame);
 
-		// Validate the pipeline type
-		if (this->pipelineType.empty()) {
-			throw std::runtime_error("failed to render model: pipeline type is not set!");
+		// The scene draws the merged static geometry instead
+		if (m_staticBatched) {
+			return;
 		}
 
-		// Validate the mesh resource
-		if (!m_meshResource) {
-			throw std::runtime_error("failed to render model: mesh resource is null!");
+		// The depth pre-pass already selected the LOD of this frame
+		if (!m_drawPrepared) {
+			this->prepareDraw(scene, renderer);
 		}
+		m_drawPrepared = false;
 
-		// Get the model matrix and the active camera
-		auto modelMatrix = this->getModelMatrix();
-		auto currentCamera = renderer->getActiveCamera();
+		// With auto instancing the scene draws the model together with all models of the same resource
+		if (!m_batched) {
+			this->drawMeshes(scene, renderer, commandBuffer, currentFrame);
+		}
+	}
+}
+
+void Model::renderDepth(Scene* scene, Renderer* renderer, VkCommandBuffer commandBuffer, int32_t currentFrame)
+{
+	if (!this->hasState(EntityState::ENTITY_STATE_VISIBLE) || m_staticBatched) {
+		return;
+	}
+	this->prepareDraw(scene, renderer);
+	m_drawPrepared = true;
+	if (!m_batched) {
+		this->drawMeshes(scene, renderer, commandBuffer, currentFrame);
+	}
+}
+
+void Model::prepareDraw(Scene* scene, Renderer* renderer)
+{
+	// Validate the pipeline type
+	if (this->pipelineType.empty()) {
+		throw std::runtime_error("failed to render model: pipeline type is not set!");
+	}
 
-		// Bind the pipeline to render with
-		renderer->bindPipeline(commandBuffer, this->pipelineType);
+	// Validate the mesh resource
+	if (!m_meshResource) {
+		throw std::runtime_error("failed to render model: mesh resource is null!");
+	}
 
-		// Bind the scene descriptor sets e.g. lights
-		scene->bindSceneDescriptorSets(renderer, commandBuffer, currentFrame, this->pipelineType);
+	// Select the LOD from the projected size of the world bounds
+	if (m_meshResource->getLODCount() > 1) {
+		AABB bounds = this->getAABB(true);
+		if (bounds.isValid()) {
+			float screenSize = StaticMeshesRsc::getScreenSize(bounds.center(), glm::length(bounds.halfExtents()), renderer->getCameraViewProjection(renderer->getActiveCamera()));
+			m_lod = m_meshResource->selectLOD(screenSize, m_lod);
+		}
+	}
 
-		// Bind the model matrix push constant
-		renderer->bindPushConstants(commandBuffer, renderer->getCurrentPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(UboModel), &modelMatrix);
+	// With auto instancing the model is added to the batch of its resource and LOD
+	ModelBatcher* batcher = scene->getModelBatcher();
+	m_batched = batcher != nullptr && this->pipelineType == ToString(PipelineType::PIPELINE_TYPE_GRAPHICS_3D);
+	if (m_batched) {
+		batcher->add(m_meshResource, m_lod, this->getModelMatrix().model);
+	}
+}
 
-		// Bind the model related descriptor sets
-		VkDescriptorSet descriptorSet = renderer->getCameraDescriptorSet(currentCamera, currentFrame);
-		renderer->bindDescriptorSet(descriptorSet, 0, currentFrame);
+void Model::drawMeshes(Scene* scene, Renderer* renderer, VkCommandBuffer commandBuffer, int32_t currentFrame)
+{
+	// Get the model matrix and the active camera
+	auto modelMatrix = this->getModelMatrix();
+	auto currentCamera = renderer->getActiveCamera();
 
-		// Render all meshes
-		for (const auto& mesh : m_meshResource->meshes) {
-			auto material = mesh->material.get();
+	// Bind the pipeline to render with
+	renderer->bindPipeline(commandBuffer, this->pipelineType);
 
-			// Bind the material related descriptor sets
-			material->bindMaterial(renderer, commandBuffer, 1, currentFrame);
+	// Bind the scene descriptor sets e.g. lights
+	scene->bindSceneDescriptorSets(renderer, commandBuffer, currentFrame, this->pipelineType);
 
-			// Draw the mesh
-			renderer->drawBuffers(mesh->vertexBufferIndex, mesh->indexBufferIndex, commandBuffer);
-		}
+	// Bind the model matrix push constant
+	renderer->bindPushConstants(commandBuffer, renderer->getCurrentPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(UboModel), &modelMatrix);
+
+	// Bind the model related descriptor sets
+	VkDescriptorSet descriptorSet = renderer->getCameraDescriptorSet(currentCamera, currentFrame);
+	renderer->bindDescriptorSet(descriptorSet, 0, currentFrame);
+
+	// Render all meshes
+	for (const auto& mesh : m_meshResource->meshes) {
+		auto material = mesh->material.get();
+
+		// Bind the material related descriptor sets
+		material->bindMaterial(renderer, commandBuffer, 1, currentFrame);
+
+		// Draw the mesh
+		renderer->drawGeometry(mesh->getGeometryIndex(m_lod), commandBuffer);
+	}
+}
+
+bool Model::hasCacheableDraws() const
+{
+	// The LOD is selected from the camera distance every frame
+	if (m_meshResource == nullptr || m_meshResource->getLODCount() > 1) {
+		return false;
 	}
+	return this->hasState(EntityState::ENTITY_STATE_STATIC) && !this->behaviorsRenderEveryFrame();
 }
 
 void Model::destroy(Scene* scene, Renderer* renderer)
@@ -87,3 +146,31 @@ void Model::createAABB()
 	}
 	setAABB(aabb);
 }
+
+bool Model::hasRaycastGeometry() const
+{
+	return m_meshResource != nullptr && m_meshResource->getTriangleBVH() != nullptr;
+}
+
+bool Model::raycastGeometry(const Ray& ray, float maxDistance, RayHit& hit)
+{
+	// The direction isn't normalized, so distances are the same in world and model space
+	glm::mat4 invWorldMatrix = glm::inverse(this->getWorldMatrix());
+	Ray localRay;
+	localRay.origin = glm::vec3(invWorldMatrix * glm::vec4(ray.origin, 1.0f));
+	localRay.direction = glm::vec3(invWorldMatrix * glm::vec4(ray.direction, 0.0f));
+
+	TriangleHit triangleHit;
+	if (!m_meshResource->getTriangleBVH()->raycast(localRay, maxDistance, triangleHit)) {
+		return false;
+	}
+
+	hit.hit = true;
+	hit.distance = triangleHit.distance;
+	hit.position = ray.origin + ray.direction * triangleHit.distance;
+	hit.hitobject = this;
+	hit.normal = glm::normalize(glm::transpose(glm::mat3(invWorldMatrix)) * triangleHit.normal);
+	hit.meshIndex = static_cast<int>(triangleHit.meshIndex);
+	hit.triangleIndex = static_cast<int>(triangleHit.triangleIndex);
+	return true;
+}
@@ -20,6 +20,38 @@ private:
 	/// </summary>
 	StaticMeshesRsc* m_meshResource;
 
+	/// <summary>
+	/// The LOD drawn last frame, kept for the hysteresis of the LOD selection
+	/// </summary>
+	int m_lod = 0;
+
+	/// <summary>
+	/// Whether the geometry of the model is merged into the static geometry of the scene
+	/// </summary>
+	bool m_staticBatched = false;
+
+	/// <summary>
+	/// Whether renderDepth already selected the LOD of this frame and whether the model was added to the model batch
+	/// </summary>
+	bool m_drawPrepared = false;
+	bool m_batched = false;
+
+	/// <summary>
+	/// Selects the LOD and adds the model to the model batch of the scene if it collects models
+	/// </summary>
+	/// <param name="scene"></param>
+	/// <param name="renderer"></param>
+	void prepareDraw(Scene* scene, Renderer* renderer);
+
+	/// <summary>
+	/// Draws the meshes of the selected LOD
+	/// </summary>
+	/// <param name="scene"></param>
+	/// <param name="renderer"></param>
+	/// <param name="commandBuffer"></param>
+	/// <param name="currentFrame"></param>
+	void drawMeshes(Scene* scene, Renderer* renderer, VkCommandBuffer commandBuffer, int32_t currentFrame);
+
 public:
     /// <summary>
 	/// Create a model from a mesh resource
@@ -29,6 +61,38 @@ public:
     Model(std::string name, StaticMeshesRsc* ressource);
 	~Model() = default;
 
+	/// <summary>
+	/// Returns the mesh resource of the model
+	/// </summary>
+	/// <returns></returns>
+	StaticMeshesRsc* getMeshResource() const {
+		return m_meshResource;
+	}
+
+	/// <summary>
+	/// Returns the LOD drawn last frame
+	/// </summary>
+	/// <returns></returns>
+	int getLOD() const {
+		return m_lod;
+	}
+
+	/// <summary>
+	/// Sets whether the scene draws the model as part of its static geometry, the model doesn't draw itself then
+	/// </summary>
+	/// <param name="staticBatched"></param>
+	void setStaticBatched(bool staticBatched) {
+		m_staticBatched = staticBatched;
+	}
+
+	/// <summary>
+	/// Whether the scene draws the model as part of its static geometry
+	/// </summary>
+	/// <returns></returns>
+	bool isStaticBatched() const {
+		return m_staticBatched;
+	}
+
 	/// <summary>
 	/// Update the model
 	/// </summary>
@@ -52,6 +116,21 @@ public:
 	/// <param name="currentFrame"></param>
 	void render(Scene* scene, Renderer* renderer, VkCommandBuffer commandBuffer, int32_t currentFrame);
 
+	/// <summary>
+	/// Render the depth of the model, selects the LOD the following render draws with
+	/// </summary>
+	/// <param name="scene"></param>
+	/// <param name="renderer"></param>
+	/// <param name="commandBuffer"></param>
+	/// <param name="currentFrame"></param>
+	void renderDepth(Scene* scene, Renderer* renderer, VkCommandBuffer commandBuffer, int32_t currentFrame) override;
+
+	/// <summary>
+	/// Static models with a single LOD draw the same every frame
+	/// </summary>
+	/// <returns></returns>
+	bool hasCacheableDraws() const override;
+
 	/// <summary>
 	/// Destroy the model
 	/// </summary>
@@ -64,5 +143,21 @@ public:
 	/// </summary>
 	void createAABB() override;
 
+	/// <summary>
+	/// Whether the mesh resource has a triangle BVH for precise raycasts
+	/// </summary>
+	/// <returns></returns>
+	bool hasRaycastGeometry() const override;
+
+	/// <summary>
+	/// Raycasts the triangles of the mesh resource
+	/// The ray is transformed into model space and traverses the triangle BVH shared by all models of the resource.
+	/// </summary>
+	/// <param name="ray"></param>
+	/// <param name="maxDistance"></param>
+	/// <param name="hit"></param>
+	/// <returns></returns>
+	bool raycastGeometry(const Ray& ray, float maxDistance, RayHit& hit) override;
+
 };
 
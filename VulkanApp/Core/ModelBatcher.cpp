@@ -0,0 +1,128 @@
+#include "ModelBatcher.h"
+#include "Scene.h"
+#include "../Assets/StaticMeshesRsc.h"
+#include <algorithm>
+#include <stdexcept>
+
+void ModelBatcher::add(StaticMeshesRsc* resource, int lod, const glm::mat4& modelMatrix)
+{
+	if (m_uploaded) {
+		throw std::runtime_error("failed to add model to batch: the batches of this frame were already uploaded!");
+	}
+
+	auto [it, inserted] = m_batchIndices.try_emplace({ resource, lod }, m_batches.size());
+	if (inserted) {
+		Batch batch;
+		batch.resource = resource;
+		batch.lod = lod;
+		m_batches.push_back(std::move(batch));
+	}
+
+	// The instanced shader hides instances whose extras.x is zero
+	m_batches[it->second].instances.push_back({ modelMatrix, glm::vec4(1.0f, 0.0f, 0.0f, 0.0f) });
+}
+
+void ModelBatcher::upload(Renderer* renderer, uint32_t currentFrame)
+{
+	m_uploaded = true;
+	m_uploadedBufferIndex = -1;
+
+	// Lay out the batches one after another
+	m_instances.clear();
+	for (const auto& batch : m_batches) {
+		m_instances.insert(m_instances.end(), batch.instances.begin(), batch.instances.end());
+	}
+	if (m_instances.empty()) {
+		return;
+	}
+
+	// Grow the storage buffer of this swapchain image, the GPU is done with its previous contents
+	if (m_frameBuffers.size() <= currentFrame) {
+		m_frameBuffers.resize(currentFrame + 1);
+	}
+	FrameBuffer& frameBuffer = m_frameBuffers[currentFrame];
+	if (frameBuffer.capacity < m_instances.size()) {
+		renderer->disposeStorageBuffer(frameBuffer.storageBufferIndex);
+		frameBuffer.capacity = std::max({ m_instances.size(), frameBuffer.capacity * 2, static_cast<size_t>(256) });
+		frameBuffer.storageBufferIndex = renderer->createStorageBuffer(sizeof(InstanceData) * frameBuffer.capacity);
+	}
+	renderer->updateStorageBuffer(frameBuffer.storageBufferIndex, m_instances.data(), sizeof(InstanceData) * m_instances.size(), 0);
+	m_uploadedBufferIndex = frameBuffer.storageBufferIndex;
+}
+
+void ModelBatcher::draw(Scene* scene, Renderer* renderer, VkCommandBuffer commandBuffer, uint32_t currentFrame)
+{
+	m_drawCount = 0;
+	if (!m_uploaded) {
+		this->upload(renderer, currentFrame);
+	}
+	if (m_uploadedBufferIndex < 0) {
+		return;
+	}
+
+	// All batches share the pipeline, the scene descriptor sets, the camera and the instance buffer
+	auto storageBuffer = renderer->getStorageBuffer(m_uploadedBufferIndex);
+	std::string pipelineType = ToString(PipelineType::PIPELINE_TYPE_GRAPHICS_3D_INSTANCED);
+	renderer->bindPipeline(commandBuffer, pipelineType);
+	scene->bindSceneDescriptorSets(renderer, commandBuffer, currentFrame, pipelineType);
+	std::array<VkDescriptorSet, 2> baseDescriptorSets = {
+		renderer->getCameraDescriptorSet(renderer->getActiveCamera(), currentFrame),
+		renderer->getStorageBufferDescriptorSet(storageBuffer->descriptorIndex)
+	};
+	renderer->bindDescriptorSets(baseDescriptorSets, 0, currentFrame);
+
+	int firstInstance = 0;
+	for (const auto& batch : m_batches) {
+		int count = static_cast<int>(batch.instances.size());
+		if (count == 0) {
+			continue;
+		}
+		for (const auto& mesh : batch.resource->meshes) {
+			mesh->material->bindMaterial(renderer, commandBuffer, 2, currentFrame);
+			renderer->drawGeometry(mesh->getGeometryIndex(batch.lod), commandBuffer, count, firstInstance);
+			m_drawCount++;
+		}
+		firstInstance += count;
+	}
+}
+
+void ModelBatcher::clear()
+{
+	m_uploaded = false;
+	m_uploadedBufferIndex = -1;
+
+	// Batches that stayed empty for a frame are dropped, e.g. of resources that are no longer drawn
+	bool stale = std::any_of(m_batches.begin(), m_batches.end(), [](const Batch& batch) {
+		return batch.instances.empty();
+	});
+	if (stale) {
+		std::erase_if(m_batches, [](const Batch& batch) {
+			return batch.instances.empty();
+		});
+		m_batchIndices.clear();
+		for (size_t i = 0; i < m_batches.size(); i++) {
+			m_batchIndices[{ m_batches[i].resource, m_batches[i].lod }] = i;
+		}
+	}
+	for (auto& batch : m_batches) {
+		batch.instances.clear();
+	}
+}
+
+void ModelBatcher::flush(Scene* scene, Renderer* renderer, VkCommandBuffer commandBuffer, uint32_t currentFrame)
+{
+	this->draw(scene, renderer, commandBuffer, currentFrame);
+	this->clear();
+}
+
+void ModelBatcher::dispose(Renderer* renderer)
+{
+	for (auto& frameBuffer : m_frameBuffers) {
+		renderer->disposeStorageBuffer(frameBuffer.storageBufferIndex);
+	}
+	m_frameBuffers.clear();
+	m_batches.clear();
+	m_batchIndices.clear();
+	m_uploaded = false;
+	m_uploadedBufferIndex = -1;
+}
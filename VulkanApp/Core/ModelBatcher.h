@@ -0,0 +1,130 @@
+#pragma once
+#include "../Graphics/Renderer.h"
+#include "Instancer.h"
+#include <unordered_map>
+#include <vector>
+
+class Scene;
+class StaticMeshesRsc;
+
+/// <summary>
+/// Collects the models of a frame and draws all models sharing a mesh resource and LOD with one instanced draw per mesh
+/// The model matrices are written into a storage buffer per swapchain image that grows with the number of models,
+/// the groups are drawn with the instanced PBR pipeline. The instances are uploaded once per frame, the uploaded batches
+/// can be drawn several times, e.g. in both stages of a depth pre-pass.
+/// </summary>
+class ModelBatcher
+{
+private:
+	/// <summary>
+	/// The models of one mesh resource and LOD
+	/// </summary>
+	struct Batch {
+		StaticMeshesRsc* resource = nullptr;
+		int lod = 0;
+		std::vector<InstanceData> instances;
+	};
+
+	struct BatchKey {
+		const StaticMeshesRsc* resource;
+		int lod;
+
+		bool operator==(const BatchKey&) const = default;
+	};
+
+	struct BatchKeyHash {
+		size_t operator()(const BatchKey& key) const {
+			return std::hash<const void*>()(key.resource) ^ (static_cast<size_t>(key.lod) * 0x9E3779B97F4A7C15ull);
+		}
+	};
+
+	/// <summary>
+	/// Storage buffer of a swapchain image
+	/// </summary>
+	struct FrameBuffer {
+		int storageBufferIndex = -1;
+		size_t capacity = 0;	// In instances
+	};
+
+	/// <summary>
+	/// The batches, kept between frames so their instance vectors keep their capacity
+	/// </summary>
+	std::vector<Batch> m_batches;
+	std::unordered_map<BatchKey, size_t, BatchKeyHash> m_batchIndices;
+
+	/// <summary>
+	/// The instances of all batches in draw order, reused between frames
+	/// </summary>
+	std::vector<InstanceData> m_instances;
+
+	std::vector<FrameBuffer> m_frameBuffers;
+
+	/// <summary>
+	/// The storage buffer holding the uploaded instances, -1 until the batches of the frame are uploaded
+	/// </summary>
+	int m_uploadedBufferIndex = -1;
+	bool m_uploaded = false;
+
+	/// <summary>
+	/// Number of draw calls of the last draw
+	/// </summary>
+	size_t m_drawCount = 0;
+
+public:
+	ModelBatcher() = default;
+	~ModelBatcher() = default;
+
+	/// <summary>
+	/// Adds a model to the batch of its mesh resource and LOD
+	/// </summary>
+	/// <param name="resource"></param>
+	/// <param name="lod"></param>
+	/// <param name="modelMatrix"></param>
+	void add(StaticMeshesRsc* resource, int lod, const glm::mat4& modelMatrix);
+
+	/// <summary>
+	/// Writes the instances of all batches into the storage buffer of the swapchain image
+	/// No models can be added afterwards until the batches are cleared.
+	/// </summary>
+	/// <param name="renderer"></param>
+	/// <param name="currentFrame">The swapchain image, its storage buffer is not in use by the GPU anymore</param>
+	void upload(Renderer* renderer, uint32_t currentFrame);
+
+	/// <summary>
+	/// Draws all batches, uploads them first if they weren't uploaded yet
+	/// </summary>
+	/// <param name="scene">Binds the scene descriptor sets, e.g. the lights</param>
+	/// <param name="renderer"></param>
+	/// <param name="commandBuffer"></param>
+	/// <param name="currentFrame"></param>
+	void draw(Scene* scene, Renderer* renderer, VkCommandBuffer commandBuffer, uint32_t currentFrame);
+
+	/// <summary>
+	/// Empties the batches for the next frame
+	/// </summary>
+	void clear();
+
+	/// <summary>
+	/// Draws all batches, then empties them
+	/// </summary>
+	/// <param name="scene">Binds the scene descriptor sets, e.g. the lights</param>
+	/// <param name="renderer"></param>
+	/// <param name="commandBuffer"></param>
+	/// <param name="currentFrame">The swapchain image, its storage buffer is not in use by the GPU anymore</param>
+	void flush(Scene* scene, Renderer* renderer, VkCommandBuffer commandBuffer, uint32_t currentFrame);
+
+	/// <summary>
+	/// Frees the storage buffers
+	/// </summary>
+	/// <param name="renderer"></param>
+	void dispose(Renderer* renderer);
+
+	/// <summary>
+	/// Returns the number of draw calls of the last draw
+	/// </summary>
+	/// <returns></returns>
+	size_t getDrawCount() const {
+		return m_drawCount;
+	}
+};
+
@@ -43,6 +43,6 @@ void PrimitiveEntity::render(Scene* scene, Renderer* renderer, VkCommandBuffer c
 {
 	if (this->hasState(EntityState::ENTITY_STATE_VISIBLE)) {
 		Entity::render(scene, renderer, commandBuffer, currentFrame);
-		renderer->drawPrimitive(m_primitiveType, this->transform.getMatrix(), glm::vec4(1), commandBuffer, currentFrame);
+		renderer->drawPrimitive(m_primitiveType, this->getWorldMatrix(), glm::vec4(1), commandBuffer, currentFrame);
 	}
 }
\ No newline at end of file
@@ -1,4 +1,9 @@
 #include "Scene.h"
+#include "GFX.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
 
 void Scene::init(Renderer* renderer)
 {
@@ -17,6 +22,214 @@ void Scene::update(float deltaTime)
 	}
 }
 
+void Scene::enableEntityStorage()
+{
+	if (m_entityStorage == nullptr) {
+		m_entityStorage = std::make_unique<EntityStorage>();
+	}
+}
+
+void Scene::registerEntity(Entity* entity)
+{
+	m_entityIndex.add(entity);
+	if (m_entityStorage != nullptr) {
+		entity->attachToStorage(m_entityStorage.get());
+	}
+}
+
+void Scene::unregisterEntity(Entity* entity)
+{
+	m_entityIndex.remove(entity);
+	auto it = m_spatialProxies.find(entity);
+	if (it != m_spatialProxies.end()) {
+		m_bvh.remove(it->second.proxy);
+		m_spatialProxies.erase(it);
+	}
+}
+
+void Scene::updateEntities(const std::vector<Entity*>& entities, float deltaTime)
+{
+	auto jobSystem = GFX::instance().getService<JobSystem>(JobSystem::SERVICE_NAME);
+	if (this->updateMode == SceneUpdateMode::SCENE_UPDATE_MODE_SERIAL || jobSystem == nullptr) {
+		for (auto entity : entities) {
+			entity->update(this, deltaTime);
+		}
+		if (m_entityStorage != nullptr) {
+			m_entityStorage->updateWorldData();
+		}
+		this->syncSpatialIndex(entities);
+		return;
+	}
+
+	// Update the thread safe entities in parallel batches (this includes their culling behaviors)
+	jobSystem->parallelFor(entities.size(), this->parallelBatchSize, [this, &entities, deltaTime](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			if (entities[i]->supportsParallelUpdate()) {
+				entities[i]->update(this, deltaTime);
+			}
+		}
+	});
+
+	// Everything else runs on the calling thread
+	for (auto entity : entities) {
+		if (!entity->supportsParallelUpdate()) {
+			entity->update(this, deltaTime);
+		}
+	}
+
+	// Stream over the storage arrays once all transforms are final
+	if (m_entityStorage != nullptr) {
+		m_entityStorage->updateWorldData(jobSystem);
+	}
+	this->syncSpatialIndex(entities);
+}
+
+void Scene::syncSpatialIndex(const std::vector<Entity*>& entities)
+{
+	for (Entity* entity : entities) {
+		// Unchanged entities only cost a version compare
+		uint32_t worldVersion = entity->getWorldVersion();
+		auto it = m_spatialProxies.find(entity);
+		if (it != m_spatialProxies.end() && it->second.worldVersion == worldVersion) {
+			continue;
+		}
+
+		AABB aabb = entity->getAABB(true);
+		if (it == m_spatialProxies.end()) {
+			// Entities without a valid AABB are checked again every sync, only report them once they get one
+			if (!aabb.isValid()) {
+				continue;
+			}
+			m_spatialProxies.emplace(entity, SpatialProxy{ m_bvh.insert(aabb, entity), worldVersion });
+		}
+		else if (!aabb.isValid()) {
+			m_bvh.remove(it->second.proxy);
+			m_spatialProxies.erase(it);
+		}
+		else {
+			m_bvh.update(it->second.proxy, aabb);
+			it->second.worldVersion = worldVersion;
+		}
+		this->onEntityMoved(entity);
+	}
+}
+
+bool Scene::intersectEntity(Entity* entity, const Ray& ray, const AABB& aabb, float maxDistance, RayHit& hit) const
+{
+	if (!entity->hasState(EntityState::ENTITY_STATE_RAYCASTABLE) || !this->isEntityQueryable(entity)) {
+		return false;
+	}
+	float tMin, tMax;
+	if (!RayCast::rayIntersectsAABB(ray, aabb, tMin, tMax) || tMin >= maxDistance) {
+		return false;
+	}
+
+	// Entities with geometry are only hit if the ray hits one of their triangles
+	if (entity->hasRaycastGeometry()) {
+		return entity->raycastGeometry(ray, maxDistance, hit);
+	}
+
+	hit = {};
+	hit.hit = true;
+	hit.distance = tMin;
+	hit.position = ray.origin + ray.direction * tMin;
+	hit.hitobject = entity;
+	return true;
+}
+
+RayHit Scene::raycastEntities(const Ray& ray) const
+{
+	RayHit closest = {};
+	closest.distance = std::numeric_limits<float>::max();
+
+	// Leaves are visited front to back, every hit shortens the ray
+	m_bvh.raycast(ray, closest.distance, [&](void* userData, const AABB& aabb, float maxDistance) {
+		RayHit hit;
+		if (this->intersectEntity(static_cast<Entity*>(userData), ray, aabb, maxDistance, hit)) {
+			closest = hit;
+			return hit.distance;
+		}
+		return maxDistance;
+	});
+
+	if (!closest.hit) {
+		closest.position = ray.origin + ray.direction * closest.distance;
+	}
+	return closest;
+}
+
+void Scene::raycastPacket(std::span<const Ray> rays, std::span<RayHit> hits) const
+{
+	for (size_t i = 0; i < rays.size(); i++) {
+		hits[i] = {};
+	}
+	RayPacket packet;
+	packet.load(rays.data(), rays.size(), std::numeric_limits<float>::max());
+
+	// Each lane keeps its own closest hit, the hits shorten the rays of their lane only
+	m_bvh.raycastPacket(packet, [&](int lane, void* userData, const AABB& aabb, float maxDistance) {
+		RayHit hit;
+		if (this->intersectEntity(static_cast<Entity*>(userData), rays[lane], aabb, maxDistance, hit)) {
+			hits[lane] = hit;
+			return hit.distance;
+		}
+		return maxDistance;
+	});
+
+	for (size_t i = 0; i < rays.size(); i++) {
+		if (!hits[i].hit) {
+			hits[i].distance = packet.maxDistance[i];
+			hits[i].position = rays[i].origin + rays[i].direction * hits[i].distance;
+		}
+	}
+}
+
+void Scene::raycastBatch(std::span<const Ray> rays, std::span<RayHit> hits, bool parallel) const
+{
+	if (rays.size() != hits.size()) {
+		throw std::runtime_error("failed to raycast batch: rays and hits differ in size!");
+	}
+
+	size_t packetCount = (rays.size() + RAY_PACKET_SIZE - 1) / RAY_PACKET_SIZE;
+	auto castPackets = [this, rays, hits](size_t begin, size_t end) {
+		for (size_t packet = begin; packet < end; packet++) {
+			size_t first = packet * RAY_PACKET_SIZE;
+			size_t count = std::min<size_t>(RAY_PACKET_SIZE, rays.size() - first);
+			this->raycastPacket(rays.subspan(first, count), hits.subspan(first, count));
+		}
+	};
+
+	auto jobSystem = parallel ? GFX::instance().getService<JobSystem>(JobSystem::SERVICE_NAME) : nullptr;
+	if (jobSystem == nullptr) {
+		castPackets(0, packetCount);
+		return;
+	}
+	size_t packetsPerJob = std::max<size_t>(1, this->raycastBatchSize / RAY_PACKET_SIZE);
+	jobSystem->parallelFor(packetCount, packetsPerJob, castPackets);
+}
+
+void Scene::queryAABB(const AABB& aabb, std::vector<Entity*>& results) const
+{
+	m_bvh.queryAABB(aabb, [&](void* userData, const AABB& entityAABB) {
+		Entity* entity = static_cast<Entity*>(userData);
+		if (DynamicBVH::overlaps(aabb, entityAABB) && this->isEntityQueryable(entity)) {
+			results.push_back(entity);
+		}
+		return true;
+	});
+}
+
+void Scene::querySphere(const glm::vec3& center, float radius, std::vector<Entity*>& results) const
+{
+	m_bvh.querySphere(center, radius, [&](void* userData, const AABB& entityAABB) {
+		Entity* entity = static_cast<Entity*>(userData);
+		if (DynamicBVH::overlapsSphere(entityAABB, center, radius) && this->isEntityQueryable(entity)) {
+			results.push_back(entity);
+		}
+		return true;
+	});
+}
+
 void Scene::render(Renderer* renderer, VkCommandBuffer commandBuffer, uint32_t currentFrame)
 {
 	for (const auto& behavior : m_sceneBehaviors) {
@@ -42,8 +255,31 @@ void Scene::afterSwapchainRecreate(Renderer* renderer, const glm::ivec2& newSize
 	}
 }
 
+void Scene::beginModelBatch()
+{
+	m_batchingModels = this->autoInstancing;
+}
+
+void Scene::flushModelBatch(Renderer* renderer, VkCommandBuffer commandBuffer, uint32_t currentFrame)
+{
+	if (!m_batchingModels) {
+		return;
+	}
+	m_batchingModels = false;
+	m_modelBatcher.flush(this, renderer, commandBuffer, currentFrame);
+}
+
+void Scene::drawModelBatch(Renderer* renderer, VkCommandBuffer commandBuffer, uint32_t currentFrame)
+{
+	if (!m_batchingModels) {
+		return;
+	}
+	m_modelBatcher.draw(this, renderer, commandBuffer, currentFrame);
+}
+
 void Scene::destroy(Renderer* renderer)
 {
+	m_modelBatcher.dispose(renderer);
 	for (const auto& behavior : m_sceneBehaviors) 
 	{
 		behavior->destroy(this, renderer);
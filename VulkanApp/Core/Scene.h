@@ -1,11 +1,23 @@
 #pragma once
 #include "../Graphics/Renderer.h"
+#include <span>
 #include <vector>
 #include "Entity.h"
+#include "EntityIndex.h"
 #include "Skybox.h"
 #include "SceneBehavior.h"
 #include "../Math/RayCast.h"
+#include "../Math/DynamicBVH.h"
+#include "ModelBatcher.h"
+#include <unordered_map>
 
+/// <summary>
+/// How a scene updates its entities
+/// </summary>
+enum class SceneUpdateMode {
+	SCENE_UPDATE_MODE_SERIAL,	// All entities are updated on the calling thread
+	SCENE_UPDATE_MODE_PARALLEL	// Entities that support it are updated in chunks on the job system
+};
 
 /// <summary>
 /// Base class for all scenes
@@ -24,7 +36,205 @@ private:
 	/// Vector of scene behaviors
 	/// </summary>
 	std::vector<std::unique_ptr<SceneBehavior>> m_sceneBehaviors;
+
+	/// <summary>
+	/// Optional data-oriented storage for the entity transforms, AABBs and states
+	/// Declared in the base class so it outlives the entities owned by derived scenes.
+	/// </summary>
+	std::unique_ptr<EntityStorage> m_entityStorage;
+
+	/// <summary>
+	/// Hash index over all entities of the scene for name, UUID, tag and type lookups
+	/// </summary>
+	EntityIndex m_entityIndex;
+
+	/// <summary>
+	/// A BVH leaf of an entity and the world version its AABB was taken from
+	/// </summary>
+	struct SpatialProxy {
+		int proxy;
+		uint32_t worldVersion;
+	};
+
+	/// <summary>
+	/// Bounding volume hierarchy over the world AABBs of the entities
+	/// </summary>
+	DynamicBVH m_bvh;
+
+	/// <summary>
+	/// The BVH leaf of each entity with a valid AABB
+	/// </summary>
+	std::unordered_map<const Entity*, SpatialProxy> m_spatialProxies;
+
+	/// <summary>
+	/// Collects the models while the scene renders with auto instancing
+	/// </summary>
+	ModelBatcher m_modelBatcher;
+
+	/// <summary>
+	/// Whether models are collected right now
+	/// </summary>
+	bool m_batchingModels = false;
+
+protected:
+	/// <summary>
+	/// Inserts, moves or removes the BVH leaves of the given entities whose world AABB changed
+	/// Called at the end of updateEntities, derived scenes call it after initializing their entities.
+	/// </summary>
+	/// <param name="entities"></param>
+	void syncSpatialIndex(const std::vector<Entity*>& entities);
+
+	/// <summary>
+	/// Intersects a ray with an entity whose BVH leaf was reached
+	/// Uses the triangles of entities with raycast geometry and the AABB of all others.
+	/// </summary>
+	/// <param name="entity"></param>
+	/// <param name="ray"></param>
+	/// <param name="aabb">The world AABB stored in the BVH</param>
+	/// <param name="maxDistance"></param>
+	/// <param name="hit"></param>
+	/// <returns>True if the entity was hit closer than maxDistance</returns>
+	bool intersectEntity(Entity* entity, const Ray& ray, const AABB& aabb, float maxDistance, RayHit& hit) const;
+
+	/// <summary>
+	/// Finds the closest raycastable entity hit by the ray using the BVH
+	/// </summary>
+	/// <param name="ray"></param>
+	/// <returns></returns>
+	RayHit raycastEntities(const Ray& ray) const;
+
+	/// <summary>
+	/// Finds the closest raycastable entity for each ray of a packet
+	/// </summary>
+	/// <param name="rays"></param>
+	/// <param name="hits">Receives one result per ray</param>
+	void raycastPacket(std::span<const Ray> rays, std::span<RayHit> hits) const;
+
+	/// <summary>
+	/// Whether the entity takes part in raycasts and overlap queries
+	/// Derived scenes can exclude entities, e.g. entities of inactive chunks.
+	/// </summary>
+	/// <param name="entity"></param>
+	/// <returns></returns>
+	virtual bool isEntityQueryable(const Entity* entity) const {
+		return true;
+	}
+
+	/// <summary>
+	/// Called by syncSpatialIndex for every entity whose world AABB changed
+	/// Derived scenes use it to keep their own bounding volumes up to date.
+	/// </summary>
+	/// <param name="entity"></param>
+	virtual void onEntityMoved(Entity* entity) {}
+
+	/// <summary>
+	/// Adds the entity to the entity index and attaches it to the entity storage if the storage is enabled
+	/// Derived scenes call this for every entity they take ownership of.
+	/// </summary>
+	/// <param name="entity"></param>
+	void registerEntity(Entity* entity);
+
+	/// <summary>
+	/// Removes the entity from the entity index and the BVH
+	/// Derived scenes call this before they give up an entity that lives on, e.g. while it waits for its deferred destruction.
+	/// </summary>
+	/// <param name="entity"></param>
+	void unregisterEntity(Entity* entity);
+
+	/// <summary>
+	/// Empties the entity index in one go
+	/// Derived scenes call this in their destructor so the entities don't unregister one by one.
+	/// </summary>
+	void releaseEntityIndex() {
+		m_entityIndex.clear();
+	}
+
+	/// <summary>
+	/// Updates the given entities according to the update mode
+	/// In parallel mode entities that support it are updated in batches on the job system,
+	/// the remaining entities are updated afterwards on the calling thread.
+	/// Falls back to a serial update if no job system is registered with GFX.
+	/// Recomputes the world data of the entity storage and syncs the BVH afterwards.
+	/// </summary>
+	/// <param name="entities"></param>
+	/// <param name="deltaTime"></param>
+	void updateEntities(const std::vector<Entity*>& entities, float deltaTime);
+
+	/// <summary>
+	/// Starts collecting models if auto instancing is enabled, called by derived scenes before rendering their entities
+	/// </summary>
+	void beginModelBatch();
+
+	/// <summary>
+	/// Draws the collected models and stops collecting
+	/// </summary>
+	/// <param name="renderer"></param>
+	/// <param name="commandBuffer"></param>
+	/// <param name="currentFrame"></param>
+	void flushModelBatch(Renderer* renderer, VkCommandBuffer commandBuffer, uint32_t currentFrame);
+
+	/// <summary>
+	/// Draws the collected models and keeps them for another draw in the same frame, e.g. the shading stage of a depth pre-pass
+	/// The models are uploaded by the first draw, no models can be added afterwards.
+	/// </summary>
+	/// <param name="renderer"></param>
+	/// <param name="commandBuffer"></param>
+	/// <param name="currentFrame"></param>
+	void drawModelBatch(Renderer* renderer, VkCommandBuffer commandBuffer, uint32_t currentFrame);
+
 public:
+	/// <summary>
+	/// The update mode of the scene
+	/// </summary>
+	SceneUpdateMode updateMode = SceneUpdateMode::SCENE_UPDATE_MODE_SERIAL;
+
+	/// <summary>
+	/// Number of entities per job in parallel updates
+	/// </summary>
+	size_t parallelBatchSize = 64;
+
+	/// <summary>
+	/// Number of rays per job in parallel batched raycasts
+	/// </summary>
+	size_t raycastBatchSize = 256;
+
+	/// <summary>
+	/// Draws all visible models that share a mesh resource and LOD with one instanced draw per mesh
+	/// Only models using the PBR pipeline are batched, the others draw themselves as before.
+	/// </summary>
+	bool autoInstancing = false;
+
+	/// <summary>
+	/// Returns the batcher models add themselves to instead of drawing
+	/// </summary>
+	/// <returns>nullptr while the scene doesn't collect models</returns>
+	ModelBatcher* getModelBatcher() {
+		return m_batchingModels ? &m_modelBatcher : nullptr;
+	}
+
+	/// <summary>
+	/// Enables the entity storage backend
+	/// Entities added to the scene afterwards keep their transform, AABB and state in the storage.
+	/// Derived scenes override this to attach the entities they already own.
+	/// </summary>
+	virtual void enableEntityStorage();
+
+	/// <summary>
+	/// Returns the entity index of the scene
+	/// </summary>
+	/// <returns></returns>
+	const EntityIndex& getEntityIndex() const {
+		return m_entityIndex;
+	}
+
+	/// <summary>
+	/// Returns the entity storage of the scene
+	/// </summary>
+	/// <returns>nullptr if the entity storage is not enabled</returns>
+	EntityStorage* getEntityStorage() const {
+		return m_entityStorage.get();
+	}
+
 	/// <summary>
 	/// init the scene
 	/// </summary>
@@ -44,6 +254,62 @@ public:
 	/// <returns></returns>
 	virtual RayHit raycast(const Ray& ray) const = 0;
 
+	/// <summary>
+	/// Performs many raycasts at once, hits[i] receives the closest hit of rays[i]
+	/// The rays are traversed in packets of RAY_PACKET_SIZE with SIMD slab tests, keep neighboring
+	/// rays coherent (e.g. rays through neighboring pixels) for the best speedup. In parallel mode
+	/// the packets are spread over the job system, don't run it while the scene is updated.
+	/// </summary>
+	/// <param name="rays"></param>
+	/// <param name="hits">Must have the same size as rays</param>
+	/// <param name="parallel">Whether to spread the rays over the job system</param>
+	virtual void raycastBatch(std::span<const Ray> rays, std::span<RayHit> hits, bool parallel = false) const;
+
+	/// <summary>
+	/// Returns what the scene already knows about the visibility of an entity for the camera
+	/// Scenes that cull groups of entities report entities of fully visible or fully culled groups,
+	/// so the per entity frustum test can be skipped. Called from parallel entity updates.
+	/// </summary>
+	/// <param name="entity"></param>
+	/// <param name="camera"></param>
+	/// <returns>FRUSTUM_TEST_INTERSECTS if the entity has to be tested on its own</returns>
+	virtual FrustumTestResult getCullingHint(const Entity* entity, const Camera* camera) const {
+		return FrustumTestResult::FRUSTUM_TEST_INTERSECTS;
+	}
+
+	/// <summary>
+	/// Checks if a box is hidden behind the geometry the scene rendered before
+	/// Scenes without occlusion culling never report occluded boxes. Called from parallel entity updates.
+	/// </summary>
+	/// <param name="bounds">World space bounds</param>
+	/// <returns></returns>
+	virtual bool isOccluded(const AABB& bounds) const {
+		return false;
+	}
+
+	/// <summary>
+	/// Collects all entities whose world AABB overlaps the given AABB
+	/// </summary>
+	/// <param name="aabb"></param>
+	/// <param name="results">The entities are appended to the list</param>
+	void queryAABB(const AABB& aabb, std::vector<Entity*>& results) const;
+
+	/// <summary>
+	/// Collects all entities whose world AABB overlaps the given sphere
+	/// </summary>
+	/// <param name="center"></param>
+	/// <param name="radius"></param>
+	/// <param name="results">The entities are appended to the list</param>
+	void querySphere(const glm::vec3& center, float radius, std::vector<Entity*>& results) const;
+
+	/// <summary>
+	/// Rebuilds the BVH of the scene with the SAH
+	/// Useful after loading or after large parts of the scene moved.
+	/// </summary>
+	void rebuildSpatialIndex() {
+		m_bvh.build();
+	}
+
 	/// <summary>
 	/// render the scene
 	/// </summary>
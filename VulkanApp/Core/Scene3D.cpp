@@ -1,4 +1,7 @@
 #include "Scene3D.h"
+#include "../Graphics/Camera2D.h"
+#include <filesystem>
+#include <iostream>
 
 Scene3D::Scene3D()
 {
@@ -8,21 +11,70 @@ Scene3D::Scene3D()
 	this->directionalLight->addBindingInfo({ ToString(PipelineType::PIPELINE_TYPE_GRAPHICS_3D_INSTANCED), 7 });
 }
 
+Scene3D::~Scene3D()
+{
+	this->releaseEntityIndex();
+}
+
+void Scene3D::enableEntityStorage()
+{
+	Scene::enableEntityStorage();
+	for (const auto& entity : m_entities) {
+		entity->attachToStorage(this->getEntityStorage());
+	}
+}
+
 void Scene3D::init(Renderer* renderer)
 {
 	// Initialize the base scene
 	Scene::init(renderer);
 
+	// The compute shaders are built with Shaders/compile.bat, without them the models draw themselves
+	if (this->gpuDrivenRendering && !std::filesystem::exists("Shaders/cull_comp.spv")) {
+		std::cout << "[SCENE3D] Shaders/cull_comp.spv is missing, GPU driven rendering is disabled." << std::endl;
+		this->gpuDrivenRendering = false;
+	}
+	if (this->occlusionCulling && (!std::filesystem::exists("Shaders/depth_reduce_comp.spv") || !std::filesystem::exists("Shaders/cull_occlusion_comp.spv"))) {
+		std::cout << "[SCENE3D] Shaders/depth_reduce_comp.spv or Shaders/cull_occlusion_comp.spv is missing, occlusion culling is disabled." << std::endl;
+		this->occlusionCulling = false;
+	}
+	if (this->depthPrePass && (!std::filesystem::exists("Shaders/shader_depth_vert.spv") || !std::filesystem::exists("Shaders/shader3di_depth_vert.spv"))) {
+		std::cout << "[SCENE3D] Shaders/shader_depth_vert.spv or Shaders/shader3di_depth_vert.spv is missing, the depth pre-pass is disabled." << std::endl;
+		this->depthPrePass = false;
+	}
+
 	// Initialize the skybox if it exists
 	if (this->hasSkybox()) {
 		skybox->init(renderer);
 	}
 
+	// The depth pyramid reduces the depth of the render target after every frame
+	if (this->occlusionCulling) {
+		m_depthPyramidIndex = renderer->createDepthPyramid(this->getRenderTargetIndex());
+		m_depthPyramid = renderer->getDepthPyramid(m_depthPyramidIndex);
+	}
+
 	// Initialize all entities
 	for (const auto& entity : m_entities) {
 		entity->init(this, renderer);
 	}
 
+	// Build the BVH once all entities have their AABBs
+	m_updateQueue.clear();
+	for (const auto& entity : m_entities) {
+		m_updateQueue.push_back(entity.get());
+	}
+	this->syncSpatialIndex(m_updateQueue);
+	this->rebuildSpatialIndex();
+
+	// Merge the static models once they are initialized
+	if (this->staticBatching) {
+		m_staticGeometry.build(renderer, m_updateQueue, this->staticClusterSize);
+	}
+	if (this->gpuDrivenRendering) {
+		m_indirectGeometry.build(renderer, m_updateQueue);
+	}
+
 	// Initialize the directional light if it exists
 	if (this->directionalLight != nullptr) {
 		this->directionalLight->init(renderer);
@@ -33,9 +85,11 @@ void Scene3D::update(float deltaTime)
 {
 	Scene::update(deltaTime);
 
+	m_updateQueue.clear();
 	for (const auto& entity : m_entities) {
-		entity->update(this, deltaTime);
+		m_updateQueue.push_back(entity.get());
 	}
+	this->updateEntities(m_updateQueue, deltaTime);
 }
 
 void Scene3D::render(Renderer* renderer, VkCommandBuffer commandBuffer, uint32_t currentFrame)
@@ -43,6 +97,14 @@ void Scene3D::render(Renderer* renderer, VkCommandBuffer commandBuffer, uint32_t
 	// Get the render target for this scene
 	int renderTargetIndex = this->getRenderTargetIndex();
 	auto renderTarget = renderer->getRenderTarget(renderTargetIndex);
+	const Frustum* frustum = this->cullingCamera != nullptr ? &this->cullingCamera->getFrustum() : nullptr;
+
+	// Cull the GPU driven draws, compute passes can't be recorded inside of the render pass
+	// With two phases the first one only draws the objects that were visible last frame
+	bool twoPhase = m_depthPyramidIndex >= 0 && this->twoPhaseOcclusion && m_indirectGeometry.hasObjects();
+	IndirectCullPhase phase = twoPhase ? IndirectCullPhase::CULL_PHASE_FIRST : IndirectCullPhase::CULL_PHASE_SINGLE;
+	m_indirectGeometry.cull(renderer, commandBuffer, this->cullingCamera, m_depthPyramidIndex, phase);
+	const UboViewProjection& viewProjection = renderer->getCameraViewProjection(renderer->getActiveCamera());
 
 	// Beginn the render pass with the render target's framebuffer
 	renderer->beginnRenderPass(commandBuffer, renderTarget->getFramebuffer(), glm::vec4(0.0f, 0.0f, 0.0f, 0.0f), renderer->getOffscreenRenderPass());
@@ -55,23 +117,101 @@ void Scene3D::render(Renderer* renderer, VkCommandBuffer commandBuffer, uint32_t
 		this->directionalLight->updateBuffers(renderer, commandBuffer, currentFrame);
 	}
 
-	// Render all entities
+	// Write the depth of the opaque geometry first, the shading stage only shades the nearest fragments
+	if (this->depthPrePass) {
+		this->renderDepthPrePass(renderer, commandBuffer, currentFrame, frustum);
+		renderer->setDepthPrePassStage(DepthPrePassStage::DEPTH_PRE_PASS_SHADING);
+	}
+
+	m_staticGeometry.render(this, renderer, commandBuffer, currentFrame, frustum);
+	m_indirectGeometry.render(this, renderer, commandBuffer, currentFrame);
+
+	// Test the skipped objects against the depth drawn so far and continue the render pass with the ones that became visible
+	if (twoPhase) {
+		renderer->endRenderPass(commandBuffer);
+		renderer->buildDepthPyramid(m_depthPyramidIndex, commandBuffer, currentFrame, viewProjection, false);
+		m_indirectGeometry.cull(renderer, commandBuffer, this->cullingCamera, m_depthPyramidIndex, IndirectCullPhase::CULL_PHASE_SECOND);
+		renderer->beginnRenderPass(commandBuffer, renderTarget->getFramebuffer(), glm::vec4(0.0f, 0.0f, 0.0f, 0.0f), renderer->getOffscreenLoadRenderPass());
+
+		// The pre-pass didn't draw the objects of the second phase
+		if (this->depthPrePass) {
+			renderer->setDepthPrePassStage(DepthPrePassStage::DEPTH_PRE_PASS_DEPTH);
+			m_indirectGeometry.render(this, renderer, commandBuffer, currentFrame);
+			renderer->setDepthPrePassStage(DepthPrePassStage::DEPTH_PRE_PASS_SHADING);
+		}
+		m_indirectGeometry.render(this, renderer, commandBuffer, currentFrame);
+	}
+
+	// Batched sprites outside of the view of a 2D culling camera are dropped when they are queued
+	Camera2D* camera2D = dynamic_cast<Camera2D*>(this->cullingCamera);
+	if (camera2D != nullptr) {
+		glm::vec2 viewMin, viewMax;
+		camera2D->getViewBounds(viewMin, viewMax);
+		renderer->setSpriteCullBounds(viewMin, viewMax);
+	}
+	else {
+		renderer->disableSpriteCulling();
+	}
+
+	// Render all entities, with auto instancing the models are collected and drawn in batches
+	// After a depth pre-pass the batch is already collected and uploaded, the models only draw themselves again
+	this->beginModelBatch();
 	for (const auto& entity : m_entities) {
 		entity->render(this, renderer, commandBuffer, currentFrame);
 	}
+	this->flushModelBatch(renderer, commandBuffer, currentFrame);
+	renderer->setDepthPrePassStage(DepthPrePassStage::DEPTH_PRE_PASS_NONE);
 
 	// Render the skybox if it exists
 	if (this->hasSkybox()) {
 		skybox->render(renderer, commandBuffer, currentFrame);
 	}
 
+	// Batched sprites don't write depth, draw them over the skybox
+	renderer->flushSprites(commandBuffer, currentFrame);
+
+	// Queued text draws over the sprites
+	renderer->flushText(commandBuffer, currentFrame);
+
+	// Debug shapes queued while rendering the scene
+	renderer->flushDebugDraw(commandBuffer, currentFrame);
+
 	// End the render pass
 	renderer->endRenderPass(commandBuffer);
+
+	// Reduce the finished depth for the occlusion tests of the next frame
+	if (m_depthPyramidIndex >= 0) {
+		renderer->buildDepthPyramid(m_depthPyramidIndex, commandBuffer, currentFrame, viewProjection);
+	}
+}
+
+void Scene3D::renderDepthPrePass(Renderer* renderer, VkCommandBuffer commandBuffer, uint32_t currentFrame, const Frustum* frustum)
+{
+	renderer->setDepthPrePassStage(DepthPrePassStage::DEPTH_PRE_PASS_DEPTH);
+	m_staticGeometry.render(this, renderer, commandBuffer, currentFrame, frustum);
+	m_indirectGeometry.render(this, renderer, commandBuffer, currentFrame);
+
+	// Entities drawn with other pipelines are left to the shading stage
+	// The entities prepare their draws here, the model batch is uploaded once and drawn again by the shading stage
+	this->beginModelBatch();
+	for (const auto& entity : m_entities) {
+		if (renderer->hasDepthPrePassVariants(entity->pipelineType)) {
+			entity->renderDepth(this, renderer, commandBuffer, currentFrame);
+		}
+	}
+	this->drawModelBatch(renderer, commandBuffer, currentFrame);
 }
 
 void Scene3D::destroy(Renderer* renderer)
 {
 	Scene::destroy(renderer);
+	m_staticGeometry.dispose(renderer);
+	m_indirectGeometry.dispose(renderer);
+	if (m_depthPyramidIndex >= 0) {
+		renderer->disposeDepthPyramid(m_depthPyramidIndex);
+		m_depthPyramidIndex = -1;
+		m_depthPyramid = nullptr;
+	}
 
 	// Destroy the skybox if it exists
 	if (this->hasSkybox()) {
@@ -97,28 +237,22 @@ void Scene3D::bindSceneDescriptorSets(Renderer* renderer, VkCommandBuffer comman
 	}
 }
 
-RayHit Scene3D::raycast(const Ray& ray) const
+void Scene3D::afterSwapchainRecreate(Renderer* renderer, const glm::ivec2& newSize)
 {
-	float closestDistance = std::numeric_limits<float>::max();
-	Entity* closestEntity = nullptr;
+	Scene::afterSwapchainRecreate(renderer, newSize);
 
-	for (const auto& entity : m_entities) {
-		if (entity->hasState(EntityState::ENTITY_STATE_RAYCASTABLE)) {
-			AABB aabb = entity->getAABB(true);
-			float tMin, tMax;
-			if (RayCast::rayIntersectsAABB(ray, aabb, tMin, tMax)) {
-				if (tMin < closestDistance) {
-					closestDistance = tMin;
-					closestEntity = entity.get();
-				}
-			}
-		}
+	// The renderer replaced the depth pyramid together with the depth image
+	if (m_depthPyramidIndex >= 0) {
+		m_depthPyramid = renderer->getDepthPyramid(m_depthPyramidIndex);
 	}
+}
+
+bool Scene3D::isOccluded(const AABB& bounds) const
+{
+	return m_depthPyramid != nullptr && m_depthPyramid->isOccluded(bounds);
+}
 
-	RayHit result = {};
-	result.distance = closestDistance;
-	result.hitobject = closestEntity;
-	result.position = ray.origin + ray.direction * closestDistance;
-	result.hit = (closestEntity != nullptr);
-	return result;
+RayHit Scene3D::raycast(const Ray& ray) const
+{
+	return this->raycastEntities(ray);
 }
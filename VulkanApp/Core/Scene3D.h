@@ -2,6 +2,8 @@
 #include "Scene.h"
 #include "Entity.h"
 #include "Skybox.h"
+#include "StaticGeometry.h"
+#include "IndirectGeometry.h"
 #include "../Graphics/DirectionalLight.h"
 
 class Scene3D 
@@ -13,6 +15,37 @@ private:
 	/// </summary>
 	std::vector<std::unique_ptr<Entity>> m_entities;
 
+	/// <summary>
+	/// Entities to update this frame, reused between frames
+	/// </summary>
+	std::vector<Entity*> m_updateQueue;
+
+	/// <summary>
+	/// The merged geometry of the static models
+	/// </summary>
+	StaticGeometry m_staticGeometry;
+
+	/// <summary>
+	/// The static models drawn with GPU culled indirect draws
+	/// </summary>
+	IndirectGeometry m_indirectGeometry;
+
+	/// <summary>
+	/// The depth pyramid of the render target, created at init with occlusion culling
+	/// </summary>
+	int m_depthPyramidIndex = -1;
+	DepthPyramid* m_depthPyramid = nullptr;
+
+	/// <summary>
+	/// Writes the depth of the static geometry and the entities drawn with pipelines having depth pre-pass variants
+	/// The entities are drawn with renderDepth, which prepares their draws for the following render.
+	/// </summary>
+	/// <param name="renderer"></param>
+	/// <param name="commandBuffer"></param>
+	/// <param name="currentFrame"></param>
+	/// <param name="frustum"></param>
+	void renderDepthPrePass(Renderer* renderer, VkCommandBuffer commandBuffer, uint32_t currentFrame, const Frustum* frustum);
+
 public:
 	/// <summary>
 	/// The skybox of the scene
@@ -24,8 +57,56 @@ public:
 	/// </summary>
 	std::unique_ptr<DirectionalLight> directionalLight;
 
+	/// <summary>
+	/// Merges the models with the ENTITY_STATE_STATIC state into world space clusters at init
+	/// Every cluster holds the triangles of one material inside one grid cell and is drawn with one draw call.
+	/// Merged models are drawn with their full detail meshes, they don't switch LODs anymore.
+	/// </summary>
+	bool staticBatching = false;
+
+	/// <summary>
+	/// Edge length of the grid cells the static geometry is split into
+	/// </summary>
+	float staticClusterSize = 32.0f;
+
+	/// <summary>
+	/// Draws the models with the ENTITY_STATE_STATIC state with GPU culled indirect draws, set before init
+	/// Models merged by static batching and models with LODs are not included. Needs the Shaders/cull_comp.spv compute shader, init
+	/// turns the flag off with a warning if it is missing.
+	/// </summary>
+	bool gpuDrivenRendering = false;
+
+	/// <summary>
+	/// Camera the static geometry is culled against
+	/// The static geometry clusters are not culled while it is nullptr, the GPU driven draws are culled against the active camera then.
+	/// </summary>
+	Camera* cullingCamera = nullptr;
+
+	/// <summary>
+	/// Rejects objects hidden behind the depth of the previous frame, set before init
+	/// The GPU driven draws are tested in the culling shader, entities with an occlusion enabled FrustumCullingBhv
+	/// on the CPU against a small copy of the depth that is a few frames old. Needs the Shaders/cull_occlusion_comp.spv
+	/// and Shaders/depth_reduce_comp.spv compute shaders, init turns the flag off with a warning if one is missing.
+	/// </summary>
+	bool occlusionCulling = false;
+
+	/// <summary>
+	/// Draws the GPU driven objects visible last frame first and tests the others against the depth of this frame
+	/// Avoids popping of objects that come out from behind an occluder, but splits the render pass in two.
+	/// </summary>
+	bool twoPhaseOcclusion = false;
+
+	/// <summary>
+	/// Draws the depth of the opaque PBR geometry before shading it, so every pixel is shaded once
+	/// The shading stage tests for equal depth without writing it. Entities drawn with the PBR pipelines draw in both
+	/// stages, their LODs and batches are chosen once by renderDepth. The depth pipelines are created on first use from Shaders/shader_depth_vert.spv and
+	/// Shaders/shader3di_depth_vert.spv, init turns the flag off with a warning if one is missing. Compile them with Shaders/compile.bat
+	/// together with vert.spv and shader3di_vert.spv, the equal test relies on the invariant positions of all four shaders.
+	/// </summary>
+	bool depthPrePass = false;
+
 	Scene3D();
-	~Scene3D() = default;
+	~Scene3D();
 
 	/// <summary>
 	/// Checks if the scene has a skybox
@@ -35,6 +116,22 @@ public:
 		return skybox != nullptr;
 	}
 
+	/// <summary>
+	/// Returns the merged geometry of the static models
+	/// </summary>
+	/// <returns></returns>
+	const StaticGeometry& getStaticGeometry() const {
+		return m_staticGeometry;
+	}
+
+	/// <summary>
+	/// Returns the static models drawn with GPU culled indirect draws
+	/// </summary>
+	/// <returns></returns>
+	const IndirectGeometry& getIndirectGeometry() const {
+		return m_indirectGeometry;
+	}
+
 	/// <summary>
 	/// Add an entity to the scene and return it casted to the correct type
 	/// </summary>
@@ -47,6 +144,7 @@ public:
 		if (casted == nullptr) {
 			throw std::runtime_error("Failed to add entity: entity is not of the correct type!");
 		}
+		this->registerEntity(casted);
 		m_entities.push_back(std::move(entity));
 		return casted;
 	}
@@ -59,14 +157,25 @@ public:
 	template<typename T>
 	std::vector<T*> findEntities() const {
 		std::vector<T*> foundEntities;
-		for (const auto& entity : m_entities) {
-			if (auto casted = dynamic_cast<T*>(entity.get())) {
-				foundEntities.push_back(casted);
-			}
-		}
+		this->getEntityIndex().forEach<T>([&foundEntities](T* entity) {
+			foundEntities.push_back(entity);
+			return true;
+		});
 		return foundEntities;
 	}
 
+	/// <summary>
+	/// Calls the function for every entity of type T in the scene without allocating
+	/// Return false from the function to stop the iteration.
+	/// </summary>
+	/// <typeparam name="T"></typeparam>
+	/// <typeparam name="Fn"></typeparam>
+	/// <param name="function"></param>
+	template<typename T, typename Fn>
+	void forEachEntity(Fn&& function) const {
+		this->getEntityIndex().forEach<T>(std::forward<Fn>(function));
+	}
+
 	/// <summary>
 	/// Find an entity by name and return it casted to the correct type
 	/// </summary>
@@ -75,16 +184,36 @@ public:
 	/// <returns></returns>
 	template<typename T>
 	T* findEntity(const std::string& name) const {
-		for (const auto& entity : m_entities) {
-			if (entity->name == name) {
-				if (auto casted = dynamic_cast<T*>(entity.get())) {
-					return casted;
-				}
+		return this->findEntity<T>(StringTable::instance().find(name));
+	}
+
+	/// <summary>
+	/// Find an entity by its interned name and return it casted to the correct type
+	/// </summary>
+	/// <typeparam name="T"></typeparam>
+	/// <param name="name"></param>
+	/// <returns></returns>
+	template<typename T>
+	T* findEntity(StringId name) const {
+		for (Entity* entity : this->getEntityIndex().getByName(name)) {
+			if (auto casted = dynamic_cast<T*>(entity)) {
+				return casted;
 			}
 		}
 		return nullptr;
 	}
 
+	/// <summary>
+	/// Find an entity by its UUID and return it casted to the correct type
+	/// </summary>
+	/// <typeparam name="T"></typeparam>
+	/// <param name="uuid"></param>
+	/// <returns></returns>
+	template<typename T>
+	T* findEntityByUUID(const std::string& uuid) const {
+		return dynamic_cast<T*>(this->getEntityIndex().findByUUID(uuid));
+	}
+
 	/// <summary>
 	/// Find an entity by type and return it casted to the correct type
 	/// </summary>
@@ -92,12 +221,7 @@ public:
 	/// <returns></returns>
 	template<typename T>
 	T* findEntity() const {
-		for (const auto& entity : m_entities) {
-			if (auto casted = dynamic_cast<T*>(entity.get())) {
-				return casted;
-			}
-		}
-		return nullptr;
+		return this->getEntityIndex().findFirst<T>();
 	}
 
 	/// <summary>
@@ -107,13 +231,7 @@ public:
 	/// <returns></returns>
 	template<typename T>
 	std::vector<T*> findEntitiesByType() const {
-		std::vector<T*> foundEntities;
-		for (const auto& entity : m_entities) {
-			if (auto casted = dynamic_cast<T*>(entity.get())) {
-				foundEntities.push_back(casted);
-			}
-		}
-		return foundEntities;
+		return this->findEntities<T>();
 	}
 
 
@@ -126,11 +244,9 @@ public:
 	/// <returns></returns>
 	template<typename T>
 	T* findTaggedEntity(const std::string& tagKey) const {
-		for (const auto& entity : m_entities) {
-			if (entity->hasTag(tagKey)) {
-				if (auto casted = dynamic_cast<T*>(entity.get())) {
-					return casted;
-				}
+		for (Entity* entity : this->getTaggedEntities(tagKey)) {
+			if (auto casted = dynamic_cast<T*>(entity)) {
+				return casted;
 			}
 		}
 		return nullptr;
@@ -138,19 +254,31 @@ public:
 
 	/// <summary>
 	/// Get all entities with a given tag
+	/// The returned list is owned by the scene and changes when entities are added or retagged.
 	/// </summary>
 	/// <param name="tagKey"></param>
 	/// <returns></returns>
-	std::vector<Entity*> getTaggedEntities(const std::string& tagKey) const {
-		std::vector<Entity*> taggedEntities;
-		for (const auto& entity : m_entities) {
-			if (entity->hasTag(tagKey)) {
-				taggedEntities.push_back(entity.get());
-			}
-		}
-		return taggedEntities;
+	const std::vector<Entity*>& getTaggedEntities(const std::string& tagKey) const {
+		return this->getEntityIndex().getByTag(StringTable::instance().find(tagKey));
+	}
+
+	/// <summary>
+	/// Calls the function for every entity having all tags of the mask
+	/// Create the mask with StringTable::createTagMask. Return false from the function to stop the iteration.
+	/// </summary>
+	/// <typeparam name="Fn"></typeparam>
+	/// <param name="mask"></param>
+	/// <param name="function"></param>
+	template<typename Fn>
+	void forEachTaggedEntity(const TagMask& mask, Fn&& function) const {
+		this->getEntityIndex().forEachWithTags(mask, std::forward<Fn>(function));
 	}
 
+	/// <summary>
+	/// Enables the entity storage and attaches the entities already in the scene
+	/// </summary>
+	void enableEntityStorage() override;
+
 	/// <summary>
 	/// Init the scene
 	/// </summary>
@@ -186,6 +314,20 @@ public:
 	/// <param name="currentPipeline"></param>
 	void bindSceneDescriptorSets(Renderer* renderer, VkCommandBuffer commandBuffer, int32_t currentFrame, const std::string& currentPipeline) override;
 
+	/// <summary>
+	/// Recreates the render target and updates the depth pyramid following it
+	/// </summary>
+	/// <param name="renderer"></param>
+	/// <param name="newSize"></param>
+	void afterSwapchainRecreate(Renderer* renderer, const glm::ivec2& newSize) override;
+
+	/// <summary>
+	/// Checks a box against the depth pyramid, false as long as occlusion culling is disabled
+	/// </summary>
+	/// <param name="bounds"></param>
+	/// <returns></returns>
+	bool isOccluded(const AABB& bounds) const override;
+
 	/// <summary>
 	/// Perform a raycast in the scene and return the closest hit information
 	/// </summary>
@@ -21,6 +21,11 @@ void Sprite::init(Scene* scene, Renderer* renderer)
 	m_textureImage->bufferIndex = renderer->createImageBuffer(m_textureImage.get());
 	m_textureImage->freeImageData();
 
+	// Batched sprites use the quads of the sprite batch
+	if (this->batched) {
+		return;
+	}
+
 	auto spriteVertices = getSpriteVertices();
 	m_mesh->vertexBufferIndex = renderer->createVertexBuffer(&spriteVertices);
 
@@ -34,6 +39,18 @@ void Sprite::render(Scene* scene, Renderer* renderer, VkCommandBuffer commandBuf
 	{
 		Entity::render(scene, renderer, commandBuffer, currentFrame);
 
+		if (this->batched) {
+			// The quad is transformed on the CPU, take position, size and rotation from the model matrix
+			auto modelMatrix = this->getModelMatrix();
+			SpriteInstance sprite;
+			sprite.position = glm::vec2(modelMatrix[3]);
+			sprite.depth = modelMatrix[3].z;
+			sprite.size = glm::vec2(glm::length(glm::vec3(modelMatrix[0])), glm::length(glm::vec3(modelMatrix[1])));
+			sprite.rotation = std::atan2(modelMatrix[0].y, modelMatrix[0].x);
+			renderer->queueSprite(m_textureImage->bufferIndex, sprite, this->layer);
+			return;
+		}
+
 		if (this->pipelineType.empty()) {
 			throw std::runtime_error("failed to render sprite: pipeline type is not set!");
 		}
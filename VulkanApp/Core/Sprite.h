@@ -23,6 +23,16 @@ private:
 	std::unique_ptr<ImageTexture> m_textureImage;
 
 public:
+	/// <summary>
+	/// Draws the sprite through the sprite batch of the renderer instead of its own mesh
+	/// Batched sprites sharing a texture are drawn together once the scene flushes the batch.
+	/// </summary>
+	bool batched = false;
+
+	/// <summary>
+	/// Draw order of batched sprites, lower layers are drawn first
+	/// </summary>
+	int layer = 0;
 
 	/// <summary>
 	/// Create a sprite from a texture file
@@ -0,0 +1,197 @@
+#include "StaticGeometry.h"
+#include "Scene.h"
+#include "Model.h"
+#include <algorithm>
+#include <iostream>
+#include <unordered_map>
+
+namespace {
+	/// <summary>
+	/// Vertices and indices of a cluster while it is built
+	/// </summary>
+	struct ClusterData {
+		Material* material = nullptr;
+		glm::ivec3 cell = glm::ivec3(0);
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		AABB bounds;
+		std::vector<StaticGeometry::ModelSpan> spans;
+	};
+
+	struct ClusterKey {
+		const Material* material;
+		glm::ivec3 cell;
+
+		bool operator==(const ClusterKey&) const = default;
+	};
+
+	struct ClusterKeyHash {
+		size_t operator()(const ClusterKey& key) const {
+			size_t h = std::hash<const void*>()(key.material);
+			h ^= static_cast<size_t>(static_cast<uint32_t>(key.cell.x)) * 0x9E3779B97F4A7C15ull;
+			h ^= static_cast<size_t>(static_cast<uint32_t>(key.cell.y)) * 0xC2B2AE3D27D4EB4Full;
+			h ^= static_cast<size_t>(static_cast<uint32_t>(key.cell.z)) * 0x165667B19E3779F9ull;
+			return h;
+		}
+	};
+}
+
+size_t StaticGeometry::build(Renderer* renderer, const std::vector<Entity*>& entities, float clusterSize)
+{
+	if (clusterSize <= 0.0f) {
+		throw std::runtime_error("failed to build static geometry: cluster size must be positive!");
+	}
+	this->dispose(renderer);
+
+	std::vector<ClusterData> clusters;
+	std::unordered_map<ClusterKey, size_t, ClusterKeyHash> clusterIndices;
+	std::unordered_map<uint64_t, uint32_t> remap;
+	std::vector<Vertex> worldVertices;
+	std::string pipelineType = ToString(PipelineType::PIPELINE_TYPE_GRAPHICS_3D);
+	size_t skippedModels = 0;
+
+	for (Entity* entity : entities) {
+		Model* model = dynamic_cast<Model*>(entity);
+		if (model == nullptr || !model->hasState(EntityState::ENTITY_STATE_STATIC) || model->pipelineType != pipelineType || model->getMeshResource() == nullptr) {
+			continue;
+		}
+
+		// Initialized meshes only have their vertices if the resource keeps them
+		if (!model->getMeshResource()->keepMeshData) {
+			skippedModels++;
+			continue;
+		}
+		uint32_t modelIndex = static_cast<uint32_t>(m_models.size());
+
+		// Mirroring transforms flip the winding, swap two corners to keep the front faces
+		const glm::mat4& worldMatrix = model->getWorldMatrix();
+		glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(worldMatrix)));
+		bool mirrored = glm::determinant(glm::mat3(worldMatrix)) < 0.0f;
+
+		for (const auto& mesh : model->getMeshResource()->meshes) {
+			worldVertices.resize(mesh->vertices.size());
+			for (size_t i = 0; i < mesh->vertices.size(); i++) {
+				Vertex vertex = mesh->vertices[i];
+				vertex.pos = glm::vec3(worldMatrix * glm::vec4(vertex.pos, 1.0f));
+				glm::vec3 normal = normalMatrix * vertex.normal;
+				float length = glm::length(normal);
+				vertex.normal = length > 0.0f ? normal / length : vertex.normal;
+				worldVertices[i] = vertex;
+			}
+
+			// Each triangle goes to the cluster of the cell containing its center, shared vertices are copied once per cluster
+			remap.clear();
+			const auto& indices = mesh->indices;
+			for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+				uint32_t corners[3] = { indices[i], indices[i + 1], indices[i + 2] };
+				if (mirrored) {
+					std::swap(corners[1], corners[2]);
+				}
+				glm::vec3 center = (worldVertices[corners[0]].pos + worldVertices[corners[1]].pos + worldVertices[corners[2]].pos) / 3.0f;
+				glm::ivec3 cell = glm::ivec3(glm::floor(center / clusterSize));
+
+				auto [it, inserted] = clusterIndices.try_emplace({ mesh->material.get(), cell }, clusters.size());
+				if (inserted) {
+					ClusterData data;
+					data.material = mesh->material.get();
+					data.cell = cell;
+					clusters.push_back(std::move(data));
+				}
+				ClusterData& cluster = clusters[it->second];
+				if (cluster.spans.empty() || cluster.spans.back().model != modelIndex) {
+					cluster.spans.push_back({ modelIndex, static_cast<uint32_t>(cluster.indices.size()), 0 });
+				}
+				cluster.spans.back().indexCount += 3;
+
+				for (uint32_t corner : corners) {
+					uint64_t key = (static_cast<uint64_t>(it->second) << 32) | corner;
+					auto [vertexIt, added] = remap.try_emplace(key, static_cast<uint32_t>(cluster.vertices.size()));
+					if (added) {
+						cluster.vertices.push_back(worldVertices[corner]);
+						cluster.bounds.expand(worldVertices[corner].pos);
+					}
+					cluster.indices.push_back(vertexIt->second);
+				}
+			}
+		}
+
+		model->setStaticBatched(true);
+		m_models.push_back(model);
+	}
+	if (skippedModels > 0) {
+		std::cout << "[STATIC GEOMETRY] " << skippedModels << " static models were not merged, set keepMeshData on their mesh resources before the asset manager initializes them." << std::endl;
+	}
+
+	// Upload the clusters grouped by material
+	std::sort(clusters.begin(), clusters.end(), [](const ClusterData& a, const ClusterData& b) {
+		return a.material < b.material;
+	});
+	m_clusters.reserve(clusters.size());
+	for (auto& data : clusters) {
+		Cluster cluster;
+		cluster.material = data.material;
+		cluster.geometryIndex = renderer->createGeometry(&data.vertices, &data.indices);
+		cluster.bounds = data.bounds;
+		cluster.spans = std::move(data.spans);
+		m_clusters.push_back(std::move(cluster));
+	}
+	return m_models.size();
+}
+
+void StaticGeometry::render(Scene* scene, Renderer* renderer, VkCommandBuffer commandBuffer, uint32_t currentFrame, const Frustum* frustum)
+{
+	m_drawCount = 0;
+	if (m_clusters.empty()) {
+		return;
+	}
+
+	// The clusters are in world space, all of them share the pipeline, the lights and the camera
+	std::string pipelineType = ToString(PipelineType::PIPELINE_TYPE_GRAPHICS_3D);
+	UboModel modelMatrix = { glm::mat4(1.0f) };
+	renderer->bindPipeline(commandBuffer, pipelineType);
+	scene->bindSceneDescriptorSets(renderer, commandBuffer, currentFrame, pipelineType);
+	renderer->bindPushConstants(commandBuffer, renderer->getCurrentPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(UboModel), &modelMatrix);
+	renderer->bindDescriptorSet(renderer->getCameraDescriptorSet(renderer->getActiveCamera(), currentFrame), 0, currentFrame);
+
+	Material* boundMaterial = nullptr;
+	for (const Cluster& cluster : m_clusters) {
+		if (frustum != nullptr && !frustum->intersectsAABB(cluster.bounds)) {
+			continue;
+		}
+
+		// Draw the runs of consecutive visible models, one run covers the whole cluster if no model is hidden
+		size_t span = 0;
+		while (span < cluster.spans.size()) {
+			if (!m_models[cluster.spans[span].model]->hasState(EntityState::ENTITY_STATE_VISIBLE)) {
+				span++;
+				continue;
+			}
+			uint32_t firstIndex = cluster.spans[span].firstIndex;
+			uint32_t indexCount = 0;
+			while (span < cluster.spans.size() && m_models[cluster.spans[span].model]->hasState(EntityState::ENTITY_STATE_VISIBLE)) {
+				indexCount += cluster.spans[span].indexCount;
+				span++;
+			}
+			if (cluster.material != boundMaterial) {
+				cluster.material->bindMaterial(renderer, commandBuffer, 1, currentFrame);
+				boundMaterial = cluster.material;
+			}
+			renderer->drawGeometryIndices(cluster.geometryIndex, firstIndex, indexCount, commandBuffer);
+			m_drawCount++;
+		}
+	}
+}
+
+void StaticGeometry::dispose(Renderer* renderer)
+{
+	for (const Cluster& cluster : m_clusters) {
+		renderer->disposeGeometry(cluster.geometryIndex);
+	}
+	m_clusters.clear();
+
+	for (Model* model : m_models) {
+		model->setStaticBatched(false);
+	}
+	m_models.clear();
+	m_drawCount = 0;
+}
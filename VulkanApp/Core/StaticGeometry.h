@@ -0,0 +1,111 @@
+#pragma once
+#include "../Graphics/Renderer.h"
+#include "../Graphics/Material.h"
+#include "../Math/AABB.h"
+#include "../Math/Frustum.h"
+#include "Entity.h"
+#include <vector>
+
+class Scene;
+class Model;
+
+/// <summary>
+/// Merged geometry of the static models of a scene
+/// Models with the ENTITY_STATE_STATIC state are baked into world space vertex and index buffers once. The
+/// triangles are grouped by material and by a grid cell of their center, every group is a cluster that is
+/// culled on its own and drawn with one draw call. The baked models don't draw themselves anymore, so they
+/// must not move, change their mesh resource or leave the scene while the geometry is built.
+/// Clusters skip the triangles of models without the ENTITY_STATE_VISIBLE state, a cluster with hidden models
+/// takes one draw call per run of visible models. The clusters hold the full detail meshes, merged models give up
+/// their LODs, so static batching suits models that are close to the camera or have no LODs.
+/// </summary>
+class StaticGeometry
+{
+public:
+	/// <summary>
+	/// The indices a model contributed to a cluster, the triangles of a model are consecutive
+	/// </summary>
+	struct ModelSpan {
+		uint32_t model = 0;		// Index into the baked models
+		uint32_t firstIndex = 0;
+		uint32_t indexCount = 0;
+	};
+
+private:
+	/// <summary>
+	/// The triangles of one material inside one grid cell
+	/// </summary>
+	struct Cluster {
+		Material* material = nullptr;
+		int geometryIndex = -1;
+		AABB bounds;
+		std::vector<ModelSpan> spans;
+	};
+
+	/// <summary>
+	/// The clusters, sorted by material so consecutive clusters share the material binding
+	/// </summary>
+	std::vector<Cluster> m_clusters;
+
+	/// <summary>
+	/// The models baked into the clusters
+	/// </summary>
+	std::vector<Model*> m_models;
+
+	/// <summary>
+	/// Number of clusters drawn by the last render
+	/// </summary>
+	size_t m_drawCount = 0;
+
+public:
+	StaticGeometry() = default;
+	~StaticGeometry() = default;
+
+	StaticGeometry(const StaticGeometry&) = delete;
+	StaticGeometry& operator=(const StaticGeometry&) = delete;
+
+	/// <summary>
+	/// Bakes the static models of the entities into clusters, other entities are ignored
+	/// Only models using the PBR pipeline whose mesh resource keeps its mesh data are baked, the static models of other
+	/// resources are logged and keep drawing themselves. Replaces the geometry built before.
+	/// </summary>
+	/// <param name="renderer"></param>
+	/// <param name="entities"></param>
+	/// <param name="clusterSize">Edge length of the grid cells the triangles are grouped by</param>
+	/// <returns>Number of baked models</returns>
+	size_t build(Renderer* renderer, const std::vector<Entity*>& entities, float clusterSize);
+
+	/// <summary>
+	/// Draws the clusters, leaves out the triangles of hidden models
+	/// </summary>
+	/// <param name="scene">Binds the scene descriptor sets, e.g. the lights</param>
+	/// <param name="renderer"></param>
+	/// <param name="commandBuffer"></param>
+	/// <param name="currentFrame"></param>
+	/// <param name="frustum">Clusters outside of it are skipped, nullptr draws all clusters</param>
+	void render(Scene* scene, Renderer* renderer, VkCommandBuffer commandBuffer, uint32_t currentFrame, const Frustum* frustum);
+
+	/// <summary>
+	/// Frees the buffers and lets the baked models draw themselves again
+	/// The buffers may still be used by frames in flight, dispose once the device doesn't use them anymore.
+	/// </summary>
+	/// <param name="renderer"></param>
+	void dispose(Renderer* renderer);
+
+	/// <summary>
+	/// Returns the number of clusters
+	/// </summary>
+	/// <returns></returns>
+	size_t getClusterCount() const {
+		return m_clusters.size();
+	}
+
+	/// <summary>
+	/// Returns the number of clusters drawn by the last render
+	/// </summary>
+	/// <returns></returns>
+	size_t getDrawCount() const {
+		return m_drawCount;
+	}
+};
+
@@ -0,0 +1,75 @@
+#include "StringTable.h"
+#include <mutex>
+#include <stdexcept>
+
+StringId StringTable::intern(const std::string& value)
+{
+	{
+		std::shared_lock<std::shared_mutex> lock(m_mutex);
+		auto it = m_ids.find(value);
+		if (it != m_ids.end()) {
+			return it->second;
+		}
+	}
+
+	// Another thread could have interned it in the meantime, so check again
+	std::unique_lock<std::shared_mutex> lock(m_mutex);
+	auto it = m_ids.find(value);
+	if (it != m_ids.end()) {
+		return it->second;
+	}
+
+	StringId id = static_cast<StringId>(m_strings.size());
+	m_strings.push_back(value);
+	m_tagBits.push_back(MAX_TAG_BITS);
+	m_ids.emplace(value, id);
+	return id;
+}
+
+StringId StringTable::find(const std::string& value) const
+{
+	std::shared_lock<std::shared_mutex> lock(m_mutex);
+	auto it = m_ids.find(value);
+	return it != m_ids.end() ? it->second : INVALID_STRING_ID;
+}
+
+const std::string& StringTable::getString(StringId id) const
+{
+	std::shared_lock<std::shared_mutex> lock(m_mutex);
+	if (id >= m_strings.size()) {
+		throw std::runtime_error("failed to get interned string: invalid string id!");
+	}
+	return m_strings[id];
+}
+
+uint32_t StringTable::getTagBit(StringId id)
+{
+	{
+		std::shared_lock<std::shared_mutex> lock(m_mutex);
+		if (id >= m_tagBits.size()) {
+			throw std::runtime_error("failed to get tag bit: invalid string id!");
+		}
+		if (m_tagBits[id] != MAX_TAG_BITS || m_tagBitCount == MAX_TAG_BITS) {
+			return m_tagBits[id];
+		}
+	}
+
+	std::unique_lock<std::shared_mutex> lock(m_mutex);
+	if (m_tagBits[id] == MAX_TAG_BITS && m_tagBitCount < MAX_TAG_BITS) {
+		m_tagBits[id] = m_tagBitCount++;
+	}
+	return m_tagBits[id];
+}
+
+TagMask StringTable::createTagMask(std::initializer_list<std::string> tags)
+{
+	TagMask mask;
+	for (const auto& tag : tags) {
+		uint32_t bit = this->getTagBit(this->intern(tag));
+		if (bit == MAX_TAG_BITS) {
+			throw std::runtime_error("failed to create tag mask: too many tags in use!");
+		}
+		mask.set(bit);
+	}
+	return mask;
+}
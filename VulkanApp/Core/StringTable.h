@@ -0,0 +1,115 @@
+#pragma once
+#include <bitset>
+#include <cstdint>
+#include <deque>
+#include <initializer_list>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// <summary>
+/// Id of an interned string
+/// </summary>
+using StringId = uint32_t;
+
+/// <summary>
+/// Id of strings that are not interned
+/// </summary>
+constexpr StringId INVALID_STRING_ID = UINT32_MAX;
+
+/// <summary>
+/// Maximum number of tags that can take part in tag mask queries
+/// </summary>
+constexpr size_t MAX_TAG_BITS = 64;
+
+/// <summary>
+/// One bit per tag key, used for multi-tag queries
+/// </summary>
+using TagMask = std::bitset<MAX_TAG_BITS>;
+
+/// <summary>
+/// Global table of interned strings
+/// Entity names and tag keys are interned once and compared as 32-bit ids afterwards.
+/// Interned strings live until the application exits. All methods are thread safe.
+/// </summary>
+class StringTable
+{
+private:
+	StringTable() = default;
+	~StringTable() = default;
+
+	/// <summary>
+	/// Maps the strings to their ids
+	/// </summary>
+	std::unordered_map<std::string, StringId> m_ids;
+
+	/// <summary>
+	/// The strings by id, a deque keeps the references stable
+	/// </summary>
+	std::deque<std::string> m_strings;
+
+	/// <summary>
+	/// The tag bit of each id, MAX_TAG_BITS if the id has no bit
+	/// </summary>
+	std::vector<uint32_t> m_tagBits;
+
+	/// <summary>
+	/// Number of tag bits handed out
+	/// </summary>
+	uint32_t m_tagBitCount = 0;
+
+	/// <summary>
+	/// Guards the table
+	/// </summary>
+	mutable std::shared_mutex m_mutex;
+
+public:
+	/// <summary>
+	/// Singleton instance accessor
+	/// </summary>
+	/// <returns></returns>
+	static StringTable& instance()
+	{
+		static StringTable instance;
+		return instance;
+	}
+
+	StringTable(const StringTable&) = delete;
+	StringTable& operator=(const StringTable&) = delete;
+
+	/// <summary>
+	/// Returns the id of the string and interns it if needed
+	/// </summary>
+	/// <param name="value"></param>
+	/// <returns></returns>
+	StringId intern(const std::string& value);
+
+	/// <summary>
+	/// Returns the id of the string without interning it
+	/// </summary>
+	/// <param name="value"></param>
+	/// <returns>INVALID_STRING_ID if the string was never interned</returns>
+	StringId find(const std::string& value) const;
+
+	/// <summary>
+	/// Returns the string of an id
+	/// </summary>
+	/// <param name="id"></param>
+	/// <returns></returns>
+	const std::string& getString(StringId id) const;
+
+	/// <summary>
+	/// Returns the tag mask bit of the id and assigns one on first use
+	/// </summary>
+	/// <param name="id"></param>
+	/// <returns>MAX_TAG_BITS if all bits are taken, the tag can't be used in mask queries then</returns>
+	uint32_t getTagBit(StringId id);
+
+	/// <summary>
+	/// Creates a tag mask for the given tag keys
+	/// </summary>
+	/// <param name="tags"></param>
+	/// <returns></returns>
+	TagMask createTagMask(std::initializer_list<std::string> tags);
+};
@@ -0,0 +1,258 @@
+#include "Tilemap.h"
+#include "../Graphics/Renderer.h"
+#include <algorithm>
+#include <limits>
+
+Tilemap::Tilemap(std::string name, std::string tilesetFile, int tileWidth, int tileHeight) : Entity(name)
+{
+	if (tileWidth <= 0 || tileHeight <= 0) {
+		throw std::runtime_error("failed to create tilemap: invalid tile size!");
+	}
+	this->pipelineType = ToString(PipelineType::PIPELINE_TYPE_GRAPHICS_2D);
+	m_tileset = std::make_unique<ImageTexture>(tilesetFile);
+	m_tileWidth = tileWidth;
+	m_tileHeight = tileHeight;
+	m_tilesetColumns = m_tileset->width / tileWidth;
+	m_tilesetRows = m_tileset->height / tileHeight;
+}
+
+void Tilemap::update(Scene* scene, float dt)
+{
+	if (this->hasState(EntityState::ENTITY_STATE_ACTIVE))
+	{
+		Entity::update(scene, dt);
+	}
+}
+
+void Tilemap::init(Scene* scene, Renderer* renderer)
+{
+	m_tileset->bufferIndex = renderer->createImageBuffer(m_tileset.get());
+	m_tileset->freeImageData();
+
+	// Bake the tiles set before the tilemap was added
+	this->rebuildDirtyChunks(renderer);
+}
+
+void Tilemap::render(Scene* scene, Renderer* renderer, VkCommandBuffer commandBuffer, int32_t currentFrame)
+{
+	m_drawCount = 0;
+	if (!this->hasState(EntityState::ENTITY_STATE_VISIBLE))
+	{
+		return;
+	}
+	Entity::render(scene, renderer, commandBuffer, currentFrame);
+	this->rebuildDirtyChunks(renderer);
+	if (m_chunks.size() == 0) {
+		return;
+	}
+
+	// Orthographic cameras see a rectangle of the map, unproject the clip space corners into tile space
+	int currentCamera = renderer->getActiveCamera();
+	auto modelMatrix = this->getModelMatrix();
+	const UboViewProjection& viewProjection = renderer->getCameraViewProjection(currentCamera);
+	glm::ivec2 firstChunk = m_chunkMin;
+	glm::ivec2 lastChunk = m_chunkMax;
+	if (viewProjection.projection[3][3] == 1.0f) {
+		glm::mat4 invMVP = glm::inverse(viewProjection.projection * viewProjection.view * modelMatrix);
+		glm::vec2 viewMin = glm::vec2(std::numeric_limits<float>::max());
+		glm::vec2 viewMax = glm::vec2(std::numeric_limits<float>::lowest());
+		for (float x : { -1.0f, 1.0f }) {
+			for (float y : { -1.0f, 1.0f }) {
+				glm::vec4 corner = invMVP * glm::vec4(x, y, 0.0f, 1.0f);
+				viewMin = glm::min(viewMin, glm::vec2(corner) / corner.w);
+				viewMax = glm::max(viewMax, glm::vec2(corner) / corner.w);
+			}
+		}
+		firstChunk = glm::max(firstChunk, glm::ivec2(glm::floor(viewMin / static_cast<float>(CHUNK_SIZE))));
+		lastChunk = glm::min(lastChunk, glm::ivec2(glm::floor(viewMax / static_cast<float>(CHUNK_SIZE))));
+	}
+	if (firstChunk.x > lastChunk.x || firstChunk.y > lastChunk.y) {
+		return;
+	}
+
+	// All chunks share the pipeline, the camera and the tileset
+	std::vector<VkDescriptorSet> descriptorSets = {
+		renderer->getCameraDescriptorSet(currentCamera, currentFrame),
+		renderer->getSamplerDescriptorSetFromImageBuffer(m_tileset->bufferIndex)
+	};
+	renderer->bindPipeline(commandBuffer, this->pipelineType);
+	scene->bindSceneDescriptorSets(renderer, commandBuffer, currentFrame, this->pipelineType);
+	renderer->bindPushConstants(commandBuffer, renderer->getCurrentPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(UboModel), &modelMatrix);
+	renderer->bindDescriptorSets(descriptorSets, currentFrame);
+
+	for (int y = firstChunk.y; y <= lastChunk.y; y++) {
+		for (int x = firstChunk.x; x <= lastChunk.x; x++) {
+			const TileChunk* chunk = m_chunks.find({ x, y, 0 });
+			if (chunk == nullptr || chunk->geometryIndex < 0) {
+				continue;
+			}
+			renderer->drawGeometry(chunk->geometryIndex, commandBuffer);
+			m_drawCount++;
+		}
+	}
+}
+
+void Tilemap::destroy(Scene* scene, Renderer* renderer)
+{
+	m_chunks.forEach([renderer](const ChunkIndex& index, TileChunk& chunk) {
+		if (chunk.geometryIndex >= 0) {
+			renderer->disposeGeometry(chunk.geometryIndex);
+			chunk.geometryIndex = -1;
+		}
+	});
+	renderer->disposeImageTexture(m_tileset->bufferIndex);
+}
+
+ChunkIndex Tilemap::toChunkIndex(int x, int y, int& localX, int& localY)
+{
+	// Round towards negative infinity, so tile -1 is the last tile of chunk -1
+	int chunkX = x >= 0 ? x / CHUNK_SIZE : (x + 1) / CHUNK_SIZE - 1;
+	int chunkY = y >= 0 ? y / CHUNK_SIZE : (y + 1) / CHUNK_SIZE - 1;
+	localX = x - chunkX * CHUNK_SIZE;
+	localY = y - chunkY * CHUNK_SIZE;
+	return { chunkX, chunkY, 0 };
+}
+
+void Tilemap::setTile(int x, int y, int tile)
+{
+	if (tile < EMPTY_TILE || tile >= m_tilesetColumns * m_tilesetRows) {
+		throw std::runtime_error("failed to set tile: invalid tile index!");
+	}
+
+	int localX, localY;
+	ChunkIndex index = toChunkIndex(x, y, localX, localY);
+	TileChunk* chunk = m_chunks.find(index);
+	if (chunk == nullptr) {
+		if (tile == EMPTY_TILE) {
+			return;
+		}
+		chunk = &m_chunks[index];
+		chunk->tiles.assign(CHUNK_SIZE * CHUNK_SIZE, EMPTY_TILE);
+	}
+
+	int& current = chunk->tiles[localY * CHUNK_SIZE + localX];
+	if (current == tile) {
+		return;
+	}
+	if (current == EMPTY_TILE) {
+		chunk->tileCount++;
+	}
+	else if (tile == EMPTY_TILE) {
+		chunk->tileCount--;
+	}
+	current = tile;
+
+	if (!chunk->dirty) {
+		chunk->dirty = true;
+		m_dirtyChunks.push_back(index);
+	}
+}
+
+void Tilemap::fill(int x, int y, int width, int height, int tile)
+{
+	for (int tileY = y; tileY < y + height; tileY++) {
+		for (int tileX = x; tileX < x + width; tileX++) {
+			this->setTile(tileX, tileY, tile);
+		}
+	}
+}
+
+int Tilemap::getTile(int x, int y) const
+{
+	int localX, localY;
+	const TileChunk* chunk = m_chunks.find(toChunkIndex(x, y, localX, localY));
+	if (chunk == nullptr) {
+		return EMPTY_TILE;
+	}
+	return chunk->tiles[localY * CHUNK_SIZE + localX];
+}
+
+void Tilemap::rebuildDirtyChunks(Renderer* renderer)
+{
+	if (m_dirtyChunks.empty()) {
+		return;
+	}
+
+	for (const ChunkIndex& index : m_dirtyChunks) {
+		TileChunk* chunk = m_chunks.find(index);
+		if (chunk == nullptr) {
+			continue;
+		}
+		chunk->dirty = false;
+
+		// The pool keeps freed geometry alive for the frames in flight
+		if (chunk->geometryIndex >= 0) {
+			renderer->disposeGeometry(chunk->geometryIndex);
+			chunk->geometryIndex = -1;
+		}
+		if (chunk->tileCount == 0) {
+			m_chunks.erase(index);
+			continue;
+		}
+		this->buildChunk(renderer, index, *chunk);
+	}
+	m_dirtyChunks.clear();
+
+	// Added and removed chunks change the range and the bounds
+	this->updateChunkRange();
+	this->createAABB();
+}
+
+void Tilemap::buildChunk(Renderer* renderer, const ChunkIndex& index, TileChunk& chunk)
+{
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	vertices.reserve(chunk.tileCount * 4);
+	indices.reserve(chunk.tileCount * 6);
+
+	const glm::vec3 color = glm::vec3(1.0f);
+	const glm::vec3 normal = glm::vec3(0.0f, 0.0f, 1.0f);
+	glm::vec2 uvSize = glm::vec2(static_cast<float>(m_tileWidth) / m_tileset->width, static_cast<float>(m_tileHeight) / m_tileset->height);
+	glm::vec2 origin = glm::vec2(index.chunkX, index.chunkY) * static_cast<float>(CHUNK_SIZE);
+	for (int y = 0; y < CHUNK_SIZE; y++) {
+		for (int x = 0; x < CHUNK_SIZE; x++) {
+			int tile = chunk.tiles[y * CHUNK_SIZE + x];
+			if (tile == EMPTY_TILE) {
+				continue;
+			}
+
+			// Same corner order and winding as the sprite quad
+			glm::vec2 min = origin + glm::vec2(x, y);
+			glm::vec2 max = min + glm::vec2(1.0f);
+			glm::vec2 uvMin = glm::vec2(tile % m_tilesetColumns, tile / m_tilesetColumns) * uvSize;
+			glm::vec2 uvMax = uvMin + uvSize;
+			uint32_t first = static_cast<uint32_t>(vertices.size());
+			vertices.push_back({ { max.x, min.y, 0.0f }, color, { uvMax.x, uvMax.y }, normal }); // Bottom Right
+			vertices.push_back({ { max.x, max.y, 0.0f }, color, { uvMax.x, uvMin.y }, normal }); // Top Right
+			vertices.push_back({ { min.x, max.y, 0.0f }, color, { uvMin.x, uvMin.y }, normal }); // Top Left
+			vertices.push_back({ { min.x, min.y, 0.0f }, color, { uvMin.x, uvMax.y }, normal }); // Bottom Left
+			for (uint32_t corner : { 0u, 1u, 2u, 2u, 3u, 0u }) {
+				indices.push_back(first + corner);
+			}
+		}
+	}
+	chunk.geometryIndex = renderer->createGeometry(&vertices, &indices);
+}
+
+void Tilemap::updateChunkRange()
+{
+	m_chunkMin = glm::ivec2(std::numeric_limits<int>::max());
+	m_chunkMax = glm::ivec2(std::numeric_limits<int>::min());
+	m_chunks.forEach([this](const ChunkIndex& index, const TileChunk& chunk) {
+		m_chunkMin = glm::min(m_chunkMin, glm::ivec2(index.chunkX, index.chunkY));
+		m_chunkMax = glm::max(m_chunkMax, glm::ivec2(index.chunkX, index.chunkY));
+	});
+}
+
+void Tilemap::createAABB()
+{
+	AABB aabb;
+	if (m_chunks.size() == 0) {
+		aabb.expand(glm::vec3(0.0f));
+	}
+	else {
+		aabb.expand(glm::vec3(glm::vec2(m_chunkMin) * static_cast<float>(CHUNK_SIZE), 0.0f));
+		aabb.expand(glm::vec3(glm::vec2(m_chunkMax + 1) * static_cast<float>(CHUNK_SIZE), 0.0f));
+	}
+	this->setAABB(aabb);
+}
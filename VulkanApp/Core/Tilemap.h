@@ -0,0 +1,147 @@
+#pragma once
+#include "Entity.h"
+#include "Scene.h"
+#include "ChunkMap.h"
+#include "../Graphics/ImageTexture.h"
+#include <vector>
+
+/// <summary>
+/// Tilemap Entity
+/// Stores tile indices in chunks of CHUNK_SIZE x CHUNK_SIZE tiles. Every chunk is baked into one static mesh against a
+/// tileset atlas, changed chunks are rebuilt before the next render. With an orthographic camera like Camera2D only the
+/// chunks overlapping the view are drawn. A tile is one unit large, tile (x, y) covers [x, x + 1] x [y, y + 1] in local
+/// space, use the transform to scale and move the map.
+/// </summary>
+class Tilemap :
+	public Entity
+{
+private:
+	/// <summary>
+	/// The tiles of one chunk and their baked mesh
+	/// </summary>
+	struct TileChunk {
+		std::vector<int> tiles;		// CHUNK_SIZE * CHUNK_SIZE tile indices, row by row
+		int geometryIndex = -1;
+		uint32_t tileCount = 0;		// Number of tiles that are not empty
+		bool dirty = false;
+	};
+
+	/// <summary>
+	/// The chunks by their index, chunkZ is always 0
+	/// </summary>
+	ChunkMap<TileChunk> m_chunks;
+
+	/// <summary>
+	/// Chunks whose mesh has to be rebuilt
+	/// </summary>
+	std::vector<ChunkIndex> m_dirtyChunks;
+
+	/// <summary>
+	/// The range of chunk indices in use, bounds the visible range and the AABB
+	/// </summary>
+	glm::ivec2 m_chunkMin = glm::ivec2(0);
+	glm::ivec2 m_chunkMax = glm::ivec2(-1);
+
+	/// <summary>
+	/// The tileset atlas, its tiles are numbered row by row starting at the top left
+	/// </summary>
+	std::unique_ptr<ImageTexture> m_tileset;
+	int m_tileWidth;
+	int m_tileHeight;
+	int m_tilesetColumns = 0;
+	int m_tilesetRows = 0;
+
+	/// <summary>
+	/// Number of chunks drawn by the last render
+	/// </summary>
+	size_t m_drawCount = 0;
+
+	/// <summary>
+	/// Splits a tile position into its chunk and the position inside the chunk
+	/// </summary>
+	/// <param name="x"></param>
+	/// <param name="y"></param>
+	/// <param name="localX"></param>
+	/// <param name="localY"></param>
+	/// <returns></returns>
+	static ChunkIndex toChunkIndex(int x, int y, int& localX, int& localY);
+
+	/// <summary>
+	/// Bakes the dirty chunks, chunks without tiles are removed
+	/// </summary>
+	/// <param name="renderer"></param>
+	void rebuildDirtyChunks(Renderer* renderer);
+
+	/// <summary>
+	/// Bakes the tiles of a chunk into one mesh
+	/// </summary>
+	/// <param name="renderer"></param>
+	/// <param name="index"></param>
+	/// <param name="chunk"></param>
+	void buildChunk(Renderer* renderer, const ChunkIndex& index, TileChunk& chunk);
+
+	/// <summary>
+	/// Recomputes the range of chunk indices in use
+	/// </summary>
+	void updateChunkRange();
+
+public:
+	static constexpr int CHUNK_SIZE = 32;
+	static constexpr int EMPTY_TILE = -1;
+
+	/// <summary>
+	/// Create a tilemap from a tileset file
+	/// </summary>
+	/// <param name="name"></param>
+	/// <param name="tilesetFile"></param>
+	/// <param name="tileWidth">Width of a tile in the tileset in pixels</param>
+	/// <param name="tileHeight">Height of a tile in the tileset in pixels</param>
+	Tilemap(std::string name, std::string tilesetFile, int tileWidth, int tileHeight);
+	~Tilemap() = default;
+	void update(Scene* scene, float dt) override;
+	void init(Scene* scene, Renderer* renderer) override;
+	void render(Scene* scene, Renderer* renderer, VkCommandBuffer commandBuffer, int32_t currentFrame) override;
+	void destroy(Scene* scene, Renderer* renderer) override;
+
+	/// <summary>
+	/// Sets a tile, the chunk is rebuilt before the next render
+	/// </summary>
+	/// <param name="x"></param>
+	/// <param name="y"></param>
+	/// <param name="tile">Index into the tileset or EMPTY_TILE</param>
+	void setTile(int x, int y, int tile);
+
+	/// <summary>
+	/// Sets all tiles of a rectangle
+	/// </summary>
+	/// <param name="x"></param>
+	/// <param name="y"></param>
+	/// <param name="width"></param>
+	/// <param name="height"></param>
+	/// <param name="tile">Index into the tileset or EMPTY_TILE</param>
+	void fill(int x, int y, int width, int height, int tile);
+
+	/// <summary>
+	/// Returns a tile
+	/// </summary>
+	/// <param name="x"></param>
+	/// <param name="y"></param>
+	/// <returns>EMPTY_TILE if the tile was never set</returns>
+	int getTile(int x, int y) const;
+
+	/// <summary>
+	/// Returns the number of chunks holding tiles
+	/// </summary>
+	/// <returns></returns>
+	size_t getChunkCount() const { return m_chunks.size(); }
+
+	/// <summary>
+	/// Returns the number of chunks drawn by the last render
+	/// </summary>
+	/// <returns></returns>
+	size_t getDrawCount() const { return m_drawCount; }
+
+	int getTextureBufferIndex() const { return m_tileset->bufferIndex; }
+
+	void createAABB() override;
+};
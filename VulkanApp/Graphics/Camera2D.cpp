@@ -1,4 +1,5 @@
 #include "Camera2D.h"
+#include <limits>
 
 float Camera2D::calculateScreenCorrection(float viewportWidth, float viewportHeight)
 {
@@ -16,14 +17,14 @@ Camera2D::Camera2D(glm::vec3 position, glm::vec2 viewSize, const float near, con
 {
 	m_near = near;
 	m_far = far;
-	this->transform.position = position;
+	this->transform.setPosition(position);
 	this->m_viewSize = viewSize;
 	this->createFrustum();
 }
 
 glm::mat4 Camera2D::getViewMatrix()
 {
-	return glm::lookAt(transform.position, transform.position + transform.getForward(), transform.getUp());
+	return glm::lookAt(transform.getPosition(), transform.getPosition() + transform.getForward(), transform.getUp());
 	//glm::mat4 view = glm::lookAt(glm::vec3(0, 0, 1), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
 	//return view;
 }
@@ -37,10 +38,10 @@ glm::mat4 Camera2D::getProjectionMatrix()
 	float halfWidth = m_viewSize.x / 2.0f;
 	float halfHeight = m_viewSize.y / 2.0f;
 
-	float left = this->transform.position.x - halfWidth;
-	float right = this->transform.position.x + halfWidth;
-	float bottom = this->transform.position.y - halfHeight;
-	float top = this->transform.position.y + halfHeight;
+	float left = this->transform.getPosition().x - halfWidth;
+	float right = this->transform.getPosition().x + halfWidth;
+	float bottom = this->transform.getPosition().y - halfHeight;
+	float top = this->transform.getPosition().y + halfHeight;
 
 	auto projection = glm::ortho(left, right, bottom, top, m_near, m_far);
 
@@ -54,23 +55,23 @@ UboViewProjection Camera2D::getViewProjection()
 	UboViewProjection viewProj = {};
 	viewProj.projection = getProjectionMatrix();
 	viewProj.view = getViewMatrix();
-	viewProj.cameraPos = this->transform.position;
+	viewProj.cameraPos = this->transform.getPosition();
 	return viewProj;
 }
 
 void Camera2D::moveForward(float distance)
 {
-	this->transform.position.z += distance;
+	this->transform.translate(glm::vec3(0.0f, 0.0f, distance));
 }
 
 void Camera2D::moveUp(float distance)
 {
-	this->transform.position.y += distance;
+	this->transform.translate(glm::vec3(0.0f, distance, 0.0f));
 }
 
 void Camera2D::moveRight(float distance)
 {
-	this->transform.position.x += distance;
+	this->transform.translate(glm::vec3(distance, 0.0f, 0.0f));
 }
 
 void Camera2D::turn(float pitch, float yaw, float roll)
@@ -101,6 +102,22 @@ glm::vec3 Camera2D::unprojectPosition(const glm::vec3& screenpos, const glm::vec
 	return glm::vec3(worldPos) / worldPos.w;
 }
 
+void Camera2D::getViewBounds(glm::vec2& min, glm::vec2& max)
+{
+	// Unproject the corners of the clip space, the view matrix moves the projection as well
+	glm::mat4 invVP = glm::inverse(getProjectionMatrix() * getViewMatrix());
+	min = glm::vec2(std::numeric_limits<float>::max());
+	max = glm::vec2(std::numeric_limits<float>::lowest());
+	for (float x : { -1.0f, 1.0f }) {
+		for (float y : { -1.0f, 1.0f }) {
+			glm::vec4 worldPos = invVP * glm::vec4(x, y, 0.0f, 1.0f);
+			glm::vec2 corner = glm::vec2(worldPos) / worldPos.w;
+			min = glm::min(min, corner);
+			max = glm::max(max, corner);
+		}
+	}
+}
+
 FrustumPoints& Camera2D::getFrustumPoints() const
 {
 	// Direction Vectors
@@ -120,16 +137,16 @@ FrustumPoints& Camera2D::getFrustumPoints() const
 	FrustumPoints frustumPoints;
 
 	// Near plane corners
-	frustumPoints.nearTopLeft = transform.position + glm::vec3(-halfWidth, halfHeight, -neardist);
-	frustumPoints.nearTopRight = transform.position + glm::vec3(halfWidth, halfHeight, -neardist);
-	frustumPoints.nearBottomLeft = transform.position + glm::vec3(-halfWidth, -halfHeight, -neardist);
-	frustumPoints.nearBottomRight = transform.position + glm::vec3(halfWidth, -halfHeight, -neardist);
+	frustumPoints.nearTopLeft = transform.getPosition() + glm::vec3(-halfWidth, halfHeight, -neardist);
+	frustumPoints.nearTopRight = transform.getPosition() + glm::vec3(halfWidth, halfHeight, -neardist);
+	frustumPoints.nearBottomLeft = transform.getPosition() + glm::vec3(-halfWidth, -halfHeight, -neardist);
+	frustumPoints.nearBottomRight = transform.getPosition() + glm::vec3(halfWidth, -halfHeight, -neardist);
 
 	// Far plane corners
-	frustumPoints.farTopLeft = transform.position + glm::vec3(-halfWidth, halfHeight, -fardist);
-	frustumPoints.farTopRight = transform.position + glm::vec3(halfWidth, halfHeight, -fardist);
-	frustumPoints.farBottomLeft = transform.position + glm::vec3(-halfWidth, -halfHeight, -fardist);
-	frustumPoints.farBottomRight = transform.position + glm::vec3(halfWidth, -halfHeight, -fardist);
+	frustumPoints.farTopLeft = transform.getPosition() + glm::vec3(-halfWidth, halfHeight, -fardist);
+	frustumPoints.farTopRight = transform.getPosition() + glm::vec3(halfWidth, halfHeight, -fardist);
+	frustumPoints.farBottomLeft = transform.getPosition() + glm::vec3(-halfWidth, -halfHeight, -fardist);
+	frustumPoints.farBottomRight = transform.getPosition() + glm::vec3(halfWidth, -halfHeight, -fardist);
 
 	return frustumPoints;
 }
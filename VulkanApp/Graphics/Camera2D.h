@@ -112,6 +112,13 @@ public:
 	/// <returns></returns>
 	FrustumPoints& getFrustumPoints() const override;
 
+	/// <summary>
+	/// Gets the world space rectangle visible through the camera, e.g. to cull sprites.
+	/// </summary>
+	/// <param name="min"></param>
+	/// <param name="max"></param>
+	void getViewBounds(glm::vec2& min, glm::vec2& max);
+
 	/// <summary>
 	/// Dumps camera information for debugging.
 	/// </summary>
@@ -3,7 +3,7 @@
 Camera3D::Camera3D(glm::vec3 position, glm::vec2 aspectRatio, float fov, float nearPlane, float farPlane)
 	: Camera()
 {
-	transform.position = position;
+	transform.setPosition(position);
 	m_fov = fov;
 	m_aspectRatio = aspectRatio.x / aspectRatio.y;
 	m_nearPlane = nearPlane;
@@ -13,10 +13,10 @@ Camera3D::Camera3D(glm::vec3 position, glm::vec2 aspectRatio, float fov, float n
 
 glm::mat4 Camera3D::getViewMatrix()
 {
-	auto cameraForward = transform.position + transform.getForward();
+	auto cameraForward = transform.getPosition() + transform.getForward();
 	auto up = glm::vec3(0.0f, 1.0f, 0.0f);
 
-	return glm::lookAt(transform.position, cameraForward, up);
+	return glm::lookAt(transform.getPosition(), cameraForward, up);
 }
 
 glm::mat4 Camera3D::getProjectionMatrix()
@@ -31,7 +31,7 @@ UboViewProjection Camera3D::getViewProjection()
 	UboViewProjection ubo = {};
 	ubo.view = getViewMatrix();
 	ubo.projection = getProjectionMatrix();
-	ubo.cameraPos = this->transform.position;
+	ubo.cameraPos = this->transform.getPosition();
 	return ubo;
 }
 
@@ -95,8 +95,8 @@ FrustumPoints& Camera3D::getFrustumPoints() const
 	float fovY = glm::radians(m_fov);
 
 	// Centers of Near and Far planes
-	glm::vec3 nearCenter = transform.position + forward * neardist;
-	glm::vec3 farCenter = transform.position + forward * fardist;
+	glm::vec3 nearCenter = transform.getPosition() + forward * neardist;
+	glm::vec3 farCenter = transform.getPosition() + forward * fardist;
 
 	// Calculate height and width of Near and Far planes
 	float nearHeigth = 2.0f * tan(fovY * 0.5f) * neardist;
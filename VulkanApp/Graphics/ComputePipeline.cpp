@@ -0,0 +1,55 @@
+#include "ComputePipeline.h"
+#include "Pipeline.h"
+
+ComputePipeline::ComputePipeline(const std::string& shaderSource, const std::string& entryPoint)
+{
+	m_shaderSource = shaderSource;
+	m_entryPoint = entryPoint;
+}
+
+void ComputePipeline::createPipelineLayout(VkDevice device, VkDescriptorSetLayout* descriptorSetLayouts, uint32_t descriptorSetLayoutCount, VkPushConstantRange* pushConstantRanges, uint32_t pushConstantRangeCount)
+{
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = descriptorSetLayoutCount;
+	pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts;
+	pipelineLayoutInfo.pushConstantRangeCount = pushConstantRangeCount;
+	pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges;
+
+	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create compute pipeline layout!");
+	}
+}
+
+void ComputePipeline::createPipeline(VkDevice device)
+{
+	if (m_pipelineLayout == VK_NULL_HANDLE) {
+		throw std::runtime_error("Pipeline layout must be created before creating the compute pipeline!");
+	}
+
+	auto shaderSrc = readFile(m_shaderSource);
+	VkShaderModule shaderModule = Pipeline::createShaderModule(device, shaderSrc);
+
+	VkPipelineShaderStageCreateInfo shaderStageInfo{};
+	shaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	shaderStageInfo.module = shaderModule;
+	shaderStageInfo.pName = m_entryPoint.c_str();
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = shaderStageInfo;
+	pipelineInfo.layout = m_pipelineLayout;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineInfo.basePipelineIndex = -1;
+
+	if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+		vkDestroyShaderModule(device, shaderModule, nullptr);
+		throw std::runtime_error("failed to create compute pipeline!");
+	}
+	else {
+		std::printf("[GFX]: Compute pipeline created successfully.\n");
+	}
+
+	vkDestroyShaderModule(device, shaderModule, nullptr);
+}
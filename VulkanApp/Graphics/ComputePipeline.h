@@ -0,0 +1,39 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <string>
+#include <vector>
+#include "../Utils.h"
+
+/// <summary>
+/// A compute shader with its pipeline layout
+/// </summary>
+class ComputePipeline
+{
+private:
+	std::string m_shaderSource;
+	std::string m_entryPoint;
+	VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+
+public:
+	VkPipeline pipeline = VK_NULL_HANDLE;
+
+	/// <summary>
+	/// Creates the pipeline object, call createPipelineLayout and createPipeline to initialize it
+	/// </summary>
+	/// <param name="shaderSource">Path of the SPIR-V compute shader</param>
+	/// <param name="entryPoint"></param>
+	ComputePipeline(const std::string& shaderSource, const std::string& entryPoint = "main");
+
+	VkPipelineLayout getPipelineLayout() const {
+		return m_pipelineLayout;
+	}
+
+	void createPipelineLayout(VkDevice device, VkDescriptorSetLayout* descriptorSetLayouts, uint32_t descriptorSetLayoutCount, VkPushConstantRange* pushConstantRanges = nullptr, uint32_t pushConstantRangeCount = 0);
+	void createPipeline(VkDevice device);
+
+	void destroy(VkDevice device) {
+		vkDestroyPipeline(device, pipeline, nullptr);
+		vkDestroyPipelineLayout(device, m_pipelineLayout, nullptr);
+	}
+};
@@ -0,0 +1,113 @@
+#include "DebugDrawBatcher.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+void DebugDrawBatcher::beginFrame(VkDevice device, uint32_t frame)
+{
+	if (frame >= m_frames.size()) {
+		m_frames.resize(frame + 1);
+	}
+	m_frame = frame;
+
+	// The command buffer of the image finished, so the outgrown buffers and the instances are free again
+	FrameBuffers& buffers = m_frames[frame];
+	for (InstanceBuffer& retired : buffers.retired) {
+		destroyInstanceBuffer(device, retired);
+	}
+	buffers.retired.clear();
+	buffers.current.usedInstances = 0;
+}
+
+void DebugDrawBatcher::add(PrimitiveType primitiveType, const glm::mat4& modelMatrix, const glm::vec4& color)
+{
+	m_queues[primitiveType].push_back({ modelMatrix, color });
+}
+
+const std::vector<DebugDraw>& DebugDrawBatcher::upload(VkPhysicalDevice physicalDevice, VkDevice device)
+{
+	m_draws.clear();
+	uint32_t queuedInstances = 0;
+	for (const auto& [primitiveType, instances] : m_queues) {
+		queuedInstances += static_cast<uint32_t>(instances.size());
+	}
+	if (queuedInstances == 0) {
+		return m_draws;
+	}
+	if (m_frames.empty()) {
+		throw std::runtime_error("failed to upload debug draws: no frame was started!");
+	}
+
+	// Draws recorded earlier in the frame still read the current buffer, so a larger one replaces it until the frame finished
+	FrameBuffers& frame = m_frames[m_frame];
+	InstanceBuffer& current = frame.current;
+	if (current.usedInstances + queuedInstances > current.capacity) {
+		if (current.buffer != VK_NULL_HANDLE) {
+			frame.retired.push_back(current);
+		}
+		uint32_t capacity = std::max({ queuedInstances * 2, current.capacity * 2, MIN_CAPACITY });
+		current = InstanceBuffer();
+		createInstanceBuffer(physicalDevice, device, capacity, current);
+	}
+
+	// The shapes of every primitive type are drawn with one call
+	UboModelColor* mapped = static_cast<UboModelColor*>(current.mapped);
+	for (auto& [primitiveType, instances] : m_queues) {
+		if (instances.empty()) {
+			continue;
+		}
+		std::memcpy(mapped + current.usedInstances, instances.data(), sizeof(UboModelColor) * instances.size());
+
+		DebugDraw draw;
+		draw.primitiveType = primitiveType;
+		draw.instanceBuffer = current.buffer;
+		draw.instanceOffset = sizeof(UboModelColor) * static_cast<VkDeviceSize>(current.usedInstances);
+		draw.instanceCount = static_cast<uint32_t>(instances.size());
+		m_draws.push_back(draw);
+
+		current.usedInstances += draw.instanceCount;
+		instances.clear();
+	}
+	return m_draws;
+}
+
+void DebugDrawBatcher::createInstanceBuffer(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t capacity, InstanceBuffer& instanceBuffer)
+{
+	VkDeviceSize size = sizeof(UboModelColor) * static_cast<VkDeviceSize>(capacity);
+	createBuffer(physicalDevice,
+		device,
+		size,
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		&instanceBuffer.buffer,
+		&instanceBuffer.memory);
+	if (vkMapMemory(device, instanceBuffer.memory, 0, size, 0, &instanceBuffer.mapped) != VK_SUCCESS) {
+		throw std::runtime_error("failed to map debug draw instance buffer!");
+	}
+	instanceBuffer.capacity = capacity;
+	instanceBuffer.usedInstances = 0;
+}
+
+void DebugDrawBatcher::destroyInstanceBuffer(VkDevice device, InstanceBuffer& instanceBuffer)
+{
+	if (instanceBuffer.buffer == VK_NULL_HANDLE) {
+		return;
+	}
+	vkUnmapMemory(device, instanceBuffer.memory);
+	vkDestroyBuffer(device, instanceBuffer.buffer, nullptr);
+	vkFreeMemory(device, instanceBuffer.memory, nullptr);
+	instanceBuffer = InstanceBuffer();
+}
+
+void DebugDrawBatcher::dispose(VkDevice device)
+{
+	for (FrameBuffers& frame : m_frames) {
+		destroyInstanceBuffer(device, frame.current);
+		for (InstanceBuffer& retired : frame.retired) {
+			destroyInstanceBuffer(device, retired);
+		}
+	}
+	m_frames.clear();
+	m_queues.clear();
+	m_draws.clear();
+}
@@ -0,0 +1,86 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <map>
+#include <vector>
+#include "Primitive.h"
+#include "../Utils.h"
+
+/// <summary>
+/// One instanced draw of the queued shapes of a primitive type
+/// </summary>
+struct DebugDraw {
+	PrimitiveType primitiveType = PrimitiveType::PRIMITIVE_TYPE_CUBE;
+	VkBuffer instanceBuffer = VK_NULL_HANDLE;	// UboModelColor per instance
+	VkDeviceSize instanceOffset = 0;
+	uint32_t instanceCount = 0;
+};
+
+/// <summary>
+/// Collects debug shapes during a frame and draws them with one instanced draw per primitive type
+/// The model matrix and the color of every shape are streamed as per instance attributes through host visible
+/// buffers, one per swapchain image. Several flushes in one frame append to the buffer of the frame.
+/// </summary>
+class DebugDrawBatcher
+{
+private:
+	/// <summary>
+	/// A host visible instance buffer with room for capacity instances
+	/// </summary>
+	struct InstanceBuffer {
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		void* mapped = nullptr;
+		uint32_t capacity = 0;
+		uint32_t usedInstances = 0;
+	};
+
+	/// <summary>
+	/// The instance buffer of a swapchain image and the buffers it outgrew during the frame
+	/// </summary>
+	struct FrameBuffers {
+		InstanceBuffer current;
+		std::vector<InstanceBuffer> retired;
+	};
+
+	static constexpr uint32_t MIN_CAPACITY = 1024;
+
+	std::map<PrimitiveType, std::vector<UboModelColor>> m_queues;
+	std::vector<FrameBuffers> m_frames;
+	uint32_t m_frame = 0;
+	std::vector<DebugDraw> m_draws;
+
+	static void createInstanceBuffer(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t capacity, InstanceBuffer& instanceBuffer);
+	static void destroyInstanceBuffer(VkDevice device, InstanceBuffer& instanceBuffer);
+
+public:
+	DebugDrawBatcher() = default;
+	~DebugDrawBatcher() = default;
+
+	/// <summary>
+	/// Starts a frame, the previous command buffer of the swapchain image has finished
+	/// </summary>
+	/// <param name="device"></param>
+	/// <param name="frame">Index of the swapchain image</param>
+	void beginFrame(VkDevice device, uint32_t frame);
+
+	/// <summary>
+	/// Queues a shape for the next upload
+	/// </summary>
+	/// <param name="primitiveType"></param>
+	/// <param name="modelMatrix"></param>
+	/// <param name="color"></param>
+	void add(PrimitiveType primitiveType, const glm::mat4& modelMatrix, const glm::vec4& color);
+
+	/// <summary>
+	/// Appends the queued shapes to the instance buffer of the frame and empties the queues
+	/// </summary>
+	/// <param name="physicalDevice">Creates larger instance buffers if needed</param>
+	/// <param name="device"></param>
+	/// <returns>One draw per primitive type, valid until the next upload</returns>
+	const std::vector<DebugDraw>& upload(VkPhysicalDevice physicalDevice, VkDevice device);
+
+	void dispose(VkDevice device);
+};
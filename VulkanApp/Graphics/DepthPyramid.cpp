@@ -0,0 +1,409 @@
+#include "DepthPyramid.h"
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+DepthPyramid::DepthPyramid(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue transferQueue, VkCommandPool transferCommandPool, VkImageView depthImageView, VkExtent2D extent, VkDescriptorSetLayout reduceSetLayout, VkDescriptorSetLayout pyramidSetLayout)
+{
+	if (extent.width == 0 || extent.height == 0) {
+		throw std::runtime_error("failed to create depth pyramid: the depth image is empty!");
+	}
+
+	// Every level halves the size of the level before, down to one texel
+	VkExtent2D levelSize = extent;
+	m_levelSizes.push_back(levelSize);
+	while (levelSize.width > 1 || levelSize.height > 1) {
+		levelSize.width = std::max(1u, levelSize.width / 2);
+		levelSize.height = std::max(1u, levelSize.height / 2);
+		m_levelSizes.push_back(levelSize);
+	}
+	uint32_t levelCount = static_cast<uint32_t>(m_levelSizes.size());
+	while (m_readbackLevel + 1 < levelCount && std::max(m_levelSizes[m_readbackLevel].width, m_levelSizes[m_readbackLevel].height) > READBACK_SIZE) {
+		m_readbackLevel++;
+	}
+
+	// The levels are written as storage images and read by the next level, the culling shader and the readback
+	VkImageCreateInfo imageInfo = {};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.extent = { extent.width, extent.height, 1 };
+	imageInfo.mipLevels = levelCount;
+	imageInfo.arrayLayers = 1;
+	imageInfo.format = VK_FORMAT_R32_SFLOAT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	if (vkCreateImage(device, &imageInfo, nullptr, &m_image) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create depth pyramid image!");
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(device, m_image, &memoryRequirements);
+	VkMemoryAllocateInfo memoryAllocInfo = {};
+	memoryAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memoryAllocInfo.allocationSize = memoryRequirements.size;
+	memoryAllocInfo.memoryTypeIndex = findMemoryType(physicalDevice, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	if (vkAllocateMemory(device, &memoryAllocInfo, nullptr, &m_imageMemory) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate depth pyramid memory!");
+	}
+	vkBindImageMemory(device, m_image, m_imageMemory, 0);
+
+	VkImageViewCreateInfo viewInfo = {};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = m_image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = VK_FORMAT_R32_SFLOAT;
+	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	viewInfo.subresourceRange.baseMipLevel = 0;
+	viewInfo.subresourceRange.levelCount = levelCount;
+	viewInfo.subresourceRange.baseArrayLayer = 0;
+	viewInfo.subresourceRange.layerCount = 1;
+	if (vkCreateImageView(device, &viewInfo, nullptr, &m_pyramidView) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create depth pyramid image view!");
+	}
+	m_levelViews.resize(levelCount, VK_NULL_HANDLE);
+	for (uint32_t level = 0; level < levelCount; level++) {
+		viewInfo.subresourceRange.baseMipLevel = level;
+		viewInfo.subresourceRange.levelCount = 1;
+		if (vkCreateImageView(device, &viewInfo, nullptr, &m_levelViews[level]) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create depth pyramid level view!");
+		}
+	}
+
+	// The shaders fetch single texels, the sampler only has to exist
+	VkSamplerCreateInfo samplerInfo = {};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_NEAREST;
+	samplerInfo.minFilter = VK_FILTER_NEAREST;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.maxLod = static_cast<float>(levelCount);
+	if (vkCreateSampler(device, &samplerInfo, nullptr, &m_sampler) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create depth pyramid sampler!");
+	}
+
+	// The info is only written on the GPU timeline, so frames in flight never see a newer one than their pyramid
+	createBuffer(physicalDevice,
+		device,
+		sizeof(DepthPyramidInfo),
+		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		&m_infoBuffer,
+		&m_infoBufferMemory);
+
+	// Until the first build the info marks the pyramid as empty, so nothing is occluded
+	VkCommandBuffer setupCommandBuffer = beginCommandBuffer(device, transferCommandPool);
+	VkImageMemoryBarrier layoutBarrier = {};
+	layoutBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	layoutBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	layoutBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	layoutBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	layoutBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	layoutBarrier.image = m_image;
+	layoutBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount, 0, 1 };
+	layoutBarrier.srcAccessMask = 0;
+	layoutBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(setupCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &layoutBarrier);
+	DepthPyramidInfo emptyInfo = {};
+	vkCmdUpdateBuffer(setupCommandBuffer, m_infoBuffer, 0, sizeof(DepthPyramidInfo), &emptyInfo);
+	submitCommandBuffer(device, transferCommandPool, transferQueue, setupCommandBuffer);
+
+	// One set per level for the reduction and one for the culling shader
+	std::array<VkDescriptorPoolSize, 3> poolSizes = {};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[0].descriptorCount = levelCount + 1;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	poolSizes[1].descriptorCount = levelCount;
+	poolSizes[2].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	poolSizes[2].descriptorCount = 1;
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = levelCount + 1;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create depth pyramid descriptor pool!");
+	}
+
+	std::vector<VkDescriptorSetLayout> layouts(levelCount, reduceSetLayout);
+	layouts.push_back(pyramidSetLayout);
+	std::vector<VkDescriptorSet> descriptorSets(layouts.size());
+	VkDescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = m_descriptorPool;
+	allocInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
+	allocInfo.pSetLayouts = layouts.data();
+	if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate depth pyramid descriptor sets!");
+	}
+	m_reduceDescriptorSets.assign(descriptorSets.begin(), descriptorSets.begin() + levelCount);
+	m_descriptorSet = descriptorSets.back();
+
+	// The first level reads the depth image, the others the level before
+	std::vector<VkDescriptorImageInfo> sourceInfos(levelCount);
+	std::vector<VkDescriptorImageInfo> destinationInfos(levelCount);
+	std::vector<VkWriteDescriptorSet> writes;
+	writes.reserve(levelCount * 2 + 2);
+	for (uint32_t level = 0; level < levelCount; level++) {
+		sourceInfos[level].sampler = m_sampler;
+		sourceInfos[level].imageView = level == 0 ? depthImageView : m_levelViews[level - 1];
+		sourceInfos[level].imageLayout = level == 0 ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+		destinationInfos[level].imageView = m_levelViews[level];
+		destinationInfos[level].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		VkWriteDescriptorSet write = {};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = m_reduceDescriptorSets[level];
+		write.dstArrayElement = 0;
+		write.descriptorCount = 1;
+		write.dstBinding = 0;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		write.pImageInfo = &sourceInfos[level];
+		writes.push_back(write);
+		write.dstBinding = 1;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		write.pImageInfo = &destinationInfos[level];
+		writes.push_back(write);
+	}
+
+	VkDescriptorImageInfo pyramidInfo = {};
+	pyramidInfo.sampler = m_sampler;
+	pyramidInfo.imageView = m_pyramidView;
+	pyramidInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+	VkDescriptorBufferInfo infoBufferInfo = {};
+	infoBufferInfo.buffer = m_infoBuffer;
+	infoBufferInfo.offset = 0;
+	infoBufferInfo.range = sizeof(DepthPyramidInfo);
+
+	VkWriteDescriptorSet pyramidWrite = {};
+	pyramidWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	pyramidWrite.dstSet = m_descriptorSet;
+	pyramidWrite.dstArrayElement = 0;
+	pyramidWrite.descriptorCount = 1;
+	pyramidWrite.dstBinding = 0;
+	pyramidWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	pyramidWrite.pImageInfo = &pyramidInfo;
+	writes.push_back(pyramidWrite);
+	pyramidWrite.dstBinding = 1;
+	pyramidWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	pyramidWrite.pImageInfo = nullptr;
+	pyramidWrite.pBufferInfo = &infoBufferInfo;
+	writes.push_back(pyramidWrite);
+	vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+	this->state = GFX_BUFFER_STATE_INITIALIZED;
+	std::cout << "[DEPTH PYRAMID] Depth pyramid created with " << levelCount << " levels for " << extent.width << "x" << extent.height << "." << std::endl;
+}
+
+void DepthPyramid::build(VkPhysicalDevice physicalDevice, VkDevice device, VkCommandBuffer commandBuffer, const ComputePipeline& reducePipeline, uint32_t frame, const glm::mat4& viewProjection, bool copyReadback)
+{
+	// The command buffer of the frame finished before it is recorded again, so its readback is complete
+	if (frame >= m_readbacks.size()) {
+		m_readbacks.resize(frame + 1);
+	}
+	Readback& readback = m_readbacks[frame];
+	const VkExtent2D& readbackSize = m_levelSizes[m_readbackLevel];
+	if (!copyReadback) {
+		// Nothing to create or read, the readback of the frame is recorded by another build
+	}
+	else if (readback.buffer == VK_NULL_HANDLE) {
+		VkDeviceSize readbackBytes = sizeof(float) * static_cast<VkDeviceSize>(readbackSize.width) * readbackSize.height;
+		createBuffer(physicalDevice,
+			device,
+			readbackBytes,
+			VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			&readback.buffer,
+			&readback.memory);
+		vkMapMemory(device, readback.memory, 0, readbackBytes, 0, &readback.mapped);
+	}
+	else if (readback.written) {
+		this->updateCpuLevels(readback);
+	}
+
+	// The culling and the readback of the previous build may still read the pyramid and its info, its levels are overwritten
+	VkMemoryBarrier rebuildBarrier = {};
+	rebuildBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	rebuildBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+	rebuildBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0, 1, &rebuildBarrier, 0, nullptr, 0, nullptr);
+
+	DepthPyramidInfo info;
+	info.viewProjection = viewProjection;
+	info.size = glm::vec4(static_cast<float>(m_levelSizes[0].width), static_cast<float>(m_levelSizes[0].height), static_cast<float>(m_levelSizes.size()), 1.0f);
+	vkCmdUpdateBuffer(commandBuffer, m_infoBuffer, 0, sizeof(DepthPyramidInfo), &info);
+
+	VkMemoryBarrier infoBarrier = {};
+	infoBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	infoBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	infoBarrier.dstAccessMask = VK_ACCESS_UNIFORM_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &infoBarrier, 0, nullptr, 0, nullptr);
+
+	// Every level waits for the level before, the last one for the culling shader and the readback
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, reducePipeline.pipeline);
+	for (size_t level = 0; level < m_levelSizes.size(); level++) {
+		DepthReduceConstants constants;
+		const VkExtent2D& sourceSize = level == 0 ? m_levelSizes[0] : m_levelSizes[level - 1];
+		constants.sourceSize = glm::ivec2(sourceSize.width, sourceSize.height);
+		constants.destinationSize = glm::ivec2(m_levelSizes[level].width, m_levelSizes[level].height);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, reducePipeline.getPipelineLayout(), 0, 1, &m_reduceDescriptorSets[level], 0, nullptr);
+		vkCmdPushConstants(commandBuffer, reducePipeline.getPipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(DepthReduceConstants), &constants);
+		vkCmdDispatch(commandBuffer, (m_levelSizes[level].width + 7) / 8, (m_levelSizes[level].height + 7) / 8, 1);
+
+		VkMemoryBarrier levelBarrier = {};
+		levelBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		levelBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		levelBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &levelBarrier, 0, nullptr, 0, nullptr);
+	}
+
+	if (!copyReadback) {
+		return;
+	}
+
+	// Copy the small level for the CPU test
+	VkBufferImageCopy region = {};
+	region.bufferOffset = 0;
+	region.bufferRowLength = 0;
+	region.bufferImageHeight = 0;
+	region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, m_readbackLevel, 0, 1 };
+	region.imageOffset = { 0, 0, 0 };
+	region.imageExtent = { readbackSize.width, readbackSize.height, 1 };
+	vkCmdCopyImageToBuffer(commandBuffer, m_image, VK_IMAGE_LAYOUT_GENERAL, readback.buffer, 1, &region);
+
+	VkMemoryBarrier readbackBarrier = {};
+	readbackBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	readbackBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	readbackBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &readbackBarrier, 0, nullptr, 0, nullptr);
+
+	readback.viewProjection = viewProjection;
+	readback.written = true;
+}
+
+void DepthPyramid::updateCpuLevels(const Readback& readback)
+{
+	// Reduce the readback on the CPU the same way the shader reduces the levels
+	size_t cpuLevelCount = m_levelSizes.size() - m_readbackLevel;
+	m_cpuLevels.resize(cpuLevelCount);
+	const VkExtent2D& readbackSize = m_levelSizes[m_readbackLevel];
+	const float* data = static_cast<const float*>(readback.mapped);
+	m_cpuLevels[0].assign(data, data + static_cast<size_t>(readbackSize.width) * readbackSize.height);
+
+	for (size_t i = 1; i < cpuLevelCount; i++) {
+		const VkExtent2D& sourceSize = m_levelSizes[m_readbackLevel + i - 1];
+		const VkExtent2D& size = m_levelSizes[m_readbackLevel + i];
+		const std::vector<float>& source = m_cpuLevels[i - 1];
+		std::vector<float>& level = m_cpuLevels[i];
+		level.assign(static_cast<size_t>(size.width) * size.height, 0.0f);
+		for (uint32_t y = 0; y < size.height; y++) {
+			// The last texel of an odd sized level also covers the remaining row or column
+			uint32_t firstY = sourceSize.height == size.height ? y : y * 2;
+			uint32_t lastY = y + 1 == size.height ? sourceSize.height - 1 : (sourceSize.height == size.height ? y : y * 2 + 1);
+			for (uint32_t x = 0; x < size.width; x++) {
+				uint32_t firstX = sourceSize.width == size.width ? x : x * 2;
+				uint32_t lastX = x + 1 == size.width ? sourceSize.width - 1 : (sourceSize.width == size.width ? x : x * 2 + 1);
+				float maxDepth = 0.0f;
+				for (uint32_t sy = firstY; sy <= lastY; sy++) {
+					for (uint32_t sx = firstX; sx <= lastX; sx++) {
+						maxDepth = std::max(maxDepth, source[sy * sourceSize.width + sx]);
+					}
+				}
+				level[y * size.width + x] = maxDepth;
+			}
+		}
+	}
+	m_cpuViewProjection = readback.viewProjection;
+	m_cpuValid = true;
+}
+
+float DepthPyramid::getMaxDepth(const glm::vec2& uvMin, const glm::vec2& uvMax) const
+{
+	// Texel i of a level covers the texels i << level of the first level, the last texel also covers the rest
+	glm::ivec2 size(static_cast<int>(m_levelSizes[0].width), static_cast<int>(m_levelSizes[0].height));
+	glm::ivec2 pixelMin = glm::clamp(glm::ivec2(uvMin * glm::vec2(size)), glm::ivec2(0), size - 1);
+	glm::ivec2 pixelMax = glm::clamp(glm::ivec2(uvMax * glm::vec2(size)), glm::ivec2(0), size - 1);
+	uint32_t level = m_readbackLevel;
+	while (level + 1 < m_levelSizes.size() && ((pixelMax.x >> level) - (pixelMin.x >> level) > 1 || (pixelMax.y >> level) - (pixelMin.y >> level) > 1)) {
+		level++;
+	}
+
+	const VkExtent2D& levelSize = m_levelSizes[level];
+	const std::vector<float>& depth = m_cpuLevels[level - m_readbackLevel];
+	int lastX = static_cast<int>(levelSize.width) - 1;
+	int lastY = static_cast<int>(levelSize.height) - 1;
+	float maxDepth = 0.0f;
+	for (int y = std::min(pixelMin.y >> level, lastY); y <= std::min(pixelMax.y >> level, lastY); y++) {
+		for (int x = std::min(pixelMin.x >> level, lastX); x <= std::min(pixelMax.x >> level, lastX); x++) {
+			maxDepth = std::max(maxDepth, depth[y * levelSize.width + x]);
+		}
+	}
+	return maxDepth;
+}
+
+bool DepthPyramid::isOccluded(const AABB& bounds) const
+{
+	if (!m_cpuValid || !bounds.isValid()) {
+		return false;
+	}
+
+	// Project the corners with the view projection the depth was rendered with
+	glm::vec3 ndcMin(FLT_MAX);
+	glm::vec3 ndcMax(-FLT_MAX);
+	for (int i = 0; i < 8; i++) {
+		glm::vec3 corner((i & 1) ? bounds.max.x : bounds.min.x, (i & 2) ? bounds.max.y : bounds.min.y, (i & 4) ? bounds.max.z : bounds.min.z);
+		glm::vec4 clip = m_cpuViewProjection * glm::vec4(corner, 1.0f);
+		if (clip.w <= 0.0f) {
+			return false;
+		}
+		glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		ndcMin = glm::min(ndcMin, ndc);
+		ndcMax = glm::max(ndcMax, ndc);
+	}
+
+	// Nothing is known about boxes crossing the near plane or outside of the rendered view
+	if (ndcMin.z < 0.0f || ndcMax.x < -1.0f || ndcMin.x > 1.0f || ndcMax.y < -1.0f || ndcMin.y > 1.0f) {
+		return false;
+	}
+	glm::vec2 uvMin = glm::clamp(glm::vec2(ndcMin) * 0.5f + 0.5f, glm::vec2(0.0f), glm::vec2(1.0f));
+	glm::vec2 uvMax = glm::clamp(glm::vec2(ndcMax) * 0.5f + 0.5f, glm::vec2(0.0f), glm::vec2(1.0f));
+	return ndcMin.z > this->getMaxDepth(uvMin, uvMax);
+}
+
+void DepthPyramid::dispose(VkDevice device)
+{
+	for (Readback& readback : m_readbacks) {
+		if (readback.buffer != VK_NULL_HANDLE) {
+			vkUnmapMemory(device, readback.memory);
+			vkDestroyBuffer(device, readback.buffer, nullptr);
+			vkFreeMemory(device, readback.memory, nullptr);
+		}
+	}
+	m_readbacks.clear();
+	m_cpuLevels.clear();
+	m_cpuValid = false;
+
+	vkDestroyDescriptorPool(device, m_descriptorPool, nullptr);
+	vkDestroyBuffer(device, m_infoBuffer, nullptr);
+	vkFreeMemory(device, m_infoBufferMemory, nullptr);
+	vkDestroySampler(device, m_sampler, nullptr);
+	for (VkImageView view : m_levelViews) {
+		vkDestroyImageView(device, view, nullptr);
+	}
+	m_levelViews.clear();
+	vkDestroyImageView(device, m_pyramidView, nullptr);
+	vkDestroyImage(device, m_image, nullptr);
+	vkFreeMemory(device, m_imageMemory, nullptr);
+	this->state = GFX_BUFFER_STATE_DISPOSED;
+	std::cout << "[DEPTH PYRAMID] Depth pyramid disposed." << std::endl;
+}
@@ -0,0 +1,147 @@
+#pragma once
+#include "Buffer.h"
+#include "ComputePipeline.h"
+#include "../Math/AABB.h"
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// Uniform buffer of the depth pyramid read by the occlusion culling shader, matches DepthPyramidInfo of Shaders/cull.comp
+/// </summary>
+struct DepthPyramidInfo {
+	glm::mat4 viewProjection = glm::mat4(1.0f);	// The view projection the depth was rendered with
+	glm::vec4 size = glm::vec4(0.0f);			// xy = size of the first level, z = level count, w = 1 once the pyramid was built
+};
+
+/// <summary>
+/// Push constants of the depth reduction shader
+/// </summary>
+struct DepthReduceConstants {
+	glm::ivec2 sourceSize;
+	glm::ivec2 destinationSize;
+};
+
+/// <summary>
+/// Mip chain of the farthest depth of a render target, used to reject objects hidden behind the rendered geometry
+/// The first level copies the depth image, every further level halves the size and keeps the largest depth of the
+/// texels it covers. A box is occluded if its nearest depth is behind the largest depth of the texels it covers.
+/// A small level is copied back every frame, so entities can be tested on the CPU against the depth of a finished frame.
+/// </summary>
+class DepthPyramid : public Buffer
+{
+private:
+	/// <summary>
+	/// Copy of a level in host memory, written by the frame using the same frame index
+	/// </summary>
+	struct Readback {
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		void* mapped = nullptr;
+		glm::mat4 viewProjection = glm::mat4(1.0f);
+		bool written = false;
+	};
+
+	VkImage m_image = VK_NULL_HANDLE;
+	VkDeviceMemory m_imageMemory = VK_NULL_HANDLE;
+	VkImageView m_pyramidView = VK_NULL_HANDLE;
+	std::vector<VkImageView> m_levelViews;
+	std::vector<VkExtent2D> m_levelSizes;
+	VkSampler m_sampler = VK_NULL_HANDLE;
+
+	VkBuffer m_infoBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory m_infoBufferMemory = VK_NULL_HANDLE;
+
+	VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+	std::vector<VkDescriptorSet> m_reduceDescriptorSets;	// One per level, reads the level before or the depth image
+	VkDescriptorSet m_descriptorSet = VK_NULL_HANDLE;		// The whole pyramid and its info for the culling shader
+
+	/// <summary>
+	/// The level copied back for the CPU test, the first level not larger than READBACK_SIZE
+	/// </summary>
+	uint32_t m_readbackLevel = 0;
+	std::vector<Readback> m_readbacks;
+
+	/// <summary>
+	/// The levels of the last finished readback, m_cpuLevels[0] is m_readbackLevel
+	/// </summary>
+	std::vector<std::vector<float>> m_cpuLevels;
+	glm::mat4 m_cpuViewProjection = glm::mat4(1.0f);
+	bool m_cpuValid = false;
+
+	/// <summary>
+	/// Copies a finished readback and reduces it to the coarser levels
+	/// </summary>
+	/// <param name="readback"></param>
+	void updateCpuLevels(const Readback& readback);
+
+	/// <summary>
+	/// Selects the level where the texel range of the rectangle is at most two texels wide and returns the largest depth in it
+	/// </summary>
+	/// <param name="uvMin"></param>
+	/// <param name="uvMax"></param>
+	/// <returns></returns>
+	float getMaxDepth(const glm::vec2& uvMin, const glm::vec2& uvMax) const;
+
+public:
+	static constexpr uint32_t READBACK_SIZE = 128;
+
+	/// <summary>
+	/// The render target whose depth image is reduced
+	/// </summary>
+	int renderTargetIndex = -1;
+
+	/// <summary>
+	/// Creates the pyramid for a depth image
+	/// The depth image has to be in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL when the pyramid is built.
+	/// </summary>
+	/// <param name="physicalDevice"></param>
+	/// <param name="device"></param>
+	/// <param name="transferQueue"></param>
+	/// <param name="transferCommandPool"></param>
+	/// <param name="depthImageView">View of the depth aspect of the depth image</param>
+	/// <param name="extent">Size of the depth image</param>
+	/// <param name="reduceSetLayout">Sampler at binding 0 and storage image at binding 1</param>
+	/// <param name="pyramidSetLayout">Sampler at binding 0 and uniform buffer at binding 1</param>
+	DepthPyramid(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue transferQueue, VkCommandPool transferCommandPool, VkImageView depthImageView, VkExtent2D extent, VkDescriptorSetLayout reduceSetLayout, VkDescriptorSetLayout pyramidSetLayout);
+
+	/// <summary>
+	/// Records the reduction of the depth image and the readback for the frame, call it outside of render passes
+	/// </summary>
+	/// <param name="physicalDevice">Creates the readback buffer of new frame indices</param>
+	/// <param name="device"></param>
+	/// <param name="commandBuffer"></param>
+	/// <param name="reducePipeline"></param>
+	/// <param name="frame">Index of the command buffer, its readback is read once the command buffer is recorded again</param>
+	/// <param name="viewProjection">The view projection the depth image was rendered with</param>
+	/// <param name="copyReadback">false skips the readback, e.g. for a pyramid of a partly rendered frame</param>
+	void build(VkPhysicalDevice physicalDevice, VkDevice device, VkCommandBuffer commandBuffer, const ComputePipeline& reducePipeline, uint32_t frame, const glm::mat4& viewProjection, bool copyReadback = true);
+
+	/// <summary>
+	/// Checks if a box is hidden behind the depth of the last finished readback
+	/// Boxes reaching behind the camera or out of the view are never occluded. Safe to call from parallel updates.
+	/// </summary>
+	/// <param name="bounds">World space bounds</param>
+	/// <returns>false as long as no readback finished</returns>
+	bool isOccluded(const AABB& bounds) const;
+
+	/// <summary>
+	/// Returns the descriptor set of the whole pyramid and its info for the culling shader
+	/// </summary>
+	/// <returns></returns>
+	VkDescriptorSet getDescriptorSet() const {
+		return m_descriptorSet;
+	}
+
+	/// <summary>
+	/// Returns the number of levels
+	/// </summary>
+	/// <returns></returns>
+	uint32_t getLevelCount() const {
+		return static_cast<uint32_t>(m_levelSizes.size());
+	}
+
+	void dispose(VkDevice device) override;
+};
@@ -3,6 +3,7 @@
 #include <GLFW/glfw3.h>
 #include <string>
 #include <map>
+#include <memory>
 #include "FontAtlas.h"
 
 
@@ -11,18 +12,27 @@ class Font
 private:
 	int m_textureBufferIndex;
 
-	FontAtlas m_fontAtlas;
+	std::shared_ptr<FontAtlas> m_fontAtlas;
 	std::string m_fontName;
 	int m_fontSize;
 public:
 	
-	Font(const std::string& fontPath, int fontSize, int textureIndex, const FontAtlas fontAtlas) :
-		m_textureBufferIndex(textureIndex), m_fontSize(fontSize),	m_fontName(fontPath), m_fontAtlas(fontAtlas) {}
+	Font(const std::string& fontPath, int fontSize, int textureIndex, std::shared_ptr<FontAtlas> fontAtlas) :
+		m_textureBufferIndex(textureIndex), m_fontSize(fontSize),	m_fontName(fontPath), m_fontAtlas(std::move(fontAtlas)) {}
 
 	void dispose(VkDevice device);
 	int getTextureBufferIndex() const { return m_textureBufferIndex; }
-	const FontAtlas& getFontAtlas() const { return m_fontAtlas; }
+	const FontAtlas& getFontAtlas() const { return *m_fontAtlas; }
+	FontAtlas& getFontAtlas() { return *m_fontAtlas; }
+	const std::shared_ptr<FontAtlas>& getSharedFontAtlas() const { return m_fontAtlas; }
 	const std::string& getFontName() const { return m_fontName; }
 	int getFontSize() const { return m_fontSize; }
+
+	/// <summary>
+	/// Returns the factor from the atlas metrics to the font size
+	/// 1 for bitmap atlases, distance field atlases are rasterized at one size for all fonts using them.
+	/// </summary>
+	/// <returns></returns>
+	float getMetricScale() const { return static_cast<float>(m_fontSize) / m_fontAtlas->pixelSize; }
 };
 
@@ -1,126 +1,360 @@
 #include "FontAtlas.h"
+#include "../Utils.h"
+#include <freetype/ftmodapi.h>
 #include <stdexcept>
 #include <iostream>
 #include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 
-bool FontAtlas::loadFont(const std::string& fontPath, int fontSize) {
-	FT_Library ft;
-	if (FT_Init_FreeType(&ft)) {
-		std::cerr << "[FONT ERROR]: Could not init FreeType Library" << std::endl;
-		return false;
+namespace {
+	constexpr uint32_t CACHE_MAGIC = 0x46584647;	// "GFXF"
+	constexpr uint32_t CACHE_VERSION = 1;
+	constexpr uint32_t MAX_ATLAS_SIZE = 8192;
+
+	/// <summary>
+	/// Header of an atlas cache file, followed by the shelves, the characters and the pixels
+	/// </summary>
+	struct FontAtlasCacheHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint64_t fontFileSize;
+		int64_t fontWriteTime;	// A changed font file invalidates the cache
+		int32_t type;
+		int32_t pixelSize;
+		int32_t spread;
+		uint32_t atlasWidth;
+		uint32_t atlasHeight;
+		uint32_t shelfCount;
+		uint32_t characterCount;
+	};
+
+	bool getFontFileStamp(const std::string& fontPath, uint64_t& size, int64_t& writeTime)
+	{
+		std::error_code error;
+		size = std::filesystem::file_size(fontPath, error);
+		if (error) return false;
+		auto time = std::filesystem::last_write_time(fontPath, error);
+		if (error) return false;
+		writeTime = static_cast<int64_t>(time.time_since_epoch().count());
+		return true;
+	}
+}
+
+struct FontAtlas::FontFace {
+	FT_Library library = nullptr;
+	FT_Face face = nullptr;
+
+	~FontFace() {
+		if (face != nullptr) FT_Done_Face(face);
+		if (library != nullptr) FT_Done_FreeType(library);
+	}
+};
+
+bool FontAtlas::loadFont(const std::string& fontPath, int fontSize, FontAtlasType atlasType, const std::string& cachePath) {
+	m_fontPath = fontPath;
+	m_face.reset();
+	m_faceFailed = false;
+	m_full = false;
+	m_hasDirtyRegion = false;
+	type = atlasType;
+	pixelSize = fontSize;
+	spread = atlasType == FontAtlasType::SDF ? SDF_SPREAD : 0;
+	m_cachePath = cachePath;
+	if (m_cachePath.empty()) {
+		m_cachePath = fontPath + (atlasType == FontAtlasType::SDF ? ".sdf" : ".bitmap") + std::to_string(fontSize) + ".cache";
 	}
 
-	FT_Face face;
-	if (FT_New_Face(ft, fontPath.c_str(), 0, &face)) {
-		std::cerr << "[FONT ERROR]: Failed to load font: " << fontPath << std::endl;
-		FT_Done_FreeType(ft);
+	// A cache of the unchanged font file skips the rasterization
+	if (this->loadCache()) {
+		std::cout << "[FONT]: Loaded atlas " << atlasWidth << "x" << atlasHeight << " with " << characters.size()
+			<< " characters from " << m_cachePath << std::endl;
+		this->buildGlyphTable();
+		return true;
+	}
+
+	if (!this->openFace()) {
 		return false;
 	}
 
-	FT_Set_Pixel_Sizes(face, 0, fontSize);
+	// Room for GLYPHS_PER_ROW * GLYPH_ROWS glyphs of the font size, ASCII takes less than half of it
+	uint32_t cellSize = static_cast<uint32_t>(fontSize + 2 * spread) + 2 * GLYPH_PADDING;
+	atlasWidth = nextPowerOfTwo(GLYPHS_PER_ROW * cellSize);
+	atlasHeight = nextPowerOfTwo(GLYPH_ROWS * cellSize);
+	pixelData.assign(atlasWidth * atlasHeight, 0);
+	characters.clear();
+	m_shelves.clear();
+	this->buildGlyphTable();
 
-	// Erster Pass: Finde maximale Glyph-Gre
-	uint32_t maxGlyphWidth = 0;
-	uint32_t maxGlyphHeight = 0;
+	std::cout << "[FONT]: Creating " << (atlasType == FontAtlasType::SDF ? "distance field " : "") << "atlas "
+		<< atlasWidth << "x" << atlasHeight << std::endl;
 
-	for (unsigned char c = 32; c < 128; c++) {
-		if (FT_Load_Char(face, c, FT_LOAD_RENDER)) {
-			continue;
-		}
-		maxGlyphWidth = std::max(maxGlyphWidth, face->glyph->bitmap.width);
-		maxGlyphHeight = std::max(maxGlyphHeight, face->glyph->bitmap.rows);
+	for (uint32_t c = 32; c < 128; c++) {
+		this->addGlyph(c);
 	}
 
-	// Padding zwischen Glyphen
-	const uint32_t padding = 2;
-	uint32_t cellWidth = maxGlyphWidth + padding;
-	uint32_t cellHeight = maxGlyphHeight + padding;
+	// The texture is created from the whole atlas
+	m_hasDirtyRegion = false;
+	std::cout << "[FONT]: Loaded " << characters.size() << " characters" << std::endl;
+
+	this->saveCache();
+	return true;
+}
+
+bool FontAtlas::openFace()
+{
+	if (m_face != nullptr) return true;
+	if (m_faceFailed) return false;
+	m_faceFailed = true;
+
+	auto fontFace = std::make_shared<FontFace>();
+	if (FT_Init_FreeType(&fontFace->library)) {
+		std::cerr << "[FONT ERROR]: Could not init FreeType Library" << std::endl;
+		return false;
+	}
 
-	// Grid-Layout berechnen (z.B. 16x6 fr 96 Zeichen)
-	const uint32_t glyphsPerRow = 16;
-	const uint32_t numGlyphs = 96; // ASCII 32-127
-	const uint32_t numRows = (numGlyphs + glyphsPerRow - 1) / glyphsPerRow;
+	if (FT_New_Face(fontFace->library, m_fontPath.c_str(), 0, &fontFace->face)) {
+		std::cerr << "[FONT ERROR]: Failed to load font: " << m_fontPath << std::endl;
+		return false;
+	}
 
-	atlasWidth = nextPowerOfTwo(glyphsPerRow * cellWidth);
-	atlasHeight = nextPowerOfTwo(numRows * cellHeight);
+	FT_Set_Pixel_Sizes(fontFace->face, 0, pixelSize);
 
-	std::cout << "[FONT]: Creating atlas " << atlasWidth << "x" << atlasHeight << std::endl;
-	std::cout << "[FONT]: Grid: " << glyphsPerRow << "x" << numRows
-		<< " (Cell: " << cellWidth << "x" << cellHeight << ")" << std::endl;
-	std::cout << "[FONT]: Max glyph: " << maxGlyphWidth << "x" << maxGlyphHeight << std::endl;
+	// The outline and the bitmap based distance field renderers
+	if (type == FontAtlasType::SDF) {
+		FT_Int sdfSpread = spread;
+		FT_Property_Set(fontFace->library, "sdf", "spread", &sdfSpread);
+		FT_Property_Set(fontFace->library, "bsdf", "spread", &sdfSpread);
+	}
 
-	// Atlas Buffer erstellen
-	pixelData.resize(atlasWidth * atlasHeight, 0);
+	m_face = fontFace;
+	m_faceFailed = false;
+	return true;
+}
 
-	// Zweiter Pass: Glyphen in Grid kopieren
-	uint32_t currentGlyph = 0;
+bool FontAtlas::addGlyph(uint32_t codepoint)
+{
+	if (characters.find(codepoint) != characters.end()) return true;
+	if (m_full || !this->openFace()) return false;
 
-	for (unsigned char c = 32; c < 128; c++) {
-		if (FT_Load_Char(face, c, FT_LOAD_RENDER)) {
-			std::cerr << "[FONT WARNING]: Failed to load char '" << c << "'" << std::endl;
-			continue;
-		}
+	FT_Face face = m_face->face;
+	FT_GlyphSlot g = face->glyph;
+	FT_Render_Mode renderMode = type == FontAtlasType::SDF ? FT_RENDER_MODE_SDF : FT_RENDER_MODE_NORMAL;
 
-		FT_GlyphSlot g = face->glyph;
-		FT_Bitmap& bitmap = g->bitmap;
+	// Glyphs without contours, like spaces, only advance
+	bool loaded = FT_Load_Glyph(face, FT_Get_Char_Index(face, codepoint), FT_LOAD_DEFAULT) == 0;
+	bool hasBitmap = loaded && (g->format != FT_GLYPH_FORMAT_OUTLINE || g->outline.n_contours > 0);
+	if (hasBitmap && FT_Render_Glyph(g, renderMode)) {
+		loaded = false;
+	}
+	if (!loaded) {
+		std::cerr << "[FONT WARNING]: Failed to load glyph U+" << std::hex << codepoint << std::dec << std::endl;
+		this->setCharacter(codepoint, Character{});
+		return false;
+	}
 
-		// Berechne Grid-Position
-		uint32_t gridX = currentGlyph % glyphsPerRow;
-		uint32_t gridY = currentGlyph / glyphsPerRow;
+	FT_Bitmap& bitmap = g->bitmap;
+	Character character = {};
+	character.bearingX = g->bitmap_left;
+	character.bearingY = g->bitmap_top;
+	character.advance = g->advance.x >> 6;
 
-		uint32_t offsetX = gridX * cellWidth;
-		uint32_t offsetY = gridY * cellHeight;
+	if (hasBitmap && bitmap.width > 0 && bitmap.rows > 0) {
+		uint32_t x, y;
+		if (!this->packGlyph(bitmap.width + 2 * GLYPH_PADDING, bitmap.rows + 2 * GLYPH_PADDING, x, y)) {
+			if (!m_full) {
+				std::cerr << "[FONT WARNING]: Atlas of " << m_fontPath << " is full, further glyphs are skipped" << std::endl;
+				m_full = true;
+			}
+			return false;
+		}
+		x += GLYPH_PADDING;
+		y += GLYPH_PADDING;
 
-		// Kopiere Bitmap in Atlas
+		// Copy the bitmap into the atlas
+		uint32_t pitch = static_cast<uint32_t>(std::abs(bitmap.pitch));
 		for (uint32_t row = 0; row < bitmap.rows; row++) {
-			for (uint32_t col = 0; col < bitmap.width; col++) {
-				uint32_t atlasX = offsetX + col;
-				uint32_t atlasY = offsetY + row;
-				uint32_t atlasIndex = atlasY * atlasWidth + atlasX;
-				uint32_t bitmapIndex = row * bitmap.width + col;
-
-				if (atlasIndex < pixelData.size()) {
-					pixelData[atlasIndex] = bitmap.buffer[bitmapIndex];
-				}
-			}
+			std::memcpy(&pixelData[(y + row) * atlasWidth + x], bitmap.buffer + row * pitch, bitmap.width);
 		}
 
-		// Speichere Character Info
-		Character character;
-		character.uvX = (float)offsetX / atlasWidth;
-		character.uvY = (float)offsetY / atlasHeight;
+		// Grow the region uploaded with the next takeDirtyRegion
+		if (m_hasDirtyRegion) {
+			uint32_t right = std::max(m_dirtyRegion.x + m_dirtyRegion.width, x + bitmap.width);
+			uint32_t bottom = std::max(m_dirtyRegion.y + m_dirtyRegion.height, y + bitmap.rows);
+			m_dirtyRegion.x = std::min(m_dirtyRegion.x, x);
+			m_dirtyRegion.y = std::min(m_dirtyRegion.y, y);
+			m_dirtyRegion.width = right - m_dirtyRegion.x;
+			m_dirtyRegion.height = bottom - m_dirtyRegion.y;
+		}
+		else {
+			m_dirtyRegion = { x, y, bitmap.width, bitmap.rows };
+			m_hasDirtyRegion = true;
+		}
+
+		character.uvX = (float)x / atlasWidth;
+		character.uvY = (float)y / atlasHeight;
 		character.uvWidth = (float)bitmap.width / atlasWidth;
 		character.uvHeight = (float)bitmap.rows / atlasHeight;
 		character.width = bitmap.width;
 		character.height = bitmap.rows;
-		character.bearingX = g->bitmap_left;
-		character.bearingY = g->bitmap_top;
-		character.advance = g->advance.x >> 6;
+	}
 
-		characters[c] = character;
-		currentGlyph++;
+	this->setCharacter(codepoint, character);
+	return true;
+}
+
+void FontAtlas::addGlyphs(const std::string& text)
+{
+	for (size_t offset = 0; offset < text.size();) {
+		uint32_t codepoint = decodeUtf8(text, offset);
+		if (codepoint == '\n' || this->findCharacter(codepoint) != nullptr) continue;
+		this->addGlyph(codepoint);
 	}
+}
 
-	std::cout << "[FONT]: Loaded " << characters.size() << " characters" << std::endl;
+bool FontAtlas::packGlyph(uint32_t width, uint32_t height, uint32_t& x, uint32_t& y)
+{
+	// The lowest shelf the glyph fits on wastes the least height
+	Shelf* shelf = nullptr;
+	for (Shelf& candidate : m_shelves) {
+		if (candidate.height >= height && candidate.width + width <= atlasWidth && (shelf == nullptr || candidate.height < shelf->height)) {
+			shelf = &candidate;
+		}
+	}
+
+	// Open a new shelf below the last one
+	if (shelf == nullptr) {
+		uint32_t top = m_shelves.empty() ? 0 : m_shelves.back().y + m_shelves.back().height;
+		if (width > atlasWidth || top + height > atlasHeight) {
+			return false;
+		}
+		m_shelves.push_back({ top, height, 0 });
+		shelf = &m_shelves.back();
+	}
+
+	x = shelf->width;
+	y = shelf->y;
+	shelf->width += width;
+	return true;
+}
 
-	// Debug: berprfe Atlas
-	int nonZeroPixels = 0;
-	for (auto pixel : pixelData) {
-		if (pixel > 0) nonZeroPixels++;
+void FontAtlas::setCharacter(uint32_t codepoint, const Character& character)
+{
+	characters[codepoint] = character;
+	if (codepoint < m_glyphTable.size()) {
+		m_glyphTable[codepoint] = character;
+		m_hasGlyph[codepoint] = true;
 	}
-	std::cout << "[FONT]: Non-zero pixels: " << nonZeroPixels
-		<< " (" << (100.0f * nonZeroPixels / pixelData.size()) << "%)" << std::endl;
+	m_cacheDirty = true;
+}
+
+bool FontAtlas::takeDirtyRegion(AtlasRegion& region)
+{
+	if (!m_hasDirtyRegion) return false;
+	region = m_dirtyRegion;
+	m_hasDirtyRegion = false;
+	return true;
+}
 
-	// Debug: Zeige ein paar Characters
-	if (characters.find('A') != characters.end()) {
-		const Character& ch = characters['A'];
-		std::cout << "[FONT]: Character 'A' - UV: (" << ch.uvX << ", " << ch.uvY
-			<< ") Size: " << ch.uvWidth << "x" << ch.uvHeight
-			<< " Pixels: " << ch.width << "x" << ch.height << std::endl;
+bool FontAtlas::loadCache()
+{
+	std::ifstream file(m_cachePath, std::ios::binary);
+	if (!file) return false;
+
+	FontAtlasCacheHeader header = {};
+	uint64_t fontFileSize;
+	int64_t fontWriteTime;
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))
+		|| !getFontFileStamp(m_fontPath, fontFileSize, fontWriteTime)
+		|| header.magic != CACHE_MAGIC
+		|| header.version != CACHE_VERSION
+		|| header.fontFileSize != fontFileSize
+		|| header.fontWriteTime != fontWriteTime
+		|| header.type != static_cast<int32_t>(type)
+		|| header.pixelSize != pixelSize
+		|| header.spread != spread
+		|| header.atlasWidth == 0 || header.atlasWidth > MAX_ATLAS_SIZE
+		|| header.atlasHeight == 0 || header.atlasHeight > MAX_ATLAS_SIZE) {
+		return false;
 	}
 
-	FT_Done_Face(face);
-	FT_Done_FreeType(ft);
+	atlasWidth = header.atlasWidth;
+	atlasHeight = header.atlasHeight;
+	m_shelves.resize(header.shelfCount);
+	file.read(reinterpret_cast<char*>(m_shelves.data()), sizeof(Shelf) * m_shelves.size());
 
+	characters.clear();
+	characters.reserve(header.characterCount);
+	for (uint32_t i = 0; i < header.characterCount && file; i++) {
+		uint32_t codepoint;
+		Character character;
+		file.read(reinterpret_cast<char*>(&codepoint), sizeof(codepoint));
+		file.read(reinterpret_cast<char*>(&character), sizeof(character));
+		characters[codepoint] = character;
+	}
+
+	pixelData.resize(atlasWidth * atlasHeight);
+	file.read(reinterpret_cast<char*>(pixelData.data()), pixelData.size());
+	if (!file) {
+		std::cerr << "[FONT WARNING]: Atlas cache " << m_cachePath << " is truncated" << std::endl;
+		characters.clear();
+		m_shelves.clear();
+		pixelData.clear();
+		return false;
+	}
+
+	m_cacheDirty = false;
 	return true;
+}
+
+bool FontAtlas::saveCache()
+{
+	if (!m_cacheDirty) return true;
+
+	FontAtlasCacheHeader header = {};
+	if (!getFontFileStamp(m_fontPath, header.fontFileSize, header.fontWriteTime)) {
+		return false;
+	}
+	header.magic = CACHE_MAGIC;
+	header.version = CACHE_VERSION;
+	header.type = static_cast<int32_t>(type);
+	header.pixelSize = pixelSize;
+	header.spread = spread;
+	header.atlasWidth = atlasWidth;
+	header.atlasHeight = atlasHeight;
+	header.shelfCount = static_cast<uint32_t>(m_shelves.size());
+	header.characterCount = static_cast<uint32_t>(characters.size());
+
+	std::ofstream file(m_cachePath, std::ios::binary | std::ios::trunc);
+	if (!file) {
+		std::cerr << "[FONT WARNING]: Could not write atlas cache " << m_cachePath << std::endl;
+		return false;
+	}
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(m_shelves.data()), sizeof(Shelf) * m_shelves.size());
+	for (const auto& [codepoint, character] : characters) {
+		file.write(reinterpret_cast<const char*>(&codepoint), sizeof(codepoint));
+		file.write(reinterpret_cast<const char*>(&character), sizeof(character));
+	}
+	file.write(reinterpret_cast<const char*>(pixelData.data()), pixelData.size());
+	if (!file) {
+		std::cerr << "[FONT WARNING]: Could not write atlas cache " << m_cachePath << std::endl;
+		return false;
+	}
+
+	m_cacheDirty = false;
+	return true;
+}
+
+void FontAtlas::buildGlyphTable()
+{
+	m_hasGlyph.fill(false);
+	for (const auto& [codepoint, character] : characters) {
+		if (codepoint < m_glyphTable.size()) {
+			m_glyphTable[codepoint] = character;
+			m_hasGlyph[codepoint] = true;
+		}
+	}
 }
\ No newline at end of file
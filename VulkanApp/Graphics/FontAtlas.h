@@ -3,6 +3,9 @@
 #include <string>
 #include <map>
 #include <vector>
+#include <array>
+#include <memory>
+#include <unordered_map>
 
 struct Character {
 	float uvX, uvY;              // UV coordinates in the atlas (0.0 - 1.0)
@@ -12,6 +15,24 @@ struct Character {
 	uint32_t width, height;      // Pixel size (fr Debugging)
 };
 
+/// <summary>
+/// Content of the atlas texture
+/// </summary>
+enum class FontAtlasType {
+	BITMAP,		// Coverage of the glyphs at the font size
+	SDF			// Signed distance to the glyph outlines, one atlas renders every font size, drawn with Shaders/text_sdf_frag.spv
+};
+
+/// <summary>
+/// Rectangle of the atlas in pixels
+/// </summary>
+struct AtlasRegion {
+	uint32_t x = 0;
+	uint32_t y = 0;
+	uint32_t width = 0;
+	uint32_t height = 0;
+};
+
 class FontAtlas {
 private:
 	uint32_t nextPowerOfTwo(uint32_t n) {
@@ -26,14 +47,121 @@ private:
 		return n;
 	}
 
+	/// <summary>
+	/// Row of the shelf packer, glyphs are appended from left to right
+	/// </summary>
+	struct Shelf {
+		uint32_t y;
+		uint32_t height;
+		uint32_t width;	// Used width
+	};
+
+	/// <summary>
+	/// FreeType library and face, opened for the first glyph that is not in the atlas
+	/// </summary>
+	struct FontFace;
+
+	static constexpr uint32_t GLYPHS_PER_ROW = 16;
+	static constexpr uint32_t GLYPH_ROWS = 8;
+	static constexpr uint32_t GLYPH_PADDING = 1;	// Empty texels around every glyph, keeps linear filtering inside the glyph
+
+	std::shared_ptr<FontFace> m_face;
+	bool m_faceFailed = false;
+	std::string m_fontPath;
+	std::string m_cachePath;
+
+	std::vector<Shelf> m_shelves;
+	AtlasRegion m_dirtyRegion;
+	bool m_hasDirtyRegion = false;
+	bool m_full = false;
+	bool m_cacheDirty = false;
+
+	/// <summary>
+	/// Copy of the characters indexed by their byte, avoids the map lookups while laying out text
+	/// </summary>
+	std::array<Character, 256> m_glyphTable = {};
+	std::array<bool, 256> m_hasGlyph = {};
+
+	bool openFace();
+	bool packGlyph(uint32_t width, uint32_t height, uint32_t& x, uint32_t& y);
+	void setCharacter(uint32_t codepoint, const Character& character);
+	bool loadCache();
+
 public:
+	/// <summary>
+	/// Size the glyphs of distance field atlases are rasterized at
+	/// </summary>
+	static constexpr int SDF_PIXEL_SIZE = 48;
+
+	/// <summary>
+	/// Distance in atlas pixels covered by the distance field around the outlines
+	/// </summary>
+	static constexpr int SDF_SPREAD = 8;
+
 	FontAtlas() = default;
 	~FontAtlas() = default;
 
-	std::map<char, Character> characters;
+	std::unordered_map<uint32_t, Character> characters;
 	uint32_t atlasWidth;
 	uint32_t atlasHeight;
 	std::vector<unsigned char> pixelData;
+	FontAtlasType type = FontAtlasType::BITMAP;
+	int pixelSize = 0;
+	int spread = 0;
+
+	/// <summary>
+	/// Loads the atlas from its cache file or rasterizes ASCII 32-127 into a new one
+	/// The atlas leaves room for glyphs added later on, the cache is written for new atlases.
+	/// </summary>
+	/// <param name="fontPath"></param>
+	/// <param name="fontSize">Pixel size the glyphs are rasterized at</param>
+	/// <param name="atlasType"></param>
+	/// <param name="cachePath">Empty uses the font path with the type and size appended</param>
+	/// <returns></returns>
+	bool loadFont(const std::string& fontPath, int fontSize, FontAtlasType atlasType = FontAtlasType::BITMAP, const std::string& cachePath = "");
+
+	/// <summary>
+	/// Rasterizes a glyph into free space of the atlas and marks the space dirty
+	/// Glyphs that fail to load are stored without size, so they aren't retried.
+	/// </summary>
+	/// <param name="codepoint"></param>
+	/// <returns>false if the glyph failed to load or the atlas is full</returns>
+	bool addGlyph(uint32_t codepoint);
 
-	bool loadFont(const std::string& fontPath, int fontSize);
+	/// <summary>
+	/// Adds the glyphs of an UTF-8 text that are not in the atlas yet
+	/// </summary>
+	/// <param name="text"></param>
+	void addGlyphs(const std::string& text);
+
+	/// <summary>
+	/// Returns the bounds of the pixels changed since the last call
+	/// </summary>
+	/// <param name="region"></param>
+	/// <returns>false if no pixels changed</returns>
+	bool takeDirtyRegion(AtlasRegion& region);
+
+	/// <summary>
+	/// Writes the atlas and the metrics to the cache file if glyphs were added since it was read or written
+	/// </summary>
+	/// <returns></returns>
+	bool saveCache();
+
+	/// <summary>
+	/// Copies the characters into the lookup table, call it after changing the characters
+	/// </summary>
+	void buildGlyphTable();
+
+	/// <summary>
+	/// Returns the character of a code point
+	/// </summary>
+	/// <param name="codepoint"></param>
+	/// <returns>nullptr if the atlas has no glyph for it</returns>
+	const Character* findCharacter(uint32_t codepoint) const {
+		if (codepoint < m_glyphTable.size()) {
+			return m_hasGlyph[codepoint] ? &m_glyphTable[codepoint] : nullptr;
+		}
+		auto character = characters.find(codepoint);
+		return character != characters.end() ? &character->second : nullptr;
+	}
 };
\ No newline at end of file
@@ -0,0 +1,261 @@
+#include "GeometryPool.h"
+#include "../Utils.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+void GeometryPool::init(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue transferQueue, VkCommandPool transferCommandPool, uint32_t pageVertexCount, uint32_t pageIndexCount, uint32_t framesInFlight)
+{
+	if (pageVertexCount == 0 || pageIndexCount == 0) {
+		throw std::runtime_error("failed to init geometry pool: page sizes must be positive!");
+	}
+	m_physicalDevice = physicalDevice;
+	m_device = device;
+	m_transferQueue = transferQueue;
+	m_transferCommandPool = transferCommandPool;
+	m_pageVertexCount = pageVertexCount;
+	m_pageIndexCount = pageIndexCount;
+	m_framesInFlight = std::max(framesInFlight, 1u);
+}
+
+void GeometryPool::beginFrame()
+{
+	m_frame++;
+	this->releasePendingRanges();
+}
+
+int GeometryPool::createPage(uint32_t vertexCount, uint32_t indexCount)
+{
+	Page page;
+	page.vertexCapacity = std::max(vertexCount, m_pageVertexCount);
+	page.indexCapacity = std::max(indexCount, m_pageIndexCount);
+
+	// Storage usage lets compute passes read the geometry, e.g. for GPU culling
+	createBuffer(m_physicalDevice,
+		m_device,
+		sizeof(Vertex) * static_cast<VkDeviceSize>(page.vertexCapacity),
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		&page.vertexBuffer,
+		&page.vertexBufferMemory);
+	createBuffer(m_physicalDevice,
+		m_device,
+		sizeof(uint32_t) * static_cast<VkDeviceSize>(page.indexCapacity),
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		&page.indexBuffer,
+		&page.indexBufferMemory);
+	page.freeVertices.push_back({ 0, page.vertexCapacity });
+	page.freeIndices.push_back({ 0, page.indexCapacity });
+
+	std::cout << "[GEOMETRY POOL] Page created with " << page.vertexCapacity << " vertices and " << page.indexCapacity << " indices." << std::endl;
+	m_pages.push_back(std::move(page));
+	return static_cast<int>(m_pages.size()) - 1;
+}
+
+bool GeometryPool::takeBlock(std::vector<Block>& freeList, uint32_t size, uint32_t& offset)
+{
+	for (size_t i = 0; i < freeList.size(); i++) {
+		Block& block = freeList[i];
+		if (block.size < size) {
+			continue;
+		}
+		offset = block.offset;
+		block.offset += size;
+		block.size -= size;
+		if (block.size == 0) {
+			freeList.erase(freeList.begin() + i);
+		}
+		return true;
+	}
+	return false;
+}
+
+void GeometryPool::returnBlock(std::vector<Block>& freeList, Block block)
+{
+	if (block.size == 0) {
+		return;
+	}
+	auto it = std::lower_bound(freeList.begin(), freeList.end(), block.offset, [](const Block& a, uint32_t offset) {
+		return a.offset < offset;
+	});
+	it = freeList.insert(it, block);
+
+	// Merge with the following block, then with the previous one
+	auto next = it + 1;
+	if (next != freeList.end() && it->offset + it->size == next->offset) {
+		it->size += next->size;
+		freeList.erase(next);
+	}
+	if (it != freeList.begin()) {
+		auto previous = it - 1;
+		if (previous->offset + previous->size == it->offset) {
+			previous->size += it->size;
+			freeList.erase(it);
+		}
+	}
+}
+
+void GeometryPool::releasePendingRanges()
+{
+	// A range freed in frame F was last read by frame F, which has finished once frame F + framesInFlight began
+	size_t kept = 0;
+	for (const PendingRange& pending : m_pendingRanges) {
+		if (pending.frame + m_framesInFlight > m_frame) {
+			m_pendingRanges[kept++] = pending;
+			continue;
+		}
+		const GeometryRange& geometry = m_ranges[pending.range];
+		Page& page = m_pages[geometry.page];
+		if (geometry.ownsVertices) {
+			returnBlock(page.freeVertices, { geometry.vertexOffset, geometry.vertexCount });
+		}
+		returnBlock(page.freeIndices, { geometry.firstIndex, geometry.indexCount });
+		m_freeRanges.push_back(pending.range);
+	}
+	m_pendingRanges.resize(kept);
+}
+
+void GeometryPool::upload(VkBuffer buffer, VkDeviceSize offset, const void* data, VkDeviceSize size)
+{
+	if (size == 0) {
+		return;
+	}
+
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingBufferMemory;
+	createBuffer(m_physicalDevice,
+		m_device,
+		size,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		&stagingBuffer,
+		&stagingBufferMemory);
+
+	void* mapped;
+	vkMapMemory(m_device, stagingBufferMemory, 0, size, 0, &mapped);
+	memcpy(mapped, data, static_cast<size_t>(size));
+	vkUnmapMemory(m_device, stagingBufferMemory);
+
+	VkCommandBuffer transferCommandBuffer = beginCommandBuffer(m_device, m_transferCommandPool);
+	VkBufferCopy copyRegion = {};
+	copyRegion.srcOffset = 0;
+	copyRegion.dstOffset = offset;
+	copyRegion.size = size;
+	vkCmdCopyBuffer(transferCommandBuffer, stagingBuffer, buffer, 1, &copyRegion);
+	submitCommandBuffer(m_device, m_transferCommandPool, m_transferQueue, transferCommandBuffer);
+
+	vkDestroyBuffer(m_device, stagingBuffer, nullptr);
+	vkFreeMemory(m_device, stagingBufferMemory, nullptr);
+}
+
+int GeometryPool::allocate(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+{
+	return this->allocate(vertices, std::vector<const std::vector<uint32_t>*>{ &indices }).front();
+}
+
+std::vector<int> GeometryPool::allocate(const std::vector<Vertex>& vertices, const std::vector<const std::vector<uint32_t>*>& indexLists)
+{
+	if (m_device == VK_NULL_HANDLE) {
+		throw std::runtime_error("failed to allocate geometry: geometry pool is not initialized!");
+	}
+	if (indexLists.empty()) {
+		throw std::runtime_error("failed to allocate geometry: no index list given!");
+	}
+	uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+	uint32_t totalIndexCount = 0;
+	for (const auto* indices : indexLists) {
+		totalIndexCount += static_cast<uint32_t>(indices->size());
+	}
+
+	// The vertices and all index lists have to be in the same page, so a page only fits if all of them fit
+	int page = -1;
+	std::vector<uint32_t> offsets(indexLists.size() + 1);
+	auto fits = [&](int pageIndex) {
+		Page& candidate = m_pages[pageIndex];
+		if (!takeBlock(candidate.freeVertices, vertexCount, offsets[0])) {
+			return false;
+		}
+		for (size_t i = 0; i < indexLists.size(); i++) {
+			uint32_t indexCount = static_cast<uint32_t>(indexLists[i]->size());
+			if (!takeBlock(candidate.freeIndices, indexCount, offsets[i + 1])) {
+				returnBlock(candidate.freeVertices, { offsets[0], vertexCount });
+				for (size_t j = 0; j < i; j++) {
+					returnBlock(candidate.freeIndices, { offsets[j + 1], static_cast<uint32_t>(indexLists[j]->size()) });
+				}
+				return false;
+			}
+		}
+		page = pageIndex;
+		return true;
+	};
+
+	// Blocks still read by frames in flight are not free yet, a new page is created instead of waiting for them
+	bool found = false;
+	for (int i = 0; i < static_cast<int>(m_pages.size()) && !found; i++) {
+		found = fits(i);
+	}
+	if (!found) {
+		fits(this->createPage(vertexCount, totalIndexCount));
+	}
+
+	// The first range owns the vertices, the others draw them with their own indices
+	const Page& target = m_pages[page];
+	this->upload(target.vertexBuffer, sizeof(Vertex) * static_cast<VkDeviceSize>(offsets[0]), vertices.data(), sizeof(Vertex) * static_cast<VkDeviceSize>(vertexCount));
+	std::vector<int> ranges;
+	ranges.reserve(indexLists.size());
+	for (size_t i = 0; i < indexLists.size(); i++) {
+		const auto& indices = *indexLists[i];
+		GeometryRange range;
+		range.page = page;
+		range.vertexOffset = offsets[0];
+		range.vertexCount = vertexCount;
+		range.firstIndex = offsets[i + 1];
+		range.indexCount = static_cast<uint32_t>(indices.size());
+		range.ownsVertices = i == 0;
+		this->upload(target.indexBuffer, sizeof(uint32_t) * static_cast<VkDeviceSize>(range.firstIndex), indices.data(), sizeof(uint32_t) * static_cast<VkDeviceSize>(range.indexCount));
+
+		// Reuse the index of a released range
+		if (!m_freeRanges.empty()) {
+			m_ranges[m_freeRanges.back()] = range;
+			ranges.push_back(m_freeRanges.back());
+			m_freeRanges.pop_back();
+			continue;
+		}
+		m_ranges.push_back(range);
+		ranges.push_back(static_cast<int>(m_ranges.size()) - 1);
+	}
+	return ranges;
+}
+
+void GeometryPool::free(int range)
+{
+	if (range < 0 || range >= static_cast<int>(m_ranges.size()) || m_ranges[range].disposed) {
+		return;
+	}
+	m_ranges[range].disposed = true;
+	m_pendingRanges.push_back({ range, m_frame });
+}
+
+const GeometryRange& GeometryPool::getRange(int range) const
+{
+	if (range < 0 || range >= static_cast<int>(m_ranges.size())) {
+		throw std::runtime_error("failed to get geometry: range index out of bounds!");
+	}
+	return m_ranges[range];
+}
+
+void GeometryPool::dispose()
+{
+	for (Page& page : m_pages) {
+		vkDestroyBuffer(m_device, page.vertexBuffer, nullptr);
+		vkFreeMemory(m_device, page.vertexBufferMemory, nullptr);
+		vkDestroyBuffer(m_device, page.indexBuffer, nullptr);
+		vkFreeMemory(m_device, page.indexBufferMemory, nullptr);
+	}
+	m_pages.clear();
+	m_ranges.clear();
+	m_freeRanges.clear();
+	m_pendingRanges.clear();
+}
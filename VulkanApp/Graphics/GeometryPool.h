@@ -0,0 +1,198 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <cstdint>
+#include <vector>
+#include "VertexBuffer.h"
+
+/// <summary>
+/// The part of the geometry pool a mesh was sub-allocated in
+/// Drawn with vkCmdDrawIndexed(indexCount, instances, firstIndex, vertexOffset, firstInstance) after binding the page buffers.
+/// </summary>
+struct GeometryRange
+{
+	int page = -1;
+	uint32_t vertexOffset = 0;		// In vertices
+	uint32_t vertexCount = 0;
+	uint32_t firstIndex = 0;
+	uint32_t indexCount = 0;
+	bool ownsVertices = true;		// False if the range draws the vertices of another range, e.g. a generated LOD
+	bool disposed = false;
+};
+
+/// <summary>
+/// Large device local vertex and index buffers shared by all static meshes
+/// The buffers are split into pages, meshes are sub-allocated inside one page and freed ranges are reused through
+/// a free list. Draws of meshes in the same page only differ in their draw offsets, so the buffers are bound once per page.
+/// Freed ranges are held back until the frames in flight at the time of the free have finished, their blocks and
+/// range indices are reused afterwards.
+/// </summary>
+class GeometryPool
+{
+private:
+	/// <summary>
+	/// A free part of a page buffer, in vertices or indices
+	/// </summary>
+	struct Block {
+		uint32_t offset;
+		uint32_t size;
+	};
+
+	/// <summary>
+	/// A vertex and an index buffer with their free lists, sorted by offset
+	/// </summary>
+	struct Page {
+		VkBuffer vertexBuffer = VK_NULL_HANDLE;
+		VkDeviceMemory vertexBufferMemory = VK_NULL_HANDLE;
+		VkBuffer indexBuffer = VK_NULL_HANDLE;
+		VkDeviceMemory indexBufferMemory = VK_NULL_HANDLE;
+		uint32_t vertexCapacity = 0;
+		uint32_t indexCapacity = 0;
+		std::vector<Block> freeVertices;
+		std::vector<Block> freeIndices;
+	};
+
+	/// <summary>
+	/// A freed range that may still be read by frames in flight
+	/// </summary>
+	struct PendingRange {
+		int range;
+		uint64_t frame;		// The frame the range was freed in
+	};
+
+	VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+	VkDevice m_device = VK_NULL_HANDLE;
+	VkQueue m_transferQueue = VK_NULL_HANDLE;
+	VkCommandPool m_transferCommandPool = VK_NULL_HANDLE;
+	uint32_t m_pageVertexCount = 0;
+	uint32_t m_pageIndexCount = 0;
+	uint32_t m_framesInFlight = 1;
+	uint64_t m_frame = 0;
+
+	std::vector<Page> m_pages;
+	std::vector<GeometryRange> m_ranges;
+	std::vector<int> m_freeRanges;
+	std::vector<PendingRange> m_pendingRanges;
+
+	/// <summary>
+	/// Creates a page with at least the given capacities
+	/// </summary>
+	/// <param name="vertexCount"></param>
+	/// <param name="indexCount"></param>
+	/// <returns>The index of the page</returns>
+	int createPage(uint32_t vertexCount, uint32_t indexCount);
+
+	/// <summary>
+	/// Takes a block of the given size from a free list, first fit
+	/// </summary>
+	/// <param name="freeList"></param>
+	/// <param name="size"></param>
+	/// <param name="offset">Receives the offset of the block</param>
+	/// <returns>False if no free block is large enough</returns>
+	static bool takeBlock(std::vector<Block>& freeList, uint32_t size, uint32_t& offset);
+
+	/// <summary>
+	/// Returns a block to a free list and merges it with its neighbors
+	/// </summary>
+	/// <param name="freeList"></param>
+	/// <param name="block"></param>
+	static void returnBlock(std::vector<Block>& freeList, Block block);
+
+	/// <summary>
+	/// Moves the blocks of the pending ranges no frame in flight reads anymore into the free lists
+	/// </summary>
+	void releasePendingRanges();
+
+	/// <summary>
+	/// Copies data into a page buffer through a staging buffer
+	/// </summary>
+	/// <param name="buffer"></param>
+	/// <param name="offset">In bytes</param>
+	/// <param name="data"></param>
+	/// <param name="size">In bytes</param>
+	void upload(VkBuffer buffer, VkDeviceSize offset, const void* data, VkDeviceSize size);
+
+public:
+	GeometryPool() = default;
+	~GeometryPool() = default;
+
+	/// <summary>
+	/// Initializes the pool, the pages are created on demand
+	/// </summary>
+	/// <param name="physicalDevice"></param>
+	/// <param name="device"></param>
+	/// <param name="transferQueue"></param>
+	/// <param name="transferCommandPool"></param>
+	/// <param name="pageVertexCount">Vertex capacity of a page, larger meshes get a page of their own</param>
+	/// <param name="pageIndexCount">Index capacity of a page</param>
+	/// <param name="framesInFlight">Number of frames the renderer records ahead, freed ranges are reused after as many frames</param>
+	void init(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue transferQueue, VkCommandPool transferCommandPool, uint32_t pageVertexCount, uint32_t pageIndexCount, uint32_t framesInFlight);
+
+	/// <summary>
+	/// Starts a frame once the renderer waited for the oldest frame in flight, releases the ranges freed before it
+	/// </summary>
+	void beginFrame();
+
+	/// <summary>
+	/// Sub-allocates and uploads a mesh
+	/// </summary>
+	/// <param name="vertices"></param>
+	/// <param name="indices">Relative to the first vertex of the mesh</param>
+	/// <returns>The index of the range</returns>
+	int allocate(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+
+	/// <summary>
+	/// Sub-allocates and uploads vertices together with several index lists drawing them, e.g. a mesh and its LODs
+	/// The first range owns the vertices, free it after the others.
+	/// </summary>
+	/// <param name="vertices"></param>
+	/// <param name="indexLists">Relative to the first vertex, at least one</param>
+	/// <returns>The index of the range of each index list</returns>
+	std::vector<int> allocate(const std::vector<Vertex>& vertices, const std::vector<const std::vector<uint32_t>*>& indexLists);
+
+	/// <summary>
+	/// Frees a range, its blocks are reused once the frames in flight are done with them
+	/// The range index is handed out again afterwards, drop it after freeing.
+	/// </summary>
+	/// <param name="range"></param>
+	void free(int range);
+
+	/// <summary>
+	/// Returns a range
+	/// </summary>
+	/// <param name="range"></param>
+	/// <returns></returns>
+	const GeometryRange& getRange(int range) const;
+
+	/// <summary>
+	/// Returns the vertex buffer of a page
+	/// </summary>
+	/// <param name="page"></param>
+	/// <returns></returns>
+	VkBuffer getVertexBuffer(int page) const {
+		return m_pages[page].vertexBuffer;
+	}
+
+	/// <summary>
+	/// Returns the index buffer of a page
+	/// </summary>
+	/// <param name="page"></param>
+	/// <returns></returns>
+	VkBuffer getIndexBuffer(int page) const {
+		return m_pages[page].indexBuffer;
+	}
+
+	/// <summary>
+	/// Returns the number of pages
+	/// </summary>
+	/// <returns></returns>
+	size_t getPageCount() const {
+		return m_pages.size();
+	}
+
+	/// <summary>
+	/// Destroys all pages
+	/// </summary>
+	void dispose();
+};
+
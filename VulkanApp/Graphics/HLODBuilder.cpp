@@ -0,0 +1,167 @@
+#include "HLODBuilder.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+	/// <summary>
+	/// A clustering cell, vertices of different colors are kept apart so the colors don't mix
+	/// </summary>
+	struct ClusterKey {
+		int x;
+		int y;
+		int z;
+		uint32_t color;
+
+		bool operator==(const ClusterKey&) const = default;
+	};
+
+	struct ClusterKeyHash {
+		size_t operator()(const ClusterKey& key) const {
+			uint64_t h = static_cast<uint64_t>(static_cast<uint32_t>(key.x)) * 0x9E3779B97F4A7C15ull;
+			h ^= static_cast<uint64_t>(static_cast<uint32_t>(key.y)) * 0xC2B2AE3D27D4EB4Full;
+			h ^= static_cast<uint64_t>(static_cast<uint32_t>(key.z)) * 0x165667B19E3779F9ull;
+			h ^= static_cast<uint64_t>(key.color) * 0x27D4EB2F165667C5ull;
+			return static_cast<size_t>(h ^ (h >> 29));
+		}
+	};
+
+	struct Cluster {
+		glm::vec3 position = glm::vec3(0.0f);
+		glm::vec3 normal = glm::vec3(0.0f);
+		uint32_t color = 0;
+		uint32_t count = 0;
+	};
+}
+
+void HLODBuilder::addMesh(const HLODSourceMesh& mesh, const glm::mat4& worldMatrix)
+{
+	if (mesh.normals.size() != mesh.positions.size()) {
+		throw std::runtime_error("failed to add mesh to hlod builder: normal count doesn't match the position count!");
+	}
+
+	uint32_t color = this->findColor(mesh.baseColor);
+	uint32_t baseVertex = static_cast<uint32_t>(m_positions.size());
+	glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(worldMatrix)));
+	for (size_t i = 0; i < mesh.positions.size(); i++) {
+		m_positions.push_back(glm::vec3(worldMatrix * glm::vec4(mesh.positions[i], 1.0f)));
+		m_normals.push_back(normalMatrix * mesh.normals[i]);
+		m_colors.push_back(color);
+	}
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+		if (mesh.indices[i] >= mesh.positions.size() || mesh.indices[i + 1] >= mesh.positions.size() || mesh.indices[i + 2] >= mesh.positions.size()) {
+			throw std::runtime_error("failed to add mesh to hlod builder: index out of range!");
+		}
+		m_indices.push_back(baseVertex + mesh.indices[i]);
+		m_indices.push_back(baseVertex + mesh.indices[i + 1]);
+		m_indices.push_back(baseVertex + mesh.indices[i + 2]);
+	}
+}
+
+HLODMeshData HLODBuilder::build(float cellSize) const
+{
+	if (!(cellSize > 0.0f)) {
+		throw std::runtime_error("failed to build hlod proxy: cell size must be positive!");
+	}
+
+	HLODMeshData data;
+	if (m_indices.empty()) {
+		return data;
+	}
+
+	// Collapse the vertices of each cell into one vertex at their average position
+	std::unordered_map<ClusterKey, uint32_t, ClusterKeyHash> clusterIndices;
+	std::vector<Cluster> clusters;
+	std::vector<uint32_t> remap(m_positions.size());
+	float invCellSize = 1.0f / cellSize;
+	for (size_t i = 0; i < m_positions.size(); i++) {
+		glm::vec3 cell = glm::floor(m_positions[i] * invCellSize);
+		ClusterKey key = { static_cast<int>(cell.x), static_cast<int>(cell.y), static_cast<int>(cell.z), m_colors[i] };
+		auto [it, inserted] = clusterIndices.try_emplace(key, static_cast<uint32_t>(clusters.size()));
+		if (inserted) {
+			clusters.emplace_back();
+			clusters.back().color = m_colors[i];
+		}
+		Cluster& cluster = clusters[it->second];
+		cluster.position += m_positions[i];
+		cluster.normal += m_normals[i];
+		cluster.count++;
+		remap[i] = it->second;
+	}
+
+	// Triangles whose corners fell into the same cell disappear
+	std::vector<uint32_t> used(clusters.size(), UINT32_MAX);
+	for (size_t i = 0; i + 2 < m_indices.size(); i += 3) {
+		uint32_t a = remap[m_indices[i]];
+		uint32_t b = remap[m_indices[i + 1]];
+		uint32_t c = remap[m_indices[i + 2]];
+		if (a == b || b == c || a == c) {
+			continue;
+		}
+		for (uint32_t cluster : { a, b, c }) {
+			if (used[cluster] == UINT32_MAX) {
+				used[cluster] = static_cast<uint32_t>(data.vertices.size());
+				data.vertices.emplace_back();
+			}
+			data.indices.push_back(used[cluster]);
+		}
+	}
+	if (data.indices.empty()) {
+		data.vertices.clear();
+		return data;
+	}
+
+	// One tile per palette entry, the tiles are laid out in a square grid
+	int tileCount = static_cast<int>(m_palette.size());
+	int columns = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(tileCount))));
+	int rows = (tileCount + columns - 1) / columns;
+	data.atlasWidth = columns * ATLAS_TILE_SIZE;
+	data.atlasHeight = rows * ATLAS_TILE_SIZE;
+	data.atlasPixels.assign(static_cast<size_t>(data.atlasWidth) * data.atlasHeight * 4, 255);
+	for (int tile = 0; tile < tileCount; tile++) {
+		glm::vec4 color = glm::clamp(m_palette[tile], glm::vec4(0.0f), glm::vec4(1.0f)) * 255.0f + 0.5f;
+		int originX = (tile % columns) * ATLAS_TILE_SIZE;
+		int originY = (tile / columns) * ATLAS_TILE_SIZE;
+		for (int y = originY; y < originY + ATLAS_TILE_SIZE; y++) {
+			for (int x = originX; x < originX + ATLAS_TILE_SIZE; x++) {
+				uint8_t* pixel = &data.atlasPixels[(static_cast<size_t>(y) * data.atlasWidth + x) * 4];
+				pixel[0] = static_cast<uint8_t>(color.r);
+				pixel[1] = static_cast<uint8_t>(color.g);
+				pixel[2] = static_cast<uint8_t>(color.b);
+				pixel[3] = static_cast<uint8_t>(color.a);
+			}
+		}
+	}
+
+	for (size_t i = 0; i < clusters.size(); i++) {
+		if (used[i] == UINT32_MAX) {
+			continue;
+		}
+		const Cluster& cluster = clusters[i];
+		Vertex& vertex = data.vertices[used[i]];
+		vertex.pos = cluster.position / static_cast<float>(cluster.count);
+		float length = glm::length(cluster.normal);
+		vertex.normal = length > 0.0f ? cluster.normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+		vertex.color = glm::vec3(1.0f);
+
+		// Sample the center of the tile of the color
+		int tile = static_cast<int>(cluster.color);
+		vertex.texCoord = glm::vec2(
+			((tile % columns) + 0.5f) * ATLAS_TILE_SIZE / static_cast<float>(data.atlasWidth),
+			((tile / columns) + 0.5f) * ATLAS_TILE_SIZE / static_cast<float>(data.atlasHeight));
+		data.bounds.expand(vertex.pos);
+	}
+	return data;
+}
+
+uint32_t HLODBuilder::findColor(const glm::vec4& color)
+{
+	// Meshes with the same base color share a tile
+	auto it = std::find(m_palette.begin(), m_palette.end(), color);
+	if (it != m_palette.end()) {
+		return static_cast<uint32_t>(it - m_palette.begin());
+	}
+	m_palette.push_back(color);
+	return static_cast<uint32_t>(m_palette.size() - 1);
+}
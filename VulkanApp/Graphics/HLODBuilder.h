@@ -0,0 +1,79 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "VertexBuffer.h"
+#include "../Math/AABB.h"
+
+/// <summary>
+/// Geometry of a mesh kept on the CPU for baking HLOD proxies
+/// </summary>
+struct HLODSourceMesh
+{
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<uint32_t> indices;
+	glm::vec4 baseColor = glm::vec4(1.0f);	// Average albedo of the material
+};
+
+/// <summary>
+/// A baked HLOD proxy, one mesh in world space with a palette atlas as albedo texture
+/// </summary>
+struct HLODMeshData
+{
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	int atlasWidth = 0;
+	int atlasHeight = 0;
+	std::vector<uint8_t> atlasPixels;	// RGBA8
+	AABB bounds;
+};
+
+/// <summary>
+/// Merges meshes into a single simplified proxy mesh
+/// The meshes are transformed into world space and simplified by vertex clustering on a uniform grid.
+/// Every distinct base color gets a tile in the atlas, so the proxy needs one material and one draw.
+/// Only uses CPU data, so a proxy can be built on a worker thread or offline.
+/// </summary>
+class HLODBuilder
+{
+public:
+	/// <summary>
+	/// Size of an atlas tile in pixels, large enough that filtering doesn't bleed into the neighbors
+	/// </summary>
+	static constexpr int ATLAS_TILE_SIZE = 4;
+
+	HLODBuilder() = default;
+	~HLODBuilder() = default;
+
+	/// <summary>
+	/// Adds a mesh with its world matrix
+	/// </summary>
+	/// <param name="mesh"></param>
+	/// <param name="worldMatrix"></param>
+	void addMesh(const HLODSourceMesh& mesh, const glm::mat4& worldMatrix);
+
+	/// <summary>
+	/// Builds the proxy
+	/// </summary>
+	/// <param name="cellSize">Edge length of the clustering cells in world units, larger cells give coarser proxies</param>
+	/// <returns>Empty vertices and indices if all triangles collapsed</returns>
+	HLODMeshData build(float cellSize) const;
+
+	/// <summary>
+	/// Whether no triangles were added
+	/// </summary>
+	/// <returns></returns>
+	bool empty() const {
+		return m_indices.empty();
+	}
+
+private:
+	std::vector<glm::vec3> m_positions;
+	std::vector<glm::vec3> m_normals;
+	std::vector<uint32_t> m_colors;		// Palette entry of each vertex
+	std::vector<uint32_t> m_indices;
+	std::vector<glm::vec4> m_palette;
+
+	uint32_t findColor(const glm::vec4& color);
+};
@@ -115,6 +115,21 @@ VkFormat ImageBuffer::getVkFormat(ImageBufferFormat format)
 	}
 }
 
+uint32_t ImageBuffer::getBytesPerPixel(ImageBufferFormat format)
+{
+	switch (format)
+	{
+	case ImageBufferFormat::RGBA:
+		return 4;
+	case ImageBufferFormat::RGB:
+		return 3;
+	case ImageBufferFormat::GRAY:
+		return 1;
+	default:
+		throw std::runtime_error("Unsupported image buffer format.");
+	}
+}
+
 ImageBuffer::ImageBuffer(stbi_uc* imageData, int width, int height, VkPhysicalDevice physicalDevice, VkDevice device, VkQueue queue, VkCommandPool pool)
 {
 	this->calcImageSize(width, height, ImageBufferFormat::RGBA);
@@ -125,6 +140,7 @@ ImageBuffer::ImageBuffer(stbi_uc* imageData, int width, int height, VkPhysicalDe
 ImageBuffer::ImageBuffer(std::vector<unsigned char> imageData, uint32_t width, uint32_t height, VkPhysicalDevice physicalDevice, VkDevice device, VkQueue queue, VkCommandPool pool, ImageBufferFormat format)
 {
 	// Calculate image size based on format
+	this->format = format;
 	this->calcImageSize(width, height, format);
 
 	// Get the target format
@@ -196,6 +212,78 @@ ImageBuffer::ImageBuffer(std::vector<unsigned char> imageData, uint32_t width, u
 	imageView = createImageView(device, image, targetFormat, VK_IMAGE_ASPECT_COLOR_BIT);
 }
 
+void ImageBuffer::updateRegion(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue queue, VkCommandPool pool, const unsigned char* imageData, uint32_t imageWidth, uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+{
+	if (width == 0 || height == 0) {
+		return;
+	}
+
+	// Copy the rows of the region into a staging buffer
+	uint32_t bytesPerPixel = getBytesPerPixel(format);
+	VkDeviceSize regionSize = static_cast<VkDeviceSize>(width) * height * bytesPerPixel;
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingBufferMemory;
+	createBuffer(
+		physicalDevice,
+		device,
+		regionSize,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		&stagingBuffer,
+		&stagingBufferMemory);
+
+	void* data;
+	vkMapMemory(device, stagingBufferMemory, 0, regionSize, 0, &data);
+	for (uint32_t row = 0; row < height; row++) {
+		memcpy(static_cast<unsigned char*>(data) + static_cast<size_t>(row) * width * bytesPerPixel,
+			imageData + (static_cast<size_t>(y + row) * imageWidth + x) * bytesPerPixel,
+			static_cast<size_t>(width) * bytesPerPixel);
+	}
+	vkUnmapMemory(device, stagingBufferMemory);
+
+	VkCommandBuffer commandBuffer = beginCommandBuffer(device, pool);
+
+	// Wait for the fragment shaders of earlier submissions before writing
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	VkBufferImageCopy region = {};
+	region.bufferOffset = 0;
+	region.bufferRowLength = 0;
+	region.bufferImageHeight = 0;
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.mipLevel = 0;
+	region.imageSubresource.baseArrayLayer = 0;
+	region.imageSubresource.layerCount = 1;
+	region.imageOffset = { static_cast<int32_t>(x), static_cast<int32_t>(y), 0 };
+	region.imageExtent = { width, height, 1 };
+	vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	submitCommandBuffer(device, pool, queue, commandBuffer);
+
+	vkDestroyBuffer(device, stagingBuffer, nullptr);
+	vkFreeMemory(device, stagingBufferMemory, nullptr);
+}
+
 void ImageBuffer::dispose(VkDevice device)
 {
 	vkDestroyImageView(device, imageView, nullptr);
@@ -18,6 +18,7 @@ private:
 	void calcImageSize(int width, int height, ImageBufferFormat format);
 	void createImageBuffer(stbi_uc* imageData, int width, int height, VkPhysicalDevice physicalDevice, VkDevice device, VkQueue queue, VkCommandPool pool);
 	VkFormat getVkFormat(ImageBufferFormat format);
+	uint32_t getBytesPerPixel(ImageBufferFormat format);
 
 public:
 	VkImage image;
@@ -25,8 +26,25 @@ public:
 	VkImageView imageView;
 	VkDeviceSize imageSize;
 	int descriptorIndex = -1;
+	ImageBufferFormat format = ImageBufferFormat::RGBA;
 
 	ImageBuffer(stbi_uc* imageData, int width, int height, VkPhysicalDevice physicalDevice, VkDevice device, VkQueue queue, VkCommandPool pool);
 	ImageBuffer(std::vector<unsigned char> imageData, uint32_t width, uint32_t height, VkPhysicalDevice physicalDevice, VkDevice device, VkQueue queue, VkCommandPool pool, ImageBufferFormat format);
+
+	/// <summary>
+	/// Uploads a rectangle of the image data, waits until the copy finished
+	/// Draws submitted before finish reading the image before it is written.
+	/// </summary>
+	/// <param name="physicalDevice"></param>
+	/// <param name="device"></param>
+	/// <param name="queue"></param>
+	/// <param name="pool"></param>
+	/// <param name="imageData">Data of the whole image in the format of the buffer</param>
+	/// <param name="imageWidth">Width of a row of imageData in pixels</param>
+	/// <param name="x"></param>
+	/// <param name="y"></param>
+	/// <param name="width"></param>
+	/// <param name="height"></param>
+	void updateRegion(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue queue, VkCommandPool pool, const unsigned char* imageData, uint32_t imageWidth, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
 	void dispose(VkDevice device);
 };
\ No newline at end of file
@@ -26,3 +26,21 @@ void ImageTexture::freeImageData()
 		imageData = nullptr;
 	}
 }
+
+glm::vec4 ImageTexture::getAverageColor() const
+{
+	size_t pixelCount = static_cast<size_t>(width) * height;
+	if (!imageData || pixelCount == 0) {
+		return glm::vec4(1.0f);
+	}
+
+	// The image data is always RGBA8
+	uint64_t sums[4] = {};
+	for (size_t i = 0; i < pixelCount; i++) {
+		for (int channel = 0; channel < 4; channel++) {
+			sums[channel] += imageData[i * 4 + channel];
+		}
+	}
+	float scale = 1.0f / (255.0f * static_cast<float>(pixelCount));
+	return glm::vec4(sums[0] * scale, sums[1] * scale, sums[2] * scale, sums[3] * scale);
+}
@@ -1,6 +1,7 @@
 #pragma once
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
 #include "../Utils.h"
 
 /// <summary>
@@ -19,5 +20,11 @@ public:
 	ImageTexture(int width, int height, const std::vector<uint8_t>& pixelData);
 	~ImageTexture();
 	void freeImageData();
+
+	/// <summary>
+	/// Returns the average color of the image
+	/// </summary>
+	/// <returns>White if the image data was already freed</returns>
+	glm::vec4 getAverageColor() const;
 };
 
@@ -0,0 +1,88 @@
+#include "IndirectDrawList.h"
+#include "../Utils.h"
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+	/// <summary>
+	/// Creates a device local buffer and fills it through a staging buffer
+	/// </summary>
+	void createDeviceBuffer(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue transferQueue, VkCommandPool transferCommandPool, const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer* buffer, VkDeviceMemory* bufferMemory)
+	{
+		createBuffer(physicalDevice,
+			device,
+			size,
+			usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			buffer,
+			bufferMemory);
+		if (data == nullptr) {
+			return;
+		}
+
+		VkBuffer stagingBuffer;
+		VkDeviceMemory stagingBufferMemory;
+		createBuffer(physicalDevice,
+			device,
+			size,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			&stagingBuffer,
+			&stagingBufferMemory);
+
+		void* mapped;
+		vkMapMemory(device, stagingBufferMemory, 0, size, 0, &mapped);
+		memcpy(mapped, data, static_cast<size_t>(size));
+		vkUnmapMemory(device, stagingBufferMemory);
+
+		copyBuffer(device, transferQueue, transferCommandPool, stagingBuffer, *buffer, size);
+		vkDestroyBuffer(device, stagingBuffer, nullptr);
+		vkFreeMemory(device, stagingBufferMemory, nullptr);
+	}
+}
+
+IndirectDrawList::IndirectDrawList(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue transferQueue, VkCommandPool transferCommandPool, const void* instanceData, VkDeviceSize instanceDataSize, const std::vector<IndirectDrawObject>& objects, const std::vector<IndirectDrawGroup>& drawGroups)
+{
+	if (objects.empty() || drawGroups.empty()) {
+		throw std::runtime_error("failed to create indirect draw list: no objects given!");
+	}
+	objectCount = static_cast<uint32_t>(objects.size());
+	groups = drawGroups;
+
+	// The instances are read by the vertex shader, the objects by the culling shader
+	instanceBufferSize = instanceDataSize;
+	createDeviceBuffer(physicalDevice, device, transferQueue, transferCommandPool, instanceData, instanceBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, &instanceBuffer, &instanceBufferMemory);
+	objectBufferSize = sizeof(IndirectDrawObject) * static_cast<VkDeviceSize>(objects.size());
+	createDeviceBuffer(physicalDevice, device, transferQueue, transferCommandPool, objects.data(), objectBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, &objectBuffer, &objectBufferMemory);
+
+	// The commands and counts are written by the culling shader every frame, the counts are cleared before
+	commandBufferSize = sizeof(VkDrawIndexedIndirectCommand) * static_cast<VkDeviceSize>(objects.size());
+	createDeviceBuffer(physicalDevice, device, transferQueue, transferCommandPool, nullptr, commandBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, &commandBuffer, &commandBufferMemory);
+	countBufferSize = sizeof(uint32_t) * static_cast<VkDeviceSize>(drawGroups.size());
+	createDeviceBuffer(physicalDevice, device, transferQueue, transferCommandPool, nullptr, countBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, &countBuffer, &countBufferMemory);
+
+	// The occlusion culling remembers which objects were visible, none before the first test
+	std::vector<uint32_t> visibility(objects.size(), 0);
+	visibilityBufferSize = sizeof(uint32_t) * static_cast<VkDeviceSize>(objects.size());
+	createDeviceBuffer(physicalDevice, device, transferQueue, transferCommandPool, visibility.data(), visibilityBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, &visibilityBuffer, &visibilityBufferMemory);
+
+	this->state = GFX_BUFFER_STATE_INITIALIZED;
+	std::cout << "[INDIRECT DRAW LIST] Indirect draw list created with " << objectCount << " objects in " << groups.size() << " groups." << std::endl;
+}
+
+void IndirectDrawList::dispose(VkDevice device)
+{
+	vkDestroyBuffer(device, instanceBuffer, nullptr);
+	vkFreeMemory(device, instanceBufferMemory, nullptr);
+	vkDestroyBuffer(device, objectBuffer, nullptr);
+	vkFreeMemory(device, objectBufferMemory, nullptr);
+	vkDestroyBuffer(device, commandBuffer, nullptr);
+	vkFreeMemory(device, commandBufferMemory, nullptr);
+	vkDestroyBuffer(device, countBuffer, nullptr);
+	vkFreeMemory(device, countBufferMemory, nullptr);
+	vkDestroyBuffer(device, visibilityBuffer, nullptr);
+	vkFreeMemory(device, visibilityBufferMemory, nullptr);
+	this->state = GFX_BUFFER_STATE_DISPOSED;
+	std::cout << "[INDIRECT DRAW LIST] Indirect draw list disposed." << std::endl;
+}
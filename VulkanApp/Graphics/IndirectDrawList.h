@@ -0,0 +1,108 @@
+#pragma once
+#include "Buffer.h"
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// An object culled by the GPU, matches the DrawObject struct of Shaders/cull.comp (std430)
+/// </summary>
+struct IndirectDrawObject {
+	glm::vec4 boundsMin;			// World space
+	glm::vec4 boundsMax;
+	glm::vec4 sphere;				// World space center and radius
+	glm::vec4 cone = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);	// World space normal cone axis and cutoff, a cutoff of 1 is never back facing
+	uint32_t firstIndex = 0;		// Geometry range of the mesh in its geometry pool page
+	uint32_t indexCount = 0;
+	int32_t vertexOffset = 0;
+	uint32_t drawGroup = 0;			// The group the draw command is written to
+	uint32_t firstCommand = 0;		// First command of the group
+	uint32_t padding[3] = {};
+};
+
+/// <summary>
+/// Phases of the occlusion culling of an indirect draw list
+/// </summary>
+enum class IndirectCullPhase {
+	CULL_PHASE_SINGLE = 0,	// Tests the objects against the depth pyramid of the previous frame
+	CULL_PHASE_FIRST = 1,	// Draws the objects visible after the last test, without testing them against the depth pyramid
+	CULL_PHASE_SECOND = 2	// Tests the objects against the depth pyramid built from the first phase and draws the ones it skipped
+};
+
+/// <summary>
+/// Push constants of the culling compute shader
+/// </summary>
+struct IndirectCullConstants {
+	std::array<glm::vec4, 6> planes;	// xyz = normal, w = distance, inside if dot(normal, p) + w >= 0
+	glm::vec4 cameraPosition;			// Objects whose normal cone faces away from it are culled
+	uint32_t objectCount = 0;
+	uint32_t compact = 0;				// 1 if the visible commands are compacted and counted per group
+	uint32_t phase = 0;					// IndirectCullPhase, only read by the occlusion culling shader
+	uint32_t padding = 0;
+};
+
+/// <summary>
+/// A range of draw commands drawn with one indirect draw call
+/// All objects of a group share the geometry pool page, the caller groups them by material too.
+/// </summary>
+struct IndirectDrawGroup {
+	int page = -1;
+	uint32_t firstCommand = 0;
+	uint32_t commandCount = 0;
+};
+
+/// <summary>
+/// Device local buffers of objects drawn with GPU culled indirect draws
+/// The culling compute shader reads the objects and writes one VkDrawIndexedIndirectCommand per visible object
+/// into the range of its group. The firstInstance of a command is the index of the object, so the vertex shader
+/// reads the transform of the object from the instance buffer.
+/// </summary>
+class IndirectDrawList : public Buffer
+{
+public:
+	VkBuffer instanceBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory instanceBufferMemory = VK_NULL_HANDLE;
+	VkBuffer objectBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory objectBufferMemory = VK_NULL_HANDLE;
+	VkBuffer commandBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory commandBufferMemory = VK_NULL_HANDLE;
+	VkBuffer countBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory countBufferMemory = VK_NULL_HANDLE;
+	VkBuffer visibilityBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory visibilityBufferMemory = VK_NULL_HANDLE;
+
+	VkDeviceSize instanceBufferSize = 0;
+	VkDeviceSize objectBufferSize = 0;
+	VkDeviceSize commandBufferSize = 0;
+	VkDeviceSize countBufferSize = 0;
+	VkDeviceSize visibilityBufferSize = 0;
+
+	uint32_t objectCount = 0;
+	std::vector<IndirectDrawGroup> groups;
+
+	// Storage buffer descriptor indices of the renderer
+	int instanceDescriptorIndex = -1;
+	int objectDescriptorIndex = -1;
+	int commandDescriptorIndex = -1;
+	int countDescriptorIndex = -1;
+	int visibilityDescriptorIndex = -1;
+
+	/// <summary>
+	/// Creates the buffers and uploads the instances and the objects
+	/// </summary>
+	/// <param name="physicalDevice"></param>
+	/// <param name="device"></param>
+	/// <param name="transferQueue"></param>
+	/// <param name="transferCommandPool"></param>
+	/// <param name="instanceData">One instance per object in the layout of the vertex shader</param>
+	/// <param name="instanceDataSize">In bytes</param>
+	/// <param name="objects">Sorted by group, the commands of a group follow each other</param>
+	/// <param name="drawGroups"></param>
+	IndirectDrawList(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue transferQueue, VkCommandPool transferCommandPool, const void* instanceData, VkDeviceSize instanceDataSize, const std::vector<IndirectDrawObject>& objects, const std::vector<IndirectDrawGroup>& drawGroups);
+	~IndirectDrawList() = default;
+
+	void dispose(VkDevice device) override;
+};
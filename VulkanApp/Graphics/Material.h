@@ -1,5 +1,8 @@
 #pragma once
+#include <atomic>
+#include <cstdint>
 #include <vector>
+#include <glm/glm.hpp>
 #include "ImageTexture.h"
 #include <string>
 
@@ -23,5 +26,34 @@ public:
 	virtual void init(Renderer* renderer) = 0;
 	virtual void dispose(Renderer* renderer) = 0;
 	virtual void bindMaterial(Renderer* renderer, VkCommandBuffer commandBuffer, int firstSet, int frame) = 0;
+
+	/// <summary>
+	/// Returns the average albedo of the material, used to color simplified proxies
+	/// Only valid before init, the texture data is freed once it is uploaded.
+	/// </summary>
+	/// <returns></returns>
+	virtual glm::vec4 getBaseColor() const {
+		return glm::vec4(1.0f);
+	}
+
+	/// <summary>
+	/// Marks that the descriptor sets bound by a material changed
+	/// Call this after changing the textures of an initialized material, command buffers recorded
+	/// with the old descriptor sets are recorded again.
+	/// </summary>
+	static void markChanged() {
+		s_revision.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	/// <summary>
+	/// Returns a counter that changes whenever any material changes
+	/// </summary>
+	/// <returns></returns>
+	static uint64_t getRevision() {
+		return s_revision.load(std::memory_order_relaxed);
+	}
+
+private:
+	inline static std::atomic<uint64_t> s_revision = 0;
 };
 
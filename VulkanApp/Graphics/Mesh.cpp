@@ -4,25 +4,50 @@
 #include "Renderer.h"
 
 /// <summary>
-/// Initialize the mesh by creating vertex and index buffers in the renderer
+/// Initialize the mesh by sub-allocating it in the geometry pool of the renderer
 /// and dispose the local vertex and index data to save memory
 /// </summary>
 /// <param name="renderer"></param>
-void Mesh::init(Renderer* renderer)
+void Mesh::init(Renderer* renderer, bool keepData)
 {
 	this->material->init(renderer);
-	this->vertexBufferIndex = renderer->createVertexBuffer(&this->vertices);
-	this->indexBufferIndex = renderer->createIndexBuffer(&this->indices);
-	this->vertices.clear();
-	this->indices.clear();
+
+	// Generated LODs draw the vertices of the mesh, so they are allocated together with it in one page
+	std::vector<const std::vector<uint32_t>*> indexLists = { &this->indices };
+	for (const auto& lod : this->lods) {
+		if (lod.vertices.empty()) {
+			indexLists.push_back(&lod.indices);
+		}
+	}
+	std::vector<int> ranges = renderer->createGeometry(&this->vertices, indexLists);
+	this->geometryIndex = ranges[0];
+
+	// Authored LODs bring their own vertices
+	size_t nextRange = 1;
+	for (auto& lod : this->lods) {
+		lod.geometryIndex = lod.vertices.empty() ? ranges[nextRange++] : renderer->createGeometry(&lod.vertices, &lod.indices);
+		lod.vertices.clear();
+		lod.indices.clear();
+	}
+
+	if (!keepData) {
+		this->vertices.clear();
+		this->indices.clear();
+	}
 }
 
 /// <summary>
 /// Dispose the mesh and free resources
-/// No need to dispose vertex and index buffers since the renderer will handle that
+/// The LODs are freed before the mesh, the generated ones draw its vertices
 /// </summary>
 /// <param name="renderer"></param>
 void Mesh::dispose(Renderer* renderer)
 {
+	for (auto& lod : this->lods) {
+		renderer->disposeGeometry(lod.geometryIndex);
+		lod.geometryIndex = -1;
+	}
+	renderer->disposeGeometry(this->geometryIndex);
+	this->geometryIndex = -1;
 	this->material->dispose(renderer);
 }
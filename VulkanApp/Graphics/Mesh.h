@@ -3,8 +3,20 @@
 #include <GLFW/glfw3.h>
 #include "VertexBuffer.h"
 #include "IndexBuffer.h"
+#include <algorithm>
 #include <vector>
 #include "Material.h"
+#include "MeshletBuilder.h"
+
+/// <summary>
+/// A coarser level of detail of a mesh
+/// </summary>
+struct MeshLOD
+{
+	std::vector<Vertex> vertices;	// Empty if the LOD draws the vertices of the mesh
+	std::vector<uint32_t> indices;
+	int geometryIndex = -1;
+};
 
 /// <summary>
 /// Representation of an mesh witch contains vertices, indices and a material
@@ -17,16 +29,49 @@ public:
 	std::unique_ptr<Material> material;
 	std::vector<Vertex> vertices;
 	std::vector<uint32_t> indices;
+
+	/// <summary>
+	/// The range of the mesh in the geometry pool, set by init
+	/// </summary>
+	int geometryIndex = -1;
+
+	/// <summary>
+	/// Buffers of meshes that are not initialized through init, e.g. sprites
+	/// </summary>
 	int vertexBufferIndex = -1;
 	int indexBufferIndex = -1;
 
+	/// <summary>
+	/// The coarser levels of detail, lods[0] is LOD 1
+	/// </summary>
+	std::vector<MeshLOD> lods;
+
+	/// <summary>
+	/// Clusters of the base mesh culled on their own by GPU driven rendering, empty if the mesh is drawn as a whole
+	/// </summary>
+	std::vector<Meshlet> meshlets;
+
 	Mesh() = default;
 	~Mesh() = default;
 
-	void init(Renderer* renderer);
+	/// <summary>
+	/// Sub-allocates the mesh and its LODs in the geometry pool of the renderer
+	/// </summary>
+	/// <param name="renderer"></param>
+	/// <param name="keepData">Keeps the vertices and indices of the mesh instead of freeing them</param>
+	void init(Renderer* renderer, bool keepData = false);
 	void setVertices(std::vector<Vertex> vertices) { this->vertices = vertices; }
 	void setIndices(std::vector<uint32_t> indices) { this->indices = indices; }
 
+	/// <summary>
+	/// Returns the geometry pool range of a level of detail, LOD 0 is the mesh itself
+	/// </summary>
+	/// <param name="lod">Clamped to the available LODs</param>
+	/// <returns></returns>
+	int getGeometryIndex(int lod) const {
+		return lod <= 0 || lods.empty() ? geometryIndex : lods[std::min<size_t>(lod, lods.size()) - 1].geometryIndex;
+	}
+
 	void dispose(Renderer* renderer);
 };
 
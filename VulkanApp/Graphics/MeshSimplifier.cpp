@@ -0,0 +1,330 @@
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+	/// <summary>
+	/// Symmetric 4x4 error quadric, sums the squared distances to a set of planes
+	/// </summary>
+	struct Quadric {
+		double xx = 0, xy = 0, xz = 0, xw = 0;
+		double yy = 0, yz = 0, yw = 0;
+		double zz = 0, zw = 0;
+		double ww = 0;
+
+		void addPlane(double a, double b, double c, double d, double weight) {
+			xx += weight * a * a; xy += weight * a * b; xz += weight * a * c; xw += weight * a * d;
+			yy += weight * b * b; yz += weight * b * c; yw += weight * b * d;
+			zz += weight * c * c; zw += weight * c * d;
+			ww += weight * d * d;
+		}
+
+		void add(const Quadric& other) {
+			xx += other.xx; xy += other.xy; xz += other.xz; xw += other.xw;
+			yy += other.yy; yz += other.yz; yw += other.yw;
+			zz += other.zz; zw += other.zw;
+			ww += other.ww;
+		}
+
+		double evaluate(const glm::vec3& p) const {
+			double x = p.x, y = p.y, z = p.z;
+			double error = xx * x * x + 2 * xy * x * y + 2 * xz * x * z + 2 * xw * x
+				+ yy * y * y + 2 * yz * y * z + 2 * yw * y
+				+ zz * z * z + 2 * zw * z
+				+ ww;
+			return std::max(error, 0.0);
+		}
+	};
+
+	struct Collapse {
+		uint32_t from;
+		uint32_t to;
+		double cost;
+	};
+
+	struct PositionHash {
+		size_t operator()(const glm::vec3& p) const {
+			uint32_t bits[3];
+			std::memcpy(bits, &p, sizeof(bits));
+			uint64_t h = bits[0] * 0x9E3779B97F4A7C15ull;
+			h ^= bits[1] * 0xC2B2AE3D27D4EB4Full;
+			h ^= bits[2] * 0x165667B19E3779F9ull;
+			return static_cast<size_t>(h ^ (h >> 29));
+		}
+	};
+
+	struct EdgeHash {
+		size_t operator()(uint64_t edge) const {
+			return static_cast<size_t>(edge * 0x9E3779B97F4A7C15ull ^ (edge >> 32));
+		}
+	};
+}
+
+std::vector<uint32_t> MeshSimplifier::simplify(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, size_t targetIndexCount, float maxError, float* resultError)
+{
+	if (indices.size() % 3 != 0) {
+		throw std::runtime_error("failed to simplify mesh: index count is not a multiple of 3!");
+	}
+	for (uint32_t index : indices) {
+		if (index >= vertices.size()) {
+			throw std::runtime_error("failed to simplify mesh: index out of range!");
+		}
+	}
+
+	std::vector<uint32_t> result = indices;
+	if (resultError != nullptr) {
+		*resultError = 0.0f;
+	}
+	if (result.size() <= targetIndexCount) {
+		return result;
+	}
+
+	// Errors are squared distances, scale them to the size of the mesh
+	glm::vec3 minPos = vertices.empty() ? glm::vec3(0.0f) : vertices[0].pos;
+	glm::vec3 maxPos = minPos;
+	for (const auto& vertex : vertices) {
+		minPos = glm::min(minPos, vertex.pos);
+		maxPos = glm::max(maxPos, vertex.pos);
+	}
+	double extent = std::max(static_cast<double>(glm::length(maxPos - minPos)), 1e-12);
+	double errorScale = 1.0 / (extent * extent);
+	double errorLimit = maxError == FLT_MAX ? DBL_MAX : static_cast<double>(maxError) * maxError;
+
+	// Vertices sharing a position are welded into one vertex of the surface, the vertices of a position are its
+	// wedges with different attributes (e.g. split UVs or normals along a seam)
+	size_t vertexCount = vertices.size();
+	std::vector<uint32_t> positionIds(vertexCount);
+	std::vector<glm::vec3> positions;
+	{
+		std::unordered_map<glm::vec3, uint32_t, PositionHash> positionMap;
+		positionMap.reserve(vertexCount);
+		for (size_t i = 0; i < vertexCount; i++) {
+			auto [it, inserted] = positionMap.try_emplace(vertices[i].pos, static_cast<uint32_t>(positions.size()));
+			if (inserted) {
+				positions.push_back(vertices[i].pos);
+			}
+			positionIds[i] = it->second;
+		}
+	}
+	size_t positionCount = positions.size();
+
+	// Wedges of each position
+	std::vector<uint32_t> wedgeOffsets(positionCount + 1, 0);
+	std::vector<uint32_t> wedges(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++) {
+		wedgeOffsets[positionIds[i] + 1]++;
+	}
+	for (size_t i = 0; i < positionCount; i++) {
+		wedgeOffsets[i + 1] += wedgeOffsets[i];
+	}
+	{
+		std::vector<uint32_t> fill(wedgeOffsets.begin(), wedgeOffsets.end() - 1);
+		for (size_t i = 0; i < vertexCount; i++) {
+			wedges[fill[positionIds[i]]++] = static_cast<uint32_t>(i);
+		}
+	}
+
+	// Edges of the welded surface used by one triangle are borders, edges used by more than two are non manifold
+	std::unordered_map<uint64_t, uint32_t, EdgeHash> edgeUses;
+	edgeUses.reserve(result.size());
+	for (size_t i = 0; i < result.size(); i += 3) {
+		for (int corner = 0; corner < 3; corner++) {
+			uint32_t a = positionIds[result[i + corner]];
+			uint32_t b = positionIds[result[i + (corner + 1) % 3]];
+			uint64_t edge = (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+			edgeUses[edge]++;
+		}
+	}
+
+	// Only borders lock their positions, seams are welded and collapse along themselves
+	std::vector<bool> locked(positionCount, false);
+	for (const auto& [edge, uses] : edgeUses) {
+		if (uses != 2) {
+			locked[static_cast<uint32_t>(edge >> 32)] = true;
+			locked[static_cast<uint32_t>(edge & 0xFFFFFFFFu)] = true;
+		}
+	}
+
+	// Every position starts with the planes of its triangles, weighted by their area
+	std::vector<Quadric> quadrics(positionCount);
+	for (size_t i = 0; i < result.size(); i += 3) {
+		glm::vec3 p0 = vertices[result[i]].pos;
+		glm::vec3 p1 = vertices[result[i + 1]].pos;
+		glm::vec3 p2 = vertices[result[i + 2]].pos;
+		glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		float length = glm::length(normal);
+		if (length <= 0.0f) {
+			continue;
+		}
+		normal /= length;
+		double d = -static_cast<double>(glm::dot(normal, p0));
+		for (int corner = 0; corner < 3; corner++) {
+			quadrics[positionIds[result[i + corner]]].addPlane(normal.x, normal.y, normal.z, d, length * 0.5);
+		}
+	}
+
+	std::vector<uint32_t> remap(vertexCount);
+	std::vector<bool> touched(positionCount);
+	std::vector<uint32_t> triangleOffsets(vertexCount + 1);
+	std::vector<uint32_t> vertexTriangles;
+	std::vector<Collapse> collapses;
+	std::vector<std::pair<uint32_t, uint32_t>> wedgeCollapses;
+	double appliedError = 0.0;
+
+	while (result.size() > targetIndexCount) {
+		size_t triangleCount = result.size() / 3;
+
+		// Triangles of each vertex for the wedge matching and the flip test
+		std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+		for (uint32_t index : result) {
+			triangleOffsets[index + 1]++;
+		}
+		for (size_t i = 0; i < vertexCount; i++) {
+			triangleOffsets[i + 1] += triangleOffsets[i];
+		}
+		vertexTriangles.resize(result.size());
+		{
+			std::vector<uint32_t> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+			for (size_t i = 0; i < result.size(); i++) {
+				vertexTriangles[fill[result[i]]++] = static_cast<uint32_t>(i / 3);
+			}
+		}
+
+		// Collapse each free position along its cheapest edges
+		collapses.clear();
+		for (size_t i = 0; i < result.size(); i += 3) {
+			for (int corner = 0; corner < 3; corner++) {
+				uint32_t a = result[i + corner];
+				uint32_t b = result[i + (corner + 1) % 3];
+				for (auto [from, to] : { std::pair{ a, b }, std::pair{ b, a } }) {
+					uint32_t fromPosition = positionIds[from];
+					uint32_t toPosition = positionIds[to];
+					if (!locked[fromPosition] && fromPosition != toPosition) {
+						Quadric quadric = quadrics[fromPosition];
+						quadric.add(quadrics[toPosition]);
+						collapses.push_back({ from, to, quadric.evaluate(positions[toPosition]) * errorScale });
+					}
+				}
+			}
+		}
+		if (collapses.empty()) {
+			break;
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+			return a.cost < b.cost;
+		});
+
+		// A collapse removes two triangles, don't overshoot the target
+		size_t wanted = std::max<size_t>(1, (triangleCount - targetIndexCount / 3) / 2);
+		size_t applied = 0;
+		for (size_t i = 0; i < vertexCount; i++) {
+			remap[i] = static_cast<uint32_t>(i);
+		}
+		std::fill(touched.begin(), touched.end(), false);
+
+		for (const Collapse& collapse : collapses) {
+			if (applied >= wanted || collapse.cost > errorLimit) {
+				break;
+			}
+			uint32_t fromPosition = positionIds[collapse.from];
+			uint32_t toPosition = positionIds[collapse.to];
+			if (touched[fromPosition] || touched[toPosition]) {
+				continue;
+			}
+
+			// Every wedge moves onto the wedge of the target position on its side of the seam. A collapse across a
+			// seam leaves a wedge without a partner or with several and would tear the attributes, so it is rejected.
+			wedgeCollapses.clear();
+			bool valid = true;
+			for (uint32_t w = wedgeOffsets[fromPosition]; w < wedgeOffsets[fromPosition + 1] && valid; w++) {
+				uint32_t wedge = wedges[w];
+				if (triangleOffsets[wedge] == triangleOffsets[wedge + 1]) {
+					continue;
+				}
+				uint32_t partner = UINT32_MAX;
+				for (uint32_t t = triangleOffsets[wedge]; t < triangleOffsets[wedge + 1]; t++) {
+					const uint32_t* triangle = &result[vertexTriangles[t] * 3];
+					for (int corner = 0; corner < 3; corner++) {
+						if (positionIds[triangle[corner]] != toPosition) {
+							continue;
+						}
+						if (partner != UINT32_MAX && partner != triangle[corner]) {
+							valid = false;
+						}
+						partner = triangle[corner];
+					}
+				}
+				valid = valid && partner != UINT32_MAX;
+				wedgeCollapses.push_back({ wedge, partner });
+			}
+			if (!valid) {
+				continue;
+			}
+
+			// Reject collapses that flip a remaining triangle
+			bool flips = false;
+			glm::vec3 target = positions[toPosition];
+			for (auto [from, to] : wedgeCollapses) {
+				for (uint32_t t = triangleOffsets[from]; t < triangleOffsets[from + 1] && !flips; t++) {
+					const uint32_t* triangle = &result[vertexTriangles[t] * 3];
+					if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+						continue;
+					}
+					glm::vec3 p[3];
+					glm::vec3 q[3];
+					for (int corner = 0; corner < 3; corner++) {
+						p[corner] = vertices[triangle[corner]].pos;
+						q[corner] = triangle[corner] == from ? target : p[corner];
+					}
+					glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+					glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+					flips = glm::dot(before, after) <= 0.0f;
+				}
+			}
+			if (flips) {
+				continue;
+			}
+
+			// The neighbors keep their triangles for this pass so their flip tests stay valid
+			for (auto [from, to] : wedgeCollapses) {
+				for (uint32_t t = triangleOffsets[from]; t < triangleOffsets[from + 1]; t++) {
+					const uint32_t* triangle = &result[vertexTriangles[t] * 3];
+					touched[positionIds[triangle[0]]] = true;
+					touched[positionIds[triangle[1]]] = true;
+					touched[positionIds[triangle[2]]] = true;
+				}
+				remap[from] = to;
+			}
+			quadrics[toPosition].add(quadrics[fromPosition]);
+			appliedError = std::max(appliedError, collapse.cost);
+			applied++;
+		}
+		if (applied == 0) {
+			break;
+		}
+
+		// Apply the collapses and drop the triangles that became degenerate
+		size_t write = 0;
+		for (size_t i = 0; i < result.size(); i += 3) {
+			uint32_t a = remap[result[i]];
+			uint32_t b = remap[result[i + 1]];
+			uint32_t c = remap[result[i + 2]];
+			if (positionIds[a] == positionIds[b] || positionIds[b] == positionIds[c] || positionIds[a] == positionIds[c]) {
+				continue;
+			}
+			result[write++] = a;
+			result[write++] = b;
+			result[write++] = c;
+		}
+		result.resize(write);
+	}
+
+	if (resultError != nullptr) {
+		*resultError = static_cast<float>(std::sqrt(appliedError));
+	}
+	return result;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <cfloat>
+#include <cstdint>
+#include <vector>
+#include "VertexBuffer.h"
+
+/// <summary>
+/// Simplifies triangle meshes by quadric edge collapses
+/// Vertices are only collapsed onto other vertices of the mesh, so the simplified indices can be drawn with the
+/// vertex buffer of the original mesh. Vertices are welded by position first, so attribute seams (several vertices
+/// at the same position, e.g. split UVs or normals) don't split the surface. Seams only collapse along themselves,
+/// every vertex of a seam moves onto the vertex on its own side, which keeps the attribute discontinuity intact.
+/// Vertices on open borders are never removed, which keeps the silhouette.
+/// </summary>
+class MeshSimplifier
+{
+public:
+	/// <summary>
+	/// Simplifies a mesh until it has at most the target number of indices or no collapse is left below the error
+	/// </summary>
+	/// <param name="vertices"></param>
+	/// <param name="indices">Triangle list</param>
+	/// <param name="targetIndexCount"></param>
+	/// <param name="maxError">Largest collapse error relative to the size of the mesh, FLT_MAX to only stop at the target</param>
+	/// <param name="resultError">Receives the largest error of the applied collapses relative to the size of the mesh, optional</param>
+	/// <returns>The indices of the simplified mesh, more than the target if no valid collapse was left</returns>
+	static std::vector<uint32_t> simplify(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, size_t targetIndexCount, float maxError = FLT_MAX, float* resultError = nullptr);
+};
+
@@ -0,0 +1,176 @@
+#include "MeshletBuilder.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+std::vector<Meshlet> MeshletBuilder::build(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, size_t maxVertices, size_t maxTriangles)
+{
+	if (maxVertices < 3 || maxTriangles == 0) {
+		throw std::runtime_error("failed to build meshlets: a meshlet needs room for at least one triangle!");
+	}
+	if (indices.size() % 3 != 0) {
+		throw std::runtime_error("failed to build meshlets: indices are not a triangle list!");
+	}
+	const size_t triangleCount = indices.size() / 3;
+	for (uint32_t index : indices) {
+		if (index >= vertices.size()) {
+			throw std::runtime_error("failed to build meshlets: index out of range!");
+		}
+	}
+
+	// Triangles of every vertex, compressed into one array
+	std::vector<uint32_t> adjacencyOffsets(vertices.size() + 1, 0);
+	for (uint32_t index : indices) {
+		adjacencyOffsets[index + 1]++;
+	}
+	for (size_t i = 1; i < adjacencyOffsets.size(); i++) {
+		adjacencyOffsets[i] += adjacencyOffsets[i - 1];
+	}
+	std::vector<uint32_t> adjacency(indices.size());
+	std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (size_t i = 0; i < indices.size(); i++) {
+		adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+
+	// Stamps mark the vertices and candidate triangles of the meshlet being built
+	constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+	std::vector<uint32_t> vertexStamps(vertices.size(), NONE);
+	std::vector<uint32_t> candidateStamps(triangleCount, NONE);
+	std::vector<bool> used(triangleCount, false);
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> reordered;
+	reordered.reserve(indices.size());
+	std::vector<Meshlet> meshlets;
+
+	size_t nextSeed = 0;
+	while (true) {
+		while (nextSeed < triangleCount && used[nextSeed]) {
+			nextSeed++;
+		}
+		if (nextSeed == triangleCount) {
+			break;
+		}
+
+		uint32_t stamp = static_cast<uint32_t>(meshlets.size());
+		Meshlet meshlet;
+		meshlet.firstIndex = static_cast<uint32_t>(reordered.size());
+		size_t vertexCount = 0;
+		size_t meshletTriangles = 0;
+		candidates.clear();
+
+		uint32_t triangle = static_cast<uint32_t>(nextSeed);
+		while (true) {
+			// Add the triangle and queue its unused neighbors
+			used[triangle] = true;
+			meshletTriangles++;
+			for (int corner = 0; corner < 3; corner++) {
+				uint32_t vertex = indices[triangle * 3 + corner];
+				reordered.push_back(vertex);
+				if (vertexStamps[vertex] != stamp) {
+					vertexStamps[vertex] = stamp;
+					vertexCount++;
+				}
+				for (uint32_t i = adjacencyOffsets[vertex]; i < adjacencyOffsets[vertex + 1]; i++) {
+					uint32_t neighbor = adjacency[i];
+					if (!used[neighbor] && candidateStamps[neighbor] != stamp) {
+						candidateStamps[neighbor] = stamp;
+						candidates.push_back(neighbor);
+					}
+				}
+			}
+			if (meshletTriangles == maxTriangles) {
+				break;
+			}
+
+			// Take the neighbor adding the fewest vertices that still fits, used candidates are dropped on the way
+			uint32_t best = NONE;
+			int bestNewVertices = 4;
+			size_t kept = 0;
+			for (size_t i = 0; i < candidates.size(); i++) {
+				uint32_t candidate = candidates[i];
+				if (used[candidate]) {
+					continue;
+				}
+				candidates[kept++] = candidate;
+				int newVertices = 0;
+				for (int corner = 0; corner < 3; corner++) {
+					newVertices += vertexStamps[indices[candidate * 3 + corner]] != stamp ? 1 : 0;
+				}
+				if (newVertices < bestNewVertices && vertexCount + newVertices <= maxVertices) {
+					best = candidate;
+					bestNewVertices = newVertices;
+				}
+			}
+			candidates.resize(kept);
+			if (best == NONE) {
+				break;
+			}
+			triangle = best;
+		}
+
+		meshlet.indexCount = static_cast<uint32_t>(reordered.size()) - meshlet.firstIndex;
+		meshlets.push_back(meshlet);
+	}
+
+	indices = std::move(reordered);
+	for (Meshlet& meshlet : meshlets) {
+		computeBounds(vertices, indices, meshlet);
+	}
+	return meshlets;
+}
+
+void MeshletBuilder::computeBounds(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, Meshlet& meshlet)
+{
+	uint32_t lastIndex = meshlet.firstIndex + meshlet.indexCount;
+	if (meshlet.indexCount == 0) {
+		return;
+	}
+
+	// The sphere is centered on the box of the corners
+	glm::vec3 boundsMin = vertices[indices[meshlet.firstIndex]].pos;
+	glm::vec3 boundsMax = boundsMin;
+	for (uint32_t i = meshlet.firstIndex; i < lastIndex; i++) {
+		boundsMin = glm::min(boundsMin, vertices[indices[i]].pos);
+		boundsMax = glm::max(boundsMax, vertices[indices[i]].pos);
+	}
+	meshlet.center = (boundsMin + boundsMax) * 0.5f;
+	float radiusSquared = 0.0f;
+	for (uint32_t i = meshlet.firstIndex; i < lastIndex; i++) {
+		glm::vec3 offset = vertices[indices[i]].pos - meshlet.center;
+		radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+	}
+	meshlet.radius = std::sqrt(radiusSquared);
+
+	// The cone spans the face normals of the counter clockwise front faces, degenerate triangles are skipped
+	std::vector<glm::vec3> normals;
+	normals.reserve(meshlet.indexCount / 3);
+	glm::vec3 normalSum(0.0f);
+	for (uint32_t i = meshlet.firstIndex; i + 2 < lastIndex; i += 3) {
+		const glm::vec3& p0 = vertices[indices[i]].pos;
+		glm::vec3 normal = glm::cross(vertices[indices[i + 1]].pos - p0, vertices[indices[i + 2]].pos - p0);
+		float length = glm::length(normal);
+		if (length > 0.0f) {
+			normals.push_back(normal / length);
+			normalSum += normal / length;
+		}
+	}
+	meshlet.coneAxis = glm::vec3(0.0f);
+	meshlet.coneCutoff = 1.0f;
+	float sumLength = glm::length(normalSum);
+	if (normals.empty() || sumLength <= 0.0f) {
+		return;
+	}
+	glm::vec3 axis = normalSum / sumLength;
+	float minDot = 1.0f;
+	for (const glm::vec3& normal : normals) {
+		minDot = std::min(minDot, glm::dot(normal, axis));
+	}
+
+	// Clusters whose normals spread over more than about 84 degrees from the axis are never culled
+	if (minDot <= 0.1f) {
+		return;
+	}
+	meshlet.coneAxis = axis;
+	meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "VertexBuffer.h"
+
+/// <summary>
+/// A small cluster of connected triangles of a mesh, culled on its own
+/// The cluster is back facing for every camera position with dot(center - camera, coneAxis) >= coneCutoff * length(center - camera) + radius.
+/// </summary>
+struct Meshlet
+{
+	uint32_t firstIndex = 0;		// Relative to the first index of the mesh
+	uint32_t indexCount = 0;
+	glm::vec3 center = glm::vec3(0.0f);	// Bounding sphere in model space
+	float radius = 0.0f;
+	glm::vec3 coneAxis = glm::vec3(0.0f);	// Average direction of the triangle normals
+	float coneCutoff = 1.0f;		// Sine of the largest angle between a triangle normal and the axis, 1 if the cluster is never back facing
+};
+
+/// <summary>
+/// Splits triangle meshes into meshlets
+/// Meshlets are grown over shared vertices, every step takes the adjacent triangle adding the fewest new vertices,
+/// so the clusters stay compact. The triangles of the mesh are reordered so every meshlet is a range of its indices,
+/// the mesh itself still draws all of them.
+/// </summary>
+class MeshletBuilder
+{
+public:
+	/// <summary>
+	/// Builds the meshlets of a mesh and reorders its indices
+	/// </summary>
+	/// <param name="vertices"></param>
+	/// <param name="indices">Triangle list, reordered so the triangles of each meshlet follow each other</param>
+	/// <param name="maxVertices">Largest number of distinct vertices in a meshlet</param>
+	/// <param name="maxTriangles">Largest number of triangles in a meshlet</param>
+	/// <returns>The meshlets in the order of their index ranges</returns>
+	static std::vector<Meshlet> build(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, size_t maxVertices = 64, size_t maxTriangles = 124);
+
+	/// <summary>
+	/// Computes the bounding sphere and the normal cone of a range of triangles
+	/// </summary>
+	/// <param name="vertices"></param>
+	/// <param name="indices"></param>
+	/// <param name="meshlet">firstIndex and indexCount select the triangles, receives the bounds</param>
+	static void computeBounds(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, Meshlet& meshlet);
+};
@@ -4,7 +4,14 @@ class OffscreenRenderPass : public RenderPass
 {
 private:
 	VkRenderPass m_renderPass;
+
+	/// <summary>
+	/// Keeps the contents of the render target instead of clearing them
+	/// </summary>
+	bool m_loadContents = false;
 public:
+	OffscreenRenderPass(bool loadContents = false) : m_loadContents(loadContents) {}
+
 	void createRenderPass(VkDevice device, VkFormat swapChainImageFormat, VkFormat depthFormat) override;
 	void dispose(VkDevice device) override;
 	VkRenderPass getRenderPass() override { return m_renderPass; }
@@ -45,7 +45,14 @@ void PBRMaterial::init(Renderer* renderer)
 
 void PBRMaterial::dispose(Renderer* renderer)
 {
-	// No need to do anything here since the renderer will dispose the image buffer itself
+	// Free the GPU resources now, the renderer skips disposed buffers when it shuts down
+	for (ImageTexture* texture : { albedoTexture.get(), normalTexture.get(), metRoughTexture.get(), aoTexture.get() }) {
+		if (texture != nullptr) {
+			renderer->disposeImageTexture(texture->bufferIndex);
+		}
+	}
+	renderer->disposeUniformBuffer(m_uniformBufferIndex);
+	Material::markChanged();
 }
 
 void PBRMaterial::bindMaterial(Renderer* renderer, VkCommandBuffer commandBuffer, int firstSet, int frame)
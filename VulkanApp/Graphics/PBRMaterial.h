@@ -66,6 +66,15 @@ public:
 	/// <param name="frame"></param>
 	void bindMaterial(Renderer* renderer, VkCommandBuffer commandBuffer, int firstSet, int frame) override;
 
+	/// <summary>
+	/// Returns the average of the albedo texture tinted with the albedo color
+	/// </summary>
+	/// <returns></returns>
+	glm::vec4 getBaseColor() const override {
+		glm::vec4 color = albedoTexture ? albedoTexture->getAverageColor() : glm::vec4(1.0f);
+		return color * properties.albedoColor;
+	}
+
 	/// <summary>
 	/// Set the albedo texture
 	/// </summary>
@@ -29,11 +29,15 @@ void Pipeline::createPipeline(VkDevice device, VkRenderPass renderPass, VkViewpo
 		throw std::runtime_error("Pipeline layout must be created before creating the pipeline!");
 	}
 
+	// Pipelines without a fragment shader only write depth, e.g. for a depth pre-pass
+	bool hasFragmentShader = !m_shaderSources.frag.empty();
 	auto vertexShaderSrc = readFile(m_shaderSources.vert);
-	auto fragmentShaderSrc = readFile(m_shaderSources.frag);
-
 	VkShaderModule vertShaderModule = createShaderModule(device, vertexShaderSrc);
-	VkShaderModule fragShaderModule = createShaderModule(device, fragmentShaderSrc);
+	VkShaderModule fragShaderModule = VK_NULL_HANDLE;
+	if (hasFragmentShader) {
+		auto fragmentShaderSrc = readFile(m_shaderSources.frag);
+		fragShaderModule = createShaderModule(device, fragmentShaderSrc);
+	}
 
 	// CREATE SHADER STAGE INFOS
 	VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
@@ -51,10 +55,11 @@ void Pipeline::createPipeline(VkDevice device, VkRenderPass renderPass, VkViewpo
 	VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
 
 	// VERTEX INPUT
-	VkVertexInputBindingDescription bindingDescription{};
-	bindingDescription.binding = m_vertexBindingInfo.binding;
-	bindingDescription.stride = m_vertexBindingInfo.stride;
-	bindingDescription.inputRate = m_vertexBindingInfo.inputRate;
+	std::vector<VkVertexInputBindingDescription> bindingDescriptions;
+	bindingDescriptions.push_back({ m_vertexBindingInfo.binding, m_vertexBindingInfo.stride, m_vertexBindingInfo.inputRate });
+	for (const auto& bindingInfo : m_additionalBindingInfos) {
+		bindingDescriptions.push_back({ bindingInfo.binding, bindingInfo.stride, bindingInfo.inputRate });
+	}
 
 	std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
 	for (const auto& attrInfo : m_vertexAttributeInofs) {
@@ -68,15 +73,15 @@ void Pipeline::createPipeline(VkDevice device, VkRenderPass renderPass, VkViewpo
 
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertexInputInfo.vertexBindingDescriptionCount = 1;
-	vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+	vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
+	vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
 	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
 	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
 	// INPUT ASSEMBLY
 	VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
 	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	inputAssembly.topology = this->topology;
 	inputAssembly.primitiveRestartEnable = VK_FALSE;
 
 	// VIEWPORT AND SCISSOR
@@ -109,7 +114,7 @@ void Pipeline::createPipeline(VkDevice device, VkRenderPass renderPass, VkViewpo
 
 	// COLOR BLENDING
 	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachment.colorWriteMask = this->colorWriteMask;
 	colorBlendAttachment.blendEnable = VK_TRUE;
 	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
 	colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
@@ -135,7 +140,7 @@ void Pipeline::createPipeline(VkDevice device, VkRenderPass renderPass, VkViewpo
 	// PIPELINE CREATION
 	VkGraphicsPipelineCreateInfo pipelineInfo{};
 	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	pipelineInfo.stageCount = 2;
+	pipelineInfo.stageCount = hasFragmentShader ? 2 : 1;
 	pipelineInfo.pStages = shaderStages;
 	pipelineInfo.pVertexInputState = &vertexInputInfo;
 	pipelineInfo.pInputAssemblyState = &inputAssembly;
@@ -159,7 +164,9 @@ void Pipeline::createPipeline(VkDevice device, VkRenderPass renderPass, VkViewpo
 		std::printf("[GFX]: Graphics pipeline created successfully.\n");
 	}
 
-	vkDestroyShaderModule(device, fragShaderModule, nullptr);
+	if (fragShaderModule != VK_NULL_HANDLE) {
+		vkDestroyShaderModule(device, fragShaderModule, nullptr);
+	}
 	vkDestroyShaderModule(device, vertShaderModule, nullptr);
 }
 
@@ -11,6 +11,7 @@ private:
 	ShaderSourceCollection m_shaderSources;
 	std::vector<VertexAttributeInfo> m_vertexAttributeInofs;
 	VertexBindingInfo m_vertexBindingInfo;
+	std::vector<VertexBindingInfo> m_additionalBindingInfos;
 	VkPipelineLayout m_pipelineLayout;
 
 
@@ -20,6 +21,8 @@ public:
 	VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS;
 	VkBool32 depthTestEnable = VK_TRUE;
 	VkBool32 depthWriteEnable = VK_TRUE;
+	VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	VkColorComponentFlags colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
 	VkPipeline pipeline;
 
 	VkPipelineLayout getPipelineLayout() const {
@@ -31,6 +34,14 @@ public:
 		m_vertexAttributeInofs.push_back(attributeInfo);
 	}
 
+	/// <summary>
+	/// Adds a binding next to the one of the constructor, e.g. per instance attributes
+	/// </summary>
+	/// <param name="bindingInfo"></param>
+	void addVertexBinding(const VertexBindingInfo& bindingInfo) {
+		m_additionalBindingInfos.push_back(bindingInfo);
+	}
+
 	void createPipelineLayout(VkDevice device, VkDescriptorSetLayout* descriptorSetLayouts, uint32_t descriptorSetLayoutCount, VkPushConstantRange* pushConstantRanges = nullptr, uint32_t pushConstantRangeCount = 0);
 	void createPipeline(VkDevice device, VkRenderPass renderPass, VkViewport viewport, VkRect2D scissor);
 	static VkShaderModule createShaderModule(VkDevice device, const std::vector<char>& code);
@@ -13,10 +13,22 @@ Pipeline* PipelineManager::getPipeline(const std::string& name)
 	return (it != m_pipelines.end()) ? it->second.get() : nullptr;
 }
 
+void PipelineManager::setDepthPrePassVariants(const std::string& name, const DepthPrePassVariants& variants)
+{
+	m_depthPrePassVariants[name] = variants;
+}
+
+const DepthPrePassVariants* PipelineManager::getDepthPrePassVariants(const std::string& name) const
+{
+	auto it = m_depthPrePassVariants.find(name);
+	return (it != m_depthPrePassVariants.end()) ? &it->second : nullptr;
+}
+
 void PipelineManager::destroyAllPipelines(VkDevice device)
 {
 	for (auto& pair : m_pipelines) {
 		pair.second->destroy(device);
 	}
 	m_pipelines.clear();
+	m_depthPrePassVariants.clear();
 }
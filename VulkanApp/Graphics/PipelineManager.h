@@ -5,6 +5,15 @@
 #include <string>
 #include "Pipeline.h"
 
+/// <summary>
+/// The pipelines replacing a pipeline while a depth pre-pass is rendered
+/// Both need the pipeline layout of the replaced pipeline, so the draws bind the same descriptor sets and push constants.
+/// </summary>
+struct DepthPrePassVariants {
+	std::string depthPipeline;		// Writes the depth only
+	std::string shadingPipeline;	// Shades the fragments with the depth of the pre-pass
+};
+
 /// <summary>
 /// Class to manage multiple pipelines
 /// </summary>
@@ -12,12 +21,15 @@ class PipelineManager
 {
 private:
 	std::unordered_map<std::string, std::unique_ptr<Pipeline>> m_pipelines;
+	std::unordered_map<std::string, DepthPrePassVariants> m_depthPrePassVariants;
 
 public:
 	PipelineManager() = default;
 	~PipelineManager() = default;
 	Pipeline* createPipeline(const std::string& name, ShaderSourceCollection shaderSources, VertexBindingInfo bindingInfo);
 	Pipeline* getPipeline(const std::string& name);
+	void setDepthPrePassVariants(const std::string& name, const DepthPrePassVariants& variants);
+	const DepthPrePassVariants* getDepthPrePassVariants(const std::string& name) const;
 	void destroyAllPipelines(VkDevice device);
 };
 
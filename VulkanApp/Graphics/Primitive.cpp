@@ -130,6 +130,66 @@ PrimitiveData Primitive::createSphere(int latitudeSegments /*= 16*/, int longitu
 	return sphereData;
 }
 
+PrimitiveData Primitive::createLine()
+{
+	PrimitiveData lineData;
+	lineData.vertices = std::vector<Vertex>{
+		{{0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}, {0.0f, 0.0f}},
+		{{1.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}, {1.0f, 0.0f}},
+	};
+	lineData.indices = std::vector<uint32_t>{
+		0, 1
+	};
+	return lineData;
+}
+
+PrimitiveData Primitive::createWireCube()
+{
+	PrimitiveData cubeData;
+
+	// Corner i has its x, y and z sign in the bits 0, 1 and 2
+	for (int corner = 0; corner < 8; corner++) {
+		Vertex vertex = {};
+		vertex.pos = glm::vec3(corner & 1 ? 0.5f : -0.5f, corner & 2 ? 0.5f : -0.5f, corner & 4 ? 0.5f : -0.5f);
+		vertex.color = glm::vec3(1.0f);
+		cubeData.vertices.push_back(vertex);
+	}
+
+	// Every edge connects two corners differing in one bit
+	for (uint32_t corner = 0; corner < 8; corner++) {
+		for (uint32_t axis = 1; axis < 8; axis <<= 1) {
+			if ((corner & axis) == 0) {
+				cubeData.indices.push_back(corner);
+				cubeData.indices.push_back(corner | axis);
+			}
+		}
+	}
+	return cubeData;
+}
+
+PrimitiveData Primitive::createWireSphere(int segments, float radius)
+{
+	PrimitiveData sphereData;
+	for (int circle = 0; circle < 3; circle++) {
+		uint32_t first = static_cast<uint32_t>(sphereData.vertices.size());
+		for (int segment = 0; segment < segments; segment++) {
+			float angle = 2.0f * std::numbers::pi_v<float> * segment / segments;
+			float a = std::cos(angle) * radius;
+			float b = std::sin(angle) * radius;
+
+			// Circles around the z, x and y axis
+			Vertex vertex = {};
+			vertex.pos = circle == 0 ? glm::vec3(a, b, 0.0f) : circle == 1 ? glm::vec3(0.0f, a, b) : glm::vec3(b, 0.0f, a);
+			vertex.color = glm::vec3(1.0f);
+			sphereData.vertices.push_back(vertex);
+
+			sphereData.indices.push_back(first + segment);
+			sphereData.indices.push_back(first + (segment + 1) % segments);
+		}
+	}
+	return sphereData;
+}
+
 PrimitiveData Primitive::create(PrimitiveType primitiveType)
 {
 	switch (primitiveType)
@@ -142,6 +202,12 @@ PrimitiveData Primitive::create(PrimitiveType primitiveType)
 		return createCube();
 	case PrimitiveType::PRIMITIVE_TYPE_SPHERE:
 		return createSphere();
+	case PrimitiveType::PRIMITIVE_TYPE_LINE:
+		return createLine();
+	case PrimitiveType::PRIMITIVE_TYPE_WIRE_CUBE:
+		return createWireCube();
+	case PrimitiveType::PRIMITIVE_TYPE_WIRE_SPHERE:
+		return createWireSphere();
 	default:
 		throw std::runtime_error("Unknown primitive type!");
 	}
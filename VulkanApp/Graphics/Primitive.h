@@ -17,7 +17,10 @@ enum class PrimitiveType {
 	PRIMITIVE_TYPE_TRIANGLE,
 	PRIMITIVE_TYPE_QUAD,
 	PRIMITIVE_TYPE_CUBE,
-	PRIMITIVE_TYPE_SPHERE
+	PRIMITIVE_TYPE_SPHERE,
+	PRIMITIVE_TYPE_LINE,		// Line list from the origin to (1, 0, 0)
+	PRIMITIVE_TYPE_WIRE_CUBE,	// Line list of the edges of the cube
+	PRIMITIVE_TYPE_WIRE_SPHERE	// Line list of three circles around the axes
 };
 
 /// <summary>
@@ -52,6 +55,26 @@ private:
 	/// <param name="radius"></param>
 	/// <returns></returns>
 	static PrimitiveData createSphere(int latitudeSegments = 16, int longitudeSegments = 16, float radius = 0.5f);
+
+	/// <summary>
+	/// Create a line primitive
+	/// </summary>
+	/// <returns></returns>
+	static PrimitiveData createLine();
+
+	/// <summary>
+	/// Create the edges of the cube primitive
+	/// </summary>
+	/// <returns></returns>
+	static PrimitiveData createWireCube();
+
+	/// <summary>
+	/// Create three circles with the radius of the sphere primitive
+	/// </summary>
+	/// <param name="segments"></param>
+	/// <param name="radius"></param>
+	/// <returns></returns>
+	static PrimitiveData createWireSphere(int segments = 32, float radius = 0.5f);
 public:
 
 	/// <summary>
@@ -60,5 +83,16 @@ public:
 	/// <param name="primitiveType"></param>
 	/// <returns></returns>
 	static PrimitiveData create(PrimitiveType primitiveType);
+
+	/// <summary>
+	/// Checks if the indices of a primitive type form a line list instead of a triangle list
+	/// </summary>
+	/// <param name="primitiveType"></param>
+	/// <returns></returns>
+	static bool isLineList(PrimitiveType primitiveType) {
+		return primitiveType == PrimitiveType::PRIMITIVE_TYPE_LINE ||
+			primitiveType == PrimitiveType::PRIMITIVE_TYPE_WIRE_CUBE ||
+			primitiveType == PrimitiveType::PRIMITIVE_TYPE_WIRE_SPHERE;
+	}
 };
 
@@ -0,0 +1,97 @@
+#include "QuadRingBuffer.h"
+#include "../Utils.h"
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+void QuadRingBuffer::beginFrame(VkDevice device, uint32_t frame)
+{
+	if (frame >= m_frames.size()) {
+		m_frames.resize(frame + 1);
+	}
+	m_frame = frame;
+
+	// The command buffer of the image finished, so the outgrown buffers and the ring contents are free again
+	FrameRing& ring = m_frames[frame];
+	for (RingBuffer& retired : ring.retired) {
+		destroyRingBuffer(device, retired);
+	}
+	ring.retired.clear();
+	ring.current.usedQuads = 0;
+}
+
+QuadRange QuadRingBuffer::allocate(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t quadCount)
+{
+	if (m_frames.empty()) {
+		throw std::runtime_error("failed to allocate quads: no frame was started!");
+	}
+
+	// Draws recorded earlier in the frame still read the current buffer, so a larger one replaces it until the frame finished
+	FrameRing& frame = m_frames[m_frame];
+	RingBuffer& ring = frame.current;
+	if (ring.usedQuads + quadCount > ring.capacity) {
+		if (ring.buffer != VK_NULL_HANDLE) {
+			frame.retired.push_back(ring);
+		}
+		uint32_t capacity = std::max({ quadCount * 2, ring.capacity * 2, MIN_CAPACITY });
+		ring = RingBuffer();
+		createRingBuffer(physicalDevice, device, capacity, ring);
+	}
+
+	QuadRange range;
+	range.buffer = ring.buffer;
+	range.indexOffset = static_cast<VkDeviceSize>(m_vertexSize) * 4 * ring.capacity;
+	range.firstQuad = ring.usedQuads;
+	range.vertices = static_cast<char*>(ring.mapped) + static_cast<size_t>(m_vertexSize) * 4 * ring.usedQuads;
+	ring.usedQuads += quadCount;
+	return range;
+}
+
+void QuadRingBuffer::createRingBuffer(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t capacity, RingBuffer& ring) const
+{
+	VkDeviceSize vertexSize = static_cast<VkDeviceSize>(m_vertexSize) * 4 * capacity;
+	VkDeviceSize indexSize = sizeof(uint32_t) * 6 * static_cast<VkDeviceSize>(capacity);
+	createBuffer(physicalDevice,
+		device,
+		vertexSize + indexSize,
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		&ring.buffer,
+		&ring.memory);
+	if (vkMapMemory(device, ring.memory, 0, vertexSize + indexSize, 0, &ring.mapped) != VK_SUCCESS) {
+		throw std::runtime_error("failed to map quad ring buffer!");
+	}
+	ring.capacity = capacity;
+	ring.usedQuads = 0;
+
+	// Two triangles per quad, the vertices of a quad are top left, bottom left, bottom right and top right
+	static constexpr std::array<uint32_t, 6> QUAD_INDICES = { 0, 1, 2, 0, 2, 3 };
+	uint32_t* indices = reinterpret_cast<uint32_t*>(static_cast<char*>(ring.mapped) + vertexSize);
+	for (uint32_t quad = 0; quad < capacity; quad++) {
+		for (size_t i = 0; i < QUAD_INDICES.size(); i++) {
+			indices[quad * 6 + i] = quad * 4 + QUAD_INDICES[i];
+		}
+	}
+}
+
+void QuadRingBuffer::destroyRingBuffer(VkDevice device, RingBuffer& ring)
+{
+	if (ring.buffer == VK_NULL_HANDLE) {
+		return;
+	}
+	vkUnmapMemory(device, ring.memory);
+	vkDestroyBuffer(device, ring.buffer, nullptr);
+	vkFreeMemory(device, ring.memory, nullptr);
+	ring = RingBuffer();
+}
+
+void QuadRingBuffer::dispose(VkDevice device)
+{
+	for (FrameRing& frame : m_frames) {
+		destroyRingBuffer(device, frame.current);
+		for (RingBuffer& retired : frame.retired) {
+			destroyRingBuffer(device, retired);
+		}
+	}
+	m_frames.clear();
+}
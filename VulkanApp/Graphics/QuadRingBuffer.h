@@ -0,0 +1,79 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// Room for quads in the ring buffer of a frame
+/// </summary>
+struct QuadRange {
+	VkBuffer buffer = VK_NULL_HANDLE;	// Holds the vertices and, from indexOffset on, the indices
+	VkDeviceSize indexOffset = 0;
+	uint32_t firstQuad = 0;				// The first index of the range is firstQuad * 6
+	void* vertices = nullptr;			// Mapped vertices of the first quad, four per quad
+};
+
+/// <summary>
+/// Host visible buffers for quads streamed every frame, one per swapchain image
+/// The quads of a frame are appended, so several flushes in one frame don't overwrite each other. The buffers hold a
+/// fixed quad index pattern, only the vertices are written per frame. A buffer that is outgrown during a frame is kept
+/// until the frame is recorded again, draws recorded before still read it.
+/// </summary>
+class QuadRingBuffer
+{
+private:
+	/// <summary>
+	/// A host visible buffer with room for capacity quads, the vertices are followed by the indices
+	/// </summary>
+	struct RingBuffer {
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		void* mapped = nullptr;
+		uint32_t capacity = 0;
+		uint32_t usedQuads = 0;
+	};
+
+	/// <summary>
+	/// The ring buffer of a swapchain image and the buffers it outgrew during the frame
+	/// </summary>
+	struct FrameRing {
+		RingBuffer current;
+		std::vector<RingBuffer> retired;
+	};
+
+	static constexpr uint32_t MIN_CAPACITY = 256;
+
+	uint32_t m_vertexSize;
+	std::vector<FrameRing> m_frames;
+	uint32_t m_frame = 0;
+
+	void createRingBuffer(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t capacity, RingBuffer& ring) const;
+	static void destroyRingBuffer(VkDevice device, RingBuffer& ring);
+
+public:
+	/// <summary>
+	/// Creates the ring, the buffers are created on the first allocation
+	/// </summary>
+	/// <param name="vertexSize">Size of a vertex in bytes</param>
+	explicit QuadRingBuffer(uint32_t vertexSize) : m_vertexSize(vertexSize) {}
+	~QuadRingBuffer() = default;
+
+	/// <summary>
+	/// Starts a frame, the previous command buffer of the swapchain image has finished
+	/// </summary>
+	/// <param name="device"></param>
+	/// <param name="frame">Index of the swapchain image</param>
+	void beginFrame(VkDevice device, uint32_t frame);
+
+	/// <summary>
+	/// Reserves room for quads in the buffer of the frame, creates a larger buffer if needed
+	/// </summary>
+	/// <param name="physicalDevice"></param>
+	/// <param name="device"></param>
+	/// <param name="quadCount"></param>
+	/// <returns></returns>
+	QuadRange allocate(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t quadCount);
+
+	void dispose(VkDevice device);
+};
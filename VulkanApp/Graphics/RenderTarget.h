@@ -207,6 +207,18 @@ public:
     /// <returns>The image view associated with this render target.</returns>
     VkImageView getImageView() const { return m_imageView; }
 
+    /// <summary>
+    /// Gets the Vulkan image view of the depth image, it can be sampled once the render pass ended.
+    /// </summary>
+    /// <returns>The depth image view associated with this render target.</returns>
+    VkImageView getDepthImageView() const { return m_depthImageView; }
+
+    /// <summary>
+    /// Gets the size of the render target.
+    /// </summary>
+    /// <returns>The extent of the images.</returns>
+    VkExtent2D getExtent() const { return m_extent; }
+
     /// <summary>
     /// Gets the framebuffer handle used by this render target.
     /// </summary>
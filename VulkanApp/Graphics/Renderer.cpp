@@ -28,7 +28,7 @@ void Renderer::createInstance()
 	appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
 	appInfo.pEngineName = "GFX 6";
 	appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-	appInfo.apiVersion = VK_API_VERSION_1_1;
+	appInfo.apiVersion = VK_API_VERSION_1_2;	// 1.2 for vkCmdDrawIndexedIndirectCount
 
 	// Creation info for a Vulkan instance
 	VkInstanceCreateInfo createInfo = {};
@@ -137,6 +137,30 @@ void Renderer::createLogicalDevice()
 	VkPhysicalDeviceFeatures deviceFeatures = {};
 	deviceFeatures.samplerAnisotropy = VK_TRUE; // Enable anisotropic filtering TODO Add 
 
+	// The indirect draw features are optional, indirect draw lists are only available if they are supported
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(m_renderDevice.physicalDevice, &supportedFeatures);
+	deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+	deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+	m_multiDrawIndirectSupported = supportedFeatures.multiDrawIndirect == VK_TRUE && supportedFeatures.drawIndirectFirstInstance == VK_TRUE;
+
+	// Draw indirect count is core since Vulkan 1.2 but still optional
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(m_renderDevice.physicalDevice, &deviceProperties);
+	bool vulkan12Supported = deviceProperties.apiVersion >= VK_API_VERSION_1_2;
+	VkPhysicalDeviceVulkan12Features supportedVulkan12Features = {};
+	supportedVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	if (vulkan12Supported) {
+		VkPhysicalDeviceFeatures2 supportedFeatures2 = {};
+		supportedFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		supportedFeatures2.pNext = &supportedVulkan12Features;
+		vkGetPhysicalDeviceFeatures2(m_renderDevice.physicalDevice, &supportedFeatures2);
+	}
+	VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	vulkan12Features.drawIndirectCount = supportedVulkan12Features.drawIndirectCount;
+	m_drawIndirectCountSupported = supportedVulkan12Features.drawIndirectCount == VK_TRUE;
+
 	// Create the logical device
 	VkDeviceCreateInfo createInfo = {};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -145,6 +169,7 @@ void Renderer::createLogicalDevice()
 	createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
 	createInfo.ppEnabledExtensionNames = deviceExtensions.data();
 	createInfo.pEnabledFeatures = &deviceFeatures;
+	createInfo.pNext = vulkan12Supported ? &vulkan12Features : nullptr;
 
 	// Create the logical device
 	if (vkCreateDevice(m_renderDevice.physicalDevice, &createInfo, nullptr, &m_renderDevice.logicalDevice) != VK_SUCCESS) {
@@ -254,6 +279,10 @@ void Renderer::createRenderPass()
 	auto offScreenRenderPass = std::make_unique<OffscreenRenderPass>();
 	offScreenRenderPass->createRenderPass(m_renderDevice.logicalDevice, m_swapChainImageFormat, m_depthBufferFormat);
 	m_offscreenRenderPassIndex = m_renderPassManager.addRenderPass(std::move(offScreenRenderPass));
+
+	auto offScreenLoadRenderPass = std::make_unique<OffscreenRenderPass>(true);
+	offScreenLoadRenderPass->createRenderPass(m_renderDevice.logicalDevice, m_swapChainImageFormat, m_depthBufferFormat);
+	m_offscreenLoadRenderPassIndex = m_renderPassManager.addRenderPass(std::move(offScreenLoadRenderPass));
 }
 
 void Renderer::createDescriptorSetLayout()
@@ -352,7 +381,7 @@ void Renderer::createDescriptorSetLayout()
 	storageBufferLayoutBinding.binding = 0;
 	storageBufferLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
 	storageBufferLayoutBinding.descriptorCount = 1;
-	storageBufferLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	storageBufferLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
 	storageBufferLayoutBinding.pImmutableSamplers = nullptr;
 
 	VkDescriptorSetLayoutCreateInfo storageBufferLayoutInfo = {};
@@ -385,19 +414,10 @@ void Renderer::createGraphicsPipelines()
 	pushConstantRange.offset = 0;
 	pushConstantRange.size = sizeof(UboModel);
 
-	// CREATE PIPLINE RELATED VIWPORT
-	VkViewport viewport = {};
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-	viewport.width = static_cast<float>(m_swapChainExtent.width);
-	viewport.height = static_cast<float>(m_swapChainExtent.height);
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
-
-	// CREATE PIPELINES RELATED SCISSOR
-	VkRect2D scissor = {};
-	scissor.offset = { 0, 0 };
-	scissor.extent = m_swapChainExtent;
+	// CREATE PIPLINE RELATED VIWPORT AND SCISSOR
+	VkViewport viewport;
+	VkRect2D scissor;
+	this->getPipelineViewport(viewport, scissor);
 
 	// CREATE AN VERTEX BINDING INFO
 	VertexBindingInfo bindingInfo = {};
@@ -563,11 +583,11 @@ void Renderer::createGraphicsPipelines()
 
 void Renderer::createDepthBufferImage()
 {
-	// Find the best supported depth format
+	// Find the best supported depth format, render targets sample it for the depth pyramid
 	m_depthBufferFormat = chooseSupportedFormat(
 		{ VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D32_SFLOAT, VK_FORMAT_D24_UNORM_S8_UINT },
 		VK_IMAGE_TILING_OPTIMAL,
-		VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+		VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
 
 	// Create the depth image
 	m_depthBufferImage = createImage(
@@ -842,6 +862,304 @@ void Renderer::createRendererPrimitives()
 	triangleBuffer.vertexBufferIndex = createVertexBuffer(&triangleData.vertices);
 	triangleBuffer.indexBufferIndex = createIndexBuffer(&triangleData.indices);
 	m_rendererPrimitives[PrimitiveType::PRIMITIVE_TYPE_TRIANGLE] = triangleBuffer;
+
+	// Create the line list primitives of the debug draw
+	for (PrimitiveType lineType : { PrimitiveType::PRIMITIVE_TYPE_LINE, PrimitiveType::PRIMITIVE_TYPE_WIRE_CUBE, PrimitiveType::PRIMITIVE_TYPE_WIRE_SPHERE }) {
+		auto lineData = Primitive::create(lineType);
+		PrimitiveBuffer lineBuffer = {};
+		lineBuffer.vertexBufferIndex = createVertexBuffer(&lineData.vertices);
+		lineBuffer.indexBufferIndex = createIndexBuffer(&lineData.indices);
+		m_rendererPrimitives[lineType] = lineBuffer;
+	}
+}
+
+void Renderer::createGeometryPool()
+{
+	m_geometryPool.init(m_renderDevice.physicalDevice, m_renderDevice.logicalDevice, m_graphicsQueue, m_commandPool,
+		static_cast<uint32_t>(m_renderConfig.geometryPageVertices), static_cast<uint32_t>(m_renderConfig.geometryPageIndices), static_cast<uint32_t>(m_numFramesInFlight));
+}
+
+void Renderer::createCullingPipeline()
+{
+	// The objects, the draw commands and the draw counts are storage buffers
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(IndirectCullConstants);
+
+	std::array<VkDescriptorSetLayout, 3> cullingLayouts = {
+		m_storageBufferSetLayout,		// Objects
+		m_storageBufferSetLayout,		// Draw commands
+		m_storageBufferSetLayout		// Draw counts
+	};
+	m_cullingPipeline = std::make_unique<ComputePipeline>("Shaders/cull_comp.spv");
+	m_cullingPipeline->createPipelineLayout(m_renderDevice.logicalDevice, cullingLayouts.data(), static_cast<uint32_t>(cullingLayouts.size()), &pushConstantRange, 1);
+	m_cullingPipeline->createPipeline(m_renderDevice.logicalDevice);
+}
+
+void Renderer::createDepthPyramidPipelines()
+{
+	// The reduction reads the depth image or the level before and writes the next level
+	std::array<VkDescriptorSetLayoutBinding, 2> reduceBindings = {};
+	reduceBindings[0].binding = 0;
+	reduceBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	reduceBindings[0].descriptorCount = 1;
+	reduceBindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	reduceBindings[1].binding = 1;
+	reduceBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	reduceBindings[1].descriptorCount = 1;
+	reduceBindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	VkDescriptorSetLayoutCreateInfo reduceLayoutInfo = {};
+	reduceLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	reduceLayoutInfo.bindingCount = static_cast<uint32_t>(reduceBindings.size());
+	reduceLayoutInfo.pBindings = reduceBindings.data();
+	if (vkCreateDescriptorSetLayout(m_renderDevice.logicalDevice, &reduceLayoutInfo, nullptr, &m_depthReduceSetLayout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create depth reduce descriptor set layout!");
+	}
+
+	// The occlusion culling reads the whole pyramid and the view projection it was rendered with
+	std::array<VkDescriptorSetLayoutBinding, 2> pyramidBindings = {};
+	pyramidBindings[0].binding = 0;
+	pyramidBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	pyramidBindings[0].descriptorCount = 1;
+	pyramidBindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pyramidBindings[1].binding = 1;
+	pyramidBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	pyramidBindings[1].descriptorCount = 1;
+	pyramidBindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	VkDescriptorSetLayoutCreateInfo pyramidLayoutInfo = {};
+	pyramidLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	pyramidLayoutInfo.bindingCount = static_cast<uint32_t>(pyramidBindings.size());
+	pyramidLayoutInfo.pBindings = pyramidBindings.data();
+	if (vkCreateDescriptorSetLayout(m_renderDevice.logicalDevice, &pyramidLayoutInfo, nullptr, &m_depthPyramidSetLayout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create depth pyramid descriptor set layout!");
+	}
+
+	VkPushConstantRange reduceConstantRange = {};
+	reduceConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	reduceConstantRange.offset = 0;
+	reduceConstantRange.size = sizeof(DepthReduceConstants);
+	m_depthReducePipeline = std::make_unique<ComputePipeline>("Shaders/depth_reduce_comp.spv");
+	m_depthReducePipeline->createPipelineLayout(m_renderDevice.logicalDevice, &m_depthReduceSetLayout, 1, &reduceConstantRange, 1);
+	m_depthReducePipeline->createPipeline(m_renderDevice.logicalDevice);
+
+	// The culling shader compiled with OCCLUSION, it adds the visibility of the objects and the pyramid
+	VkPushConstantRange cullConstantRange = {};
+	cullConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	cullConstantRange.offset = 0;
+	cullConstantRange.size = sizeof(IndirectCullConstants);
+
+	std::array<VkDescriptorSetLayout, 5> cullingLayouts = {
+		m_storageBufferSetLayout,		// Objects
+		m_storageBufferSetLayout,		// Draw commands
+		m_storageBufferSetLayout,		// Draw counts
+		m_storageBufferSetLayout,		// Visibility
+		m_depthPyramidSetLayout			// Depth pyramid
+	};
+	m_occlusionCullingPipeline = std::make_unique<ComputePipeline>("Shaders/cull_occlusion_comp.spv");
+	m_occlusionCullingPipeline->createPipelineLayout(m_renderDevice.logicalDevice, cullingLayouts.data(), static_cast<uint32_t>(cullingLayouts.size()), &cullConstantRange, 1);
+	m_occlusionCullingPipeline->createPipeline(m_renderDevice.logicalDevice);
+}
+
+void Renderer::createDepthPrePassPipelines()
+{
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(UboModel);
+
+	VkViewport viewport;
+	VkRect2D scissor;
+	this->getPipelineViewport(viewport, scissor);
+
+	VertexBindingInfo bindingInfo = { 0, sizeof(Vertex), VK_VERTEX_INPUT_RATE_VERTEX };
+	VertexAttributeInfo positionAttr = { 0, 0, VK_FORMAT_R32G32B32_SFLOAT, static_cast<uint32_t>(offsetof(Vertex, pos)) };
+	VertexAttributeInfo colorAttr = { 0, 1, VK_FORMAT_R32G32B32_SFLOAT, static_cast<uint32_t>(offsetof(Vertex, color)) };
+	VertexAttributeInfo texCoordAttr = { 0, 2, VK_FORMAT_R32G32_SFLOAT, static_cast<uint32_t>(offsetof(Vertex, texCoord)) };
+	VertexAttributeInfo normalAttr = { 0, 3, VK_FORMAT_R32G32B32_SFLOAT, static_cast<uint32_t>(offsetof(Vertex, normal)) };
+
+	std::array<VkDescriptorSetLayout, 7> pipline3DLayouts = {
+		m_cameraDescriptorSetLayout,	// CameraUBO
+		m_samplerSetLayout,				// Albedo map
+		m_samplerSetLayout,				// Normal map
+		m_samplerSetLayout,				// MetallicRoughness map
+		m_samplerSetLayout,				// AO map
+		m_uniformBufferSetLayout,		// Material properties
+		m_uniformBufferSetLayout		// Directional Light properties
+	};
+	std::array<VkDescriptorSetLayout, 8> pipline3DInstancedLayouts = {
+		m_cameraDescriptorSetLayout,	// CameraUBO
+		m_storageBufferSetLayout,		// Instance data
+		m_samplerSetLayout, 			// Albedo map
+		m_samplerSetLayout,				// Normal map
+		m_samplerSetLayout,				// MetallicRoughness map
+		m_samplerSetLayout,				// AO map
+		m_uniformBufferSetLayout,		// Material properties
+		m_uniformBufferSetLayout		// Directional Light properties
+	};
+	ShaderSourceCollection shaders3D = { "Shaders/vert.spv", "Shaders/frag.spv" };
+	ShaderSourceCollection shaders3DInstanced = { "Shaders/shader3di_vert.spv", "Shaders/shader3di_frag.spv" };
+
+	// The variants keep the layouts of the PBR pipelines, so the draws bind the same descriptor sets
+	auto offscreenRenderPass = m_renderPassManager.getRenderPass(m_offscreenRenderPassIndex);
+	ShaderSourceCollection shaders3DDepth = { "Shaders/shader_depth_vert.spv", "" };
+	auto pipelinePtr = m_pipelineManager->createPipeline(ToString(PipelineType::PIPELINE_TYPE_GRAPHICS_3D_DEPTH), shaders3DDepth, bindingInfo);
+	pipelinePtr->colorWriteMask = 0;
+	pipelinePtr->addVertexAttribute(positionAttr);
+	pipelinePtr->createPipelineLayout(m_renderDevice.logicalDevice, pipline3DLayouts.data(), static_cast<uint32_t>(pipline3DLayouts.size()), &pushConstantRange, 1);
+	pipelinePtr->createPipeline(m_renderDevice.logicalDevice, offscreenRenderPass->getRenderPass(), viewport, scissor);
+
+	ShaderSourceCollection shaders3DInstancedDepth = { "Shaders/shader3di_depth_vert.spv", "" };
+	pipelinePtr = m_pipelineManager->createPipeline(ToString(PipelineType::PIPELINE_TYPE_GRAPHICS_3D_INSTANCED_DEPTH), shaders3DInstancedDepth, bindingInfo);
+	pipelinePtr->colorWriteMask = 0;
+	pipelinePtr->addVertexAttribute(positionAttr);
+	pipelinePtr->createPipelineLayout(m_renderDevice.logicalDevice, pipline3DInstancedLayouts.data(), static_cast<uint32_t>(pipline3DInstancedLayouts.size()), nullptr, 0);
+	pipelinePtr->createPipeline(m_renderDevice.logicalDevice, offscreenRenderPass->getRenderPass(), viewport, scissor);
+
+	// The shading variants only shade the nearest fragments, the pre-pass already wrote their depth
+	pipelinePtr = m_pipelineManager->createPipeline(ToString(PipelineType::PIPELINE_TYPE_GRAPHICS_3D_EQUAL), shaders3D, bindingInfo);
+	pipelinePtr->depthCompareOp = VK_COMPARE_OP_EQUAL;
+	pipelinePtr->depthWriteEnable = VK_FALSE;
+	pipelinePtr->addVertexAttribute(positionAttr);
+	pipelinePtr->addVertexAttribute(colorAttr);
+	pipelinePtr->addVertexAttribute(texCoordAttr);
+	pipelinePtr->addVertexAttribute(normalAttr);
+	pipelinePtr->createPipelineLayout(m_renderDevice.logicalDevice, pipline3DLayouts.data(), static_cast<uint32_t>(pipline3DLayouts.size()), &pushConstantRange, 1);
+	pipelinePtr->createPipeline(m_renderDevice.logicalDevice, offscreenRenderPass->getRenderPass(), viewport, scissor);
+
+	pipelinePtr = m_pipelineManager->createPipeline(ToString(PipelineType::PIPELINE_TYPE_GRAPHICS_3D_INSTANCED_EQUAL), shaders3DInstanced, bindingInfo);
+	pipelinePtr->depthCompareOp = VK_COMPARE_OP_EQUAL;
+	pipelinePtr->depthWriteEnable = VK_FALSE;
+	pipelinePtr->addVertexAttribute(positionAttr);
+	pipelinePtr->addVertexAttribute(colorAttr);
+	pipelinePtr->addVertexAttribute(texCoordAttr);
+	pipelinePtr->addVertexAttribute(normalAttr);
+	pipelinePtr->createPipelineLayout(m_renderDevice.logicalDevice, pipline3DInstancedLayouts.data(), static_cast<uint32_t>(pipline3DInstancedLayouts.size()), nullptr, 0);
+	pipelinePtr->createPipeline(m_renderDevice.logicalDevice, offscreenRenderPass->getRenderPass(), viewport, scissor);
+
+	this->setDepthPrePassVariants(ToString(PipelineType::PIPELINE_TYPE_GRAPHICS_3D), ToString(PipelineType::PIPELINE_TYPE_GRAPHICS_3D_DEPTH), ToString(PipelineType::PIPELINE_TYPE_GRAPHICS_3D_EQUAL));
+	this->setDepthPrePassVariants(ToString(PipelineType::PIPELINE_TYPE_GRAPHICS_3D_INSTANCED), ToString(PipelineType::PIPELINE_TYPE_GRAPHICS_3D_INSTANCED_DEPTH), ToString(PipelineType::PIPELINE_TYPE_GRAPHICS_3D_INSTANCED_EQUAL));
+
+}
+
+void Renderer::createFontSdfPipeline()
+{
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(UboModel);
+
+	VkViewport viewport;
+	VkRect2D scissor;
+	this->getPipelineViewport(viewport, scissor);
+
+	VertexBindingInfo bindingInfo = { 0, sizeof(Vertex), VK_VERTEX_INPUT_RATE_VERTEX };
+	VertexAttributeInfo positionAttr = { 0, 0, VK_FORMAT_R32G32B32_SFLOAT, static_cast<uint32_t>(offsetof(Vertex, pos)) };
+	VertexAttributeInfo colorAttr = { 0, 1, VK_FORMAT_R32G32B32_SFLOAT, static_cast<uint32_t>(offsetof(Vertex, color)) };
+	VertexAttributeInfo texCoordAttr = { 0, 2, VK_FORMAT_R32G32_SFLOAT, static_cast<uint32_t>(offsetof(Vertex, texCoord)) };
+	VertexAttributeInfo normalAttr = { 0, 3, VK_FORMAT_R32G32B32_SFLOAT, static_cast<uint32_t>(offsetof(Vertex, normal)) };
+
+	// Same layout as the bitmap font pipeline, only the fragment shader differs
+	auto offscreenRenderPass = m_renderPassManager.getRenderPass(m_offscreenRenderPassIndex);
+	std::array<VkDescriptorSetLayout, 2> fontPipelineLayouts = { m_cameraDescriptorSetLayout, m_samplerSetLayout };
+	ShaderSourceCollection fontSdfShaders = { "Shaders/text_vert.spv", "Shaders/text_sdf_frag.spv" };
+	auto pipelinePtr = m_pipelineManager->createPipeline(ToString(PipelineType::PIPELINE_TYPE_FONT_RENDERING_SDF), fontSdfShaders, bindingInfo);
+	pipelinePtr->cullMode = VK_CULL_MODE_NONE;
+	pipelinePtr->addVertexAttribute(positionAttr);
+	pipelinePtr->addVertexAttribute(colorAttr);
+	pipelinePtr->addVertexAttribute(texCoordAttr);
+	pipelinePtr->addVertexAttribute(normalAttr);
+	pipelinePtr->createPipelineLayout(m_renderDevice.logicalDevice, fontPipelineLayouts.data(), static_cast<uint32_t>(fontPipelineLayouts.size()), &pushConstantRange, 1);
+	pipelinePtr->createPipeline(m_renderDevice.logicalDevice, offscreenRenderPass->getRenderPass(), viewport, scissor);
+}
+
+void Renderer::createSpriteBatchPipelines()
+{
+	VkViewport viewport;
+	VkRect2D scissor;
+	this->getPipelineViewport(viewport, scissor);
+
+	// The sprites are transformed on the CPU
+	VertexBindingInfo spriteBindingInfo = { 0, sizeof(SpriteVertex), VK_VERTEX_INPUT_RATE_VERTEX };
+	std::array<VertexAttributeInfo, 4> spriteAttributes = {};
+	spriteAttributes[0] = { 0, 0, VK_FORMAT_R32G32B32_SFLOAT, static_cast<uint32_t>(offsetof(SpriteVertex, pos)) };
+	spriteAttributes[1] = { 0, 1, VK_FORMAT_R32G32B32A32_SFLOAT, static_cast<uint32_t>(offsetof(SpriteVertex, color)) };
+	spriteAttributes[2] = { 0, 2, VK_FORMAT_R32G32_SFLOAT, static_cast<uint32_t>(offsetof(SpriteVertex, texCoord)) };
+	spriteAttributes[3] = { 0, 3, VK_FORMAT_R32_SFLOAT, static_cast<uint32_t>(offsetof(SpriteVertex, layer)) };
+
+	auto offscreenRenderPass = m_renderPassManager.getRenderPass(m_offscreenRenderPassIndex);
+	std::array<VkDescriptorSetLayout, 2> spriteBatchLayouts = { m_cameraDescriptorSetLayout, m_samplerSetLayout };
+	std::array<std::pair<PipelineType, std::string>, 2> spriteBatchPipelines = { {
+		{ PipelineType::PIPELINE_TYPE_SPRITE_BATCH, "Shaders/sprite_batch_frag.spv" },
+		{ PipelineType::PIPELINE_TYPE_SPRITE_BATCH_ARRAY, "Shaders/sprite_batch_array_frag.spv" }
+	} };
+	for (const auto& [pipelineType, fragmentShader] : spriteBatchPipelines) {
+		ShaderSourceCollection spriteShaders = { "Shaders/sprite_batch_vert.spv", fragmentShader };
+		auto pipelinePtr = m_pipelineManager->createPipeline(ToString(pipelineType), spriteShaders, spriteBindingInfo);
+		pipelinePtr->cullMode = VK_CULL_MODE_NONE;
+		pipelinePtr->depthWriteEnable = VK_FALSE; // Transparent sprites are drawn in layer order
+		for (const VertexAttributeInfo& attribute : spriteAttributes) {
+			pipelinePtr->addVertexAttribute(attribute);
+		}
+		pipelinePtr->createPipelineLayout(m_renderDevice.logicalDevice, spriteBatchLayouts.data(), static_cast<uint32_t>(spriteBatchLayouts.size()), nullptr, 0);
+		pipelinePtr->createPipeline(m_renderDevice.logicalDevice, offscreenRenderPass->getRenderPass(), viewport, scissor);
+	}
+}
+
+void Renderer::createDebugDrawPipelines()
+{
+	VkViewport viewport;
+	VkRect2D scissor;
+	this->getPipelineViewport(viewport, scissor);
+
+	// The model matrix and the color are per instance attributes
+	VertexBindingInfo bindingInfo = { 0, sizeof(Vertex), VK_VERTEX_INPUT_RATE_VERTEX };
+	VertexBindingInfo debugInstanceBindingInfo = { 1, sizeof(UboModelColor), VK_VERTEX_INPUT_RATE_INSTANCE };
+	VertexAttributeInfo positionAttr = { 0, 0, VK_FORMAT_R32G32B32_SFLOAT, static_cast<uint32_t>(offsetof(Vertex, pos)) };
+	std::array<VertexAttributeInfo, 5> debugInstanceAttributes = {};
+	for (uint32_t column = 0; column < 4; column++) {
+		debugInstanceAttributes[column] = { 1, 1 + column, VK_FORMAT_R32G32B32A32_SFLOAT, static_cast<uint32_t>(offsetof(UboModelColor, model) + sizeof(glm::vec4) * column) };
+	}
+	debugInstanceAttributes[4] = { 1, 5, VK_FORMAT_R32G32B32A32_SFLOAT, static_cast<uint32_t>(offsetof(UboModelColor, color)) };
+
+	auto offscreenRenderPass = m_renderPassManager.getRenderPass(m_offscreenRenderPassIndex);
+	std::array<VkDescriptorSetLayout, 1> solidColorPipelineLayouts = { m_cameraDescriptorSetLayout };
+	std::array<std::pair<PipelineType, VkPrimitiveTopology>, 2> debugDrawPipelines = { {
+		{ PipelineType::PIPELINE_TYPE_DEBUG_DRAW, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST },
+		{ PipelineType::PIPELINE_TYPE_DEBUG_DRAW_LINES, VK_PRIMITIVE_TOPOLOGY_LINE_LIST }
+	} };
+	for (const auto& [pipelineType, topology] : debugDrawPipelines) {
+		ShaderSourceCollection debugDrawShaders = { "Shaders/debug_draw_vert.spv", "Shaders/solid_frag.spv" };
+		auto pipelinePtr = m_pipelineManager->createPipeline(ToString(pipelineType), debugDrawShaders, bindingInfo);
+		pipelinePtr->topology = topology;
+		if (topology == VK_PRIMITIVE_TOPOLOGY_LINE_LIST) {
+			pipelinePtr->cullMode = VK_CULL_MODE_NONE;
+		}
+		pipelinePtr->addVertexBinding(debugInstanceBindingInfo);
+		pipelinePtr->addVertexAttribute(positionAttr);
+		for (const VertexAttributeInfo& attribute : debugInstanceAttributes) {
+			pipelinePtr->addVertexAttribute(attribute);
+		}
+		pipelinePtr->createPipelineLayout(m_renderDevice.logicalDevice, solidColorPipelineLayouts.data(), static_cast<uint32_t>(solidColorPipelineLayouts.size()), nullptr, 0);
+		pipelinePtr->createPipeline(m_renderDevice.logicalDevice, offscreenRenderPass->getRenderPass(), viewport, scissor);
+	}
+}
+
+void Renderer::getPipelineViewport(VkViewport& viewport, VkRect2D& scissor) const
+{
+	viewport = {};
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = static_cast<float>(m_swapChainExtent.width);
+	viewport.height = static_cast<float>(m_swapChainExtent.height);
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+
+	scissor = {};
+	scissor.offset = { 0, 0 };
+	scissor.extent = m_swapChainExtent;
 }
 
 void Renderer::recordCommands(uint32_t currentImage)
@@ -849,6 +1167,11 @@ void Renderer::recordCommands(uint32_t currentImage)
 	VkCommandBufferBeginInfo beginInfo = {};
 	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
+	// Text, sprites and debug shapes queued by the callbacks go to the ring buffers of this image
+	m_textBatcher.beginFrame(m_renderDevice.logicalDevice, currentImage);
+	m_spriteBatch.beginFrame(m_renderDevice.logicalDevice, currentImage);
+	m_debugDrawBatcher.beginFrame(m_renderDevice.logicalDevice, currentImage);
+
 	// Offscreen callbacks
 	for (auto& offscreenCallback : m_offscreenCallbacks) {
 		offscreenCallback(this, m_commandBuffers[currentImage], currentImage);
@@ -1264,6 +1587,33 @@ void Renderer::validateCurrentPipeline()
 	}
 }
 
+/// <summary>
+/// Returns the command buffer the bind functions record into
+/// This is the secondary command buffer while one is recorded, otherwise the command buffer of the frame.
+/// </summary>
+/// <param name="frame"></param>
+/// <returns></returns>
+VkCommandBuffer Renderer::getBindCommandBuffer(int frame)
+{
+	if (m_recordingCommandBuffer != VK_NULL_HANDLE) {
+		return m_recordingCommandBuffer;
+	}
+	return this->getCommandBuffer(frame);
+}
+
+void Renderer::bindGeometryPage(VkCommandBuffer commandBuffer, int page)
+{
+	// Meshes in the same page share the buffers, only the draw offsets differ
+	if (m_geometryBindCommandBuffer != commandBuffer || m_boundGeometryPage != page) {
+		VkBuffer vertexBuffers[] = { m_geometryPool.getVertexBuffer(page) };
+		VkDeviceSize offsets[] = { 0 };
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+		vkCmdBindIndexBuffer(commandBuffer, m_geometryPool.getIndexBuffer(page), 0, VK_INDEX_TYPE_UINT32);
+		m_geometryBindCommandBuffer = commandBuffer;
+		m_boundGeometryPage = page;
+	}
+}
+
 /// <summary>
 /// Create a shader module from SPIR-V code
 /// </summary>
@@ -1417,6 +1767,17 @@ int Renderer::createStorageBufferDescriptor(VkBuffer storageBuffer, VkDeviceSize
 		throw std::runtime_error("failed to allocate storage buffer descriptor set!");
 	}
 
+	// Store the descriptor set and point it to the buffer
+	m_storageBufferDescriptorSets.push_back(descriptorSet);
+	int descriptorIndex = m_storageBufferDescriptorSets.size() - 1;
+	this->writeStorageBufferDescriptor(descriptorIndex, storageBuffer, bufferSize);
+
+	// Return the index of the descriptor set
+	return descriptorIndex;
+}
+
+void Renderer::writeStorageBufferDescriptor(int descriptorIndex, VkBuffer storageBuffer, VkDeviceSize bufferSize)
+{
 	// Storage buffer info
 	VkDescriptorBufferInfo bufferInfo = {};
 	bufferInfo.buffer = storageBuffer;
@@ -1426,7 +1787,7 @@ int Renderer::createStorageBufferDescriptor(VkBuffer storageBuffer, VkDeviceSize
 	// Descriptor Write info
 	VkWriteDescriptorSet descriptorWrite = {};
 	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	descriptorWrite.dstSet = descriptorSet;
+	descriptorWrite.dstSet = m_storageBufferDescriptorSets[descriptorIndex];
 	descriptorWrite.dstBinding = 0;
 	descriptorWrite.dstArrayElement = 0;
 	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
@@ -1435,12 +1796,6 @@ int Renderer::createStorageBufferDescriptor(VkBuffer storageBuffer, VkDeviceSize
 
 	// Update the descriptor set with the buffer info
 	vkUpdateDescriptorSets(m_renderDevice.logicalDevice, 1, &descriptorWrite, 0, nullptr);
-
-	// Store the descriptor set
-	m_storageBufferDescriptorSets.push_back(descriptorSet);
-
-	// Return the index of the descriptor set
-	return m_storageBufferDescriptorSets.size() - 1;
 }
 
 //void Renderer::allocateDynamicBufferTransferSpace()
@@ -1482,6 +1837,7 @@ int Renderer::init(GLFWwindow* window)
 		createSampler();
 		createDescriptorPool();
 		createSyncObjects();
+		createGeometryPool();
 		createRendererPrimitives();
 
 		for (auto callback : m_initCallbacks) {
@@ -1498,11 +1854,63 @@ int Renderer::init(GLFWwindow* window)
 
 void Renderer::disposeImageTexture(int imageTexture)
 {
-	if (imageTexture >= 0 && imageTexture < m_imageBuffers.size()) {
+	if (imageTexture >= 0 && imageTexture < m_imageBuffers.size() && m_imageBuffers[imageTexture]->state != GFX_BUFFER_STATE_DISPOSED) {
 		m_imageBuffers[imageTexture]->dispose(m_renderDevice.logicalDevice);
 	}
 }
 
+void Renderer::disposeVertexBuffer(int vertexBufferIndex)
+{
+	if (vertexBufferIndex >= 0 && vertexBufferIndex < m_vertexBuffers.size() && m_vertexBuffers[vertexBufferIndex]->state != GFX_BUFFER_STATE_DISPOSED) {
+		m_vertexBuffers[vertexBufferIndex]->dispose(m_renderDevice.logicalDevice);
+	}
+}
+
+void Renderer::disposeIndexBuffer(int indexBufferIndex)
+{
+	if (indexBufferIndex >= 0 && indexBufferIndex < m_indexBuffers.size() && m_indexBuffers[indexBufferIndex]->state != GFX_BUFFER_STATE_DISPOSED) {
+		m_indexBuffers[indexBufferIndex]->dispose(m_renderDevice.logicalDevice);
+	}
+}
+
+void Renderer::disposeStorageBuffer(int storageBufferIndex)
+{
+	if (storageBufferIndex >= 0 && storageBufferIndex < m_storageBuffers.size() && m_storageBuffers[storageBufferIndex]->state != GFX_BUFFER_STATE_DISPOSED) {
+		m_storageBuffers[storageBufferIndex]->dispose(m_renderDevice.logicalDevice);
+
+		// The next storage buffer takes over the slot and rewrites its descriptor set
+		m_freeStorageBuffers.push_back(storageBufferIndex);
+	}
+}
+
+void Renderer::disposeIndirectDrawList(int indirectDrawListIndex)
+{
+	if (indirectDrawListIndex >= 0 && indirectDrawListIndex < m_indirectDrawLists.size() && m_indirectDrawLists[indirectDrawListIndex]->state != GFX_BUFFER_STATE_DISPOSED) {
+		m_indirectDrawLists[indirectDrawListIndex]->dispose(m_renderDevice.logicalDevice);
+	}
+}
+
+void Renderer::disposeDepthPyramid(int depthPyramidIndex)
+{
+	if (depthPyramidIndex >= 0 && depthPyramidIndex < m_depthPyramids.size() && m_depthPyramids[depthPyramidIndex]->state != GFX_BUFFER_STATE_DISPOSED) {
+		m_depthPyramids[depthPyramidIndex]->dispose(m_renderDevice.logicalDevice);
+	}
+}
+
+void Renderer::disposeTextureArrayBuffer(int textureArrayIndex)
+{
+	if (textureArrayIndex >= 0 && textureArrayIndex < m_textureArrays.size() && m_textureArrays[textureArrayIndex]->state != GFX_BUFFER_STATE_DISPOSED) {
+		m_textureArrays[textureArrayIndex]->dispose(m_renderDevice.logicalDevice);
+	}
+}
+
+void Renderer::disposeUniformBuffer(int uniformBufferIndex)
+{
+	if (uniformBufferIndex >= 0 && uniformBufferIndex < m_uniformBuffers.size() && m_uniformBuffers[uniformBufferIndex]->state != GFX_BUFFER_STATE_DISPOSED) {
+		m_uniformBuffers[uniformBufferIndex]->dispose(m_renderDevice.logicalDevice);
+	}
+}
+
 int Renderer::createVertexBuffer(std::vector<Vertex>* vertices, const VertexBufferType vertexBufferType)
 {
 	auto vertexBuffer = std::make_unique<VertexBuffer>(m_renderDevice.physicalDevice, m_renderDevice.logicalDevice, m_graphicsQueue, m_commandPool, vertices, vertexBufferType);
@@ -1635,6 +2043,30 @@ StorageBuffer* Renderer::getStorageBuffer(int index)
 	throw std::runtime_error("failed to get storage buffer: invalid storage buffer index!");
 }
 
+IndirectDrawList* Renderer::getIndirectDrawList(int index)
+{
+	if (index >= 0 && index < m_indirectDrawLists.size()) {
+		return m_indirectDrawLists[index].get();
+	}
+	throw std::runtime_error("failed to get indirect draw list: invalid indirect draw list index!");
+}
+
+DepthPyramid* Renderer::getDepthPyramid(int index)
+{
+	if (index >= 0 && index < m_depthPyramids.size()) {
+		return m_depthPyramids[index].get();
+	}
+	throw std::runtime_error("failed to get depth pyramid: invalid depth pyramid index!");
+}
+
+TextureArrayBuffer* Renderer::getTextureArrayBuffer(int index)
+{
+	if (index >= 0 && index < m_textureArrays.size()) {
+		return m_textureArrays[index].get();
+	}
+	throw std::runtime_error("failed to get texture array: invalid texture array index!");
+}
+
 VkDevice Renderer::getDevice()
 {
 	return m_renderDevice.logicalDevice;
@@ -1697,6 +2129,14 @@ VkDescriptorSet Renderer::getCameraDescriptorSet(int cameraIndex, uint32_t frame
 	return m_cameraResources[cameraIndex].descriptorSets[frame];
 }
 
+const UboViewProjection& Renderer::getCameraViewProjection(int cameraIndex) const
+{
+	if (cameraIndex < 0 || cameraIndex >= m_cameraResources.size()) {
+		throw std::runtime_error("failed to get camera view projection: invalid camera index!");
+	}
+	return m_cameraResources[cameraIndex].viewProjection;
+}
+
 VkCommandBuffer Renderer::getCommandBuffer(int index)
 {
 	if (index >= 0 && index < m_commandBuffers.size()) {
@@ -1760,6 +2200,114 @@ void Renderer::setConfig(RenderConfig config)
 	m_renderConfig = config;
 }
 
+int Renderer::createGeometry(std::vector<Vertex>* vertices, std::vector<uint32_t>* indices)
+{
+	return m_geometryPool.allocate(*vertices, *indices);
+}
+
+std::vector<int> Renderer::createGeometry(std::vector<Vertex>* vertices, const std::vector<const std::vector<uint32_t>*>& indexLists)
+{
+	return m_geometryPool.allocate(*vertices, indexLists);
+}
+
+const GeometryRange& Renderer::getGeometry(int index) const
+{
+	return m_geometryPool.getRange(index);
+}
+
+void Renderer::disposeGeometry(int geometryIndex)
+{
+	m_geometryPool.free(geometryIndex);
+}
+
+int Renderer::createIndirectDrawList(const void* instanceData, VkDeviceSize instanceDataSize, const std::vector<IndirectDrawObject>& objects, const std::vector<IndirectDrawGroup>& groups)
+{
+	if (!m_multiDrawIndirectSupported) {
+		throw std::runtime_error("failed to create indirect draw list: multi draw indirect is not supported!");
+	}
+	auto drawList = std::make_unique<IndirectDrawList>(
+		m_renderDevice.physicalDevice,
+		m_renderDevice.logicalDevice,
+		m_graphicsQueue,
+		m_commandPool,
+		instanceData,
+		instanceDataSize,
+		objects,
+		groups
+	);
+
+	// The vertex shader reads the instances, the culling shader the rest
+	drawList->instanceDescriptorIndex = createStorageBufferDescriptor(drawList->instanceBuffer, drawList->instanceBufferSize);
+	drawList->objectDescriptorIndex = createStorageBufferDescriptor(drawList->objectBuffer, drawList->objectBufferSize);
+	drawList->commandDescriptorIndex = createStorageBufferDescriptor(drawList->commandBuffer, drawList->commandBufferSize);
+	drawList->countDescriptorIndex = createStorageBufferDescriptor(drawList->countBuffer, drawList->countBufferSize);
+	drawList->visibilityDescriptorIndex = createStorageBufferDescriptor(drawList->visibilityBuffer, drawList->visibilityBufferSize);
+
+	m_indirectDrawLists.push_back(std::move(drawList));
+	return static_cast<int>(m_indirectDrawLists.size()) - 1;
+}
+
+int Renderer::createDepthPyramid(int renderTargetIndex)
+{
+	RenderTarget* renderTarget = this->getRenderTarget(renderTargetIndex);
+	if (renderTarget == nullptr) {
+		throw std::runtime_error("failed to create depth pyramid: invalid render target index!");
+	}
+	if (m_depthReducePipeline == nullptr) {
+		this->createDepthPyramidPipelines();
+	}
+
+	auto depthPyramid = std::make_unique<DepthPyramid>(
+		m_renderDevice.physicalDevice,
+		m_renderDevice.logicalDevice,
+		m_graphicsQueue,
+		m_commandPool,
+		renderTarget->getDepthImageView(),
+		renderTarget->getExtent(),
+		m_depthReduceSetLayout,
+		m_depthPyramidSetLayout
+	);
+	depthPyramid->renderTargetIndex = renderTargetIndex;
+
+	m_depthPyramids.push_back(std::move(depthPyramid));
+	return static_cast<int>(m_depthPyramids.size()) - 1;
+}
+
+int Renderer::createTextureArrayBuffer(const std::vector<ImageTexture*>& layers)
+{
+	if (layers.empty()) {
+		throw std::runtime_error("failed to create texture array: no layers!");
+	}
+
+	std::vector<stbi_uc*> layerData;
+	layerData.reserve(layers.size());
+	for (ImageTexture* layer : layers) {
+		if (layer->width != layers[0]->width || layer->height != layers[0]->height) {
+			throw std::runtime_error("failed to create texture array: the layers differ in size!");
+		}
+		if (layer->imageData == nullptr) {
+			throw std::runtime_error("failed to create texture array: the image data of a layer was freed!");
+		}
+		layerData.push_back(layer->imageData);
+	}
+
+	auto textureArray = std::make_unique<TextureArrayBuffer>(
+		m_renderDevice.physicalDevice,
+		m_renderDevice.logicalDevice,
+		m_graphicsQueue,
+		m_commandPool,
+		layerData,
+		static_cast<uint32_t>(layers[0]->width),
+		static_cast<uint32_t>(layers[0]->height)
+	);
+
+	// Arrays are bound like textures, the sampler set layout accepts array views as well
+	textureArray->descriptorIndex = createTextureDescriptor(textureArray->imageView);
+	textureArray->state = GFX_BUFFER_STATE_INITIALIZED;
+	m_textureArrays.push_back(std::move(textureArray));
+	return static_cast<int>(m_textureArrays.size()) - 1;
+}
+
 int Renderer::createIndexBuffer(std::vector<uint32_t>* indices)
 {
 	auto indexBuffer = std::make_unique<IndexBuffer>(m_renderDevice.physicalDevice, m_renderDevice.logicalDevice, m_graphicsQueue, m_commandPool, indices);
@@ -1792,6 +2340,16 @@ int Renderer::createStorageBuffer(VkDeviceSize size)
 		size
 	);
 
+	// Reuse a disposed slot and its descriptor set, the descriptor pool only holds maxStorageBuffers sets
+	if (!m_freeStorageBuffers.empty()) {
+		int index = m_freeStorageBuffers.back();
+		m_freeStorageBuffers.pop_back();
+		storageBuffer->descriptorIndex = m_storageBuffers[index]->descriptorIndex;
+		writeStorageBufferDescriptor(storageBuffer->descriptorIndex, storageBuffer->buffer, size);
+		m_storageBuffers[index] = std::move(storageBuffer);
+		return index;
+	}
+
 	// Create the descriptor set for the storage buffer
 	storageBuffer->descriptorIndex = createStorageBufferDescriptor(storageBuffer->buffer, size);
 
@@ -1853,14 +2411,27 @@ int Renderer::createCamera()
 	return cameraIndex;
 }
 
-int Renderer::loadFont(const std::string& fontPath, int fontSize)
+int Renderer::loadFont(const std::string& fontPath, int fontSize, FontAtlasType atlasType)
 {
-	FontAtlas fontAtlas;
-	if (!fontAtlas.loadFont(fontPath, fontSize)) {
+	// Distance field fonts of the same file share one atlas for every size
+	if (atlasType == FontAtlasType::SDF) {
+		for (const auto& loadedFont : m_loadedFonts) {
+			if (loadedFont->getFontName() == fontPath && loadedFont->getFontAtlas().type == FontAtlasType::SDF) {
+				auto font = std::make_unique<Font>(fontPath, fontSize, loadedFont->getTextureBufferIndex(), loadedFont->getSharedFontAtlas());
+				m_loadedFonts.push_back(std::move(font));
+				std::cout << "[FONT]: Font loaded: " << fontPath << " with size " << fontSize << " using a shared atlas" << std::endl;
+				return m_loadedFonts.size() - 1;
+			}
+		}
+	}
+
+	auto fontAtlas = std::make_shared<FontAtlas>();
+	int atlasPixelSize = atlasType == FontAtlasType::SDF ? FontAtlas::SDF_PIXEL_SIZE : fontSize;
+	if (!fontAtlas->loadFont(fontPath, atlasPixelSize, atlasType)) {
 		throw std::runtime_error("failed to load font atlas!");
 	}
 
-	int imageBufferIndex = createImageBuffer(fontAtlas);
+	int imageBufferIndex = createImageBuffer(*fontAtlas);
 	std::cout << "[FONT]: Texture buffer created with index " << imageBufferIndex << std::endl;
 
 	auto font = std::make_unique<Font>(fontPath, fontSize, imageBufferIndex, fontAtlas);
@@ -1875,6 +2446,9 @@ void Renderer::draw()
 	// Wait for the previous frame to finish
 	vkWaitForFences(m_renderDevice.logicalDevice, 1, &m_inFlightFences[m_currentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
 
+	// The oldest frame in flight finished, the geometry freed before it can be reused
+	m_geometryPool.beginFrame();
+
 	// Setp 1: Get the next image from the swap chain
 	uint32_t imageIndex;
 	VkResult acquireResult = vkAcquireNextImageKHR(
@@ -2034,6 +2608,19 @@ void Renderer::createPipeline(std::string name, PipelineCreateInfos infos, std::
 
 void Renderer::bindPipeline(VkCommandBuffer commandBuffer, std::string pipelineName)
 {
+	// Within a depth pre-pass the pipelines with variants bind the variant of the stage,
+	// only geometry drawn with such pipelines is part of the depth stage
+	m_skipDraws = false;
+	if (m_depthPrePassStage != DepthPrePassStage::DEPTH_PRE_PASS_NONE) {
+		const DepthPrePassVariants* variants = m_pipelineManager->getDepthPrePassVariants(pipelineName);
+		if (variants == nullptr) {
+			m_skipDraws = m_depthPrePassStage == DepthPrePassStage::DEPTH_PRE_PASS_DEPTH;
+		}
+		else {
+			pipelineName = m_depthPrePassStage == DepthPrePassStage::DEPTH_PRE_PASS_DEPTH ? variants->depthPipeline : variants->shadingPipeline;
+		}
+	}
+
 	auto pipelinePtr = m_pipelineManager->getPipeline(pipelineName);
 	if (pipelinePtr == nullptr) {
 		throw std::runtime_error("failed to get graphics pipeline for binding!");
@@ -2042,6 +2629,26 @@ void Renderer::bindPipeline(VkCommandBuffer commandBuffer, std::string pipelineN
 	m_currentPipeline = pipelinePtr;
 }
 
+void Renderer::setDepthPrePassVariants(const std::string& pipelineName, const std::string& depthPipelineName, const std::string& shadingPipelineName)
+{
+	m_pipelineManager->setDepthPrePassVariants(pipelineName, { depthPipelineName, shadingPipelineName });
+}
+
+bool Renderer::hasDepthPrePassVariants(const std::string& pipelineName) const
+{
+	return m_pipelineManager->getDepthPrePassVariants(pipelineName) != nullptr;
+}
+
+void Renderer::setDepthPrePassStage(DepthPrePassStage stage)
+{
+	// The variants are only created for scenes that use a depth pre-pass, the pipelines are replaced with the swapchain
+	if (stage != DepthPrePassStage::DEPTH_PRE_PASS_NONE && m_pipelineManager->getPipeline(ToString(PipelineType::PIPELINE_TYPE_GRAPHICS_3D_DEPTH)) == nullptr) {
+		this->createDepthPrePassPipelines();
+	}
+	m_depthPrePassStage = stage;
+	m_skipDraws = false;
+}
+
 Pipeline* Renderer::getPipeline(const std::string& pipelineName)
 {
 	auto pipelinePtr = m_pipelineManager->getPipeline(pipelineName);
@@ -2054,7 +2661,7 @@ Pipeline* Renderer::getPipeline(const std::string& pipelineName)
 void Renderer::bindDescriptorSet(VkDescriptorSet descriptorSet, int firstSet, int frame)
 {
 	validateCurrentPipeline();
-	VkCommandBuffer commandBuffer = this->getCommandBuffer(frame);
+	VkCommandBuffer commandBuffer = this->getBindCommandBuffer(frame);
 	VkPipelineLayout pipelineLayout = m_currentPipeline->getPipelineLayout();
 
 	vkCmdBindDescriptorSets(
@@ -2076,7 +2683,7 @@ void Renderer::bindDescriptorSet(Pipeline* pipeline, VkDescriptorSet descriptorS
 		throw std::runtime_error("failed to bind descriptor set: pipeline is null!");
 	}
 
-	VkCommandBuffer commandBuffer = this->getCommandBuffer(frame);
+	VkCommandBuffer commandBuffer = this->getBindCommandBuffer(frame);
 	VkPipelineLayout pipelineLayout = pipeline->getPipelineLayout();
 
 	vkCmdBindDescriptorSets(
@@ -2100,7 +2707,7 @@ void Renderer::bindDescriptorSets(const std::vector<VkDescriptorSet>& descriptor
 {
 	validateCurrentPipeline();
 
-	VkCommandBuffer commandBuffer = this->getCommandBuffer(frame);
+	VkCommandBuffer commandBuffer = this->getBindCommandBuffer(frame);
 	VkPipelineLayout pipelineLayout = m_currentPipeline->getPipelineLayout();
 
 	vkCmdBindDescriptorSets(
@@ -2120,7 +2727,7 @@ void Renderer::bindDescriptorSets(Pipeline* pipeline, const std::vector<VkDescri
 	if (pipeline == nullptr) {
 		throw std::runtime_error("failed to bind descriptor sets: pipeline is null!");
 	}
-	VkCommandBuffer commandBuffer = this->getCommandBuffer(frame);
+	VkCommandBuffer commandBuffer = this->getBindCommandBuffer(frame);
 	VkPipelineLayout pipelineLayout = pipeline->getPipelineLayout();
 
 	vkCmdBindDescriptorSets(
@@ -2148,7 +2755,7 @@ void Renderer::setActiveCamera(int cameraIndex)
 	m_activeCamera = cameraIndex;
 }
 
-void Renderer::beginnRenderPass(VkCommandBuffer commandBuffer, VkFramebuffer framebuffer, glm::vec4 clearColor, int renderPassIndex)
+void Renderer::beginnRenderPass(VkCommandBuffer commandBuffer, VkFramebuffer framebuffer, glm::vec4 clearColor, int renderPassIndex, VkSubpassContents contents)
 {
 	auto renderPass = m_renderPassManager.getRenderPass(renderPassIndex);
 	VkRenderPassBeginInfo beginInfo = {};
@@ -2165,7 +2772,10 @@ void Renderer::beginnRenderPass(VkCommandBuffer commandBuffer, VkFramebuffer fra
 	beginInfo.pClearValues = clearValues.data();
 	beginInfo.framebuffer = framebuffer;
 
-	vkCmdBeginRenderPass(commandBuffer, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+	vkCmdBeginRenderPass(commandBuffer, &beginInfo, contents);
+
+	// A command buffer is begun again before its render pass, the buffers bound during its last recording are gone
+	m_geometryBindCommandBuffer = VK_NULL_HANDLE;
 }
 
 void Renderer::endRenderPass(VkCommandBuffer commandBuffer)
@@ -2173,6 +2783,140 @@ void Renderer::endRenderPass(VkCommandBuffer commandBuffer)
 	vkCmdEndRenderPass(commandBuffer);
 }
 
+VkCommandBuffer Renderer::createSecondaryCommandBuffer()
+{
+	VkCommandBufferAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = m_commandPool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+	allocInfo.commandBufferCount = 1;
+
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+	if (vkAllocateCommandBuffers(m_renderDevice.logicalDevice, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate secondary command buffer!");
+	}
+	return commandBuffer;
+}
+
+void Renderer::destroyCommandBuffer(VkCommandBuffer commandBuffer)
+{
+	if (commandBuffer != VK_NULL_HANDLE) {
+		vkFreeCommandBuffers(m_renderDevice.logicalDevice, m_commandPool, 1, &commandBuffer);
+	}
+}
+
+void Renderer::beginSecondaryCommandBuffer(VkCommandBuffer commandBuffer, VkFramebuffer framebuffer, int renderPassIndex)
+{
+	if (m_recordingCommandBuffer != VK_NULL_HANDLE) {
+		throw std::runtime_error("failed to begin secondary command buffer: another one is recorded!");
+	}
+
+	// The secondary command buffer continues the render pass of the primary command buffer
+	VkCommandBufferInheritanceInfo inheritanceInfo = {};
+	inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.renderPass = m_renderPassManager.getRenderPass(renderPassIndex)->getRenderPass();
+	inheritanceInfo.subpass = 0;
+	inheritanceInfo.framebuffer = framebuffer;
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+		throw std::runtime_error("failed to begin recording secondary command buffer!");
+	}
+	m_geometryBindCommandBuffer = VK_NULL_HANDLE;
+	m_recordingCommandBuffer = commandBuffer;
+}
+
+void Renderer::endSecondaryCommandBuffer(VkCommandBuffer commandBuffer)
+{
+	m_recordingCommandBuffer = VK_NULL_HANDLE;
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to record secondary command buffer!");
+	}
+}
+
+void Renderer::executeCommandBuffers(VkCommandBuffer commandBuffer, const std::vector<VkCommandBuffer>& secondaryCommandBuffers)
+{
+	if (!secondaryCommandBuffers.empty()) {
+		vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaryCommandBuffers.size()), secondaryCommandBuffers.data());
+	}
+
+	// The bound buffers of the primary command buffer are undefined after executing secondary ones
+	m_geometryBindCommandBuffer = VK_NULL_HANDLE;
+}
+
+void Renderer::cullIndirectDrawList(int indirectDrawListIndex, VkCommandBuffer commandBuffer, const std::array<glm::vec4, 6>& planes, const glm::vec3& cameraPosition, int depthPyramidIndex, IndirectCullPhase phase)
+{
+	IndirectDrawList* drawList = this->getIndirectDrawList(indirectDrawListIndex);
+	DepthPyramid* depthPyramid = depthPyramidIndex >= 0 ? this->getDepthPyramid(depthPyramidIndex) : nullptr;
+	if (depthPyramid == nullptr && phase != IndirectCullPhase::CULL_PHASE_SINGLE) {
+		throw std::runtime_error("failed to cull indirect draw list: the occlusion culling phases need a depth pyramid!");
+	}
+	if (m_cullingPipeline == nullptr) {
+		this->createCullingPipeline();
+	}
+	ComputePipeline* pipeline = depthPyramid != nullptr ? m_occlusionCullingPipeline.get() : m_cullingPipeline.get();
+	bool compact = m_drawIndirectCountSupported;
+
+	// The draws of the previous frame may still read the commands and counts, the visibility is written by the previous culling
+	VkMemoryBarrier visibilityBarrier = {};
+	visibilityBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	visibilityBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	visibilityBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 1, &visibilityBarrier, 0, nullptr, 0, nullptr);
+
+	// Compacted commands are appended with atomic counters starting at zero
+	if (compact) {
+		vkCmdFillBuffer(commandBuffer, drawList->countBuffer, 0, VK_WHOLE_SIZE, 0);
+
+		VkMemoryBarrier clearBarrier = {};
+		clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+	}
+
+	// One invocation per object in groups of 64
+	IndirectCullConstants constants = {};
+	constants.planes = planes;
+	constants.cameraPosition = glm::vec4(cameraPosition, 1.0f);
+	constants.objectCount = drawList->objectCount;
+	constants.compact = compact ? 1 : 0;
+	constants.phase = static_cast<uint32_t>(phase);
+	std::vector<VkDescriptorSet> descriptorSets = {
+		this->getStorageBufferDescriptorSet(drawList->objectDescriptorIndex),
+		this->getStorageBufferDescriptorSet(drawList->commandDescriptorIndex),
+		this->getStorageBufferDescriptorSet(drawList->countDescriptorIndex)
+	};
+	if (depthPyramid != nullptr) {
+		descriptorSets.push_back(this->getStorageBufferDescriptorSet(drawList->visibilityDescriptorIndex));
+		descriptorSets.push_back(depthPyramid->getDescriptorSet());
+	}
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->getPipelineLayout(), 0, static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(), 0, nullptr);
+	vkCmdPushConstants(commandBuffer, pipeline->getPipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(IndirectCullConstants), &constants);
+	vkCmdDispatch(commandBuffer, (drawList->objectCount + 63) / 64, 1, 1);
+
+	// The indirect draws of this frame read the written commands and counts
+	VkMemoryBarrier cullBarrier = {};
+	cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1, &cullBarrier, 0, nullptr, 0, nullptr);
+}
+
+void Renderer::buildDepthPyramid(int depthPyramidIndex, VkCommandBuffer commandBuffer, uint32_t frame, const UboViewProjection& viewProjection, bool readback)
+{
+	DepthPyramid* depthPyramid = this->getDepthPyramid(depthPyramidIndex);
+	depthPyramid->build(m_renderDevice.physicalDevice, m_renderDevice.logicalDevice, commandBuffer, *m_depthReducePipeline, frame, viewProjection.projection * viewProjection.view, readback);
+}
+
 void Renderer::updateCamera(int cameraIndex, uint32_t frame, const UboViewProjection& vp)
 {
 	if (cameraIndex >= 0 && cameraIndex < m_cameraResources.size()) {
@@ -2180,6 +2924,7 @@ void Renderer::updateCamera(int cameraIndex, uint32_t frame, const UboViewProjec
 		auto& buffer = camera.uniformBuffers[frame];
 
 		buffer->updateBufferData(m_renderDevice.logicalDevice, (void*)&vp, sizeof(UboViewProjection), 0);
+		camera.viewProjection = vp;
 	}
 	else {
 		throw std::runtime_error("failed to update camera: invalid camera index!");
@@ -2278,10 +3023,33 @@ void Renderer::recreateRenderTarget(int renderTargetIndex, VkExtent2D newSize)
 
 	// Update the descriptor set
 	this->updateTextureDescriptor(descriptorIndex, renderTarget->getImageView());
+
+	// The depth pyramids of the render target follow the new depth image
+	for (auto& depthPyramid : m_depthPyramids) {
+		if (depthPyramid->renderTargetIndex != renderTargetIndex || depthPyramid->state == GFX_BUFFER_STATE_DISPOSED) {
+			continue;
+		}
+		depthPyramid->dispose(m_renderDevice.logicalDevice);
+		depthPyramid = std::make_unique<DepthPyramid>(
+			m_renderDevice.physicalDevice,
+			m_renderDevice.logicalDevice,
+			m_graphicsQueue,
+			m_commandPool,
+			renderTarget->getDepthImageView(),
+			renderTarget->getExtent(),
+			m_depthReduceSetLayout,
+			m_depthPyramidSetLayout
+		);
+		depthPyramid->renderTargetIndex = renderTargetIndex;
+	}
 }
 
-void Renderer::drawBuffers(int vertexBufferIndex, int indexBufferIndex, VkCommandBuffer commandBuffer, int instances)
+void Renderer::drawBuffers(int vertexBufferIndex, int indexBufferIndex, VkCommandBuffer commandBuffer, int instances, int firstInstance)
 {
+	if (m_skipDraws) {
+		return;
+	}
+
 	// Get the required buffers
 	auto vertexBuffer = this->getVertexBuffer(vertexBufferIndex);
 	auto indexBuffer = this->getIndexBuffer(indexBufferIndex); 
@@ -2293,7 +3061,62 @@ void Renderer::drawBuffers(int vertexBufferIndex, int indexBufferIndex, VkComman
 
 	vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
 	vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
-	vkCmdDrawIndexed(commandBuffer, indexCount, instances, 0, 0, 0);
+	vkCmdDrawIndexed(commandBuffer, indexCount, instances, 0, 0, firstInstance);
+	m_geometryBindCommandBuffer = VK_NULL_HANDLE;
+}
+
+void Renderer::drawGeometry(int geometryIndex, VkCommandBuffer commandBuffer, int instances, int firstInstance)
+{
+	const GeometryRange& range = m_geometryPool.getRange(geometryIndex);
+	if (range.disposed) {
+		throw std::runtime_error("failed to draw geometry: geometry is disposed!");
+	}
+	if (m_skipDraws) {
+		return;
+	}
+
+	this->bindGeometryPage(commandBuffer, range.page);
+	vkCmdDrawIndexed(commandBuffer, range.indexCount, instances, range.firstIndex, static_cast<int32_t>(range.vertexOffset), firstInstance);
+}
+
+void Renderer::drawGeometryIndices(int geometryIndex, uint32_t firstIndex, uint32_t indexCount, VkCommandBuffer commandBuffer)
+{
+	const GeometryRange& range = m_geometryPool.getRange(geometryIndex);
+	if (range.disposed) {
+		throw std::runtime_error("failed to draw geometry: geometry is disposed!");
+	}
+	if (firstIndex + indexCount > range.indexCount) {
+		throw std::runtime_error("failed to draw geometry: indices out of range!");
+	}
+	if (m_skipDraws) {
+		return;
+	}
+
+	this->bindGeometryPage(commandBuffer, range.page);
+	vkCmdDrawIndexed(commandBuffer, indexCount, 1, range.firstIndex + firstIndex, static_cast<int32_t>(range.vertexOffset), 0);
+}
+
+void Renderer::drawIndirectDrawList(int indirectDrawListIndex, int group, VkCommandBuffer commandBuffer)
+{
+	IndirectDrawList* drawList = this->getIndirectDrawList(indirectDrawListIndex);
+	if (group < 0 || group >= static_cast<int>(drawList->groups.size())) {
+		throw std::runtime_error("failed to draw indirect draw list: invalid group index!");
+	}
+	if (m_skipDraws) {
+		return;
+	}
+	const IndirectDrawGroup& drawGroup = drawList->groups[group];
+	this->bindGeometryPage(commandBuffer, drawGroup.page);
+
+	// With draw indirect count the culling shader compacted the visible commands and counted them,
+	// otherwise every object of the group has a command and the hidden ones draw no instance
+	VkDeviceSize commandOffset = sizeof(VkDrawIndexedIndirectCommand) * static_cast<VkDeviceSize>(drawGroup.firstCommand);
+	if (m_drawIndirectCountSupported) {
+		vkCmdDrawIndexedIndirectCount(commandBuffer, drawList->commandBuffer, commandOffset, drawList->countBuffer, sizeof(uint32_t) * static_cast<VkDeviceSize>(group), drawGroup.commandCount, sizeof(VkDrawIndexedIndirectCommand));
+	}
+	else {
+		vkCmdDrawIndexedIndirect(commandBuffer, drawList->commandBuffer, commandOffset, drawGroup.commandCount, sizeof(VkDrawIndexedIndirectCommand));
+	}
 }
 
 void Renderer::drawSkybox(uint32_t vertexBufferIndex, uint32_t indexBufferIndex, uint32_t cubemapBufferIndex, int frame)
@@ -2306,7 +3129,7 @@ void Renderer::drawSkybox(uint32_t vertexBufferIndex, uint32_t indexBufferIndex,
 	auto vertexBuffer = this->getVertexBuffer(vertexBufferIndex);
 	auto indexBuffer = this->getIndexBuffer(indexBufferIndex);
 	auto cubemapBuffer = this->getCubemapBuffer(cubemapBufferIndex);
-	auto commandBuffer = this->getCommandBuffer(frame);	// Command buffer TODO: Replace with parameter?
+	auto commandBuffer = this->getBindCommandBuffer(frame);	// Command buffer TODO: Replace with parameter?
 
 	VkBuffer vertexBuffers[] = { vertexBuffer->getVertexBuffer() };
 	VkDeviceSize offsets[] = { 0 };
@@ -2319,6 +3142,9 @@ void Renderer::drawSkybox(uint32_t vertexBufferIndex, uint32_t indexBufferIndex,
 
 
 	this->bindPipeline(commandBuffer, ToString(PipelineType::PIPELINE_TYPE_SKYBOX));
+	if (m_skipDraws) {
+		return;
+	}
 	auto pipelineLayout = m_currentPipeline->getPipelineLayout();
 
 	vkCmdBindDescriptorSets(
@@ -2335,6 +3161,7 @@ void Renderer::drawSkybox(uint32_t vertexBufferIndex, uint32_t indexBufferIndex,
 	vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
 	vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
 	vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+	m_geometryBindCommandBuffer = VK_NULL_HANDLE;
 }
 
 void Renderer::drawRenderTargetQuad(RenderTarget* rendertarget, VkCommandBuffer commandBuffer, int frame)
@@ -2360,194 +3187,252 @@ void Renderer::drawTexture(int textureBufferIndex, VkCommandBuffer commandBuffer
 		throw std::runtime_error("No camera bound for texture rendering!");
 	}
 
-	// Get the required buffers and descriptors
-	auto descriptorSet = this->getCameraDescriptorSet(m_activeCamera, frame);
-	auto imageBuffer = this->getImageBuffer(textureBufferIndex);
-	auto imageDescriptorSet = this->getSamplerDescriptorSet(imageBuffer->descriptorIndex);
+	// A single sprite, queue several and flush them once to share draws
+	SpriteInstance sprite;
+	sprite.position = position;
+	sprite.size = size;
+	this->queueSprite(textureBufferIndex, sprite);
+	this->flushSprites(commandBuffer, frame);
+}
 
-	// Get the primitve
-	auto primitveBuffer = m_rendererPrimitives[PrimitiveType::PRIMITIVE_TYPE_QUAD];
+void Renderer::queueSprite(int imageBufferIndex, const SpriteInstance& sprite, int layer)
+{
+	auto imageBuffer = this->getImageBuffer(imageBufferIndex);
+	m_spriteBatch.add(imageBuffer->descriptorIndex, false, 0, sprite, layer);
+}
 
-	// Create the model matrix for the font quad
-	glm::mat4 model = glm::mat4(1.0f);
-	model = glm::translate(model, glm::vec3(position, 0.0f));
-	model = glm::scale(model, glm::vec3(size, 1.0f));
-	UboModel fontModel = {};
-	fontModel.model = model;
+void Renderer::queueSpriteFromArray(int textureArrayIndex, uint32_t arrayLayer, const SpriteInstance& sprite, int layer)
+{
+	auto textureArray = this->getTextureArrayBuffer(textureArrayIndex);
+	if (arrayLayer >= textureArray->layerCount) {
+		throw std::runtime_error("failed to queue sprite: invalid texture array layer!");
+	}
+	m_spriteBatch.add(textureArray->descriptorIndex, true, arrayLayer, sprite, layer);
+}
 
-	// Bind the pipeline, descriptor sets and draw the font quad
-	std::vector<VkDescriptorSet> descriptorSets = {
-		this->getCameraDescriptorSet(m_activeCamera, frame),
-		imageDescriptorSet
-	};
-	this->bindPipeline(commandBuffer, ToString(PipelineType::PIPELINE_TYPE_GRAPHICS_2D));
-	this->bindPushConstants(commandBuffer, this->getCurrentPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(UboModel), &fontModel);
-	this->bindDescriptorSets(descriptorSets, frame);
-	this->drawBuffers(primitveBuffer.vertexBufferIndex, primitveBuffer.indexBufferIndex, commandBuffer);
+void Renderer::setSpriteCullBounds(const glm::vec2& min, const glm::vec2& max)
+{
+	m_spriteBatch.setCullBounds(min, max);
 }
 
-void Renderer::drawText(const std::string& text, const int fontIndex, const int vertexBufferIndex, VkCommandBuffer commandBuffer, int frame, glm::vec2 position, float scale, float lineSpacing, int textalignment)
+void Renderer::disableSpriteCulling()
+{
+	m_spriteBatch.disableCulling();
+}
+
+void Renderer::flushSprites(VkCommandBuffer commandBuffer, int frame)
 {
 	if (m_activeCamera < 0)
 	{
-		throw std::runtime_error("No camera bound for font rendering!");
+		throw std::runtime_error("No camera bound for sprite rendering!");
 	}
 
-	if (text.empty()) return;
-
-	auto font = getFont(fontIndex);
-	const FontAtlas& fontAtlas = font->getFontAtlas();
-
-	std::vector<Vertex> vertices;
-	vertices.reserve(text.length() * 6);
-
-	float currentX = position.x;
-	float currentY = position.y;
-
-	auto textmessure = measureText(text, font, scale, lineSpacing);
-	if (TextAlignment::ALIGNMENT_TOP & textalignment) {
-		currentY -= textmessure.lineHeight;
-	}
-	else if (TextAlignment::ALIGNMENT_MIDDLE & textalignment) {
-		currentY += (textmessure.height - textmessure.lineHeight) / 2.0f;
-	}
-	else if (TextAlignment::ALIGNMENT_BOTTOM & textalignment) {
-		currentY += textmessure.height - textmessure.lineHeight;
-	}
+	const auto& draws = m_spriteBatch.upload(m_renderDevice.physicalDevice, m_renderDevice.logicalDevice);
+	if (draws.empty()) return;
 
-	if (TextAlignment::ALIGNMENT_CENTER & textalignment) {
-		currentX -= textmessure.width / 2.0f;
-	}
-	if (TextAlignment::ALIGNMENT_RIGHT & textalignment) {
-		currentX -= textmessure.width;
+	// The sprite pipelines are only created for applications drawing sprites, the pipelines are replaced with the swapchain
+	if (m_pipelineManager->getPipeline(ToString(PipelineType::PIPELINE_TYPE_SPRITE_BATCH)) == nullptr) {
+		this->createSpriteBatchPipelines();
 	}
 
-	float startX = currentX;
-	float lineHeight = textmessure.lineHeight;
-
-	for (char c : text) {
-		if (c == '\n') {
-			currentX = startX;
-			currentY -= lineHeight * lineSpacing;
-			continue;
+	// One draw per texture run, all draws share the ring buffer of the frame
+	PipelineType boundPipeline = PipelineType::PIPELINE_TYPE_SPRITE_BATCH;
+	bool pipelineBound = false;
+	for (const SpriteDraw& draw : draws) {
+		PipelineType pipelineType = draw.textureArray ? PipelineType::PIPELINE_TYPE_SPRITE_BATCH_ARRAY : PipelineType::PIPELINE_TYPE_SPRITE_BATCH;
+		if (!pipelineBound || pipelineType != boundPipeline) {
+			bindPipeline(commandBuffer, ToString(pipelineType));
+			if (m_skipDraws) {
+				break;
+			}
+			boundPipeline = pipelineType;
+			pipelineBound = true;
 		}
 
-		if (fontAtlas.characters.find(c) == fontAtlas.characters.end()) continue;
-		const Character& ch = fontAtlas.characters.at(c);
+		std::vector<VkDescriptorSet> descriptorSets = {
+			this->getCameraDescriptorSet(m_activeCamera, frame),
+			this->getSamplerDescriptorSet(draw.descriptorIndex)
+		};
+		this->bindDescriptorSets(descriptorSets, frame);
 
-		float xpos = currentX + ch.bearingX * scale;
-		float ypos = currentY - (ch.height - ch.bearingY) * scale;
-		float w = ch.width * scale;
-		float h = ch.height * scale;
+		VkBuffer vertexBuffers[] = { draw.buffer };
+		VkDeviceSize offsets[] = { 0 };
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+		vkCmdBindIndexBuffer(commandBuffer, draw.buffer, draw.indexOffset, VK_INDEX_TYPE_UINT32);
+		vkCmdDrawIndexed(commandBuffer, draw.indexCount, 1, draw.firstIndex, 0, 0);
+	}
+	m_geometryBindCommandBuffer = VK_NULL_HANDLE;
+}
 
-		if (w <= 0 || h <= 0) {
-			currentX += ch.advance * scale;
-			continue;
-		}
+void Renderer::drawText(const std::string& text, const int fontIndex, VkCommandBuffer commandBuffer, int frame, glm::vec2 position, float scale, float lineSpacing, int textalignment)
+{
+	this->queueText(text, fontIndex, position, scale, lineSpacing, textalignment);
+	this->flushText(commandBuffer, frame);
+}
 
-		glm::vec3 color = glm::vec3(1.0f, 1.0f, 1.0f);
-		glm::vec3 normal = glm::vec3(0.0f, 0.0f, 1.0f);
+void Renderer::queueText(const std::string& text, const int fontIndex, glm::vec2 position, float scale, float lineSpacing, int textalignment, const glm::vec3& color)
+{
+	auto font = getFont(fontIndex);
 
-		float u0 = ch.uvX;
-		float v0 = ch.uvY;
-		float u1 = ch.uvX + ch.uvWidth;
-		float v1 = ch.uvY + ch.uvHeight;
+	// Glyphs new to the atlas are uploaded before the text is drawn
+	FontAtlas& fontAtlas = font->getFontAtlas();
+	fontAtlas.addGlyphs(text);
+	AtlasRegion region;
+	if (fontAtlas.takeDirtyRegion(region)) {
+		getImageBuffer(font->getTextureBufferIndex())->updateRegion(m_renderDevice.physicalDevice, m_renderDevice.logicalDevice, m_graphicsQueue, m_commandPool,
+			fontAtlas.pixelData.data(), fontAtlas.atlasWidth, region.x, region.y, region.width, region.height);
+	}
 
-		vertices.push_back({ {xpos, ypos + h, 0.0f}, color, {u0, v0}, normal });  // v1 -> v0
-		vertices.push_back({ {xpos, ypos, 0.0f}, color, {u0, v1}, normal });      // v0 -> v1
-		vertices.push_back({ {xpos + w, ypos, 0.0f}, color, {u1, v1}, normal });  // v0 -> v1
+	m_textBatcher.add(*font, fontIndex, text, position, scale, lineSpacing, textalignment, color);
+}
 
-		vertices.push_back({ {xpos, ypos + h, 0.0f}, color, {u0, v0}, normal });  // v1 -> v0
-		vertices.push_back({ {xpos + w, ypos, 0.0f}, color, {u1, v1}, normal });  // v0 -> v1
-		vertices.push_back({ {xpos + w, ypos + h, 0.0f}, color, {u1, v0}, normal }); // v1 -> v0
+void Renderer::flushText(VkCommandBuffer commandBuffer, int frame)
+{
+	// Scenes flush every frame, only frames with queued text need a camera
+	const auto& draws = m_textBatcher.upload(m_renderDevice.physicalDevice, m_renderDevice.logicalDevice);
+	if (draws.empty()) return;
 
-		currentX += ch.advance * scale;
+	if (m_activeCamera < 0)
+	{
+		throw std::runtime_error("No camera bound for font rendering!");
 	}
 
-	if (vertices.empty()) return;
-
-	auto vertexBuffer = getVertexBuffer(vertexBufferIndex);
-	vertexBuffer->updateBuffer(m_renderDevice.physicalDevice, m_renderDevice.logicalDevice, &vertices);
+	// One draw per font atlas, all draws share the ring buffer of the frame
+	PipelineType boundPipeline = PipelineType::PIPELINE_TYPE_FONT_RENDERING;
+	bool pipelineBound = false;
+	for (const TextDraw& draw : draws) {
+		auto font = getFont(draw.fontIndex);
 
-	bindPipeline(commandBuffer, ToString(PipelineType::PIPELINE_TYPE_FONT_RENDERING));
+		// Distance field atlases need their own fragment shader
+		PipelineType pipelineType = font->getFontAtlas().type == FontAtlasType::SDF ? PipelineType::PIPELINE_TYPE_FONT_RENDERING_SDF : PipelineType::PIPELINE_TYPE_FONT_RENDERING;
+		if (!pipelineBound || pipelineType != boundPipeline) {
+			// The distance field pipeline is only created for applications with such fonts, the pipelines are replaced with the swapchain
+			if (pipelineType == PipelineType::PIPELINE_TYPE_FONT_RENDERING_SDF && m_pipelineManager->getPipeline(ToString(pipelineType)) == nullptr) {
+				this->createFontSdfPipeline();
+			}
+			bindPipeline(commandBuffer, ToString(pipelineType));
+			if (m_skipDraws) {
+				break;
+			}
 
-	auto imageBuffer = getImageBuffer(font->getTextureBufferIndex());
-	std::vector<VkDescriptorSet> descriptorSets = {
-		this->getCameraDescriptorSet(m_activeCamera, frame),
-		this->getSamplerDescriptorSet(imageBuffer->descriptorIndex)
-	};
-	this->bindDescriptorSets(descriptorSets, frame);
+			// The glyphs are laid out in world space already
+			UboModel fontModel = { glm::mat4(1) };
+			this->bindPushConstants(commandBuffer, this->getCurrentPipelineLayout(),
+				VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(UboModel), &fontModel);
+			boundPipeline = pipelineType;
+			pipelineBound = true;
+		}
 
-	UboModel fontModel = { glm::mat4(1) };
-	this->bindPushConstants(commandBuffer, this->getCurrentPipelineLayout(),
-		VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(UboModel), &fontModel);
+		auto imageBuffer = getImageBuffer(font->getTextureBufferIndex());
+		std::vector<VkDescriptorSet> descriptorSets = {
+			this->getCameraDescriptorSet(m_activeCamera, frame),
+			this->getSamplerDescriptorSet(imageBuffer->descriptorIndex)
+		};
+		this->bindDescriptorSets(descriptorSets, frame);
 
-	VkBuffer vertexBuffers[] = { vertexBuffer->getVertexBuffer() };
-	VkDeviceSize offsets[] = { 0 };
-	vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-	vkCmdDraw(commandBuffer, static_cast<uint32_t>(vertices.size()), 1, 0, 0);
+		VkBuffer vertexBuffers[] = { draw.buffer };
+		VkDeviceSize offsets[] = { 0 };
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+		vkCmdBindIndexBuffer(commandBuffer, draw.buffer, draw.indexOffset, VK_INDEX_TYPE_UINT32);
+		vkCmdDrawIndexed(commandBuffer, draw.indexCount, 1, draw.firstIndex, 0, 0);
+	}
+	m_geometryBindCommandBuffer = VK_NULL_HANDLE;
 }
 
 void Renderer::drawCube(const glm::mat4& modelMatrix, const glm::vec4& color, VkCommandBuffer commandBuffer, int frame)
 {
-	if (m_activeCamera < 0)
-	{
-		throw std::runtime_error("No camera bound for cube rendering!");
-	}
+	this->drawPrimitive(PrimitiveType::PRIMITIVE_TYPE_CUBE, modelMatrix, color, commandBuffer, frame);
+}
 
-	// Get the required buffers and descriptors
-	auto buffers = m_rendererPrimitives[PrimitiveType::PRIMITIVE_TYPE_CUBE];
-	auto descriptorSet = this->getCameraDescriptorSet(m_activeCamera, frame);
+void Renderer::drawAabb(const AABB& aabb, const glm::vec4& color, VkCommandBuffer commandBuffer, int frame)
+{
+	this->drawCube(aabb.toMatrix(), color, commandBuffer, frame);
+}
 
-	// Create descriptor set
-	std::array<VkDescriptorSet, 1> descriptorSets = {
-		descriptorSet
-	};
+void Renderer::drawPrimitive(PrimitiveType primitiveType, const glm::mat4& modelMatrix, const glm::vec4& color, VkCommandBuffer commandBuffer, int frame)
+{
+	// A single shape, queue several and flush them once to share draws
+	this->queueDebugPrimitive(primitiveType, modelMatrix, color);
+	this->flushDebugDraw(commandBuffer, frame);
+}
 
-	// Create the model matrix for the cube
-	UboModelColor uboModelColor = {};
-	uboModelColor.model = modelMatrix;
-	uboModelColor.color = color;
+void Renderer::queueDebugPrimitive(PrimitiveType primitiveType, const glm::mat4& modelMatrix, const glm::vec4& color)
+{
+	if (m_rendererPrimitives.find(primitiveType) == m_rendererPrimitives.end()) {
+		throw std::runtime_error("failed to queue debug primitive: invalid primitive type!");
+	}
+	m_debugDrawBatcher.add(primitiveType, modelMatrix, color);
+}
 
-	// Bind the pipeline, descriptor sets and draw the cube
-	this->bindPipeline(commandBuffer, ToString(PipelineType::PIPELINE_TYPE_SOLID_SHADING));
-	auto pipelineLayout = m_currentPipeline->getPipelineLayout();
+void Renderer::queueDebugLine(const glm::vec3& from, const glm::vec3& to, const glm::vec4& color)
+{
+	// The line primitive runs from the origin along the x axis, the other axes don't matter
+	glm::mat4 modelMatrix = glm::mat4(0.0f);
+	modelMatrix[0] = glm::vec4(to - from, 0.0f);
+	modelMatrix[3] = glm::vec4(from, 1.0f);
+	m_debugDrawBatcher.add(PrimitiveType::PRIMITIVE_TYPE_LINE, modelMatrix, color);
+}
 
-	this->bindPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(UboModelColor), &uboModelColor);
-	this->bindDescriptorSets(descriptorSets, 0, frame);
+void Renderer::queueDebugBox(const glm::mat4& modelMatrix, const glm::vec4& color, bool wireframe)
+{
+	m_debugDrawBatcher.add(wireframe ? PrimitiveType::PRIMITIVE_TYPE_WIRE_CUBE : PrimitiveType::PRIMITIVE_TYPE_CUBE, modelMatrix, color);
+}
 
-	this->drawBuffers(buffers.vertexBufferIndex, buffers.indexBufferIndex, commandBuffer, 1);
+void Renderer::queueDebugAabb(const AABB& aabb, const glm::vec4& color, bool wireframe)
+{
+	this->queueDebugBox(aabb.toMatrix(), color, wireframe);
 }
 
-void Renderer::drawAabb(const AABB& aabb, const glm::vec4& color, VkCommandBuffer commandBuffer, int frame)
+void Renderer::queueDebugSphere(const glm::vec3& center, float radius, const glm::vec4& color, bool wireframe)
 {
-	this->drawCube(aabb.toMatrix(), color, commandBuffer, frame);
+	// The sphere primitives have a radius of 0.5
+	glm::mat4 modelMatrix = glm::translate(glm::mat4(1.0f), center);
+	modelMatrix = glm::scale(modelMatrix, glm::vec3(radius * 2.0f));
+	m_debugDrawBatcher.add(wireframe ? PrimitiveType::PRIMITIVE_TYPE_WIRE_SPHERE : PrimitiveType::PRIMITIVE_TYPE_SPHERE, modelMatrix, color);
 }
 
-void Renderer::drawPrimitive(PrimitiveType primitiveType, const glm::mat4& modelMatrix, const glm::vec4& color, VkCommandBuffer commandBuffer, int frame)
+void Renderer::flushDebugDraw(VkCommandBuffer commandBuffer, int frame)
 {
-	if(m_activeCamera < 0)
+	if (m_activeCamera < 0)
 	{
-		throw std::runtime_error("No camera bound for primitive rendering!");
+		throw std::runtime_error("No camera bound for debug rendering!");
 	}
 
-	auto buffers = m_rendererPrimitives[primitiveType];
-	auto cameraDescriptorSet = this->getCameraDescriptorSet(m_activeCamera, frame);
+	const auto& draws = m_debugDrawBatcher.upload(m_renderDevice.physicalDevice, m_renderDevice.logicalDevice);
+	if (draws.empty()) return;
 
-	std::array<VkDescriptorSet, 1> descriptorSets = {
-		cameraDescriptorSet
-	};
-	
-	UboModelColor uboModelColor = {};
-	uboModelColor.model = modelMatrix;
-	uboModelColor.color = color;
-	this->bindPipeline(commandBuffer, ToString(PipelineType::PIPELINE_TYPE_SOLID_SHADING));
-	auto pipelineLayout = m_currentPipeline->getPipelineLayout();
+	// The debug draw pipelines are only created for applications drawing debug shapes, the pipelines are replaced with the swapchain
+	if (m_pipelineManager->getPipeline(ToString(PipelineType::PIPELINE_TYPE_DEBUG_DRAW)) == nullptr) {
+		this->createDebugDrawPipelines();
+	}
 
-	this->bindPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(UboModelColor), &uboModelColor);
-	this->bindDescriptorSets(descriptorSets, 0, frame);
+	// One instanced draw per primitive type, line lists need their own pipeline
+	PipelineType boundPipeline = PipelineType::PIPELINE_TYPE_DEBUG_DRAW;
+	bool pipelineBound = false;
+	for (const DebugDraw& draw : draws) {
+		PipelineType pipelineType = Primitive::isLineList(draw.primitiveType) ? PipelineType::PIPELINE_TYPE_DEBUG_DRAW_LINES : PipelineType::PIPELINE_TYPE_DEBUG_DRAW;
+		if (!pipelineBound || pipelineType != boundPipeline) {
+			bindPipeline(commandBuffer, ToString(pipelineType));
+			if (m_skipDraws) {
+				break;
+			}
+			std::array<VkDescriptorSet, 1> descriptorSets = {
+				this->getCameraDescriptorSet(m_activeCamera, frame)
+			};
+			this->bindDescriptorSets(descriptorSets, 0, frame);
+			boundPipeline = pipelineType;
+			pipelineBound = true;
+		}
 
-	this->drawBuffers(buffers.vertexBufferIndex, buffers.indexBufferIndex, commandBuffer, 1);
+		const PrimitiveBuffer& buffers = m_rendererPrimitives[draw.primitiveType];
+		auto indexBuffer = this->getIndexBuffer(buffers.indexBufferIndex);
+		VkBuffer vertexBuffers[] = { this->getVertexBuffer(buffers.vertexBufferIndex)->getVertexBuffer(), draw.instanceBuffer };
+		VkDeviceSize offsets[] = { 0, draw.instanceOffset };
+		vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
+		vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+		vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(indexBuffer->getIndexCount()), draw.instanceCount, 0, 0, 0);
+	}
+	m_geometryBindCommandBuffer = VK_NULL_HANDLE;
 }
 
 /// <summary>
@@ -2612,6 +3497,9 @@ void Renderer::dispose()
 	}
 	m_indexBuffers.clear();
 
+	// Free the geometry pool
+	m_geometryPool.dispose();
+
 	// Free uniform buffers
 	for (auto& uniformBuffer : m_uniformBuffers) {
 		if (uniformBuffer->state == GFX_BUFFER_STATE_DISPOSED) continue;
@@ -2639,6 +3527,45 @@ void Renderer::dispose()
 		storageBuffer->dispose(m_renderDevice.logicalDevice);
 	}
 	m_storageBuffers.clear();
+	m_freeStorageBuffers.clear();
+
+	// Free indirect draw lists and the culling pipeline
+	for (auto& drawList : m_indirectDrawLists) {
+		if (drawList->state == GFX_BUFFER_STATE_DISPOSED) continue;
+		drawList->dispose(m_renderDevice.logicalDevice);
+	}
+	m_indirectDrawLists.clear();
+	if (m_cullingPipeline != nullptr) {
+		m_cullingPipeline->destroy(m_renderDevice.logicalDevice);
+		m_cullingPipeline.reset();
+	}
+
+	// Free the text, sprite and debug draw ring buffers
+	m_textBatcher.dispose(m_renderDevice.logicalDevice);
+	m_spriteBatch.dispose(m_renderDevice.logicalDevice);
+	m_debugDrawBatcher.dispose(m_renderDevice.logicalDevice);
+
+	// Free texture arrays
+	for (auto& textureArray : m_textureArrays) {
+		if (textureArray->state == GFX_BUFFER_STATE_DISPOSED) continue;
+		textureArray->dispose(m_renderDevice.logicalDevice);
+	}
+	m_textureArrays.clear();
+
+	// Free depth pyramids and the occlusion culling pipelines
+	for (auto& depthPyramid : m_depthPyramids) {
+		if (depthPyramid->state == GFX_BUFFER_STATE_DISPOSED) continue;
+		depthPyramid->dispose(m_renderDevice.logicalDevice);
+	}
+	m_depthPyramids.clear();
+	if (m_depthReducePipeline != nullptr) {
+		m_depthReducePipeline->destroy(m_renderDevice.logicalDevice);
+		m_depthReducePipeline.reset();
+		m_occlusionCullingPipeline->destroy(m_renderDevice.logicalDevice);
+		m_occlusionCullingPipeline.reset();
+		vkDestroyDescriptorSetLayout(m_renderDevice.logicalDevice, m_depthReduceSetLayout, nullptr);
+		vkDestroyDescriptorSetLayout(m_renderDevice.logicalDevice, m_depthPyramidSetLayout, nullptr);
+	}
 
 	// Free render targets
 	for (auto& renderTarget : m_renderTargets) {
@@ -2646,8 +3573,9 @@ void Renderer::dispose()
 	}
 	m_renderTargets.clear();
 
-	// Free loaded fonts
+	// Free loaded fonts, atlases that gained glyphs update their cache
 	for (auto& font : m_loadedFonts) {
+		font->getFontAtlas().saveCache();
 		font->dispose(m_renderDevice.logicalDevice);
 	}
 	m_loadedFonts.clear();
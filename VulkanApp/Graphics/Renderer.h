@@ -28,6 +28,14 @@
 #include "Font.h"
 #include "Primitive.h"
 #include "../Math/AABB.h"
+#include "GeometryPool.h"
+#include "ComputePipeline.h"
+#include "IndirectDrawList.h"
+#include "DepthPyramid.h"
+#include "TextBatcher.h"
+#include "SpriteBatch.h"
+#include "TextureArrayBuffer.h"
+#include "DebugDrawBatcher.h"
 
 /// <summary>
 /// Renderer configuration structure
@@ -37,6 +45,8 @@ struct RenderConfig {
 	size_t maxCameras = 256;
 	size_t maxStorageBuffers = 256;
 	size_t maxUniformBuffers = 2048;
+	size_t geometryPageVertices = 1 << 20;	// Vertex capacity of a geometry pool page
+	size_t geometryPageIndices = 1 << 22;	// Index capacity of a geometry pool page
 };
 
 /// <summary>
@@ -61,6 +71,7 @@ struct PrimitiveBuffer {
 struct CameraResources {
 	std::vector<std::unique_ptr<UniformBuffer>> uniformBuffers;
 	std::vector<VkDescriptorSet> descriptorSets;
+	UboViewProjection viewProjection = {};	// The last uploaded matrices, e.g. for LOD selection on the CPU
 };
 
 /// <summary>
@@ -75,7 +86,16 @@ enum class PipelineType {
 	PIPELINE_TYPE_SKYBOX,
 	PIPELINE_TYPE_FONT_RENDERING,
 	PIPELINE_TYPE_SOLID_SHADING,
-	PIPELINE_TYPE_RENDER_TARGET_PRESENT
+	PIPELINE_TYPE_RENDER_TARGET_PRESENT,
+	PIPELINE_TYPE_GRAPHICS_3D_DEPTH,
+	PIPELINE_TYPE_GRAPHICS_3D_INSTANCED_DEPTH,
+	PIPELINE_TYPE_GRAPHICS_3D_EQUAL,
+	PIPELINE_TYPE_GRAPHICS_3D_INSTANCED_EQUAL,
+	PIPELINE_TYPE_FONT_RENDERING_SDF,
+	PIPELINE_TYPE_SPRITE_BATCH,
+	PIPELINE_TYPE_SPRITE_BATCH_ARRAY,
+	PIPELINE_TYPE_DEBUG_DRAW,
+	PIPELINE_TYPE_DEBUG_DRAW_LINES
 };
 
 /// <summary>
@@ -94,10 +114,28 @@ inline const char* ToString(PipelineType type) {
 	case PipelineType::PIPELINE_TYPE_FONT_RENDERING: return "pipeline_font_rendering";
 	case PipelineType::PIPELINE_TYPE_SOLID_SHADING: return "pipeline_solid_shading";
 	case PipelineType::PIPELINE_TYPE_RENDER_TARGET_PRESENT: return "pipeline_render_target_present";
+	case PipelineType::PIPELINE_TYPE_GRAPHICS_3D_DEPTH: return "pipeline_3D_depth";
+	case PipelineType::PIPELINE_TYPE_GRAPHICS_3D_INSTANCED_DEPTH: return "pipeline_3D_instanced_depth";
+	case PipelineType::PIPELINE_TYPE_GRAPHICS_3D_EQUAL: return "pipeline_3D_equal";
+	case PipelineType::PIPELINE_TYPE_GRAPHICS_3D_INSTANCED_EQUAL: return "pipeline_3D_instanced_equal";
+	case PipelineType::PIPELINE_TYPE_FONT_RENDERING_SDF: return "pipeline_font_rendering_sdf";
+	case PipelineType::PIPELINE_TYPE_SPRITE_BATCH: return "pipeline_sprite_batch";
+	case PipelineType::PIPELINE_TYPE_SPRITE_BATCH_ARRAY: return "pipeline_sprite_batch_array";
+	case PipelineType::PIPELINE_TYPE_DEBUG_DRAW: return "pipeline_debug_draw";
+	case PipelineType::PIPELINE_TYPE_DEBUG_DRAW_LINES: return "pipeline_debug_draw_lines";
 	default: return "unknown";
 	}
 }
 
+/// <summary>
+/// Stages of a render pass with a depth pre-pass, selects the pipelines bound for the draws
+/// </summary>
+enum class DepthPrePassStage {
+	DEPTH_PRE_PASS_NONE,		// The pipelines are bound as requested
+	DEPTH_PRE_PASS_DEPTH,		// Pipelines with depth pre-pass variants bind their depth pipeline, draws with other pipelines are skipped
+	DEPTH_PRE_PASS_SHADING		// Pipelines with depth pre-pass variants bind their shading pipeline
+};
+
 /// <summary>
 /// Text alignment options
 /// </summary>
@@ -139,12 +177,16 @@ private:
 	// PIPELINE & COMMAND BUFFERS
 	std::unique_ptr<PipelineManager> m_pipelineManager;
 	Pipeline* m_currentPipeline;
+	DepthPrePassStage m_depthPrePassStage = DepthPrePassStage::DEPTH_PRE_PASS_NONE;
+	bool m_skipDraws = false;	// The bound pipeline isn't drawn in the current depth pre-pass stage
 	VkCommandPool m_commandPool;
+	VkCommandBuffer m_recordingCommandBuffer = VK_NULL_HANDLE;	// Secondary command buffer that receives the bind calls while it is recorded
 
 	// RENDER PASS
 	RenderPassManager m_renderPassManager;
 	int m_mainRenderPassIndex = -1;
 	int m_offscreenRenderPassIndex = -1;
+	int m_offscreenLoadRenderPassIndex = -1;	// Continues drawing into a render target, e.g. after a compute pass
 
 	// SWAP CHAIN STUFF
 	int m_numFramesInFlight = 0;
@@ -189,18 +231,43 @@ private:
 	VkDescriptorSetLayout m_cubemapSetLayout;
 	VkDescriptorPool m_cubemapDescriptorPool;
 
+	// TEXTURE ARRAYS, sampled through the texture descriptor sets
+	std::vector<std::unique_ptr<TextureArrayBuffer>> m_textureArrays;
+
 	// VERTEX BUFFERS
 	std::vector<std::unique_ptr<VertexBuffer>> m_vertexBuffers;
 	std::vector<std::unique_ptr<IndexBuffer>> m_indexBuffers;
 
+	// GEOMETRY POOL
+	GeometryPool m_geometryPool;
+	VkCommandBuffer m_geometryBindCommandBuffer = VK_NULL_HANDLE;	// Command buffer the pool page below is bound to
+	int m_boundGeometryPage = -1;
+
 	// STORAGE BUFFERS
 	std::vector<std::unique_ptr<StorageBuffer>> m_storageBuffers;
 	std::vector<VkDescriptorSet> m_storageBufferDescriptorSets;
+	std::vector<int> m_freeStorageBuffers;	// Disposed slots, reused together with their descriptor sets
 	VkDescriptorSetLayout m_storageBufferSetLayout; // done
 	VkDescriptorPool m_storageBufferDescriptorPool; // done
 
+	// INDIRECT DRAWING
+	std::vector<std::unique_ptr<IndirectDrawList>> m_indirectDrawLists;
+	std::unique_ptr<ComputePipeline> m_cullingPipeline;	// Created on first use, only applications culling on the GPU need its shader
+	bool m_multiDrawIndirectSupported = false;
+	bool m_drawIndirectCountSupported = false;
+
+	// OCCLUSION CULLING
+	std::vector<std::unique_ptr<DepthPyramid>> m_depthPyramids;
+	std::unique_ptr<ComputePipeline> m_depthReducePipeline;		// Created on first use like the culling pipeline
+	std::unique_ptr<ComputePipeline> m_occlusionCullingPipeline;
+	VkDescriptorSetLayout m_depthReduceSetLayout = VK_NULL_HANDLE;
+	VkDescriptorSetLayout m_depthPyramidSetLayout = VK_NULL_HANDLE;
+
 	// OTHER RESOURCES
 	std::vector<std::unique_ptr<Font>> m_loadedFonts;
+	TextBatcher m_textBatcher;
+	SpriteBatch m_spriteBatch;
+	DebugDrawBatcher m_debugDrawBatcher;
 
 	// Callbacks
 	std::vector<std::function<void(Renderer*, VkCommandBuffer, uint32_t)>> m_drawCallbacks;
@@ -229,6 +296,14 @@ private:
 	void createDescriptorPool();
 	void createSampler();
 	void createRendererPrimitives();
+	void createGeometryPool();
+	void createCullingPipeline();
+	void createDepthPyramidPipelines();
+	void createDepthPrePassPipelines();
+	void createFontSdfPipeline();
+	void createSpriteBatchPipelines();
+	void createDebugDrawPipelines();
+	void getPipelineViewport(VkViewport& viewport, VkRect2D& scissor) const;
 
 	// Record
 	void recordCommands(uint32_t currentImage);
@@ -254,6 +329,8 @@ private:
 	VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
 	VkFormat chooseSupportedFormat(const std::vector<VkFormat>& formats, VkImageTiling tiling, VkFormatFeatureFlags features);
 	void validateCurrentPipeline();
+	VkCommandBuffer getBindCommandBuffer(int frame);
+	void bindGeometryPage(VkCommandBuffer commandBuffer, int page);
 
 	// Create functions
 	VkShaderModule createShaderModule(const std::vector<char>& code);
@@ -261,6 +338,7 @@ private:
 	int createTextureDescriptor(VkImageView textureImageView);
 	int createCubemapDescriptor(VkImageView cubemapImageView);
 	int createStorageBufferDescriptor(VkBuffer storageBuffer, VkDeviceSize bufferSize);
+	void writeStorageBufferDescriptor(int descriptorIndex, VkBuffer storageBuffer, VkDeviceSize bufferSize);
 
 	// Allocate Functions
 	//void allocateDynamicBufferTransferSpace();
@@ -273,6 +351,14 @@ public:
 
 	// Setters
 	void disposeImageTexture(int imageTexture);
+	void disposeVertexBuffer(int vertexBufferIndex);
+	void disposeIndexBuffer(int indexBufferIndex);
+	void disposeUniformBuffer(int uniformBufferIndex);
+	void disposeStorageBuffer(int storageBufferIndex);
+	void disposeGeometry(int geometryIndex);
+	void disposeIndirectDrawList(int indirectDrawListIndex);
+	void disposeDepthPyramid(int depthPyramidIndex);
+	void disposeTextureArrayBuffer(int textureArrayIndex);
 
 	// Callbacks
 	void addOnDrawCallback(std::function<void(Renderer*, VkCommandBuffer, uint32_t)> callback);
@@ -291,6 +377,7 @@ public:
 	VkDescriptorSet getCubemapDescriptorSet(int index);
 	VkDescriptorSet getStorageBufferDescriptorSet(int index);
 	VkDescriptorSet getCameraDescriptorSet(int cameraIndex, uint32_t frame);
+	const UboViewProjection& getCameraViewProjection(int cameraIndex) const;
 	VkCommandBuffer getCommandBuffer(int index);
 	VkPipelineLayout getPipelineLayout(std::string pipelineName);
 	VkPipelineLayout getCurrentPipelineLayout();
@@ -298,6 +385,9 @@ public:
 	RenderTarget* getRenderTarget(int index);
 	Font* getFont(int index);
 	int getActiveCamera();
+	int getNumFramesInFlight() { return m_numFramesInFlight; }
+	bool supportsMultiDrawIndirect() const { return m_multiDrawIndirectSupported; }	// Required by indirect draw lists
+	bool supportsDrawIndirectCount() const { return m_drawIndirectCountSupported; }	// Culled draws are compacted and counted on the GPU
 	size_t numSwapChainImages();
 
 	// Setters
@@ -313,10 +403,15 @@ public:
 	int createIndexBuffer(std::vector<uint32_t>* indices);
 	int createRenderTarget(const bool presentOnScreen = false);
 	int createStorageBuffer(VkDeviceSize size);
+	int createGeometry(std::vector<Vertex>* vertices, std::vector<uint32_t>* indices);
+	std::vector<int> createGeometry(std::vector<Vertex>* vertices, const std::vector<const std::vector<uint32_t>*>& indexLists);
+	int createIndirectDrawList(const void* instanceData, VkDeviceSize instanceDataSize, const std::vector<IndirectDrawObject>& objects, const std::vector<IndirectDrawGroup>& groups);
+	int createDepthPyramid(int renderTargetIndex);
+	int createTextureArrayBuffer(const std::vector<ImageTexture*>& layers);
 	int createCamera();
 
 	// Loader functions
-	int loadFont(const std::string& fontPath, int fontSize);
+	int loadFont(const std::string& fontPath, int fontSize, FontAtlasType atlasType = FontAtlasType::BITMAP);
 
 	// Get buffer functions
 	VertexBuffer* getVertexBuffer(int index);
@@ -325,6 +420,11 @@ public:
 	ImageBuffer* getImageBuffer(int index);
 	CubemapBuffer* getCubemapBuffer(int index);
 	StorageBuffer* getStorageBuffer(int index);
+	const GeometryRange& getGeometry(int index) const;
+	GeometryPool* getGeometryPool() { return &m_geometryPool; }
+	IndirectDrawList* getIndirectDrawList(int index);
+	DepthPyramid* getDepthPyramid(int index);
+	TextureArrayBuffer* getTextureArrayBuffer(int index);
 
 	// Create functions
 	VkViewport getSwapchainViewport();
@@ -334,6 +434,10 @@ public:
 	void createPipeline(std::string name, PipelineCreateInfos infos, std::function<void(Pipeline*, Renderer*)> creationCallback = nullptr);
 	void bindPipeline(VkCommandBuffer commandBuffer, std::string pipelineName);
 	Pipeline* getPipeline(const std::string& pipelineName);
+	void setDepthPrePassVariants(const std::string& pipelineName, const std::string& depthPipelineName, const std::string& shadingPipelineName);
+	bool hasDepthPrePassVariants(const std::string& pipelineName) const;
+	void setDepthPrePassStage(DepthPrePassStage stage);
+	DepthPrePassStage getDepthPrePassStage() const { return m_depthPrePassStage; }
 
 	// Bind functions
 	void bindDescriptorSet(Pipeline* pipeline, VkDescriptorSet descriptorSet, int firstSet, int frame);
@@ -350,9 +454,21 @@ public:
 	// Beginn / End functions
 	int getMainRenderPass() { return m_mainRenderPassIndex; }
 	int getOffscreenRenderPass() { return m_offscreenRenderPassIndex; }
-	void beginnRenderPass(VkCommandBuffer commandBuffer, VkFramebuffer framebuffer, glm::vec4 clearColor, int renderPassIndex);
+	int getOffscreenLoadRenderPass() { return m_offscreenLoadRenderPassIndex; }
+	void beginnRenderPass(VkCommandBuffer commandBuffer, VkFramebuffer framebuffer, glm::vec4 clearColor, int renderPassIndex, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
 	void endRenderPass(VkCommandBuffer commandBuffer);
 
+	// Secondary command buffer functions
+	VkCommandBuffer createSecondaryCommandBuffer();
+	void destroyCommandBuffer(VkCommandBuffer commandBuffer);
+	void beginSecondaryCommandBuffer(VkCommandBuffer commandBuffer, VkFramebuffer framebuffer, int renderPassIndex);
+	void endSecondaryCommandBuffer(VkCommandBuffer commandBuffer);
+	void executeCommandBuffers(VkCommandBuffer commandBuffer, const std::vector<VkCommandBuffer>& secondaryCommandBuffers);
+
+	// Compute functions, record them outside of render passes
+	void cullIndirectDrawList(int indirectDrawListIndex, VkCommandBuffer commandBuffer, const std::array<glm::vec4, 6>& planes, const glm::vec3& cameraPosition, int depthPyramidIndex = -1, IndirectCullPhase phase = IndirectCullPhase::CULL_PHASE_SINGLE);
+	void buildDepthPyramid(int depthPyramidIndex, VkCommandBuffer commandBuffer, uint32_t frame, const UboViewProjection& viewProjection, bool readback = true);
+
 	// Update functions
 	void updateCamera(int cameraIndex, uint32_t frame, const UboViewProjection& vp);
 	void updateUniformBuffer(int uniformBufferIndex, const void* data, VkDeviceSize size, VkDeviceSize offset = 0);
@@ -366,14 +482,30 @@ public:
 	void recreateRenderTarget(int renderTargetIndex, const glm::vec2& newSize);
 
 	// Draw functions
-	void drawBuffers(int vertexBufferIndex, int indexBufferIndex, VkCommandBuffer commandBuffer, int instances = 1);
+	void drawBuffers(int vertexBufferIndex, int indexBufferIndex, VkCommandBuffer commandBuffer, int instances = 1, int firstInstance = 0);
+	void drawGeometry(int geometryIndex, VkCommandBuffer commandBuffer, int instances = 1, int firstInstance = 0);
+	void drawGeometryIndices(int geometryIndex, uint32_t firstIndex, uint32_t indexCount, VkCommandBuffer commandBuffer);	// Draws a part of the indices of the geometry
+	void drawIndirectDrawList(int indirectDrawListIndex, int group, VkCommandBuffer commandBuffer);
 	void drawSkybox(uint32_t vertexBufferIndex, uint32_t indexBufferIndex, uint32_t cubemapBufferIndex, int frame);
 	void drawRenderTargetQuad(RenderTarget* rendertarget, VkCommandBuffer commandBuffer, int frame);
 	void drawTexture(int textureBufferIndex, VkCommandBuffer commandBuffer, int frame, glm::vec2 position, glm::vec2 size);
-	void drawText(const std::string& text, const int fontIndex, const int vertexBufferIndex, VkCommandBuffer commandBuffer, int frame, glm::vec2 position, float scale, float lineSpacing = 1.2, int textalignment = TextAlignment::ALIGNMENT_CENTER | TextAlignment::ALIGNMENT_MIDDLE);
+	void drawText(const std::string& text, const int fontIndex, VkCommandBuffer commandBuffer, int frame, glm::vec2 position, float scale, float lineSpacing = 1.2, int textalignment = TextAlignment::ALIGNMENT_CENTER | TextAlignment::ALIGNMENT_MIDDLE);
+	void queueText(const std::string& text, const int fontIndex, glm::vec2 position, float scale, float lineSpacing = 1.2, int textalignment = TextAlignment::ALIGNMENT_CENTER | TextAlignment::ALIGNMENT_MIDDLE, const glm::vec3& color = glm::vec3(1.0f));
+	void flushText(VkCommandBuffer commandBuffer, int frame);
+	void queueSprite(int imageBufferIndex, const SpriteInstance& sprite, int layer = 0);
+	void queueSpriteFromArray(int textureArrayIndex, uint32_t arrayLayer, const SpriteInstance& sprite, int layer = 0);
+	void setSpriteCullBounds(const glm::vec2& min, const glm::vec2& max);
+	void disableSpriteCulling();
+	void flushSprites(VkCommandBuffer commandBuffer, int frame);
 	void drawCube(const glm::mat4& modelMatrix, const glm::vec4& color, VkCommandBuffer commandBuffer, int frame);
 	void drawAabb(const AABB& aabb, const glm::vec4& color, VkCommandBuffer commandBuffer, int frame);
 	void drawPrimitive(PrimitiveType primitiveType, const glm::mat4& modelMatrix, const glm::vec4& color, VkCommandBuffer commandBuffer, int frame);
+	void queueDebugPrimitive(PrimitiveType primitiveType, const glm::mat4& modelMatrix, const glm::vec4& color);
+	void queueDebugLine(const glm::vec3& from, const glm::vec3& to, const glm::vec4& color);
+	void queueDebugBox(const glm::mat4& modelMatrix, const glm::vec4& color, bool wireframe = true);
+	void queueDebugAabb(const AABB& aabb, const glm::vec4& color, bool wireframe = true);
+	void queueDebugSphere(const glm::vec3& center, float radius, const glm::vec4& color, bool wireframe = true);
+	void flushDebugDraw(VkCommandBuffer commandBuffer, int frame);
 
 	~Renderer();
 };
@@ -382,7 +514,7 @@ template<typename C>
 void Renderer::bindDescriptorSets(const C& descriptorSets, int firstSet, int frame)
 {
 	validateCurrentPipeline();
-	VkCommandBuffer commandBuffer = this->getCommandBuffer(frame);
+	VkCommandBuffer commandBuffer = this->getBindCommandBuffer(frame);
 	VkPipelineLayout pipelineLayout = m_currentPipeline->getPipelineLayout();
 
 	vkCmdBindDescriptorSets(
@@ -0,0 +1,106 @@
+#include "SpriteBatch.h"
+#include <algorithm>
+#include <cmath>
+
+void SpriteBatch::beginFrame(VkDevice device, uint32_t frame)
+{
+	m_ring.beginFrame(device, frame);
+	m_culledCount = 0;
+}
+
+void SpriteBatch::setCullBounds(const glm::vec2& min, const glm::vec2& max)
+{
+	m_cullMin = min;
+	m_cullMax = max;
+	m_cullEnabled = true;
+}
+
+void SpriteBatch::add(int descriptorIndex, bool textureArray, uint32_t arrayLayer, const SpriteInstance& sprite, int layer)
+{
+	// Test the bounds of the rotated quad against the cull rectangle
+	if (m_cullEnabled) {
+		glm::vec2 extent = sprite.size * 0.5f;
+		if (sprite.rotation != 0.0f) {
+			float c = std::abs(std::cos(sprite.rotation));
+			float s = std::abs(std::sin(sprite.rotation));
+			extent = glm::vec2(c * extent.x + s * extent.y, s * extent.x + c * extent.y);
+		}
+		if (sprite.position.x + extent.x < m_cullMin.x || sprite.position.x - extent.x > m_cullMax.x ||
+			sprite.position.y + extent.y < m_cullMin.y || sprite.position.y - extent.y > m_cullMax.y) {
+			m_culledCount++;
+			return;
+		}
+	}
+
+	// Layer first, then the texture, the index keeps the queue order of equal keys
+	uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(layer) ^ 0x80000000u) << 32)
+		| (static_cast<uint64_t>(textureArray) << 31)
+		| static_cast<uint64_t>(static_cast<uint32_t>(descriptorIndex) & 0x7FFFFFFFu);
+	m_sortKeys.push_back({ key, static_cast<uint32_t>(m_sprites.size()) });
+	m_sprites.push_back({ sprite, descriptorIndex, textureArray, static_cast<float>(arrayLayer) });
+}
+
+const std::vector<SpriteDraw>& SpriteBatch::upload(VkPhysicalDevice physicalDevice, VkDevice device)
+{
+	m_draws.clear();
+	if (m_sprites.empty()) {
+		return m_draws;
+	}
+
+	std::sort(m_sortKeys.begin(), m_sortKeys.end());
+
+	QuadRange range = m_ring.allocate(physicalDevice, device, static_cast<uint32_t>(m_sprites.size()));
+	SpriteVertex* vertices = static_cast<SpriteVertex*>(range.vertices);
+	uint32_t quad = range.firstQuad;
+	for (const auto& [key, index] : m_sortKeys) {
+		const QueuedSprite& queued = m_sprites[index];
+		writeVertices(queued, vertices);
+		vertices += 4;
+
+		// Runs of the same texture collapse into one draw, also across layers
+		if (m_draws.empty() || m_draws.back().descriptorIndex != queued.descriptorIndex || m_draws.back().textureArray != queued.textureArray) {
+			SpriteDraw draw;
+			draw.descriptorIndex = queued.descriptorIndex;
+			draw.textureArray = queued.textureArray;
+			draw.buffer = range.buffer;
+			draw.indexOffset = range.indexOffset;
+			draw.firstIndex = quad * 6;
+			m_draws.push_back(draw);
+		}
+		m_draws.back().indexCount += 6;
+		quad++;
+	}
+
+	m_sprites.clear();
+	m_sortKeys.clear();
+	return m_draws;
+}
+
+void SpriteBatch::writeVertices(const QueuedSprite& queued, SpriteVertex* vertices)
+{
+	const SpriteInstance& sprite = queued.sprite;
+	glm::vec2 half = sprite.size * 0.5f;
+	glm::vec2 axisX = glm::vec2(half.x, 0.0f);
+	glm::vec2 axisY = glm::vec2(0.0f, half.y);
+	if (sprite.rotation != 0.0f) {
+		float c = std::cos(sprite.rotation);
+		float s = std::sin(sprite.rotation);
+		axisX = glm::vec2(c, s) * half.x;
+		axisY = glm::vec2(-s, c) * half.y;
+	}
+
+	// Top left, bottom left, bottom right and top right, the order of the ring buffer indices
+	const glm::vec4& uv = sprite.uvRect;
+	vertices[0] = { glm::vec3(sprite.position - axisX + axisY, sprite.depth), sprite.color, glm::vec2(uv.x, uv.y), queued.arrayLayer };
+	vertices[1] = { glm::vec3(sprite.position - axisX - axisY, sprite.depth), sprite.color, glm::vec2(uv.x, uv.w), queued.arrayLayer };
+	vertices[2] = { glm::vec3(sprite.position + axisX - axisY, sprite.depth), sprite.color, glm::vec2(uv.z, uv.w), queued.arrayLayer };
+	vertices[3] = { glm::vec3(sprite.position + axisX + axisY, sprite.depth), sprite.color, glm::vec2(uv.z, uv.y), queued.arrayLayer };
+}
+
+void SpriteBatch::dispose(VkDevice device)
+{
+	m_ring.dispose(device);
+	m_sprites.clear();
+	m_sortKeys.clear();
+	m_draws.clear();
+}
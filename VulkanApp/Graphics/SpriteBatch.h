@@ -0,0 +1,130 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "QuadRingBuffer.h"
+
+/// <summary>
+/// Vertex of the sprite batch pipelines
+/// </summary>
+struct SpriteVertex {
+	glm::vec3 pos;
+	glm::vec4 color;
+	glm::vec2 texCoord;
+	float layer;		// Layer of the texture array, unused for plain textures
+};
+
+/// <summary>
+/// A textured quad queued to the sprite batch
+/// </summary>
+struct SpriteInstance {
+	glm::vec2 position = glm::vec2(0.0f);					// Center in world space
+	glm::vec2 size = glm::vec2(1.0f);
+	float rotation = 0.0f;									// Radians around the center
+	float depth = 0.0f;										// z of the quad
+	glm::vec4 uvRect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);	// xy = top left, zw = bottom right texture coordinates, selects the sprite of an atlas
+	glm::vec4 color = glm::vec4(1.0f);
+};
+
+/// <summary>
+/// One indexed draw of the sprites sharing a texture or texture array
+/// </summary>
+struct SpriteDraw {
+	int descriptorIndex = -1;			// Sampler descriptor set of the texture or texture array
+	bool textureArray = false;
+	VkBuffer buffer = VK_NULL_HANDLE;	// Holds the vertices and, from indexOffset on, the indices
+	VkDeviceSize indexOffset = 0;
+	uint32_t firstIndex = 0;
+	uint32_t indexCount = 0;
+};
+
+/// <summary>
+/// Collects the sprites of a frame and draws them with one indexed draw per texture run
+/// The sprites are sorted by layer and then by texture, so sprites of a layer that share a texture, an atlas or a
+/// texture array are drawn together. Lower layers are drawn first, the order inside a layer is only kept per texture.
+/// The vertices are streamed through a QuadRingBuffer.
+/// </summary>
+class SpriteBatch
+{
+private:
+	/// <summary>
+	/// A sprite and the texture it samples
+	/// </summary>
+	struct QueuedSprite {
+		SpriteInstance sprite;
+		int descriptorIndex;
+		bool textureArray;
+		float arrayLayer;
+	};
+
+	std::vector<QueuedSprite> m_sprites;
+	std::vector<std::pair<uint64_t, uint32_t>> m_sortKeys;	// Layer and texture key and index of the sprite
+	QuadRingBuffer m_ring = QuadRingBuffer(sizeof(SpriteVertex));
+	std::vector<SpriteDraw> m_draws;
+
+	bool m_cullEnabled = false;
+	glm::vec2 m_cullMin = glm::vec2(0.0f);
+	glm::vec2 m_cullMax = glm::vec2(0.0f);
+	size_t m_culledCount = 0;
+
+	/// <summary>
+	/// Writes the four corners of a sprite
+	/// </summary>
+	static void writeVertices(const QueuedSprite& queued, SpriteVertex* vertices);
+
+public:
+	SpriteBatch() = default;
+	~SpriteBatch() = default;
+
+	/// <summary>
+	/// Starts a frame, the previous command buffer of the swapchain image has finished
+	/// </summary>
+	/// <param name="device"></param>
+	/// <param name="frame">Index of the swapchain image</param>
+	void beginFrame(VkDevice device, uint32_t frame);
+
+	/// <summary>
+	/// Drops sprites outside of the rectangle when they are queued, e.g. the view bounds of a Camera2D
+	/// </summary>
+	/// <param name="min"></param>
+	/// <param name="max"></param>
+	void setCullBounds(const glm::vec2& min, const glm::vec2& max);
+
+	/// <summary>
+	/// Queues all sprites again
+	/// </summary>
+	void disableCulling() {
+		m_cullEnabled = false;
+	}
+
+	/// <summary>
+	/// Queues a sprite for the next upload
+	/// </summary>
+	/// <param name="descriptorIndex">Sampler descriptor set of the texture or texture array</param>
+	/// <param name="textureArray">true if the descriptor set holds a texture array</param>
+	/// <param name="arrayLayer">Layer of the texture array</param>
+	/// <param name="sprite"></param>
+	/// <param name="layer">Draw order, lower layers are drawn first</param>
+	void add(int descriptorIndex, bool textureArray, uint32_t arrayLayer, const SpriteInstance& sprite, int layer);
+
+	/// <summary>
+	/// Sorts the queued sprites, appends them to the ring buffer of the frame and empties the queue
+	/// </summary>
+	/// <param name="physicalDevice">Creates larger ring buffers if needed</param>
+	/// <param name="device"></param>
+	/// <returns>One draw per texture run, valid until the next upload</returns>
+	const std::vector<SpriteDraw>& upload(VkPhysicalDevice physicalDevice, VkDevice device);
+
+	/// <summary>
+	/// Returns the number of sprites dropped by the culling since the frame started
+	/// </summary>
+	/// <returns></returns>
+	size_t getCulledCount() const {
+		return m_culledCount;
+	}
+
+	void dispose(VkDevice device);
+};
@@ -0,0 +1,181 @@
+#include "TextBatcher.h"
+#include "Renderer.h"
+#include "../Utils.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <string_view>
+
+void TextBatcher::beginFrame(VkDevice device, uint32_t frame)
+{
+	m_ring.beginFrame(device, frame);
+
+	// Drop texts that are no longer drawn once in a while
+	m_frameCounter++;
+	if (m_frameCounter % 64 == 0) {
+		std::erase_if(m_runs, [this](const auto& entry) {
+			return entry.second.lastUsedFrame + RUN_LIFETIME < m_frameCounter;
+		});
+	}
+}
+
+void TextBatcher::add(const Font& font, int fontIndex, const std::string& text, const glm::vec2& position, float scale, float lineSpacing, int alignment, const glm::vec3& color)
+{
+	if (text.empty()) {
+		return;
+	}
+
+	const GlyphRun& run = this->getRun(font, fontIndex, text, scale, lineSpacing, alignment);
+	if (run.quads.empty()) {
+		return;
+	}
+
+	// Fonts sharing an atlas share the draw
+	int textureBufferIndex = font.getTextureBufferIndex();
+	auto queue = std::find_if(m_queues.begin(), m_queues.end(), [textureBufferIndex](const FontQueue& queue) {
+		return queue.textureBufferIndex == textureBufferIndex;
+	});
+	if (queue == m_queues.end()) {
+		m_queues.push_back({ fontIndex, textureBufferIndex, {} });
+		queue = m_queues.end() - 1;
+	}
+
+	// Four corners per glyph, the ring buffer provides the indices
+	const glm::vec3 normal = glm::vec3(0.0f, 0.0f, 1.0f);
+	std::vector<Vertex>& vertices = queue->vertices;
+	vertices.reserve(vertices.size() + run.quads.size() * 4);
+	for (const GlyphQuad& quad : run.quads) {
+		glm::vec2 min = quad.min + position;
+		glm::vec2 max = quad.max + position;
+		vertices.push_back({ { min.x, max.y, 0.0f }, color, { quad.uvMin.x, quad.uvMin.y }, normal });
+		vertices.push_back({ { min.x, min.y, 0.0f }, color, { quad.uvMin.x, quad.uvMax.y }, normal });
+		vertices.push_back({ { max.x, min.y, 0.0f }, color, { quad.uvMax.x, quad.uvMax.y }, normal });
+		vertices.push_back({ { max.x, max.y, 0.0f }, color, { quad.uvMax.x, quad.uvMin.y }, normal });
+	}
+}
+
+const std::vector<TextDraw>& TextBatcher::upload(VkPhysicalDevice physicalDevice, VkDevice device)
+{
+	m_draws.clear();
+	uint32_t queuedQuads = 0;
+	for (const FontQueue& queue : m_queues) {
+		queuedQuads += static_cast<uint32_t>(queue.vertices.size() / 4);
+	}
+	if (queuedQuads == 0) {
+		return m_draws;
+	}
+
+	// The text of every font atlas is drawn with one call
+	QuadRange range = m_ring.allocate(physicalDevice, device, queuedQuads);
+	Vertex* vertices = static_cast<Vertex*>(range.vertices);
+	uint32_t quad = range.firstQuad;
+	for (FontQueue& queue : m_queues) {
+		if (queue.vertices.empty()) {
+			continue;
+		}
+		uint32_t quadCount = static_cast<uint32_t>(queue.vertices.size() / 4);
+		std::memcpy(vertices, queue.vertices.data(), sizeof(Vertex) * queue.vertices.size());
+
+		TextDraw draw;
+		draw.fontIndex = queue.fontIndex;
+		draw.buffer = range.buffer;
+		draw.indexOffset = range.indexOffset;
+		draw.firstIndex = quad * 6;
+		draw.indexCount = quadCount * 6;
+		m_draws.push_back(draw);
+
+		vertices += queue.vertices.size();
+		quad += quadCount;
+		queue.vertices.clear();
+	}
+	return m_draws;
+}
+
+const TextBatcher::GlyphRun& TextBatcher::getRun(const Font& font, int fontIndex, const std::string& text, float scale, float lineSpacing, int alignment)
+{
+	size_t hash = std::hash<std::string_view>()(text);
+	for (size_t value : { static_cast<size_t>(fontIndex), static_cast<size_t>(std::bit_cast<uint32_t>(scale)), static_cast<size_t>(std::bit_cast<uint32_t>(lineSpacing)), static_cast<size_t>(alignment) }) {
+		hash ^= value + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2);
+	}
+
+	// A hash collision replaces the cached run
+	GlyphRun& run = m_runs[hash];
+	if (run.fontIndex != fontIndex || run.scale != scale || run.lineSpacing != lineSpacing || run.alignment != alignment || run.text != text) {
+		run.text = text;
+		run.fontIndex = fontIndex;
+		run.scale = scale;
+		run.lineSpacing = lineSpacing;
+		run.alignment = alignment;
+		layoutRun(font, run);
+	}
+	run.lastUsedFrame = m_frameCounter;
+	return run;
+}
+
+void TextBatcher::layoutRun(const Font& font, GlyphRun& run)
+{
+	run.quads.clear();
+	const FontAtlas& fontAtlas = font.getFontAtlas();
+	float scale = run.scale * font.getMetricScale();
+
+	// Align the text block around the origin
+	float currentX = 0.0f;
+	float currentY = 0.0f;
+	auto textmessure = measureText(run.text, &font, run.scale, run.lineSpacing);
+	if (TextAlignment::ALIGNMENT_TOP & run.alignment) {
+		currentY -= textmessure.lineHeight;
+	}
+	else if (TextAlignment::ALIGNMENT_MIDDLE & run.alignment) {
+		currentY += (textmessure.height - textmessure.lineHeight) / 2.0f;
+	}
+	else if (TextAlignment::ALIGNMENT_BOTTOM & run.alignment) {
+		currentY += textmessure.height - textmessure.lineHeight;
+	}
+
+	if (TextAlignment::ALIGNMENT_CENTER & run.alignment) {
+		currentX -= textmessure.width / 2.0f;
+	}
+	if (TextAlignment::ALIGNMENT_RIGHT & run.alignment) {
+		currentX -= textmessure.width;
+	}
+
+	float startX = currentX;
+	float lineHeight = textmessure.lineHeight;
+	run.quads.reserve(run.text.size());
+	for (size_t offset = 0; offset < run.text.size();) {
+		uint32_t c = decodeUtf8(run.text, offset);
+		if (c == '\n') {
+			currentX = startX;
+			currentY -= lineHeight * run.lineSpacing;
+			continue;
+		}
+
+		const Character* character = fontAtlas.findCharacter(c);
+		if (character == nullptr) continue;
+		const Character& ch = *character;
+
+		float xpos = currentX + ch.bearingX * scale;
+		float ypos = currentY - (static_cast<float>(ch.height) - ch.bearingY) * scale;
+		float w = ch.width * scale;
+		float h = ch.height * scale;
+		currentX += ch.advance * scale;
+		if (w <= 0 || h <= 0) {
+			continue;
+		}
+
+		GlyphQuad quad;
+		quad.min = glm::vec2(xpos, ypos);
+		quad.max = glm::vec2(xpos + w, ypos + h);
+		quad.uvMin = glm::vec2(ch.uvX, ch.uvY);
+		quad.uvMax = glm::vec2(ch.uvX + ch.uvWidth, ch.uvY + ch.uvHeight);
+		run.quads.push_back(quad);
+	}
+}
+
+void TextBatcher::dispose(VkDevice device)
+{
+	m_ring.dispose(device);
+	m_runs.clear();
+	m_queues.clear();
+	m_draws.clear();
+}
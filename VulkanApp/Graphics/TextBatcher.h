@@ -0,0 +1,126 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "VertexBuffer.h"
+#include "Font.h"
+#include "QuadRingBuffer.h"
+
+/// <summary>
+/// One indexed draw of the queued text of a font
+/// </summary>
+struct TextDraw {
+	int fontIndex = -1;					// One of the fonts using the atlas
+	VkBuffer buffer = VK_NULL_HANDLE;	// Holds the vertices and, from indexOffset on, the indices
+	VkDeviceSize indexOffset = 0;
+	uint32_t firstIndex = 0;
+	uint32_t indexCount = 0;
+};
+
+/// <summary>
+/// Collects the text of a frame and draws it with one indexed draw per font atlas
+/// Laid out texts are cached, so text that is drawn every frame is only laid out once. The glyph quads of a frame
+/// are streamed through a QuadRingBuffer.
+/// </summary>
+class TextBatcher
+{
+private:
+	/// <summary>
+	/// A glyph relative to the position of its text
+	/// </summary>
+	struct GlyphQuad {
+		glm::vec2 min;
+		glm::vec2 max;
+		glm::vec2 uvMin;
+		glm::vec2 uvMax;
+	};
+
+	/// <summary>
+	/// The laid out glyphs of a text, the text and the parameters verify hash hits
+	/// </summary>
+	struct GlyphRun {
+		std::string text;
+		int fontIndex = -1;
+		float scale = 1.0f;
+		float lineSpacing = 1.0f;
+		int alignment = 0;
+		std::vector<GlyphQuad> quads;
+		uint64_t lastUsedFrame = 0;
+	};
+
+	/// <summary>
+	/// The vertices queued for an atlas since the last upload
+	/// </summary>
+	struct FontQueue {
+		int fontIndex = -1;
+		int textureBufferIndex = -1;
+		std::vector<Vertex> vertices;
+	};
+
+	/// <summary>
+	/// Runs unused for this many frames are removed from the cache
+	/// </summary>
+	static constexpr uint64_t RUN_LIFETIME = 300;
+
+	std::unordered_map<size_t, GlyphRun> m_runs;
+	std::vector<FontQueue> m_queues;
+	QuadRingBuffer m_ring = QuadRingBuffer(sizeof(Vertex));
+	std::vector<TextDraw> m_draws;
+	uint64_t m_frameCounter = 0;
+
+	/// <summary>
+	/// Returns the cached layout of a text, lays it out on a miss
+	/// </summary>
+	const GlyphRun& getRun(const Font& font, int fontIndex, const std::string& text, float scale, float lineSpacing, int alignment);
+
+	/// <summary>
+	/// Lays out a text at the origin like Renderer::drawText did
+	/// </summary>
+	static void layoutRun(const Font& font, GlyphRun& run);
+
+public:
+	TextBatcher() = default;
+	~TextBatcher() = default;
+
+	/// <summary>
+	/// Starts a frame, the previous command buffer of the swapchain image has finished
+	/// </summary>
+	/// <param name="device"></param>
+	/// <param name="frame">Index of the swapchain image</param>
+	void beginFrame(VkDevice device, uint32_t frame);
+
+	/// <summary>
+	/// Queues a text for the next upload
+	/// </summary>
+	/// <param name="font"></param>
+	/// <param name="fontIndex"></param>
+	/// <param name="text"></param>
+	/// <param name="position"></param>
+	/// <param name="scale"></param>
+	/// <param name="lineSpacing"></param>
+	/// <param name="alignment">Combination of TextAlignment flags</param>
+	/// <param name="color"></param>
+	void add(const Font& font, int fontIndex, const std::string& text, const glm::vec2& position, float scale, float lineSpacing, int alignment, const glm::vec3& color);
+
+	/// <summary>
+	/// Appends the queued text to the ring buffer of the frame and empties the queues
+	/// </summary>
+	/// <param name="physicalDevice">Creates larger ring buffers if needed</param>
+	/// <param name="device"></param>
+	/// <returns>One draw per font atlas, valid until the next upload</returns>
+	const std::vector<TextDraw>& upload(VkPhysicalDevice physicalDevice, VkDevice device);
+
+	/// <summary>
+	/// Returns the number of cached laid out texts
+	/// </summary>
+	/// <returns></returns>
+	size_t getCachedRunCount() const {
+		return m_runs.size();
+	}
+
+	void dispose(VkDevice device);
+};
@@ -0,0 +1,80 @@
+#include "TextureArrayBuffer.h"
+#include <stdexcept>
+
+TextureArrayBuffer::TextureArrayBuffer(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue queue, VkCommandPool pool, const std::vector<stbi_uc*>& layers, uint32_t width, uint32_t height)
+{
+	if (layers.empty()) {
+		throw std::runtime_error("Texture array must have at least one layer.");
+	}
+
+	this->width = width;
+	this->height = height;
+	this->layerCount = static_cast<uint32_t>(layers.size());
+
+	// CALCULATE IMAGE SIZE
+	VkDeviceSize layerSize = static_cast<VkDeviceSize>(width) * height * 4;
+	imageSize = layerSize * layerCount;
+
+	// CREATE STAGING BUFFER
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingBufferMemory;
+	createBuffer(
+		physicalDevice,
+		device,
+		imageSize,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		&stagingBuffer,
+		&stagingBufferMemory
+	);
+
+	// COPY LAYER DATA TO STAGING BUFFER
+	void* data;
+	vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
+	for (uint32_t i = 0; i < layerCount; i++) {
+		memcpy((char*)data + layerSize * i, layers[i], static_cast<size_t>(layerSize));
+	}
+	vkUnmapMemory(device, stagingBufferMemory);
+
+	// CREATE IMAGE
+	image = createImageLayered(
+		physicalDevice,
+		device,
+		width,
+		height,
+		VK_FORMAT_R8G8B8A8_UNORM,
+		VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		&imageMemory,
+		layerCount,
+		0
+	);
+
+	// UPLOAD THE LAYERS
+	transitionImageLayoutLayerd(device, queue, pool, image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, layerCount);
+	copyBufferToImageLayered(device, queue, pool, stagingBuffer, image, width, height, layerCount);
+	transitionImageLayoutLayerd(device, queue, pool, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, layerCount);
+
+	// CLEANUP STAGING BUFFER
+	vkDestroyBuffer(device, stagingBuffer, nullptr);
+	vkFreeMemory(device, stagingBufferMemory, nullptr);
+
+	// CREATE IMAGE VIEW
+	imageView = createImageViewLayered(
+		device,
+		image,
+		VK_FORMAT_R8G8B8A8_UNORM,
+		VK_IMAGE_ASPECT_COLOR_BIT,
+		VK_IMAGE_VIEW_TYPE_2D_ARRAY,
+		layerCount
+	);
+}
+
+void TextureArrayBuffer::dispose(VkDevice device)
+{
+	vkDestroyImageView(device, imageView, nullptr);
+	vkDestroyImage(device, image, nullptr);
+	vkFreeMemory(device, imageMemory, nullptr);
+	this->state = GFX_BUFFER_STATE_DISPOSED;
+}
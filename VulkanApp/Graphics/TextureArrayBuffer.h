@@ -0,0 +1,36 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <vector>
+#include "Buffer.h"
+#include "../Utils.h"
+
+/// <summary>
+/// RGBA 2D texture array, every layer has the same size
+/// Sprites using different layers of the array are drawn with one descriptor set, so they share a draw.
+/// </summary>
+class TextureArrayBuffer : public Buffer
+{
+public:
+	VkImage image;
+	VkDeviceMemory imageMemory;
+	VkImageView imageView;
+	VkDeviceSize imageSize;
+	uint32_t width;
+	uint32_t height;
+	uint32_t layerCount;
+	int descriptorIndex = -1;
+
+	/// <summary>
+	/// Creates the array and uploads the layers
+	/// </summary>
+	/// <param name="physicalDevice"></param>
+	/// <param name="device"></param>
+	/// <param name="queue"></param>
+	/// <param name="pool"></param>
+	/// <param name="layers">RGBA data of every layer</param>
+	/// <param name="width"></param>
+	/// <param name="height"></param>
+	TextureArrayBuffer(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue queue, VkCommandPool pool, const std::vector<stbi_uc*>& layers, uint32_t width, uint32_t height);
+	void dispose(VkDevice device) override;
+};
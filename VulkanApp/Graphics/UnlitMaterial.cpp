@@ -8,7 +8,7 @@ void UnlitMaterial::init(Renderer* renderer)
 
 void UnlitMaterial::dispose(Renderer* renderer)
 {
-
+	Material::markChanged();
 }
 
 void UnlitMaterial::bindMaterial(Renderer* renderer, VkCommandBuffer commandBuffer, int firstSet, int frame)
@@ -33,4 +33,12 @@ public:
 	/// <param name="firstSet"></param>
 	/// <param name="frame"></param>
 	void bindMaterial(Renderer* renderer, VkCommandBuffer commandBuffer, int firstSet, int frame) override;
+
+	/// <summary>
+	/// Returns the average of the albedo texture
+	/// </summary>
+	/// <returns></returns>
+	glm::vec4 getBaseColor() const override {
+		return albedoTexture ? albedoTexture->getAverageColor() : glm::vec4(1.0f);
+	}
 };
\ No newline at end of file
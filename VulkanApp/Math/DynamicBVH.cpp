@@ -0,0 +1,365 @@
+#include "DynamicBVH.h"
+#include <algorithm>
+
+int DynamicBVH::insert(const AABB& aabb, void* userData)
+{
+	int leaf = this->allocateNode();
+	Node& node = m_nodes[leaf];
+	node.aabb = aabb;
+	this->setFatAABB(leaf, AABB(aabb.min - glm::vec3(margin), aabb.max + glm::vec3(margin)));
+	node.userData = userData;
+	node.height = 0;
+	m_leafCount++;
+	this->insertLeaf(leaf);
+	return leaf;
+}
+
+void DynamicBVH::remove(int proxy)
+{
+	if (proxy < 0 || proxy >= static_cast<int>(m_nodes.size()) || !m_nodes[proxy].isLeaf() || m_nodes[proxy].height != 0) {
+		throw std::runtime_error("failed to remove bvh proxy: invalid proxy id!");
+	}
+	this->removeLeaf(proxy);
+	this->freeNode(proxy);
+	m_leafCount--;
+}
+
+bool DynamicBVH::update(int proxy, const AABB& aabb)
+{
+	Node& node = m_nodes[proxy];
+	node.aabb = aabb;
+
+	// Still inside the fat AABB, the tree doesn't change
+	if (glm::all(glm::greaterThanEqual(aabb.min, node.fatAABB.min)) && glm::all(glm::lessThanEqual(aabb.max, node.fatAABB.max))) {
+		return false;
+	}
+
+	this->removeLeaf(proxy);
+	this->setFatAABB(proxy, AABB(aabb.min - glm::vec3(margin), aabb.max + glm::vec3(margin)));
+	this->insertLeaf(proxy);
+	return true;
+}
+
+void DynamicBVH::clear()
+{
+	m_nodes.clear();
+	m_fatBounds.clear();
+	m_root = NULL_NODE;
+	m_freeList = NULL_NODE;
+	m_leafCount = 0;
+}
+
+void DynamicBVH::build()
+{
+	// Collect the leaves and free all inner nodes, the leaves keep their ids
+	std::vector<int> leaves;
+	leaves.reserve(m_leafCount);
+	for (int i = 0; i < static_cast<int>(m_nodes.size()); i++) {
+		if (m_nodes[i].height == 0) {
+			leaves.push_back(i);
+		}
+		else if (m_nodes[i].height > 0) {
+			this->freeNode(i);
+		}
+	}
+
+	m_root = leaves.empty() ? NULL_NODE : this->buildRecursive(leaves, 0, leaves.size(), NULL_NODE);
+}
+
+int DynamicBVH::buildRecursive(std::vector<int>& leaves, size_t begin, size_t end, int parent)
+{
+	size_t count = end - begin;
+	if (count == 1) {
+		m_nodes[leaves[begin]].parent = parent;
+		return leaves[begin];
+	}
+
+	// Bounds of the nodes and of their centroids
+	AABB bounds;
+	AABB centroidBounds;
+	for (size_t i = begin; i < end; i++) {
+		const AABB& fat = m_nodes[leaves[i]].fatAABB;
+		bounds.expand(fat);
+		centroidBounds.expand(fat.center());
+	}
+
+	glm::vec3 extents = centroidBounds.max - centroidBounds.min;
+	int axis = 0;
+	if (extents.y > extents[axis]) axis = 1;
+	if (extents.z > extents[axis]) axis = 2;
+
+	size_t split = begin + count / 2;
+	if (extents[axis] > 0.0f) {
+		// Bin the centroids along the longest axis and pick the split with the lowest SAH cost
+		constexpr int BIN_COUNT = 12;
+		AABB binBounds[BIN_COUNT];
+		size_t binCounts[BIN_COUNT] = {};
+		float scale = BIN_COUNT / extents[axis];
+		auto binOf = [&](int leaf) {
+			float offset = (m_nodes[leaf].fatAABB.center()[axis] - centroidBounds.min[axis]) * scale;
+			return std::min(static_cast<int>(offset), BIN_COUNT - 1);
+		};
+		for (size_t i = begin; i < end; i++) {
+			int bin = binOf(leaves[i]);
+			binCounts[bin]++;
+			binBounds[bin].expand(m_nodes[leaves[i]].fatAABB);
+		}
+
+		// Sweep from the right to get the cost of each right side
+		float rightCosts[BIN_COUNT] = {};
+		AABB rightBounds;
+		size_t rightCount = 0;
+		for (int i = BIN_COUNT - 1; i > 0; i--) {
+			rightBounds.expand(binBounds[i]);
+			rightCount += binCounts[i];
+			rightCosts[i] = rightCount > 0 ? surfaceArea(rightBounds) * rightCount : 0.0f;
+		}
+
+		float bestCost = FLT_MAX;
+		int bestBin = -1;
+		AABB leftBounds;
+		size_t leftCount = 0;
+		for (int i = 0; i < BIN_COUNT - 1; i++) {
+			leftBounds.expand(binBounds[i]);
+			leftCount += binCounts[i];
+			if (leftCount == 0 || leftCount == count) {
+				continue;
+			}
+			float cost = surfaceArea(leftBounds) * leftCount + rightCosts[i + 1];
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestBin = i;
+			}
+		}
+
+		if (bestBin >= 0) {
+			auto middle = std::partition(leaves.begin() + begin, leaves.begin() + end, [&](int leaf) {
+				return binOf(leaf) <= bestBin;
+			});
+			split = static_cast<size_t>(middle - leaves.begin());
+		}
+	}
+
+	// All centroids in one spot or all in one bin, split by count
+	if (split == begin || split == end) {
+		split = begin + count / 2;
+		std::nth_element(leaves.begin() + begin, leaves.begin() + split, leaves.begin() + end, [&](int a, int b) {
+			return m_nodes[a].fatAABB.center()[axis] < m_nodes[b].fatAABB.center()[axis];
+		});
+	}
+
+	int index = this->allocateNode();
+	int child0 = this->buildRecursive(leaves, begin, split, index);
+	int child1 = this->buildRecursive(leaves, split, end, index);
+
+	// Don't keep a reference across the recursion, the node vector may grow
+	Node& node = m_nodes[index];
+	node.parent = parent;
+	node.children[0] = child0;
+	node.children[1] = child1;
+	this->setFatAABB(index, bounds);
+	node.height = 1 + std::max(m_nodes[child0].height, m_nodes[child1].height);
+	return index;
+}
+
+int DynamicBVH::allocateNode()
+{
+	if (m_freeList == NULL_NODE) {
+		m_nodes.emplace_back();
+		m_fatBounds.resize(m_nodes.size());
+		return static_cast<int>(m_nodes.size() - 1);
+	}
+
+	int index = m_freeList;
+	m_freeList = m_nodes[index].parent;
+	m_nodes[index] = Node();
+	return index;
+}
+
+void DynamicBVH::freeNode(int node)
+{
+	m_nodes[node] = Node();
+	m_nodes[node].parent = m_freeList;
+	m_nodes[node].height = -1;
+	m_freeList = node;
+}
+
+void DynamicBVH::setFatAABB(int node, const AABB& aabb)
+{
+	m_nodes[node].fatAABB = aabb;
+	m_fatBounds.set(node, aabb);
+}
+
+void DynamicBVH::insertLeaf(int leaf)
+{
+	if (m_root == NULL_NODE) {
+		m_root = leaf;
+		m_nodes[leaf].parent = NULL_NODE;
+		return;
+	}
+
+	// Walk down to the sibling with the lowest surface area cost
+	AABB leafAABB = m_nodes[leaf].fatAABB;
+	int index = m_root;
+	while (!m_nodes[index].isLeaf()) {
+		const Node& node = m_nodes[index];
+		float area = surfaceArea(node.fatAABB);
+		float combinedArea = surfaceArea(node.fatAABB + leafAABB);
+
+		// Cost of making a new parent for this node and the leaf
+		float cost = 2.0f * combinedArea;
+
+		// Minimum cost of pushing the leaf further down
+		float inheritanceCost = 2.0f * (combinedArea - area);
+
+		float childCosts[2];
+		for (int i = 0; i < 2; i++) {
+			const Node& child = m_nodes[node.children[i]];
+			float enlarged = surfaceArea(child.fatAABB + leafAABB);
+			childCosts[i] = (child.isLeaf() ? enlarged : enlarged - surfaceArea(child.fatAABB)) + inheritanceCost;
+		}
+
+		if (cost < childCosts[0] && cost < childCosts[1]) {
+			break;
+		}
+		index = childCosts[0] < childCosts[1] ? node.children[0] : node.children[1];
+	}
+
+	// Create a new parent for the sibling and the leaf
+	int sibling = index;
+	int oldParent = m_nodes[sibling].parent;
+	int newParent = this->allocateNode();
+	m_nodes[newParent].parent = oldParent;
+	this->setFatAABB(newParent, leafAABB + m_nodes[sibling].fatAABB);
+	m_nodes[newParent].height = m_nodes[sibling].height + 1;
+	m_nodes[newParent].children[0] = sibling;
+	m_nodes[newParent].children[1] = leaf;
+	m_nodes[sibling].parent = newParent;
+	m_nodes[leaf].parent = newParent;
+
+	if (oldParent == NULL_NODE) {
+		m_root = newParent;
+	}
+	else if (m_nodes[oldParent].children[0] == sibling) {
+		m_nodes[oldParent].children[0] = newParent;
+	}
+	else {
+		m_nodes[oldParent].children[1] = newParent;
+	}
+
+	this->refitUpwards(m_nodes[leaf].parent);
+}
+
+void DynamicBVH::removeLeaf(int leaf)
+{
+	if (leaf == m_root) {
+		m_root = NULL_NODE;
+		return;
+	}
+
+	// The sibling takes the place of the parent
+	int parent = m_nodes[leaf].parent;
+	int grandParent = m_nodes[parent].parent;
+	int sibling = m_nodes[parent].children[0] == leaf ? m_nodes[parent].children[1] : m_nodes[parent].children[0];
+
+	if (grandParent == NULL_NODE) {
+		m_root = sibling;
+		m_nodes[sibling].parent = NULL_NODE;
+		this->freeNode(parent);
+		return;
+	}
+
+	if (m_nodes[grandParent].children[0] == parent) {
+		m_nodes[grandParent].children[0] = sibling;
+	}
+	else {
+		m_nodes[grandParent].children[1] = sibling;
+	}
+	m_nodes[sibling].parent = grandParent;
+	this->freeNode(parent);
+
+	this->refitUpwards(grandParent);
+}
+
+void DynamicBVH::refitUpwards(int index)
+{
+	while (index != NULL_NODE) {
+		index = this->balance(index);
+
+		Node& node = m_nodes[index];
+		const Node& child0 = m_nodes[node.children[0]];
+		const Node& child1 = m_nodes[node.children[1]];
+		node.height = 1 + std::max(child0.height, child1.height);
+		this->setFatAABB(index, child0.fatAABB + child1.fatAABB);
+
+		index = node.parent;
+	}
+}
+
+int DynamicBVH::balance(int indexA)
+{
+	// Rotates the tree if one subtree of A is more than one level higher than the other
+	Node& a = m_nodes[indexA];
+	if (a.isLeaf() || a.height < 2) {
+		return indexA;
+	}
+
+	int indexB = a.children[0];
+	int indexC = a.children[1];
+	int balanceFactor = m_nodes[indexC].height - m_nodes[indexB].height;
+	if (balanceFactor >= -1 && balanceFactor <= 1) {
+		return indexA;
+	}
+
+	// Promote the higher child (C) and give A one of its grandchildren
+	bool rotateRight = balanceFactor > 1;
+	int indexUp = rotateRight ? indexC : indexB;
+	int indexOther = rotateRight ? indexB : indexC;
+	Node& up = m_nodes[indexUp];
+	int indexF = up.children[0];
+	int indexG = up.children[1];
+
+	// Swap A and the promoted child
+	up.children[0] = indexA;
+	up.parent = a.parent;
+	a.parent = indexUp;
+
+	if (up.parent != NULL_NODE) {
+		Node& parent = m_nodes[up.parent];
+		if (parent.children[0] == indexA) {
+			parent.children[0] = indexUp;
+		}
+		else {
+			parent.children[1] = indexUp;
+		}
+	}
+	else {
+		m_root = indexUp;
+	}
+
+	// The higher grandchild stays with the promoted node, the lower one goes to A
+	Node& f = m_nodes[indexF];
+	Node& g = m_nodes[indexG];
+	int indexKeep = f.height > g.height ? indexF : indexG;
+	int indexMove = f.height > g.height ? indexG : indexF;
+
+	up.children[1] = indexKeep;
+	if (rotateRight) {
+		a.children[1] = indexMove;
+	}
+	else {
+		a.children[0] = indexMove;
+	}
+	m_nodes[indexMove].parent = indexA;
+
+	const Node& other = m_nodes[indexOther];
+	const Node& moved = m_nodes[indexMove];
+	this->setFatAABB(indexA, other.fatAABB + moved.fatAABB);
+	a.height = 1 + std::max(other.height, moved.height);
+
+	const Node& kept = m_nodes[indexKeep];
+	this->setFatAABB(indexUp, a.fatAABB + kept.fatAABB);
+	up.height = 1 + std::max(a.height, kept.height);
+
+	return indexUp;
+}
@@ -0,0 +1,396 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <stdexcept>
+#include <vector>
+#include "AABB.h"
+#include "RayCast.h"
+#include "RayPacket.h"
+
+/// <summary>
+/// Dynamic bounding volume hierarchy over axis-aligned bounding boxes
+/// Leaves store a tight AABB and a fat AABB enlarged by the margin, moving objects are only
+/// reinserted once they leave their fat AABB. Insertion picks the sibling with the lowest
+/// surface area cost and keeps the tree balanced with rotations, build() rebuilds the whole
+/// tree top-down with a binned SAH. Proxy ids stay valid until the proxy is removed.
+/// </summary>
+class DynamicBVH
+{
+public:
+	/// <summary>
+	/// Id of nodes that don't exist
+	/// </summary>
+	static constexpr int NULL_NODE = -1;
+
+	/// <summary>
+	/// Margin added on each side of the fat AABBs
+	/// </summary>
+	float margin = 0.1f;
+
+	DynamicBVH() = default;
+	~DynamicBVH() = default;
+
+	/// <summary>
+	/// Inserts an object and returns its proxy id
+	/// </summary>
+	/// <param name="aabb"></param>
+	/// <param name="userData"></param>
+	/// <returns></returns>
+	int insert(const AABB& aabb, void* userData);
+
+	/// <summary>
+	/// Removes the object with the given proxy id
+	/// </summary>
+	/// <param name="proxy"></param>
+	void remove(int proxy);
+
+	/// <summary>
+	/// Updates the AABB of an object
+	/// The object is only reinserted if the new AABB leaves its fat AABB.
+	/// </summary>
+	/// <param name="proxy"></param>
+	/// <param name="aabb"></param>
+	/// <returns>True if the object was reinserted</returns>
+	bool update(int proxy, const AABB& aabb);
+
+	/// <summary>
+	/// Rebuilds the whole tree top-down with a binned SAH
+	/// Use it after loading or after many objects moved, proxy ids stay valid.
+	/// </summary>
+	void build();
+
+	/// <summary>
+	/// Removes all objects
+	/// </summary>
+	void clear();
+
+	/// <summary>
+	/// Gets the user data of an object
+	/// </summary>
+	/// <param name="proxy"></param>
+	/// <returns></returns>
+	void* getUserData(int proxy) const {
+		return m_nodes[proxy].userData;
+	}
+
+	/// <summary>
+	/// Gets the tight AABB of an object
+	/// </summary>
+	/// <param name="proxy"></param>
+	/// <returns></returns>
+	const AABB& getAABB(int proxy) const {
+		return m_nodes[proxy].aabb;
+	}
+
+	/// <summary>
+	/// Returns the number of objects in the tree
+	/// </summary>
+	/// <returns></returns>
+	size_t size() const {
+		return m_leafCount;
+	}
+
+	/// <summary>
+	/// Returns the height of the tree
+	/// </summary>
+	/// <returns></returns>
+	int getHeight() const {
+		return m_root == NULL_NODE ? 0 : m_nodes[m_root].height;
+	}
+
+	/// <summary>
+	/// Casts a ray through the tree and visits the leaves front to back
+	/// The callback gets the user data, the tight AABB and the current max distance and returns the new
+	/// max distance. Return a smaller value on a hit to cull everything behind it, 0 stops the traversal.
+	/// </summary>
+	/// <typeparam name="Fn"></typeparam>
+	/// <param name="ray"></param>
+	/// <param name="maxDistance"></param>
+	/// <param name="callback"></param>
+	template<typename Fn>
+	void raycast(const Ray& ray, float maxDistance, Fn&& callback) const {
+		if (m_root == NULL_NODE) {
+			return;
+		}
+
+		const glm::vec3 invDirection = 1.0f / ray.direction;
+		struct StackEntry { int node; float entry; };
+		StackEntry stack[STACK_SIZE];
+		int count = 0;
+
+		float entry;
+		if (!intersectRay(ray.origin, invDirection, m_nodes[m_root].fatAABB, maxDistance, entry)) {
+			return;
+		}
+		stack[count++] = { m_root, entry };
+
+		while (count > 0) {
+			StackEntry current = stack[--count];
+			// The max distance may have shrunk since the node was pushed
+			if (current.entry > maxDistance) {
+				continue;
+			}
+
+			const Node& node = m_nodes[current.node];
+			if (node.isLeaf()) {
+				maxDistance = callback(node.userData, node.aabb, maxDistance);
+				if (maxDistance <= 0.0f) {
+					return;
+				}
+				continue;
+			}
+
+			// Push the far child first so the near child is visited first
+			float entry0, entry1;
+			bool hit0 = intersectRay(ray.origin, invDirection, m_nodes[node.children[0]].fatAABB, maxDistance, entry0);
+			bool hit1 = intersectRay(ray.origin, invDirection, m_nodes[node.children[1]].fatAABB, maxDistance, entry1);
+			if (count + 2 > STACK_SIZE) {
+				throw std::runtime_error("failed to raycast bvh: traversal stack overflow!");
+			}
+			if (hit0 && hit1) {
+				if (entry0 <= entry1) {
+					stack[count++] = { node.children[1], entry1 };
+					stack[count++] = { node.children[0], entry0 };
+				}
+				else {
+					stack[count++] = { node.children[0], entry0 };
+					stack[count++] = { node.children[1], entry1 };
+				}
+			}
+			else if (hit0) {
+				stack[count++] = { node.children[0], entry0 };
+			}
+			else if (hit1) {
+				stack[count++] = { node.children[1], entry1 };
+			}
+		}
+	}
+
+	/// <summary>
+	/// Casts a packet of rays through the tree, each node is tested against all rays of the packet at once
+	/// A node is entered if any active ray hits it, children are visited near first along the direction of the
+	/// first active ray. The callback gets the lane, the user data, the tight AABB and the max distance of the lane
+	/// and returns the new max distance of the lane. 0 deactivates the lane, the traversal stops once all lanes are done.
+	/// </summary>
+	/// <typeparam name="Fn"></typeparam>
+	/// <param name="packet"></param>
+	/// <param name="callback"></param>
+	template<typename Fn>
+	void raycastPacket(RayPacket& packet, Fn&& callback) const {
+		if (m_root == NULL_NODE) {
+			return;
+		}
+
+		int stack[STACK_SIZE];
+		int count = 0;
+		stack[count++] = m_root;
+
+		while (count > 0 && packet.activeMask != 0) {
+			int index = stack[--count];
+			// The lanes are tested when the node is popped, so shortened rays are culled right away
+			uint32_t mask = packet.intersect(m_fatBounds, index);
+			if (mask == 0) {
+				continue;
+			}
+			const Node& node = m_nodes[index];
+
+			if (node.isLeaf()) {
+				for (int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+					if ((mask & (1u << lane)) == 0) {
+						continue;
+					}
+					packet.maxDistance[lane] = callback(lane, node.userData, node.aabb, packet.maxDistance[lane]);
+					if (packet.maxDistance[lane] <= 0.0f) {
+						packet.activeMask &= ~(1u << lane);
+					}
+				}
+				continue;
+			}
+
+			// Rays of a packet are expected to be coherent, one lane decides the order for all
+			int lane = 0;
+			while ((mask & (1u << lane)) == 0) {
+				lane++;
+			}
+			glm::vec3 direction(packet.directionX[lane], packet.directionY[lane], packet.directionZ[lane]);
+			glm::vec3 offset = m_nodes[node.children[1]].fatAABB.center() - m_nodes[node.children[0]].fatAABB.center();
+			int nearChild = glm::dot(offset, direction) >= 0.0f ? 0 : 1;
+
+			if (count + 2 > STACK_SIZE) {
+				throw std::runtime_error("failed to raycast bvh: traversal stack overflow!");
+			}
+			stack[count++] = node.children[1 - nearChild];
+			stack[count++] = node.children[nearChild];
+		}
+	}
+
+	/// <summary>
+	/// Visits all objects whose fat AABB overlaps the given AABB
+	/// The callback gets the user data and the tight AABB, return false to stop the query.
+	/// </summary>
+	/// <typeparam name="Fn"></typeparam>
+	/// <param name="aabb"></param>
+	/// <param name="callback"></param>
+	template<typename Fn>
+	void queryAABB(const AABB& aabb, Fn&& callback) const {
+		this->query([&aabb](const AABB& bounds) {
+			return overlaps(aabb, bounds);
+		}, callback);
+	}
+
+	/// <summary>
+	/// Visits all objects whose fat AABB overlaps the given sphere
+	/// The callback gets the user data and the tight AABB, return false to stop the query.
+	/// </summary>
+	/// <typeparam name="Fn"></typeparam>
+	/// <param name="center"></param>
+	/// <param name="radius"></param>
+	/// <param name="callback"></param>
+	template<typename Fn>
+	void querySphere(const glm::vec3& center, float radius, Fn&& callback) const {
+		this->query([&center, radius](const AABB& bounds) {
+			return overlapsSphere(bounds, center, radius);
+		}, callback);
+	}
+
+	/// <summary>
+	/// Checks if two AABBs overlap
+	/// </summary>
+	/// <param name="a"></param>
+	/// <param name="b"></param>
+	/// <returns></returns>
+	static bool overlaps(const AABB& a, const AABB& b) {
+		return a.min.x <= b.max.x && a.max.x >= b.min.x &&
+			a.min.y <= b.max.y && a.max.y >= b.min.y &&
+			a.min.z <= b.max.z && a.max.z >= b.min.z;
+	}
+
+	/// <summary>
+	/// Checks if an AABB overlaps a sphere
+	/// </summary>
+	/// <param name="aabb"></param>
+	/// <param name="center"></param>
+	/// <param name="radius"></param>
+	/// <returns></returns>
+	static bool overlapsSphere(const AABB& aabb, const glm::vec3& center, float radius) {
+		glm::vec3 closest = glm::clamp(center, aabb.min, aabb.max);
+		glm::vec3 delta = closest - center;
+		return glm::dot(delta, delta) <= radius * radius;
+	}
+
+private:
+	/// <summary>
+	/// Maximum depth of the traversal stacks
+	/// </summary>
+	static constexpr int STACK_SIZE = 256;
+
+	/// <summary>
+	/// A node of the tree, leaves hold the objects
+	/// </summary>
+	struct Node {
+		AABB fatAABB;
+		AABB aabb;
+		void* userData = nullptr;
+		int parent = NULL_NODE;	// Next free node while the node is in the free list
+		int children[2] = { NULL_NODE, NULL_NODE };
+		int height = -1;		// 0 for leaves, -1 for free nodes
+
+		bool isLeaf() const {
+			return children[0] == NULL_NODE;
+		}
+	};
+
+	/// <summary>
+	/// All nodes, free nodes are chained through their parent index
+	/// </summary>
+	std::vector<Node> m_nodes;
+
+	/// <summary>
+	/// The fat AABBs of all nodes in structure of arrays layout, indexed like m_nodes
+	/// Kept in sync with Node::fatAABB through setFatAABB, packet traversals only read these.
+	/// </summary>
+	AABBArray m_fatBounds;
+
+	/// <summary>
+	/// The root node
+	/// </summary>
+	int m_root = NULL_NODE;
+
+	/// <summary>
+	/// Head of the free list
+	/// </summary>
+	int m_freeList = NULL_NODE;
+
+	/// <summary>
+	/// Number of leaves
+	/// </summary>
+	size_t m_leafCount = 0;
+
+	int allocateNode();
+	void freeNode(int node);
+	void setFatAABB(int node, const AABB& aabb);
+	void insertLeaf(int leaf);
+	void removeLeaf(int leaf);
+	int balance(int node);
+	void refitUpwards(int node);
+	int buildRecursive(std::vector<int>& leaves, size_t begin, size_t end, int parent);
+
+	/// <summary>
+	/// Surface area of an AABB, the cost metric of the SAH
+	/// </summary>
+	/// <param name="aabb"></param>
+	/// <returns></returns>
+	static float surfaceArea(const AABB& aabb) {
+		glm::vec3 extents = aabb.max - aabb.min;
+		return 2.0f * (extents.x * extents.y + extents.y * extents.z + extents.z * extents.x);
+	}
+
+	/// <summary>
+	/// Slab test of a ray against an AABB
+	/// </summary>
+	/// <param name="origin"></param>
+	/// <param name="invDirection"></param>
+	/// <param name="aabb"></param>
+	/// <param name="maxDistance"></param>
+	/// <param name="entry">Distance at which the ray enters the AABB, 0 if it starts inside</param>
+	/// <returns></returns>
+	static bool intersectRay(const glm::vec3& origin, const glm::vec3& invDirection, const AABB& aabb, float maxDistance, float& entry) {
+		glm::vec3 t0 = (aabb.min - origin) * invDirection;
+		glm::vec3 t1 = (aabb.max - origin) * invDirection;
+		glm::vec3 tNear = glm::min(t0, t1);
+		glm::vec3 tFar = glm::max(t0, t1);
+		entry = glm::max(glm::max(tNear.x, tNear.y), glm::max(tNear.z, 0.0f));
+		float exit = glm::min(glm::min(tFar.x, tFar.y), glm::min(tFar.z, maxDistance));
+		return entry <= exit;
+	}
+
+	/// <summary>
+	/// Visits all leaves whose fat AABB passes the overlap test
+	/// </summary>
+	template<typename Test, typename Fn>
+	void query(Test&& test, Fn& callback) const {
+		if (m_root == NULL_NODE) {
+			return;
+		}
+
+		int stack[STACK_SIZE];
+		int count = 0;
+		stack[count++] = m_root;
+		while (count > 0) {
+			const Node& node = m_nodes[stack[--count]];
+			if (!test(node.fatAABB)) {
+				continue;
+			}
+			if (node.isLeaf()) {
+				if (!callback(node.userData, node.aabb)) {
+					return;
+				}
+				continue;
+			}
+			if (count + 2 > STACK_SIZE) {
+				throw std::runtime_error("failed to query bvh: traversal stack overflow!");
+			}
+			stack[count++] = node.children[0];
+			stack[count++] = node.children[1];
+		}
+	}
+};
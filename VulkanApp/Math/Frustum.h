@@ -21,6 +21,15 @@ struct FrustumPoints
 	glm::vec3 farBottomRight;
 };
 
+/// <summary>
+/// Result of testing a volume against the frustum
+/// </summary>
+enum class FrustumTestResult {
+	FRUSTUM_TEST_OUTSIDE,		// The volume is completely outside the frustum
+	FRUSTUM_TEST_INTERSECTS,	// The volume is partly inside the frustum
+	FRUSTUM_TEST_INSIDE			// The volume is completely inside the frustum
+};
+
 /// <summary>
 /// Frustum class representing a view frustum defined by six planes
 /// </summary>
@@ -125,6 +134,39 @@ public:
 		return true;
 	}
 
+	/// <summary>
+	/// Classifies the AABB as outside, intersecting or inside of the frustum
+	/// Like intersectsAABB this is conservative, boxes near a frustum corner may be reported as intersecting.
+	/// </summary>
+	/// <param name="aabb"></param>
+	/// <returns></returns>
+	FrustumTestResult classifyAABB(const AABB& aabb) const {
+		return classifyAABB(aabb, this->planes);
+	}
+
+	static FrustumTestResult classifyAABB(const AABB& aabb, const std::array<Plane, 6>& planes) {
+		FrustumTestResult result = FrustumTestResult::FRUSTUM_TEST_INSIDE;
+		for (const auto& plane : planes) {
+			// The p-vertex decides if the box is outside, the n-vertex if it is completely inside
+			glm::vec3 p;
+			p.x = (plane.normal.x >= 0.0f) ? aabb.max.x : aabb.min.x;
+			p.y = (plane.normal.y >= 0.0f) ? aabb.max.y : aabb.min.y;
+			p.z = (plane.normal.z >= 0.0f) ? aabb.max.z : aabb.min.z;
+			if (plane.distance(p) < 0.0f) {
+				return FrustumTestResult::FRUSTUM_TEST_OUTSIDE;
+			}
+
+			glm::vec3 n;
+			n.x = (plane.normal.x >= 0.0f) ? aabb.min.x : aabb.max.x;
+			n.y = (plane.normal.y >= 0.0f) ? aabb.min.y : aabb.max.y;
+			n.z = (plane.normal.z >= 0.0f) ? aabb.min.z : aabb.max.z;
+			if (plane.distance(n) < 0.0f) {
+				result = FrustumTestResult::FRUSTUM_TEST_INTERSECTS;
+			}
+		}
+		return result;
+	}
+
 	/// <summary>
 	/// Checks if the frustum contains the given point
 	/// </summary>
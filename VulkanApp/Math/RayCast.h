@@ -21,6 +21,9 @@ struct RayHit
 	glm::vec3 position;
 	float distance;
 	void* hitobject;
+	glm::vec3 normal;		// Only set by triangle accurate hits
+	int meshIndex = -1;		// Mesh of the hit triangle, -1 for AABB hits
+	int triangleIndex = -1;	// Triangle within the mesh, -1 for AABB hits
 };
 
 /// <summary>
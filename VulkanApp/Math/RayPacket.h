@@ -0,0 +1,189 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "AABB.h"
+#include "RayCast.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define GFX_RAY_PACKET_AVX2
+#elif defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#define GFX_RAY_PACKET_SSE
+#endif
+
+/// <summary>
+/// Number of rays in a packet, matches the SIMD width (8 with AVX2, 4 with SSE)
+/// </summary>
+#if defined(GFX_RAY_PACKET_AVX2)
+constexpr int RAY_PACKET_SIZE = 8;
+#else
+constexpr int RAY_PACKET_SIZE = 4;
+#endif
+
+/// <summary>
+/// Axis-aligned bounding boxes in structure of arrays layout
+/// Packet traversals stream the six bounds of a box from here instead of loading whole tree nodes.
+/// </summary>
+struct AABBArray
+{
+	std::vector<float> minX;
+	std::vector<float> minY;
+	std::vector<float> minZ;
+	std::vector<float> maxX;
+	std::vector<float> maxY;
+	std::vector<float> maxZ;
+
+	void resize(size_t size) {
+		for (std::vector<float>* bounds : { &minX, &minY, &minZ, &maxX, &maxY, &maxZ }) {
+			bounds->resize(size, 0.0f);
+		}
+	}
+
+	void clear() {
+		this->resize(0);
+	}
+
+	void set(size_t index, const AABB& aabb) {
+		minX[index] = aabb.min.x;
+		minY[index] = aabb.min.y;
+		minZ[index] = aabb.min.z;
+		maxX[index] = aabb.max.x;
+		maxY[index] = aabb.max.y;
+		maxZ[index] = aabb.max.z;
+	}
+};
+
+/// <summary>
+/// A packet of rays in structure of arrays layout
+/// The inverse directions are computed once when the packet is loaded, so the slab tests
+/// against the BVH nodes only multiply. One slab test checks one AABB against all rays of
+/// the packet at once.
+/// </summary>
+struct RayPacket
+{
+	alignas(32) float originX[RAY_PACKET_SIZE];
+	alignas(32) float originY[RAY_PACKET_SIZE];
+	alignas(32) float originZ[RAY_PACKET_SIZE];
+	alignas(32) float directionX[RAY_PACKET_SIZE];
+	alignas(32) float directionY[RAY_PACKET_SIZE];
+	alignas(32) float directionZ[RAY_PACKET_SIZE];
+	alignas(32) float invDirectionX[RAY_PACKET_SIZE];
+	alignas(32) float invDirectionY[RAY_PACKET_SIZE];
+	alignas(32) float invDirectionZ[RAY_PACKET_SIZE];
+
+	/// <summary>
+	/// The max distance of each ray, shrinks as the rays hit something
+	/// </summary>
+	alignas(32) float maxDistance[RAY_PACKET_SIZE];
+
+	/// <summary>
+	/// Bit mask of the lanes that still traverse, bit i is ray i
+	/// </summary>
+	uint32_t activeMask = 0;
+
+	/// <summary>
+	/// Loads up to RAY_PACKET_SIZE rays, unused lanes stay inactive
+	/// </summary>
+	/// <param name="rays"></param>
+	/// <param name="count"></param>
+	/// <param name="distance">Initial max distance of all rays</param>
+	void load(const Ray* rays, size_t count, float distance) {
+		activeMask = 0;
+		for (int i = 0; i < RAY_PACKET_SIZE; i++) {
+			// Inactive lanes get a degenerate ray that can't hit anything
+			bool used = i < static_cast<int>(count);
+			glm::vec3 origin = used ? rays[i].origin : glm::vec3(0.0f);
+			glm::vec3 direction = used ? rays[i].direction : glm::vec3(1.0f);
+			glm::vec3 invDirection = 1.0f / direction;
+			originX[i] = origin.x;
+			originY[i] = origin.y;
+			originZ[i] = origin.z;
+			directionX[i] = direction.x;
+			directionY[i] = direction.y;
+			directionZ[i] = direction.z;
+			invDirectionX[i] = invDirection.x;
+			invDirectionY[i] = invDirection.y;
+			invDirectionZ[i] = invDirection.z;
+			maxDistance[i] = used ? distance : -1.0f;
+			if (used) {
+				activeMask |= 1u << i;
+			}
+		}
+	}
+
+	/// <summary>
+	/// Slab test of all rays against one AABB of an AABB array
+	/// </summary>
+	/// <param name="boxes"></param>
+	/// <param name="index"></param>
+	/// <returns>Bit mask of the rays that hit the AABB within their max distance</returns>
+	uint32_t intersect(const AABBArray& boxes, size_t index) const {
+#if defined(GFX_RAY_PACKET_AVX2)
+		__m256 t0, t1;
+		t0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(boxes.minX[index]), _mm256_load_ps(originX)), _mm256_load_ps(invDirectionX));
+		t1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(boxes.maxX[index]), _mm256_load_ps(originX)), _mm256_load_ps(invDirectionX));
+		__m256 entry = _mm256_max_ps(_mm256_min_ps(t0, t1), _mm256_setzero_ps());
+		__m256 exit = _mm256_min_ps(_mm256_max_ps(t0, t1), _mm256_load_ps(maxDistance));
+
+		t0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(boxes.minY[index]), _mm256_load_ps(originY)), _mm256_load_ps(invDirectionY));
+		t1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(boxes.maxY[index]), _mm256_load_ps(originY)), _mm256_load_ps(invDirectionY));
+		entry = _mm256_max_ps(_mm256_min_ps(t0, t1), entry);
+		exit = _mm256_min_ps(_mm256_max_ps(t0, t1), exit);
+
+		t0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(boxes.minZ[index]), _mm256_load_ps(originZ)), _mm256_load_ps(invDirectionZ));
+		t1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(boxes.maxZ[index]), _mm256_load_ps(originZ)), _mm256_load_ps(invDirectionZ));
+		entry = _mm256_max_ps(_mm256_min_ps(t0, t1), entry);
+		exit = _mm256_min_ps(_mm256_max_ps(t0, t1), exit);
+
+		return static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(entry, exit, _CMP_LE_OQ))) & activeMask;
+#elif defined(GFX_RAY_PACKET_SSE)
+		__m128 t0, t1;
+		t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boxes.minX[index]), _mm_load_ps(originX)), _mm_load_ps(invDirectionX));
+		t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boxes.maxX[index]), _mm_load_ps(originX)), _mm_load_ps(invDirectionX));
+		__m128 entry = _mm_max_ps(_mm_min_ps(t0, t1), _mm_setzero_ps());
+		__m128 exit = _mm_min_ps(_mm_max_ps(t0, t1), _mm_load_ps(maxDistance));
+
+		t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boxes.minY[index]), _mm_load_ps(originY)), _mm_load_ps(invDirectionY));
+		t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boxes.maxY[index]), _mm_load_ps(originY)), _mm_load_ps(invDirectionY));
+		entry = _mm_max_ps(_mm_min_ps(t0, t1), entry);
+		exit = _mm_min_ps(_mm_max_ps(t0, t1), exit);
+
+		t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boxes.minZ[index]), _mm_load_ps(originZ)), _mm_load_ps(invDirectionZ));
+		t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boxes.maxZ[index]), _mm_load_ps(originZ)), _mm_load_ps(invDirectionZ));
+		entry = _mm_max_ps(_mm_min_ps(t0, t1), entry);
+		exit = _mm_min_ps(_mm_max_ps(t0, t1), exit);
+
+		return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(entry, exit))) & activeMask;
+#else
+		uint32_t mask = 0;
+		for (int i = 0; i < RAY_PACKET_SIZE; i++) {
+			glm::vec3 origin(originX[i], originY[i], originZ[i]);
+			glm::vec3 invDirection(invDirectionX[i], invDirectionY[i], invDirectionZ[i]);
+			glm::vec3 min(boxes.minX[index], boxes.minY[index], boxes.minZ[index]);
+			glm::vec3 max(boxes.maxX[index], boxes.maxY[index], boxes.maxZ[index]);
+			glm::vec3 t0 = (min - origin) * invDirection;
+			glm::vec3 t1 = (max - origin) * invDirection;
+			glm::vec3 tNear = glm::min(t0, t1);
+			glm::vec3 tFar = glm::max(t0, t1);
+			float entry = glm::max(glm::max(tNear.x, tNear.y), glm::max(tNear.z, 0.0f));
+			float exit = glm::min(glm::min(tFar.x, tFar.y), glm::min(tFar.z, maxDistance[i]));
+			if (entry <= exit) {
+				mask |= 1u << i;
+			}
+		}
+		return mask & activeMask;
+#endif
+	}
+
+	/// <summary>
+	/// Gets the ray of a lane
+	/// </summary>
+	/// <param name="lane"></param>
+	/// <returns></returns>
+	Ray getRay(int lane) const {
+		return { glm::vec3(originX[lane], originY[lane], originZ[lane]), glm::vec3(directionX[lane], directionY[lane], directionZ[lane]) };
+	}
+};
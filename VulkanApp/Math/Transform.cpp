@@ -2,7 +2,7 @@
 
 void Transform::towards(glm::vec3 target)
 {
-	glm::vec3 direction = glm::normalize(target - position);
+	glm::vec3 direction = glm::normalize(target - m_position);
 	glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
 
 	// Check for gimbal lock
@@ -10,5 +10,6 @@ void Transform::towards(glm::vec3 target)
 		up = glm::vec3(1.0f, 0.0f, 0.0f);
 	}
 
-	rotation = glm::quatLookAt(direction, up);
+	m_rotation = glm::quatLookAt(direction, up);
+	m_version++;
 }
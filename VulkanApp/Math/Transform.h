@@ -3,27 +3,69 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtx/quaternion.hpp>
+#include <cstdint>
 
 /// <summary>
 /// Transform class for position, rotation, and scale
+/// All mutations go through the setters and bump the version, so caches built from
+/// the transform can detect changes by comparing versions.
 /// </summary>
 class Transform
 {
-public:
-	glm::vec3 position;
-	glm::quat rotation;
-	glm::vec3 scale;
+private:
+	glm::vec3 m_position;
+	glm::quat m_rotation;
+	glm::vec3 m_scale;
+
+	/// <summary>
+	/// Incremented on every mutation
+	/// </summary>
+	uint32_t m_version = 0;
 
-	Transform()	: position(0.0f, 0.0f, 0.0f), rotation(glm::quat(1.0f, 0.0f, 0.0f, 0.0f)), scale(1.0f, 1.0f, 1.0f)
+public:
+	Transform()	: m_position(0.0f, 0.0f, 0.0f), m_rotation(glm::quat(1.0f, 0.0f, 0.0f, 0.0f)), m_scale(1.0f, 1.0f, 1.0f)
 	{
 	};
 
+	/// <summary>
+	/// Gets the position of the transform
+	/// </summary>
+	/// <returns></returns>
+	const glm::vec3& getPosition() const {
+		return m_position;
+	}
+
+	/// <summary>
+	/// Gets the rotation of the transform
+	/// </summary>
+	/// <returns></returns>
+	const glm::quat& getRotation() const {
+		return m_rotation;
+	}
+
+	/// <summary>
+	/// Gets the scale of the transform
+	/// </summary>
+	/// <returns></returns>
+	const glm::vec3& getScale() const {
+		return m_scale;
+	}
+
+	/// <summary>
+	/// Gets the version of the transform, changes whenever the transform is modified
+	/// </summary>
+	/// <returns></returns>
+	uint32_t getVersion() const {
+		return m_version;
+	}
+
 	/// <summary>
 	/// Sets the position of the transform
 	/// </summary>
 	/// <param name="pos"></param>
 	void setPosition(const glm::vec3& pos) {
-		position = pos;
+		m_position = pos;
+		m_version++;
 	}
 
 	/// <summary>
@@ -31,7 +73,8 @@ public:
 	/// </summary>
 	/// <param name="rot"></param>
 	void setRotation(const glm::quat& rot) {
-		rotation = rot;
+		m_rotation = rot;
+		m_version++;
 	}
 
 	/// <summary>
@@ -39,7 +82,8 @@ public:
 	/// </summary>
 	/// <param name="scl"></param>
 	void setScale(const glm::vec3& scl) {
-		scale = scl;
+		m_scale = scl;
+		m_version++;
 	}
 
 	/// <summary>
@@ -47,7 +91,8 @@ public:
 	/// </summary>
 	/// <param name="delta"></param>
 	void translate(const glm::vec3& delta) {
-		position += delta;
+		m_position += delta;
+		m_version++;
 	}
 
 	/// <summary>
@@ -55,7 +100,8 @@ public:
 	/// </summary>
 	/// <param name="delta"></param>
 	void rotate(const glm::quat& delta) {
-		rotation = delta * rotation;
+		m_rotation = delta * m_rotation;
+		m_version++;
 	}
 
 	/// <summary>
@@ -64,7 +110,8 @@ public:
 	/// <param name="eulerAngles"></param>
 	void rotate(glm::vec3 eulerAngles) {
 		glm::quat delta = glm::quat(glm::radians(eulerAngles));
-		rotation = delta * rotation;
+		m_rotation = delta * m_rotation;
+		m_version++;
 	}
 
 	/// <summary>
@@ -75,7 +122,8 @@ public:
 	/// <param name="roll"></param>
 	void rotate(float pitch, float yaw, float roll) {
 		glm::quat delta = glm::quat(glm::radians(glm::vec3(pitch, yaw, roll)));
-		rotation = delta * rotation;
+		m_rotation = delta * m_rotation;
+		m_version++;
 	}
 
 	/// <summary>
@@ -83,7 +131,8 @@ public:
 	/// </summary>
 	/// <param name="factor"></param>
 	void scaleBy(const glm::vec3& factor) {
-		scale *= factor;
+		m_scale *= factor;
+		m_version++;
 	}
 
 	/// <summary>
@@ -91,7 +140,7 @@ public:
 	/// </summary>
 	/// <returns></returns>
 	glm::vec3 getForward() const {
-		return rotation * glm::vec3(0.0f, 0.0f, -1.0f);
+		return m_rotation * glm::vec3(0.0f, 0.0f, -1.0f);
 	}
 
 	/// <summary>
@@ -99,7 +148,7 @@ public:
 	/// </summary>
 	/// <returns></returns>
 	glm::vec3 getUp() const {
-		return rotation * glm::vec3(0.0f, 1.0f, 0.0f);
+		return m_rotation * glm::vec3(0.0f, 1.0f, 0.0f);
 	}
 
 	/// <summary>
@@ -107,7 +156,7 @@ public:
 	/// </summary>
 	/// <returns></returns>
 	glm::vec3 getRight() const {
-		return rotation * glm::vec3(1.0f, 0.0f, 0.0f);
+		return m_rotation * glm::vec3(1.0f, 0.0f, 0.0f);
 	}
 
 	/// <summary>
@@ -115,9 +164,9 @@ public:
 	/// </summary>
 	/// <returns></returns>
 	glm::mat4 getMatrix() const {
-		glm::mat4 translationMat = glm::translate(glm::mat4(1.0f), position);
-		glm::mat4 rotationMat = glm::toMat4(rotation);
-		glm::mat4 scaleMat = glm::scale(glm::mat4(1.0f), scale);
+		glm::mat4 translationMat = glm::translate(glm::mat4(1.0f), m_position);
+		glm::mat4 rotationMat = glm::toMat4(m_rotation);
+		glm::mat4 scaleMat = glm::scale(glm::mat4(1.0f), m_scale);
 		return translationMat * rotationMat * scaleMat;
 	}
 	
@@ -0,0 +1,271 @@
+#include "TriangleBVH.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <stdexcept>
+
+void TriangleBVH::addMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, uint32_t meshIndex)
+{
+	m_triangles.reserve(m_triangles.size() + indices.size() / 3);
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		if (indices[i] >= vertices.size() || indices[i + 1] >= vertices.size() || indices[i + 2] >= vertices.size()) {
+			throw std::runtime_error("failed to add mesh to triangle bvh: index out of range!");
+		}
+		Triangle triangle;
+		triangle.v0 = vertices[indices[i]].pos;
+		triangle.v1 = vertices[indices[i + 1]].pos;
+		triangle.v2 = vertices[indices[i + 2]].pos;
+		triangle.meshIndex = meshIndex;
+		triangle.triangleIndex = static_cast<uint32_t>(i / 3);
+		m_triangles.push_back(triangle);
+	}
+}
+
+void TriangleBVH::build()
+{
+	m_nodes.clear();
+	if (m_triangles.empty()) {
+		return;
+	}
+
+	std::vector<glm::vec3> centroids(m_triangles.size());
+	for (size_t i = 0; i < m_triangles.size(); i++) {
+		centroids[i] = (m_triangles[i].v0 + m_triangles[i].v1 + m_triangles[i].v2) * (1.0f / 3.0f);
+	}
+
+	// A binary tree with one triangle per leaf has at most 2n - 1 nodes
+	m_nodes.reserve(m_triangles.size() * 2);
+	Node root;
+	root.first = 0;
+	root.count = static_cast<uint32_t>(m_triangles.size());
+	m_nodes.push_back(root);
+	this->subdivide(0, centroids, 0);
+	m_nodes.shrink_to_fit();
+}
+
+void TriangleBVH::subdivide(uint32_t index, std::vector<glm::vec3>& centroids, int depth)
+{
+	// The centroids are reordered together with the triangles
+	uint32_t first = m_nodes[index].first;
+	uint32_t count = m_nodes[index].count;
+
+	AABB bounds;
+	AABB centroidBounds;
+	for (uint32_t i = first; i < first + count; i++) {
+		bounds.expand(m_triangles[i].v0);
+		bounds.expand(m_triangles[i].v1);
+		bounds.expand(m_triangles[i].v2);
+		centroidBounds.expand(centroids[i]);
+	}
+	m_nodes[index].bounds = bounds;
+
+	if (count <= MAX_LEAF_TRIANGLES) {
+		return;
+	}
+
+	glm::vec3 extents = centroidBounds.max - centroidBounds.min;
+	int axis = 0;
+	if (extents.y > extents[axis]) axis = 1;
+	if (extents.z > extents[axis]) axis = 2;
+
+	auto swapTriangles = [&](uint32_t a, uint32_t b) {
+		std::swap(m_triangles[a], m_triangles[b]);
+		std::swap(centroids[a], centroids[b]);
+	};
+
+	uint32_t split = first;
+	if (extents[axis] > 0.0f && depth < MAX_SAH_DEPTH) {
+		// Bin the centroids along the longest axis and pick the split with the lowest SAH cost
+		constexpr int BIN_COUNT = 12;
+		AABB binBounds[BIN_COUNT];
+		uint32_t binCounts[BIN_COUNT] = {};
+		float scale = BIN_COUNT / extents[axis];
+		auto binOf = [&](uint32_t triangle) {
+			float offset = (centroids[triangle][axis] - centroidBounds.min[axis]) * scale;
+			return std::min(static_cast<int>(offset), BIN_COUNT - 1);
+		};
+		for (uint32_t i = first; i < first + count; i++) {
+			int bin = binOf(i);
+			binCounts[bin]++;
+			binBounds[bin].expand(m_triangles[i].v0);
+			binBounds[bin].expand(m_triangles[i].v1);
+			binBounds[bin].expand(m_triangles[i].v2);
+		}
+
+		// Sweep from the right to get the cost of each right side
+		float rightCosts[BIN_COUNT] = {};
+		AABB rightBounds;
+		uint32_t rightCount = 0;
+		for (int i = BIN_COUNT - 1; i > 0; i--) {
+			rightBounds.expand(binBounds[i]);
+			rightCount += binCounts[i];
+			rightCosts[i] = rightCount > 0 ? surfaceArea(rightBounds) * rightCount : 0.0f;
+		}
+
+		float bestCost = FLT_MAX;
+		int bestBin = -1;
+		AABB leftBounds;
+		uint32_t leftCount = 0;
+		for (int i = 0; i < BIN_COUNT - 1; i++) {
+			leftBounds.expand(binBounds[i]);
+			leftCount += binCounts[i];
+			if (leftCount == 0 || leftCount == count) {
+				continue;
+			}
+			float cost = surfaceArea(leftBounds) * leftCount + rightCosts[i + 1];
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestBin = i;
+			}
+		}
+
+		if (bestBin >= 0) {
+			uint32_t left = first;
+			uint32_t right = first + count;
+			while (left < right) {
+				if (binOf(left) <= bestBin) {
+					left++;
+				}
+				else {
+					swapTriangles(left, --right);
+				}
+			}
+			split = left;
+		}
+	}
+
+	// All centroids in one spot, too deep or all in one bin, split by count
+	if (split == first || split == first + count) {
+		split = first + count / 2;
+		std::vector<uint32_t> order(count);
+		for (uint32_t i = 0; i < count; i++) {
+			order[i] = first + i;
+		}
+		std::nth_element(order.begin(), order.begin() + count / 2, order.end(), [&](uint32_t a, uint32_t b) {
+			return centroids[a][axis] < centroids[b][axis];
+		});
+		std::vector<Triangle> triangles(count);
+		std::vector<glm::vec3> sortedCentroids(count);
+		for (uint32_t i = 0; i < count; i++) {
+			triangles[i] = m_triangles[order[i]];
+			sortedCentroids[i] = centroids[order[i]];
+		}
+		std::copy(triangles.begin(), triangles.end(), m_triangles.begin() + first);
+		std::copy(sortedCentroids.begin(), sortedCentroids.end(), centroids.begin() + first);
+	}
+
+	// Children are stored next to each other
+	uint32_t child = static_cast<uint32_t>(m_nodes.size());
+	m_nodes.emplace_back();
+	m_nodes.emplace_back();
+	m_nodes[child].first = first;
+	m_nodes[child].count = split - first;
+	m_nodes[child + 1].first = split;
+	m_nodes[child + 1].count = first + count - split;
+	m_nodes[index].first = child;
+	m_nodes[index].count = 0;
+
+	this->subdivide(child, centroids, depth + 1);
+	this->subdivide(child + 1, centroids, depth + 1);
+}
+
+bool TriangleBVH::raycast(const Ray& ray, float maxDistance, TriangleHit& hit) const
+{
+	if (m_nodes.empty()) {
+		return false;
+	}
+
+	const glm::vec3 invDirection = 1.0f / ray.direction;
+	struct StackEntry { uint32_t node; float entry; };
+	StackEntry stack[STACK_SIZE];
+	int count = 0;
+	const Triangle* closest = nullptr;
+
+	float entry;
+	if (!intersectRay(ray.origin, invDirection, m_nodes[0].bounds, maxDistance, entry)) {
+		return false;
+	}
+	stack[count++] = { 0, entry };
+
+	while (count > 0) {
+		StackEntry current = stack[--count];
+		if (current.entry > maxDistance) {
+			continue;
+		}
+
+		const Node& node = m_nodes[current.node];
+		if (node.count > 0) {
+			for (uint32_t i = node.first; i < node.first + node.count; i++) {
+				float distance;
+				if (intersectTriangle(ray, m_triangles[i], distance) && distance < maxDistance) {
+					maxDistance = distance;
+					closest = &m_triangles[i];
+				}
+			}
+			continue;
+		}
+
+		// Push the far child first so the near child is visited first
+		float entry0, entry1;
+		bool hit0 = intersectRay(ray.origin, invDirection, m_nodes[node.first].bounds, maxDistance, entry0);
+		bool hit1 = intersectRay(ray.origin, invDirection, m_nodes[node.first + 1].bounds, maxDistance, entry1);
+		if (count + 2 > STACK_SIZE) {
+			throw std::runtime_error("failed to raycast triangle bvh: traversal stack overflow!");
+		}
+		if (hit0 && hit1) {
+			if (entry0 <= entry1) {
+				stack[count++] = { node.first + 1, entry1 };
+				stack[count++] = { node.first, entry0 };
+			}
+			else {
+				stack[count++] = { node.first, entry0 };
+				stack[count++] = { node.first + 1, entry1 };
+			}
+		}
+		else if (hit0) {
+			stack[count++] = { node.first, entry0 };
+		}
+		else if (hit1) {
+			stack[count++] = { node.first + 1, entry1 };
+		}
+	}
+
+	if (closest == nullptr) {
+		return false;
+	}
+
+	glm::vec3 normal = glm::normalize(glm::cross(closest->v1 - closest->v0, closest->v2 - closest->v0));
+	hit.distance = maxDistance;
+	hit.normal = glm::dot(normal, ray.direction) > 0.0f ? -normal : normal;
+	hit.meshIndex = closest->meshIndex;
+	hit.triangleIndex = closest->triangleIndex;
+	return true;
+}
+
+bool TriangleBVH::intersectTriangle(const Ray& ray, const Triangle& triangle, float& distance)
+{
+	constexpr float EPSILON = 1e-12f;
+	glm::vec3 edge1 = triangle.v1 - triangle.v0;
+	glm::vec3 edge2 = triangle.v2 - triangle.v0;
+	glm::vec3 p = glm::cross(ray.direction, edge2);
+	float determinant = glm::dot(edge1, p);
+	if (std::abs(determinant) < EPSILON) {
+		return false;
+	}
+
+	float invDeterminant = 1.0f / determinant;
+	glm::vec3 s = ray.origin - triangle.v0;
+	float u = glm::dot(s, p) * invDeterminant;
+	if (u < 0.0f || u > 1.0f) {
+		return false;
+	}
+
+	glm::vec3 q = glm::cross(s, edge1);
+	float v = glm::dot(ray.direction, q) * invDeterminant;
+	if (v < 0.0f || u + v > 1.0f) {
+		return false;
+	}
+
+	distance = glm::dot(edge2, q) * invDeterminant;
+	return distance >= 0.0f;
+}
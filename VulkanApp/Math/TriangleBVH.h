@@ -0,0 +1,150 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "AABB.h"
+#include "RayCast.h"
+#include "../Graphics/VertexBuffer.h"
+
+/// <summary>
+/// Closest triangle hit by a ray
+/// </summary>
+struct TriangleHit
+{
+	float distance;
+	glm::vec3 normal;		// Geometric normal facing the ray origin
+	uint32_t meshIndex;
+	uint32_t triangleIndex;	// Index of the triangle within its mesh
+};
+
+/// <summary>
+/// Static bounding volume hierarchy over the triangles of one or more meshes
+/// Built once top-down with a binned SAH, the triangles are copied into the tree so the
+/// source meshes can change or go away. Used for triangle accurate raycasts in model space.
+/// </summary>
+class TriangleBVH
+{
+public:
+	/// <summary>
+	/// Maximum number of triangles in a leaf
+	/// </summary>
+	static constexpr uint32_t MAX_LEAF_TRIANGLES = 4;
+
+	TriangleBVH() = default;
+	~TriangleBVH() = default;
+
+	/// <summary>
+	/// Adds the triangles of a mesh, call build afterwards
+	/// </summary>
+	/// <param name="vertices"></param>
+	/// <param name="indices"></param>
+	/// <param name="meshIndex">Reported by raycast for triangles of this mesh</param>
+	void addMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, uint32_t meshIndex);
+
+	/// <summary>
+	/// Builds the tree over all added triangles
+	/// </summary>
+	void build();
+
+	/// <summary>
+	/// Finds the closest triangle hit by the ray
+	/// The distance is measured in units of the ray direction, like RayCast::rayIntersectsAABB.
+	/// </summary>
+	/// <param name="ray"></param>
+	/// <param name="maxDistance"></param>
+	/// <param name="hit"></param>
+	/// <returns>True if a triangle closer than maxDistance was hit</returns>
+	bool raycast(const Ray& ray, float maxDistance, TriangleHit& hit) const;
+
+	/// <summary>
+	/// Returns the number of triangles in the tree
+	/// </summary>
+	/// <returns></returns>
+	size_t getTriangleCount() const {
+		return m_triangles.size();
+	}
+
+	/// <summary>
+	/// Returns the bounds of all triangles
+	/// </summary>
+	/// <returns></returns>
+	AABB getBounds() const {
+		return m_nodes.empty() ? AABB() : m_nodes[0].bounds;
+	}
+
+private:
+	/// <summary>
+	/// Maximum depth of the tree, deeper nodes are split by count
+	/// </summary>
+	static constexpr int MAX_SAH_DEPTH = 48;
+
+	/// <summary>
+	/// Size of the traversal stack, enough for MAX_SAH_DEPTH plus the count splits below it
+	/// </summary>
+	static constexpr int STACK_SIZE = 128;
+
+	/// <summary>
+	/// A triangle with the ids reported on a hit
+	/// </summary>
+	struct Triangle {
+		glm::vec3 v0;
+		glm::vec3 v1;
+		glm::vec3 v2;
+		uint32_t meshIndex;
+		uint32_t triangleIndex;
+	};
+
+	/// <summary>
+	/// A node of the tree
+	/// Inner nodes have a count of 0 and their children at first and first + 1,
+	/// leaves own the triangles [first, first + count).
+	/// </summary>
+	struct Node {
+		AABB bounds;
+		uint32_t first = 0;
+		uint32_t count = 0;
+	};
+
+	std::vector<Triangle> m_triangles;
+	std::vector<Node> m_nodes;
+
+	void subdivide(uint32_t node, std::vector<glm::vec3>& centroids, int depth);
+
+	/// <summary>
+	/// Surface area of an AABB, the cost metric of the SAH
+	/// </summary>
+	/// <param name="aabb"></param>
+	/// <returns></returns>
+	static float surfaceArea(const AABB& aabb) {
+		glm::vec3 extents = aabb.max - aabb.min;
+		return 2.0f * (extents.x * extents.y + extents.y * extents.z + extents.z * extents.x);
+	}
+
+	/// <summary>
+	/// Möller-Trumbore ray triangle intersection, both sides of the triangle are hit
+	/// </summary>
+	/// <param name="ray"></param>
+	/// <param name="triangle"></param>
+	/// <param name="distance"></param>
+	/// <returns></returns>
+	static bool intersectTriangle(const Ray& ray, const Triangle& triangle, float& distance);
+
+	/// <summary>
+	/// Slab test of a ray against an AABB
+	/// </summary>
+	/// <param name="origin"></param>
+	/// <param name="invDirection"></param>
+	/// <param name="aabb"></param>
+	/// <param name="maxDistance"></param>
+	/// <param name="entry">Distance at which the ray enters the AABB, 0 if it starts inside</param>
+	/// <returns></returns>
+	static bool intersectRay(const glm::vec3& origin, const glm::vec3& invDirection, const AABB& aabb, float maxDistance, float& entry) {
+		glm::vec3 t0 = (aabb.min - origin) * invDirection;
+		glm::vec3 t1 = (aabb.max - origin) * invDirection;
+		glm::vec3 tNear = glm::min(t0, t1);
+		glm::vec3 tFar = glm::max(t0, t1);
+		entry = glm::max(glm::max(tNear.x, tNear.y), glm::max(tNear.z, 0.0f));
+		float exit = glm::min(glm::min(tFar.x, tFar.y), glm::min(tFar.z, maxDistance));
+		return entry <= exit;
+	}
+};
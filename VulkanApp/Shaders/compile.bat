@@ -3,6 +3,9 @@ C:\VulkanSDK\1.4.328.0\Bin\glslangValidator.exe -V shader.frag -o frag.spv
 
 C:\VulkanSDK\1.4.328.0\Bin\glslangValidator.exe -V shader_2d.vert -o vert_2d.spv
 C:\VulkanSDK\1.4.328.0\Bin\glslangValidator.exe -V shader_2d.frag -o frag_2d.spv
+C:\VulkanSDK\1.4.328.0\Bin\glslangValidator.exe -V sprite_batch.vert -o sprite_batch_vert.spv
+C:\VulkanSDK\1.4.328.0\Bin\glslangValidator.exe -V sprite_batch.frag -o sprite_batch_frag.spv
+C:\VulkanSDK\1.4.328.0\Bin\glslangValidator.exe -V -DTEXTURE_ARRAY sprite_batch.frag -o sprite_batch_array_frag.spv
 
 C:\VulkanSDK\1.4.328.0\Bin\glslangValidator.exe -V skybox.vert -o skybox_vert.spv
 C:\VulkanSDK\1.4.328.0\Bin\glslangValidator.exe -V skybox.frag -o skybox_frag.spv
@@ -15,9 +18,12 @@ C:\VulkanSDK\1.4.328.0\Bin\glslangValidator.exe -V triangle.frag -o triangle_fra
 
 C:\VulkanSDK\1.4.328.0\Bin\glslangValidator.exe -V text.vert -o text_vert.spv
 C:\VulkanSDK\1.4.328.0\Bin\glslangValidator.exe -V text.frag -o text_frag.spv
+C:\VulkanSDK\1.4.328.0\Bin\glslangValidator.exe -V text_sdf.frag -o text_sdf_frag.spv
 
 C:\VulkanSDK\1.4.328.0\Bin\glslangValidator.exe -V shader3di.vert -o shader3di_vert.spv
 C:\VulkanSDK\1.4.328.0\Bin\glslangValidator.exe -V shader3di.frag -o shader3di_frag.spv
+C:\VulkanSDK\1.4.328.0\Bin\glslangValidator.exe -V shader_depth.vert -o shader_depth_vert.spv
+C:\VulkanSDK\1.4.328.0\Bin\glslangValidator.exe -V shader3di_depth.vert -o shader3di_depth_vert.spv
 
 C:\VulkanSDK\1.4.328.0\Bin\glslangValidator.exe -V shader_unlit3D.vert -o shader_unlit3D_vert.spv
 C:\VulkanSDK\1.4.328.0\Bin\glslangValidator.exe -V shader_unlit3D.frag -o shader_unlit3D_frag.spv
@@ -25,7 +31,12 @@ C:\VulkanSDK\1.4.328.0\Bin\glslangValidator.exe -V shader_unlit3D.frag -o shader
 C:\VulkanSDK\1.4.328.0\Bin\glslangValidator.exe -V shader_unlit3Di.vert -o shader_unlit3Di_vert.spv
 C:\VulkanSDK\1.4.328.0\Bin\glslangValidator.exe -V shader_unlit3Di.frag -o shader_unlit3Di_frag.spv
 
+C:\VulkanSDK\1.4.328.0\Bin\glslangValidator.exe -V cull.comp -o cull_comp.spv
+C:\VulkanSDK\1.4.328.0\Bin\glslangValidator.exe -V -DOCCLUSION cull.comp -o cull_occlusion_comp.spv
+C:\VulkanSDK\1.4.328.0\Bin\glslangValidator.exe -V depth_reduce.comp -o depth_reduce_comp.spv
+
 C:\VulkanSDK\1.4.328.0\Bin\glslangValidator.exe -V solid.vert -o solid_vert.spv
 C:\VulkanSDK\1.4.328.0\Bin\glslangValidator.exe -V solid.frag -o solid_frag.spv
+C:\VulkanSDK\1.4.328.0\Bin\glslangValidator.exe -V debug_draw.vert -o debug_draw_vert.spv
 
 pause
\ No newline at end of file
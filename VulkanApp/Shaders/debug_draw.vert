@@ -0,0 +1,18 @@
+#version 450
+layout(location = 0) in vec3 pos;
+
+// Per instance, matches UboModelColor
+layout(location = 1) in mat4 model;
+layout(location = 5) in vec4 instanceColor;
+
+layout(set = 0, binding = 0) uniform UboViewProjection {
+    mat4 projection;
+    mat4 view;
+} ubo;
+
+layout(location = 0) out vec4 color;
+
+void main() {
+    gl_Position = ubo.projection * ubo.view * model * vec4(pos, 1.0);
+    color = instanceColor;
+}
@@ -20,6 +20,9 @@ layout(location = 1) out vec2 fragTexCoord;
 layout(location = 2) out vec3 fragNormal;
 layout(location = 3) out vec3 fragWorldPos;
 
+// The depth pre-pass computes the same position, see shader_depth.vert
+invariant gl_Position;
+
 void main() {
     // Calculate world position
     vec4 worldPos = pushConstants.model * vec4(pos, 1.0);
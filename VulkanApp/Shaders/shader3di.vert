@@ -28,6 +28,9 @@ layout(location = 2) out vec3 fragNormal;
 layout(location = 3) out vec4 fragExtras;
 layout(location = 4) out vec3 fragWorldPos;
 
+// The depth pre-pass computes the same position, see shader3di_depth.vert
+invariant gl_Position;
+
 void main() {
     // Get current instance data
     InstanceData instance = instances[gl_InstanceIndex];
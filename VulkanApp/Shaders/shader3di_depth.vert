@@ -0,0 +1,35 @@
+#version 450
+
+// Position only variant of shader3di.vert for the depth pre-pass
+layout(location = 0) in vec3 pos;
+
+layout(set = 0, binding = 0) uniform UboViewProjection {
+    mat4 projection;
+    mat4 view;
+    vec3 cameraPos;
+} uboViewProjection;
+
+struct InstanceData {
+    mat4 model;
+    vec4 extras;  // x=visible, y=roughness, z=metallic, w=custom
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer InstanceBuffer {
+    InstanceData instances[];
+};
+
+// The shading pass tests for equal depth, so the position has to match shader3di.vert exactly
+invariant gl_Position;
+
+void main() {
+    InstanceData instance = instances[gl_InstanceIndex];
+
+    // Hidden instances are discarded by shader3di.frag, here they are moved behind the far plane
+    if (instance.extras.x < 0.5) {
+        gl_Position = vec4(0.0, 0.0, 2.0, 1.0);
+        return;
+    }
+
+    vec4 worldPos = instance.model * vec4(pos, 1.0);
+    gl_Position = uboViewProjection.projection * uboViewProjection.view * worldPos;
+}
@@ -0,0 +1,22 @@
+#version 450
+
+// Position only variant of shader.vert for the depth pre-pass
+layout(location = 0) in vec3 pos;
+
+layout(set = 0, binding = 0) uniform UboViewProjection {
+    mat4 projection;
+    mat4 view;
+    vec3 cameraPos;
+} uboViewProjection;
+
+layout(push_constant) uniform PushConstants {
+    mat4 model;
+} pushConstants;
+
+// The shading pass tests for equal depth, so the position has to match shader.vert exactly
+invariant gl_Position;
+
+void main() {
+    vec4 worldPos = pushConstants.model * vec4(pos, 1.0);
+    gl_Position = uboViewProjection.projection * uboViewProjection.view * worldPos;
+}
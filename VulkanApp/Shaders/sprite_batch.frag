@@ -0,0 +1,20 @@
+#version 450
+
+// Compiled with TEXTURE_ARRAY for sprites sampling a layer of a texture array
+layout(location = 0) out vec4 fragColor;
+layout(location = 0) in vec4 color;
+layout(location = 1) in vec3 fragTexCoord;
+
+#ifdef TEXTURE_ARRAY
+layout(set = 1, binding = 0) uniform sampler2DArray textureSampler;
+#else
+layout(set = 1, binding = 0) uniform sampler2D textureSampler;
+#endif
+
+void main() {
+#ifdef TEXTURE_ARRAY
+    fragColor = texture(textureSampler, fragTexCoord) * color;
+#else
+    fragColor = texture(textureSampler, fragTexCoord.xy) * color;
+#endif
+}
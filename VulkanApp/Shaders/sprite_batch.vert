@@ -0,0 +1,21 @@
+#version 450
+
+// Sprites of the sprite batch, the vertices are in world space already
+layout(location = 0) in vec3 pos;
+layout(location = 1) in vec4 vcolor;
+layout(location = 2) in vec2 texCoord;
+layout(location = 3) in float layer;
+
+layout(set = 0, binding = 0) uniform UboViewProjection {
+    mat4 projection;
+    mat4 view;
+} uboViewProjection;
+
+layout(location = 0) out vec4 color;
+layout(location = 1) out vec3 fragTexCoord;
+
+void main() {
+    gl_Position = uboViewProjection.projection * uboViewProjection.view * vec4(pos, 1.0);
+    color = vcolor;
+    fragTexCoord = vec3(texCoord, layer);
+}
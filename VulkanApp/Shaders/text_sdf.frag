@@ -0,0 +1,24 @@
+#version 450
+
+// Fragment Input
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
+
+// Fragment Output
+layout(location = 0) out vec4 outColor;
+
+// Distance field of the glyphs, 0.5 is the outline and larger values are inside
+layout(set = 1, binding = 0) uniform sampler2D textureSampler;
+
+void main() {
+    float distance = texture(textureSampler, fragTexCoord).r;
+
+    // Smooth the outline over about one screen pixel at any scale
+    float width = max(fwidth(distance), 0.0001);
+    float alpha = smoothstep(0.5 - width, 0.5 + width, distance);
+    outColor = vec4(fragColor, alpha);
+
+    if (alpha < 0.01) {
+        discard;
+    }
+}
@@ -9,6 +9,8 @@
 #include "stb_image.h"
 #include <chrono>
 #include <random>
+#include <thread>
+#include <functional>
 #include <array>
 #include "Graphics/Font.h"
 
@@ -119,7 +121,46 @@ static std::vector<uint8_t> createTextureData(int width, int height, const glm::
 	return data;
 }
 
-static TextMeasurement measureText(const std::string& text, Font* font, float scale, float lineSpacing) {
+/// <summary>
+/// Decodes the UTF-8 code point at offset and moves offset behind it
+/// Malformed sequences decode to U+FFFD and skip one byte.
+/// </summary>
+/// <param name="text"></param>
+/// <param name="offset"></param>
+/// <returns></returns>
+static uint32_t decodeUtf8(const std::string& text, size_t& offset) {
+	static constexpr uint32_t MIN_CODEPOINT[] = { 0, 0, 0x80, 0x800, 0x10000 };
+	unsigned char lead = static_cast<unsigned char>(text[offset]);
+	uint32_t length = lead < 0x80 ? 1 : (lead >> 5) == 0x6 ? 2 : (lead >> 4) == 0xE ? 3 : (lead >> 3) == 0x1E ? 4 : 0;
+	if (length == 1) {
+		offset++;
+		return lead;
+	}
+	if (length == 0 || offset + length > text.size()) {
+		offset++;
+		return 0xFFFD;
+	}
+
+	uint32_t codepoint = lead & (0xFF >> (length + 1));
+	for (uint32_t i = 1; i < length; i++) {
+		unsigned char next = static_cast<unsigned char>(text[offset + i]);
+		if ((next & 0xC0) != 0x80) {
+			offset++;
+			return 0xFFFD;
+		}
+		codepoint = (codepoint << 6) | (next & 0x3F);
+	}
+
+	// Overlong encodings, surrogates and values past the last code point
+	if (codepoint < MIN_CODEPOINT[length] || codepoint > 0x10FFFF || (codepoint >= 0xD800 && codepoint <= 0xDFFF)) {
+		offset++;
+		return 0xFFFD;
+	}
+	offset += length;
+	return codepoint;
+}
+
+static TextMeasurement measureText(const std::string& text, const Font* font, float scale, float lineSpacing) {
 
 	TextMeasurement result;
 	result.width = 0.0f;
@@ -134,8 +175,10 @@ static TextMeasurement measureText(const std::string& text, Font* font, float sc
 
 	float currentWidth = 0.0f;
 	const FontAtlas& atlas = font->getFontAtlas();
+	scale *= font->getMetricScale();
 
-	for (char c : text) {
+	for (size_t offset = 0; offset < text.size();) {
+		uint32_t c = decodeUtf8(text, offset);
 		if (c == '\n') {
 			if (currentWidth > result.width) {
 				result.width = currentWidth;
@@ -144,8 +187,9 @@ static TextMeasurement measureText(const std::string& text, Font* font, float sc
 			result.lines++;
 		}
 		else {
-			if (atlas.characters.find(c) == atlas.characters.end()) continue;
-			const Character& ch = atlas.characters.at(c);
+			const Character* character = atlas.findCharacter(c);
+			if (character == nullptr) continue;
+			const Character& ch = *character;
 			currentWidth += ch.advance * scale;
 			float h = ch.height * scale;
 			if (h > result.lineHeight) {
@@ -429,6 +473,33 @@ static void copyBufferToImageCubemap(VkDevice device, VkQueue queue, VkCommandPo
 	submitCommandBuffer(device, pool, queue, commandBuffer);
 }
 
+static void copyBufferToImageLayered(VkDevice device, VkQueue queue, VkCommandPool pool, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount) {
+	VkCommandBuffer commandBuffer = beginCommandBuffer(device, pool);
+	std::vector<VkBufferImageCopy> copyRegions(layerCount);
+	VkDeviceSize layerSize = static_cast<VkDeviceSize>(width) * height * 4; // Assuming 4 bytes per pixel (e.g., VK_FORMAT_R8G8B8A8_UNORM)
+	for (uint32_t layer = 0; layer < layerCount; layer++) {
+		copyRegions[layer].bufferOffset = layer * layerSize;
+		copyRegions[layer].bufferRowLength = 0;
+		copyRegions[layer].bufferImageHeight = 0;
+		copyRegions[layer].imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		copyRegions[layer].imageSubresource.mipLevel = 0;
+		copyRegions[layer].imageSubresource.baseArrayLayer = layer;
+		copyRegions[layer].imageSubresource.layerCount = 1;
+		copyRegions[layer].imageOffset = { 0, 0, 0 };
+		copyRegions[layer].imageExtent = { width, height, 1 };
+	}
+
+	vkCmdCopyBufferToImage(
+		commandBuffer,
+		buffer,
+		image,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		static_cast<uint32_t>(copyRegions.size()),
+		copyRegions.data()
+	);
+	submitCommandBuffer(device, pool, queue, commandBuffer);
+}
+
 static void copyBuffer(VkDevice device, VkQueue transferQueue, VkCommandPool transferCommandPool, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize bufferSize) {
 	//1 . Create a command buffer for the copy operation
 	VkCommandBuffer transferCommandBuffer = beginCommandBuffer(device, transferCommandPool);
@@ -575,8 +646,9 @@ static stbi_uc* loadTextureFile(std::string fileName, int* width, int* height)
 
 static std::string generateUUID()
 {
-	int seed = std::chrono::steady_clock::now().time_since_epoch().count();
-	static std::mt19937 rng(seed);
+	// One generator per thread, entities may be created by chunk loaders on worker threads
+	static thread_local std::mt19937 rng(static_cast<unsigned int>(std::chrono::steady_clock::now().time_since_epoch().count() ^
+		std::hash<std::thread::id>()(std::this_thread::get_id())));
 	std::uniform_int_distribution<int> dist(0, 61);
 
 	const char charset[] =